@@ -737,6 +737,36 @@ bool BVHAccel::IntersectP(const Ray &ray) const {
     return false;
 }
 
+void BVHAccel::IntersectProbe(const Ray &ray, const Material *material,
+                              ProbeReservoir *reservoir) const {
+    if (!nodes) return;
+    ProfilePhase p(Prof::AccelIntersect);
+    Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+    int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+    // Visit all BVH nodes overlapping the full probe segment; unlike
+    // _Intersect()_, _ray.tMax_ is never shortened
+    int toVisitOffset = 0, currentNodeIndex = 0;
+    int nodesToVisit[64];
+    while (true) {
+        const LinearBVHNode *node = &nodes[currentNodeIndex];
+        if (node->bounds.IntersectP(ray, invDir, dirIsNeg)) {
+            if (node->nPrimitives > 0) {
+                for (int i = 0; i < node->nPrimitives; ++i)
+                    primitives[node->primitivesOffset + i]->IntersectProbe(
+                        ray, material, reservoir);
+                if (toVisitOffset == 0) break;
+                currentNodeIndex = nodesToVisit[--toVisitOffset];
+            } else {
+                nodesToVisit[toVisitOffset++] = node->secondChildOffset;
+                currentNodeIndex = currentNodeIndex + 1;
+            }
+        } else {
+            if (toVisitOffset == 0) break;
+            currentNodeIndex = nodesToVisit[--toVisitOffset];
+        }
+    }
+}
+
 std::shared_ptr<BVHAccel> CreateBVHAccelerator(
     std::vector<std::shared_ptr<Primitive>> prims, const ParamSet &ps) {
     std::string splitMethodName = ps.FindOneString("splitmethod", "sah");
@@ -65,6 +65,8 @@ class BVHAccel : public Aggregate {
     ~BVHAccel();
     bool Intersect(const Ray &ray, SurfaceInteraction *isect) const;
     bool IntersectP(const Ray &ray) const;
+    void IntersectProbe(const Ray &ray, const Material *material,
+                        ProbeReservoir *reservoir) const;
 
   private:
     // BVHAccel Private Methods
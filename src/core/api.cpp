@@ -39,6 +39,7 @@
 #include "film.h"
 #include "medium.h"
 #include "stats.h"
+#include "texgraph.h"
 
 // API Additional Headers
 #include "accelerators/bvh.h"
@@ -73,6 +74,7 @@
 #include "materials/glass.h"
 #include "materials/hair.h"
 #include "materials/kdsubsurface.h"
+#include "materials/layered.h"
 #include "materials/matte.h"
 #include "materials/metal.h"
 #include "materials/mirror.h"
@@ -84,10 +86,12 @@
 #include "materials/uber.h"
 #include "samplers/halton.h"
 #include "samplers/maxmin.h"
+#include "samplers/owensobol.h"
 #include "samplers/random.h"
 #include "samplers/sobol.h"
 #include "samplers/stratified.h"
 #include "samplers/zerotwosequence.h"
+#include "samplers/zsobol.h"
 #include "shapes/cone.h"
 #include "shapes/curve.h"
 #include "shapes/cylinder.h"
@@ -575,6 +579,19 @@ std::shared_ptr<Material> MakeMaterial(const std::string &name,
             mat2 = (*graphicsState.namedMaterials)[m2]->material;
 
         material = CreateMixMaterial(mp, mat1, mat2);
+    } else if (name == "layered") {
+        std::string baseName = mp.FindString("basematerial", "");
+        std::shared_ptr<Material> base;
+        if (graphicsState.namedMaterials->find(baseName) ==
+                graphicsState.namedMaterials->end() ||
+            !(*graphicsState.namedMaterials)[baseName]->material) {
+            Error("Named material \"%s\" undefined.  Using \"matte\"",
+                  baseName.c_str());
+            base = MakeMaterial("matte", mp);
+        } else
+            base = (*graphicsState.namedMaterials)[baseName]->material;
+
+        material = CreateLayeredMaterial(mp, base);
     } else if (name == "metal")
         material = CreateMetalMaterial(mp);
     else if (name == "substrate")
@@ -640,7 +657,7 @@ std::shared_ptr<Texture<Float>> MakeFloatTexture(const std::string &name,
     else
         Warning("Float texture \"%s\" unknown.", name.c_str());
     tp.ReportUnused();
-    return std::shared_ptr<Texture<Float>>(tex);
+    return CompileTexture(std::shared_ptr<Texture<Float>>(tex));
 }
 
 std::shared_ptr<Texture<Spectrum>> MakeSpectrumTexture(
@@ -676,7 +693,7 @@ std::shared_ptr<Texture<Spectrum>> MakeSpectrumTexture(
     else
         Warning("Spectrum texture \"%s\" unknown.", name.c_str());
     tp.ReportUnused();
-    return std::shared_ptr<Texture<Spectrum>>(tex);
+    return CompileTexture(std::shared_ptr<Texture<Spectrum>>(tex));
 }
 
 std::shared_ptr<Medium> MakeMedium(const std::string &name,
@@ -768,6 +785,22 @@ std::shared_ptr<AreaLight> MakeAreaLight(const std::string &name,
     return area;
 }
 
+// Returns a single area light for all of the triangles of a mesh, or
+// nullptr if the area light _name_ has no mesh-level implementation.
+static std::shared_ptr<AreaLight> MakeAreaLight(
+    const std::string &name, const Transform &light2world,
+    const MediumInterface &mediumInterface, const ParamSet &paramSet,
+    const std::vector<std::shared_ptr<Shape>> &triangles) {
+    std::shared_ptr<AreaLight> area;
+    if (name == "area" || name == "diffuse")
+        area = CreateTriangleMeshAreaLight(light2world, mediumInterface.outside,
+                                           paramSet, triangles);
+    else
+        return nullptr;
+    paramSet.ReportUnused();
+    return area;
+}
+
 std::shared_ptr<Primitive> MakeAccelerator(
     const std::string &name,
     std::vector<std::shared_ptr<Primitive>> prims,
@@ -826,6 +859,10 @@ std::shared_ptr<Sampler> MakeSampler(const std::string &name,
         sampler = CreateHaltonSampler(paramSet, film->GetSampleBounds());
     else if (name == "sobol")
         sampler = CreateSobolSampler(paramSet, film->GetSampleBounds());
+    else if (name == "owensobol")
+        sampler = CreateOwenSobolSampler(paramSet);
+    else if (name == "zsobol")
+        sampler = CreateZSobolSampler(paramSet, film->GetSampleBounds());
     else if (name == "random")
         sampler = CreateRandomSampler(paramSet);
     else if (name == "stratified")
@@ -1351,10 +1388,20 @@ void pbrtShape(const std::string &name, const ParamSet &params) {
         params.ReportUnused();
         MediumInterface mi = graphicsState.CreateMediumInterface();
         prims.reserve(shapes.size());
+
+        // Possibly create a single area light for an emissive triangle mesh
+        std::shared_ptr<AreaLight> meshLight;
+        if (graphicsState.areaLight != "" &&
+            graphicsState.areaLightParams.FindOneBool("meshlight", true) &&
+            shapes.size() > 1 && IsTriangleMesh(shapes)) {
+            meshLight = MakeAreaLight(graphicsState.areaLight, curTransform[0],
+                                      mi, graphicsState.areaLightParams, shapes);
+            if (meshLight) areaLights.push_back(meshLight);
+        }
         for (auto s : shapes) {
             // Possibly create area light for shape
-            std::shared_ptr<AreaLight> area;
-            if (graphicsState.areaLight != "") {
+            std::shared_ptr<AreaLight> area = meshLight;
+            if (!area && graphicsState.areaLight != "") {
                 area = MakeAreaLight(graphicsState.areaLight, curTransform[0],
                                      mi, graphicsState.areaLightParams, s);
                 if (area) areaLights.push_back(area);
@@ -1605,6 +1652,10 @@ void pbrtWorldEnd() {
     if (PbrtOptions.cat || PbrtOptions.toPly) {
         printf("%*sWorldEnd\n", catIndentCount, "");
     } else {
+        // Wait for image textures that are still loading in the background
+        ImageTexture<Float, Float>::FinishLoading();
+        ImageTexture<RGBSpectrum, Spectrum>::FinishLoading();
+
         std::unique_ptr<Integrator> integrator(renderOptions->MakeIntegrator());
         std::unique_ptr<Scene> scene(renderOptions->MakeScene());
 
@@ -35,10 +35,19 @@
 #include "bssrdf.h"
 #include "interpolation.h"
 #include "parallel.h"
+#include "sampler.h"
 #include "scene.h"
+#include "sampling.h"
+#include <map>
+#include <mutex>
 
 namespace pbrt {
 
+STAT_INT_DISTRIBUTION("BSSRDF/Probe segment candidate hits", probeCandidates);
+STAT_INT_DISTRIBUTION("BSSRDF/Random walk length", randomWalkLength);
+STAT_COUNTER("Scene/BSSRDF tables computed", nBSSRDFTables);
+STAT_MEMORY_COUNTER("Memory/BSSRDF tables", bssrdfTableBytes);
+
 // BSSRDF Utility Functions
 Float FresnelMoment1(Float eta) {
     Float eta2 = eta * eta, eta3 = eta2 * eta, eta4 = eta3 * eta,
@@ -174,6 +183,27 @@ void ComputeBeamDiffusionBSSRDF(Float g, Float eta, BSSRDFTable *t) {
     }, t->nRhoSamples);
 }
 
+std::shared_ptr<const BSSRDFTable> GetBeamDiffusionBSSRDFTable(Float g,
+                                                               Float eta) {
+    // Share one tabulated profile between all materials with equal $g$ and
+    // $\eta$, since computing it dominates subsurface material creation
+    static std::mutex mutex;
+    static std::map<std::pair<Float, Float>,
+                    std::shared_ptr<const BSSRDFTable>> tables;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const BSSRDFTable> &table = tables[std::make_pair(g, eta)];
+    if (!table) {
+        const int nRhoSamples = 100, nRadiusSamples = 64;
+        BSSRDFTable *t = new BSSRDFTable(nRhoSamples, nRadiusSamples);
+        ComputeBeamDiffusionBSSRDF(g, eta, t);
+        table.reset(t);
+        ++nBSSRDFTables;
+        bssrdfTableBytes += sizeof(Float) * (2 * nRhoSamples + nRadiusSamples +
+                                             2 * nRhoSamples * nRadiusSamples);
+    }
+    return table;
+}
+
 void SubsurfaceFromDiffuse(const BSSRDFTable &t, const Spectrum &rhoEff,
                            const Spectrum &mfp, Spectrum *sigma_a,
                            Spectrum *sigma_s) {
@@ -230,10 +260,12 @@ Spectrum TabulatedBSSRDF::Sr(Float r) const {
     return Sr.Clamp();
 }
 
-Spectrum SeparableBSSRDF::Sample_S(const Scene &scene, Float u1,
-                                   const Point2f &u2, MemoryArena &arena,
-                                   SurfaceInteraction *si, Float *pdf) const {
+Spectrum SeparableBSSRDF::Sample_S(const Scene &scene, Sampler &sampler,
+                                   MemoryArena &arena, SurfaceInteraction *si,
+                                   Float *pdf) const {
     ProfilePhase pp(Prof::BSSRDFSampling);
+    Float u1 = sampler.Get1D();
+    Point2f u2 = sampler.Get2D();
     Spectrum Sp = Sample_Sp(scene, u1, u2, arena, si, pdf);
     if (!Sp.IsBlack()) {
         // Initialize material model at sampled surface interaction
@@ -292,36 +324,15 @@ Spectrum SeparableBSSRDF::Sample_Sp(const Scene &scene, Float u1,
 
     // Intersect BSSRDF sampling ray against the scene geometry
 
-    // Declare _IntersectionChain_ and linked list
-    struct IntersectionChain {
-        SurfaceInteraction si;
-        IntersectionChain *next = nullptr;
-    };
-    IntersectionChain *chain = ARENA_ALLOC(arena, IntersectionChain)();
-
-    // Accumulate chain of intersections along ray
-    IntersectionChain *ptr = chain;
-    int nFound = 0;
-    while (true) {
-        Ray r = base.SpawnRayTo(pTarget);
-        if (r.d == Vector3f(0, 0, 0) || !scene.Intersect(r, &ptr->si))
-            break;
-
-        base = ptr->si;
-        // Append admissible intersection to _IntersectionChain_
-        if (ptr->si.primitive->GetMaterial() == this->material) {
-            IntersectionChain *next = ARENA_ALLOC(arena, IntersectionChain)();
-            ptr->next = next;
-            ptr = next;
-            nFound++;
-        }
-    }
-
-    // Randomly choose one of several intersections during BSSRDF sampling
-    if (nFound == 0) return Spectrum(0.0f);
-    int selected = Clamp((int)(u1 * nFound), 0, nFound - 1);
-    while (selected-- > 0) chain = chain->next;
-    *pi = chain->si;
+    // Choose one of the intersections with _material_ along the probe
+    // segment using reservoir sampling
+    ProbeReservoir reservoir(u1, pi);
+    Ray ray = base.SpawnRayTo(pTarget);
+    if (ray.d == Vector3f(0, 0, 0)) return Spectrum(0.f);
+    scene.IntersectProbe(ray, this->material, &reservoir);
+    ReportValue(probeCandidates, reservoir.nFound);
+    if (reservoir.nFound == 0) return Spectrum(0.0f);
+    int nFound = reservoir.nFound;
 
     // Compute sample PDF and return the spatial BSSRDF term $\Sp$
     *pdf = this->Pdf_Sp(*pi) / nFound;
@@ -350,6 +361,79 @@ Float SeparableBSSRDF::Pdf_Sp(const SurfaceInteraction &pi) const {
     return pdf;
 }
 
+Spectrum RandomWalkBSSRDF::Sample_S(const Scene &scene, Sampler &sampler,
+                                    MemoryArena &arena, SurfaceInteraction *pi,
+                                    Float *pdf) const {
+    ProfilePhase pp(Prof::BSSRDFSampling);
+    // Enter the surface along a cosine-distributed direction
+    Normal3f nIn = -Faceforward(po.n, po.wo);
+    Vector3f s, t;
+    CoordinateSystem(Vector3f(nIn), &s, &t);
+    Vector3f wLocal = CosineSampleHemisphere(sampler.Get2D());
+    Ray ray = po.SpawnRay(wLocal.x * s + wLocal.y * t +
+                          wLocal.z * Vector3f(nIn));
+
+    // Follow the random walk until it leaves through a surface with
+    // _material_
+    Spectrum beta(1.f);
+    HenyeyGreenstein phase(g);
+    for (int bounces = 0; bounces < maxBounces; ++bounces) {
+        SurfaceInteraction isect;
+        bool foundIntersection = scene.Intersect(ray, &isect);
+        Float rayLength = ray.d.Length();
+        Float tMax = foundIntersection ? ray.tMax * rayLength : Infinity;
+
+        // Sample free-flight distance inside the scattering medium
+        Float dist;
+        bool scattered;
+        beta *= SampleHomogeneousFreeFlight(sigma_t, sigma_s, tMax,
+                                            sampler.Get2D(), &dist,
+                                            &scattered);
+        if (beta.IsBlack()) break;
+        if (scattered) {
+            // Scatter inside the medium and choose a new direction
+            Vector3f wo = -ray.d / rayLength, wi;
+            Point3f p = ray(dist / rayLength);
+            phase.Sample_p(wo, &wi, sampler.Get2D());
+            ray = Ray(p, wi, Infinity, po.time);
+
+            // Possibly terminate the walk with Russian roulette
+            if (bounces > 3 && beta.MaxComponentValue() < 1) {
+                Float q = std::max((Float).05, 1 - beta.MaxComponentValue());
+                if (sampler.Get1D() < q) break;
+                beta /= 1 - q;
+            }
+            continue;
+        }
+        if (!foundIntersection) break;
+
+        // Pass through surfaces of other materials embedded in the medium
+        if (isect.primitive->GetMaterial() != material) {
+            ray = isect.SpawnRay(ray.d);
+            continue;
+        }
+
+        // Reflect back into the medium with the dielectric boundary's
+        // Fresnel reflectance, which includes total internal reflection
+        Vector3f w = ray.d / rayLength;
+        Float F = FrDielectric(AbsDot(w, isect.n), eta, 1);
+        if (sampler.Get1D() < F) {
+            ray = isect.SpawnRay(w - 2 * Dot(w, isect.n) * Vector3f(isect.n));
+            continue;
+        }
+
+        // Initialize exit point of the random walk
+        ReportValue(randomWalkLength, bounces);
+        *pi = isect;
+        pi->bsdf = ARENA_ALLOC(arena, BSDF)(*pi);
+        pi->bsdf->Add(ARENA_ALLOC(arena, RandomWalkBSSRDFAdapter)(this));
+        pi->wo = Vector3f(pi->shading.n);
+        *pdf = 1;
+        return beta;
+    }
+    return Spectrum(0.f);
+}
+
 Float TabulatedBSSRDF::Sample_Sr(int ch, Float u) const {
     if (sigma_t[ch] == 0) return -1;
     return SampleCatmullRom2D(table.nRhoSamples, table.nRadiusSamples,
@@ -58,7 +58,7 @@ class BSSRDF {
 
     // BSSRDF Interface
     virtual Spectrum S(const SurfaceInteraction &pi, const Vector3f &wi) = 0;
-    virtual Spectrum Sample_S(const Scene &scene, Float u1, const Point2f &u2,
+    virtual Spectrum Sample_S(const Scene &scene, Sampler &sampler,
                               MemoryArena &arena, SurfaceInteraction *si,
                               Float *pdf) const = 0;
 
@@ -93,7 +93,7 @@ class SeparableBSSRDF : public BSSRDF {
     Spectrum Sp(const SurfaceInteraction &pi) const {
         return Sr(Distance(po.p, pi.p));
     }
-    Spectrum Sample_S(const Scene &scene, Float u1, const Point2f &u2,
+    Spectrum Sample_S(const Scene &scene, Sampler &sampler,
                       MemoryArena &arena, SurfaceInteraction *si,
                       Float *pdf) const;
     Spectrum Sample_Sp(const Scene &scene, Float u1, const Point2f &u2,
@@ -163,17 +163,79 @@ class SeparableBSSRDFAdapter : public BxDF {
             f *= bssrdf->eta * bssrdf->eta;
         return f;
     }
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        // _Sw()_ is normalized to unit albedo; as with the other
+        // transmission lobes, the $\eta^2$ radiance scaling is ignored
+        return 1;
+    }
     std::string ToString() const { return "[ SeparableBSSRDFAdapter ]"; }
 
   private:
     const SeparableBSSRDF *bssrdf;
 };
 
+class RandomWalkBSSRDF : public BSSRDF {
+    friend class RandomWalkBSSRDFAdapter;
+
+  public:
+    // RandomWalkBSSRDF Public Methods
+    RandomWalkBSSRDF(const SurfaceInteraction &po, const Material *material,
+                     TransportMode mode, Float eta, const Spectrum &sigma_a,
+                     const Spectrum &sigma_s, Float g, int maxBounces)
+        : BSSRDF(po, eta),
+          material(material),
+          mode(mode),
+          sigma_t(sigma_a + sigma_s),
+          sigma_s(sigma_s),
+          g(g),
+          maxBounces(maxBounces) {}
+    Spectrum S(const SurfaceInteraction &pi, const Vector3f &wi) {
+        // The walk has no closed-form value; it only contributes through
+        // _Sample_S()_
+        return Spectrum(0.f);
+    }
+    Spectrum Sample_S(const Scene &scene, Sampler &sampler,
+                      MemoryArena &arena, SurfaceInteraction *si,
+                      Float *pdf) const;
+    Spectrum Sw(const Vector3f &w) const {
+        Float c = 1 - 2 * FresnelMoment1(1 / eta);
+        return (1 - FrDielectric(CosTheta(w), 1, eta)) / (c * Pi);
+    }
+
+  private:
+    // RandomWalkBSSRDF Private Data
+    const Material *material;
+    const TransportMode mode;
+    const Spectrum sigma_t, sigma_s;
+    const Float g;
+    const int maxBounces;
+};
+
+class RandomWalkBSSRDFAdapter : public BxDF {
+  public:
+    // RandomWalkBSSRDFAdapter Public Methods
+    RandomWalkBSSRDFAdapter(const RandomWalkBSSRDF *bssrdf)
+        : BxDF(BxDFType(BSDF_REFLECTION | BSDF_DIFFUSE)), bssrdf(bssrdf) {}
+    Spectrum f(const Vector3f &wo, const Vector3f &wi) const {
+        Spectrum f = bssrdf->Sw(wi);
+        if (bssrdf->mode == TransportMode::Radiance)
+            f *= bssrdf->eta * bssrdf->eta;
+        return f;
+    }
+    Float EstimateAlbedo(const Vector3f &wo) const { return 1; }
+    std::string ToString() const { return "[ RandomWalkBSSRDFAdapter ]"; }
+
+  private:
+    const RandomWalkBSSRDF *bssrdf;
+};
+
 Float BeamDiffusionSS(Float sigma_s, Float sigma_a, Float g, Float eta,
                       Float r);
 Float BeamDiffusionMS(Float sigma_s, Float sigma_a, Float g, Float eta,
                       Float r);
 void ComputeBeamDiffusionBSSRDF(Float g, Float eta, BSSRDFTable *t);
+std::shared_ptr<const BSSRDFTable> GetBeamDiffusionBSSRDFTable(Float g,
+                                                               Float eta);
 void SubsurfaceFromDiffuse(const BSSRDFTable &table, const Spectrum &rhoEff,
                            const Spectrum &mfp, Spectrum *sigma_a,
                            Spectrum *sigma_s);
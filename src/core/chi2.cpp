@@ -0,0 +1,297 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+// core/chi2.cpp*
+#include "chi2.h"
+#include "reflection.h"
+#include "rng.h"
+#include <algorithm>
+
+namespace pbrt {
+
+// Chi^2 Test Definitions
+/// Regularized lower incomplete gamma function (based on code from Cephes)
+static double RLGamma(double a, double x) {
+    const double epsilon = 0.000000000000001;
+    const double big = 4503599627370496.0;
+    const double bigInv = 2.22044604925031308085e-16;
+    if (a < 0 || x < 0)
+        throw std::runtime_error("LLGamma: invalid arguments range!");
+
+    if (x == 0) return 0.0f;
+
+    double ax = (a * std::log(x)) - x - std::lgamma(a);
+    if (ax < -709.78271289338399) return a < x ? 1.0 : 0.0;
+
+    if (x <= 1 || x <= a) {
+        double r2 = a;
+        double c2 = 1;
+        double ans2 = 1;
+
+        do {
+            r2 = r2 + 1;
+            c2 = c2 * x / r2;
+            ans2 += c2;
+        } while ((c2 / ans2) > epsilon);
+
+        return std::exp(ax) * ans2 / a;
+    }
+
+    int c = 0;
+    double y = 1 - a;
+    double z = x + y + 1;
+    double p3 = 1;
+    double q3 = x;
+    double p2 = x + 1;
+    double q2 = z * x;
+    double ans = p2 / q2;
+    double error;
+
+    do {
+        c++;
+        y += 1;
+        z += 2;
+        double yc = y * c;
+        double p = (p2 * z) - (p3 * yc);
+        double q = (q2 * z) - (q3 * yc);
+
+        if (q != 0) {
+            double nextans = p / q;
+            error = std::abs((ans - nextans) / nextans);
+            ans = nextans;
+        } else {
+            // zero div, skip
+            error = 1;
+        }
+
+        // shift
+        p3 = p2;
+        p2 = p;
+        q3 = q2;
+        q2 = q;
+
+        // normalize fraction when the numerator becomes large
+        if (std::abs(p) > big) {
+            p3 *= bigInv;
+            p2 *= bigInv;
+            q3 *= bigInv;
+            q2 *= bigInv;
+        }
+    } while (error > epsilon);
+
+    return 1.0 - (std::exp(ax) * ans);
+}
+
+/// Chi^2 distribution cumulative distribution function
+double Chi2CDF(double x, int dof) {
+    if (dof < 1 || x < 0) {
+        return 0.0;
+    } else if (dof == 2) {
+        return 1.0 - std::exp(-0.5 * x);
+    } else {
+        return (Float)RLGamma(0.5 * dof, 0.5 * x);
+    }
+}
+
+/// Adaptive Simpson integration over an 1D interval
+Float AdaptiveSimpson(const std::function<Float(Float)>& f, Float x0, Float x1,
+                      Float eps, int depth) {
+    int count = 0;
+    /* Define an recursive lambda function for integration over subintervals */
+    std::function<Float(Float, Float, Float, Float, Float, Float, Float, Float,
+                        int)> integrate = [&](Float a, Float b, Float c,
+                                              Float fa, Float fb, Float fc,
+                                              Float I, Float eps, int depth) {
+        /* Evaluate the function at two intermediate points */
+        Float d = 0.5f * (a + b), e = 0.5f * (b + c), fd = f(d), fe = f(e);
+
+        /* Simpson integration over each subinterval */
+        Float h = c - a, I0 = (Float)(1.0 / 12.0) * h * (fa + 4 * fd + fb),
+              I1 = (Float)(1.0 / 12.0) * h * (fb + 4 * fe + fc), Ip = I0 + I1;
+        ++count;
+
+        /* Stopping criterion from J.N. Lyness (1969)
+          "Notes on the adaptive Simpson quadrature routine" */
+        if (depth <= 0 || std::abs(Ip - I) < 15 * eps) {
+            // Richardson extrapolation
+            return Ip + (Float)(1.0 / 15.0) * (Ip - I);
+        }
+
+        return integrate(a, d, b, fa, fd, fb, I0, .5f * eps, depth - 1) +
+               integrate(b, e, c, fb, fe, fc, I1, .5f * eps, depth - 1);
+    };
+    Float a = x0, b = 0.5f * (x0 + x1), c = x1;
+    Float fa = f(a), fb = f(b), fc = f(c);
+    Float I = (c - a) * (Float)(1.0 / 6.0) * (fa + 4 * fb + fc);
+    return integrate(a, b, c, fa, fb, fc, I, eps, depth);
+}
+
+/// Nested adaptive Simpson integration over a 2D rectangle
+Float AdaptiveSimpson2D(const std::function<Float(Float, Float)>& f, Float x0,
+                        Float y0, Float x1, Float y1, Float eps, int depth) {
+    /* Lambda function that integrates over the X axis */
+    auto integrate = [&](Float y) {
+        return AdaptiveSimpson(std::bind(f, std::placeholders::_1, y), x0, x1,
+                               eps, depth);
+    };
+    Float value = AdaptiveSimpson(integrate, y0, y1, eps, depth);
+    return value;
+}
+
+void BSDFFrequencyTable(const BSDF *bsdf, const Vector3f &wo, RNG &rng,
+                        int sampleCount, int thetaRes, int phiRes,
+                        Float *target) {
+    std::fill(target, target + thetaRes * phiRes, Float(0));
+    Float factorTheta = thetaRes / Pi, factorPhi = phiRes / (2 * Pi);
+    for (int i = 0; i < sampleCount; ++i) {
+        // Brace initialization evaluates the samples in order, keeping the
+        // RNG sequence independent of the compiler
+        Point2f u{rng.UniformFloat(), rng.UniformFloat()};
+        BxDFType flags;
+        Vector3f wi;
+        Float pdf;
+        Spectrum f = bsdf->Sample_f(wo, &wi, u, &pdf, BSDF_ALL, &flags);
+        if (f.IsBlack() || pdf == 0 || (flags & BSDF_SPECULAR)) continue;
+
+        Vector3f wiL = bsdf->WorldToLocal(wi);
+        Point2f coords(std::acos(Clamp(wiL.z, -1, 1)) * factorTheta,
+                       std::atan2(wiL.y, wiL.x) * factorPhi);
+        if (coords.y < 0) coords.y += 2 * Pi * factorPhi;
+        int thetaBin = Clamp((int)std::floor(coords.x), 0, thetaRes - 1);
+        int phiBin = Clamp((int)std::floor(coords.y), 0, phiRes - 1);
+        target[thetaBin * phiRes + phiBin] += 1;
+    }
+}
+
+void IntegrateBSDFFrequencyTable(const BSDF *bsdf, const Vector3f &wo,
+                                 int sampleCount, int thetaRes, int phiRes,
+                                 Float *target) {
+    Float factorTheta = Pi / thetaRes, factorPhi = (2 * Pi) / phiRes;
+    for (int i = 0; i < thetaRes; ++i)
+        for (int j = 0; j < phiRes; ++j)
+            *target++ =
+                sampleCount *
+                AdaptiveSimpson2D(
+                    [&](Float theta, Float phi) -> Float {
+                        Float sinTheta = std::sin(theta);
+                        Vector3f wiL(sinTheta * std::cos(phi),
+                                     sinTheta * std::sin(phi),
+                                     std::cos(theta));
+                        return bsdf->Pdf(wo, bsdf->LocalToWorld(wiL),
+                                         BSDF_ALL) *
+                               sinTheta;
+                    },
+                    i * factorTheta, j * factorPhi, (i + 1) * factorTheta,
+                    (j + 1) * factorPhi);
+}
+
+std::pair<bool, std::string> Chi2Test(const Float *frequencies,
+                                      const Float *expFrequencies, int nCells,
+                                      int sampleCount, Float minExpFrequency,
+                                      Float significanceLevel, int numTests,
+                                      Float *pValue) {
+    if (pValue) *pValue = 0;
+    /* Sort all cells by their expected frequencies */
+    std::vector<int> cells(nCells);
+    for (int i = 0; i < nCells; ++i) cells[i] = i;
+    std::sort(cells.begin(), cells.end(), [&](int a, int b) {
+        return expFrequencies[a] < expFrequencies[b];
+    });
+
+    /* Compute the Chi^2 statistic and pool cells as necessary */
+    Float pooledFrequencies = 0, pooledExpFrequencies = 0, chsq = 0;
+    int dof = 0;
+    for (int c : cells) {
+        if (expFrequencies[c] == 0) {
+            if (frequencies[c] > sampleCount * 1e-5f) {
+                /* Uh oh: samples in a cell that should be completely empty
+                   according to the probability density function. Ordinarily,
+                   even a single sample requires immediate rejection of the
+                   null hypothesis. But due to finite-precision computations
+                   and rounding errors, this can occasionally happen without
+                   there being an actual bug. Therefore, the criterion here
+                   is a bit more lenient. */
+                return std::make_pair(
+                    false, StringPrintf("Encountered %f samples in a cell "
+                                        "with expected frequency 0. "
+                                        "Rejecting the null hypothesis!",
+                                        frequencies[c]));
+            }
+        } else if (expFrequencies[c] < minExpFrequency ||
+                   (pooledExpFrequencies > 0 &&
+                    pooledExpFrequencies < minExpFrequency)) {
+            /* Pool cells with low expected frequencies until a
+               sufficiently high expected frequency is achieved. */
+            pooledFrequencies += frequencies[c];
+            pooledExpFrequencies += expFrequencies[c];
+        } else {
+            Float diff = frequencies[c] - expFrequencies[c];
+            chsq += (diff * diff) / expFrequencies[c];
+            ++dof;
+        }
+    }
+    if (pooledExpFrequencies > 0 || pooledFrequencies > 0) {
+        Float diff = pooledFrequencies - pooledExpFrequencies;
+        chsq += (diff * diff) / pooledExpFrequencies;
+        ++dof;
+    }
+
+    /* All parameters are assumed to be known, so there is no
+       additional DF reduction due to model parameters */
+    dof -= 1;
+    if (dof <= 0)
+        return std::make_pair(
+            false, StringPrintf("The number of degrees of freedom %d is too "
+                                "low!",
+                                dof));
+
+    /* Probability of obtaining a test statistic at least
+       as extreme as the one observed under the assumption
+       that the distributions match */
+    Float pval = 1 - (Float)Chi2CDF(chsq, dof);
+    if (pValue) *pValue = pval;
+
+    /* Apply the Sidak correction term, since we'll be conducting multiple
+       independent hypothesis tests. This accounts for the fact that the
+       probability of a failure increases quickly when several hypothesis
+       tests are run in sequence. */
+    Float alpha = 1.0f - std::pow(1.0f - significanceLevel, 1.0f / numTests);
+    if (pval < alpha || !std::isfinite(pval))
+        return std::make_pair(
+            false, StringPrintf("Rejected the null hypothesis (p-value = %f, "
+                                "significance level = %f)",
+                                pval, alpha));
+    return std::make_pair(true, std::string(""));
+}
+
+}  // namespace pbrt
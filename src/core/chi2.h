@@ -0,0 +1,90 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_CORE_CHI2_H
+#define PBRT_CORE_CHI2_H
+
+// core/chi2.h*
+#include "pbrt.h"
+#include "geometry.h"
+#include <functional>
+
+namespace pbrt {
+
+// Chi^2 Test Declarations
+// Helpers for testing that a BSDF's sampling routine generates directions
+// with the density returned by its Pdf() method; they are shared by the
+// unit tests and the bsdfbench tool. Histograms cover the full sphere of
+// directions, with _thetaRes_ bins in $\theta$ and _phiRes_ in $\phi$.
+
+// Chi^2 distribution cumulative distribution function
+double Chi2CDF(double x, int dof);
+
+// Adaptive Simpson integration over a 1D interval
+Float AdaptiveSimpson(const std::function<Float(Float)> &f, Float x0,
+                      Float x1, Float eps = 1e-6f, int depth = 6);
+
+// Nested adaptive Simpson integration over a 2D rectangle
+Float AdaptiveSimpson2D(const std::function<Float(Float, Float)> &f, Float x0,
+                        Float y0, Float x1, Float y1, Float eps = 1e-6f,
+                        int depth = 6);
+
+// Generates a histogram of the directions sampled by the BSDF's
+// Sample_f(); specular samples are ignored.
+void BSDFFrequencyTable(const BSDF *bsdf, const Vector3f &wo, RNG &rng,
+                        int sampleCount, int thetaRes, int phiRes,
+                        Float *target);
+
+// Numerically integrates the BSDF's Pdf() over the histogram's cells
+void IntegrateBSDFFrequencyTable(const BSDF *bsdf, const Vector3f &wo,
+                                 int sampleCount, int thetaRes, int phiRes,
+                                 Float *target);
+
+// Runs a chi^2 test of the observed _frequencies_ against the expected
+// ones, pooling cells with expected frequencies below _minExpFrequency_.
+// The significance level is Sidak-corrected for _numTests_ independent
+// tests. Returns whether the null hypothesis is accepted along with an
+// explanation if it isn't.
+std::pair<bool, std::string> Chi2Test(const Float *frequencies,
+                                      const Float *expFrequencies, int nCells,
+                                      int sampleCount, Float minExpFrequency,
+                                      Float significanceLevel, int numTests,
+                                      Float *pValue = nullptr);
+
+}  // namespace pbrt
+
+#endif  // PBRT_CORE_CHI2_H
@@ -36,4 +36,29 @@
 
 namespace pbrt {
 
+// Geometry Function Definitions
+DirectionCone Union(const DirectionCone &a, const DirectionCone &b) {
+    // Handle the cases where one cone is empty or contains the other
+    if (a.IsEmpty()) return b;
+    if (b.IsEmpty()) return a;
+    Float thetaA = std::acos(Clamp(a.cosTheta, -1, 1));
+    Float thetaB = std::acos(Clamp(b.cosTheta, -1, 1));
+    Float thetaD = std::acos(Clamp(Dot(a.w, b.w), -1, 1));
+    if (std::min(thetaD + thetaB, Pi) <= thetaA) return a;
+    if (std::min(thetaD + thetaA, Pi) <= thetaB) return b;
+
+    // Compute the spread angle of the merged cone, $\theta_o$
+    Float thetaO = (thetaA + thetaD + thetaB) / 2;
+    if (thetaO >= Pi) return DirectionCone::EntireSphere();
+
+    // Rotate _a_'s axis toward _b_'s to find the merged cone's axis
+    Float thetaR = thetaO - thetaA;
+    Vector3f wr = Cross(a.w, b.w);
+    if (wr.LengthSquared() == 0) return DirectionCone::EntireSphere();
+    wr = Normalize(wr);
+    Vector3f w = a.w * std::cos(thetaR) + Cross(wr, a.w) * std::sin(thetaR) +
+                 wr * Dot(wr, a.w) * (1 - std::cos(thetaR));
+    return DirectionCone(Normalize(w), std::cos(thetaO));
+}
+
 }  // namespace pbrt
@@ -865,6 +865,29 @@ class Bounds2iIterator : public std::forward_iterator_tag {
     const Bounds2i *bounds;
 };
 
+// DirectionCone bounds a set of directions with the cone around the unit
+// vector _w_ whose half-angle has cosine _cosTheta_.
+struct DirectionCone {
+    // DirectionCone Public Methods
+    DirectionCone() {}
+    DirectionCone(const Vector3f &w, Float cosTheta) : w(w), cosTheta(cosTheta) {}
+    static DirectionCone EntireSphere() {
+        return DirectionCone(Vector3f(0, 0, 1), -1);
+    }
+    bool IsEmpty() const { return cosTheta == Infinity; }
+    friend std::ostream &operator<<(std::ostream &os, const DirectionCone &c) {
+        os << "[ DirectionCone w: " << c.w << " cosTheta: " << c.cosTheta
+           << " ]";
+        return os;
+    }
+
+    // DirectionCone Public Data
+    Vector3f w;
+    Float cosTheta = Infinity;
+};
+
+DirectionCone Union(const DirectionCone &a, const DirectionCone &b);
+
 // Ray Declarations
 class Ray {
   public:
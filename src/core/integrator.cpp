@@ -41,6 +41,7 @@
 #include "integrator.h"
 #include "progressreporter.h"
 #include "camera.h"
+#include "lightdistrib.h"
 #include "stats.h"
 
 namespace pbrt {
@@ -105,18 +106,44 @@ Spectrum UniformSampleOneLight(const Interaction &it, const Scene &scene,
                           scene, sampler, arena, handleMedia) / lightPdf;
 }
 
+Spectrum UniformSampleOneLight(const Interaction &it, const Scene &scene,
+                               MemoryArena &arena, Sampler &sampler,
+                               bool handleMedia,
+                               const LightDistribution &lightDistrib) {
+    ProfilePhase p(Prof::DirectLighting);
+    // Choose a single light to sample for the interaction's position
+    if (scene.lights.empty()) return Spectrum(0.f);
+    Float lightPdf;
+    int lightNum =
+        lightDistrib.SampleDiscrete(it.p, it.n, sampler.Get1D(), &lightPdf);
+    if (lightPdf == 0) return Spectrum(0.f);
+    const std::shared_ptr<Light> &light = scene.lights[lightNum];
+    Point2f uLight = sampler.Get2D();
+    Point2f uScattering = sampler.Get2D();
+    // Report the outcome of the shadow ray, if one was traced, so that
+    // the distribution can learn which lights are visible.
+    Float visibility = -1;
+    Spectrum Ld = EstimateDirect(it, uScattering, *light, uLight, scene,
+                                 sampler, arena, handleMedia, false,
+                                 &visibility);
+    if (visibility >= 0)
+        lightDistrib.RecordVisibility(it.p, lightNum, visibility);
+    return Ld / lightPdf;
+}
+
 Spectrum EstimateDirect(const Interaction &it, const Point2f &uScattering,
                         const Light &light, const Point2f &uLight,
                         const Scene &scene, Sampler &sampler,
-                        MemoryArena &arena, bool handleMedia, bool specular) {
+                        MemoryArena &arena, bool handleMedia, bool specular,
+                        Float *visibility) {
     BxDFType bsdfFlags =
         specular ? BSDF_ALL : BxDFType(BSDF_ALL & ~BSDF_SPECULAR);
     Spectrum Ld(0.f);
     // Sample light source with multiple importance sampling
     Vector3f wi;
     Float lightPdf = 0, scatteringPdf = 0;
-    VisibilityTester visibility;
-    Spectrum Li = light.Sample_Li(it, uLight, &wi, &lightPdf, &visibility);
+    VisibilityTester vis;
+    Spectrum Li = light.Sample_Li(it, uLight, &wi, &lightPdf, &vis);
     VLOG(2) << "EstimateDirect uLight:" << uLight << " -> Li: " << Li << ", wi: "
             << wi << ", pdf: " << lightPdf;
     if (lightPdf > 0 && !Li.IsBlack()) {
@@ -140,14 +167,19 @@ Spectrum EstimateDirect(const Interaction &it, const Point2f &uScattering,
         if (!f.IsBlack()) {
             // Compute effect of visibility for light source sample
             if (handleMedia) {
-                Li *= visibility.Tr(scene, sampler);
+                Spectrum Tr = vis.Tr(scene, sampler);
+                Li *= Tr;
+                if (visibility) *visibility = Tr.y();
                 VLOG(2) << "  after Tr, Li: " << Li;
             } else {
-              if (!visibility.Unoccluded(scene)) {
+              if (!vis.Unoccluded(scene)) {
                 VLOG(2) << "  shadow ray blocked";
                 Li = Spectrum(0.f);
-              } else
+                if (visibility) *visibility = 0;
+              } else {
                 VLOG(2) << "  shadow ray unoccluded";
+                if (visibility) *visibility = 1;
+              }
             }
 
             // Add light's contribution to reflected radiance
@@ -185,14 +217,6 @@ Spectrum EstimateDirect(const Interaction &it, const Point2f &uScattering,
         VLOG(2) << "  BSDF / phase sampling f: " << f << ", scatteringPdf: " <<
             scatteringPdf;
         if (!f.IsBlack() && scatteringPdf > 0) {
-            // Account for light contributions along sampled direction _wi_
-            Float weight = 1;
-            if (!sampledSpecular) {
-                lightPdf = light.Pdf_Li(it, wi);
-                if (lightPdf == 0) return Ld;
-                weight = PowerHeuristic(1, scatteringPdf, 1, lightPdf);
-            }
-
             // Find intersection and compute transmittance
             SurfaceInteraction lightIsect;
             Ray ray = it.SpawnRay(wi);
@@ -201,14 +225,25 @@ Spectrum EstimateDirect(const Interaction &it, const Point2f &uScattering,
                 handleMedia ? scene.IntersectTr(ray, sampler, &lightIsect, &Tr)
                             : scene.Intersect(ray, &lightIsect);
 
-            // Add light contribution from material sampling
+            // Add light contribution from material sampling, computing the
+            // light's density from the point found along _wi_
             Spectrum Li(0.f);
+            const AreaLight *areaLight = nullptr;
             if (foundSurfaceInteraction) {
-                if (lightIsect.primitive->GetAreaLight() == &light)
-                    Li = lightIsect.Le(-wi);
+                areaLight = lightIsect.primitive->GetAreaLight();
+                if (areaLight != &light) return Ld;
+                Li = lightIsect.Le(-wi);
             } else
                 Li = light.Le(ray);
-            if (!Li.IsBlack()) Ld += f * Li * Tr * weight / scatteringPdf;
+            if (Li.IsBlack()) return Ld;
+            Float weight = 1;
+            if (!sampledSpecular) {
+                lightPdf = areaLight ? areaLight->Pdf_LiAt(it, wi, lightIsect)
+                                     : light.Pdf_Li(it, wi);
+                if (lightPdf == 0) return Ld;
+                weight = PowerHeuristic(1, scatteringPdf, 1, lightPdf);
+            }
+            Ld += f * Li * Tr * weight / scatteringPdf;
         }
     }
     return Ld;
@@ -221,7 +256,7 @@ std::unique_ptr<Distribution1D> ComputeLightPowerDistribution(
     for (const auto &light : scene.lights)
         lightPower.push_back(light->Power().y());
     return std::unique_ptr<Distribution1D>(
-        new Distribution1D(&lightPower[0], lightPower.size()));
+        new Distribution1D(&lightPower[0], lightPower.size(), true));
 }
 
 // SamplerIntegrator Method Definitions
@@ -56,6 +56,79 @@ Light::Light(int flags, const Transform &LightToWorld,
 
 Light::~Light() {}
 
+// LightBounds Method Definitions
+Float LightBounds::Importance(const Point3f &p, const Normal3f &n) const {
+    // Compute clamped squared distance to reference point
+    Point3f pc = Centroid();
+    Float d2 = DistanceSquared(p, pc);
+    d2 = std::max(d2, bounds.Diagonal().Length() / 2);
+
+    // Define cosine and sine clamped subtraction lambdas
+    auto cosSubClamped = [](Float sinTheta_a, Float cosTheta_a,
+                            Float sinTheta_b, Float cosTheta_b) -> Float {
+        if (cosTheta_a > cosTheta_b) return 1;
+        return cosTheta_a * cosTheta_b + sinTheta_a * sinTheta_b;
+    };
+    auto sinSubClamped = [](Float sinTheta_a, Float cosTheta_a,
+                            Float sinTheta_b, Float cosTheta_b) -> Float {
+        if (cosTheta_a > cosTheta_b) return 0;
+        return sinTheta_a * cosTheta_b - cosTheta_a * sinTheta_b;
+    };
+    auto safeSqrt = [](Float x) { return std::sqrt(std::max(x, Float(0))); };
+
+    // Compute sine and cosine of angle to vector _w_, $\theta_\roman{w}$
+    Vector3f wi = Normalize(p - pc);
+    Float cosTheta_w = Dot(w, wi);
+    if (twoSided) cosTheta_w = std::abs(cosTheta_w);
+    Float sinTheta_w = safeSqrt(1 - cosTheta_w * cosTheta_w);
+
+    // Compute $\cos\,\theta_\roman{b}$ for the bounds' bounding sphere
+    Point3f center;
+    Float radius;
+    bounds.BoundingSphere(&center, &radius);
+    Float cosTheta_b = -1;
+    if (DistanceSquared(p, center) > radius * radius)
+        cosTheta_b = safeSqrt(1 - radius * radius / DistanceSquared(p, center));
+    Float sinTheta_b = safeSqrt(1 - cosTheta_b * cosTheta_b);
+
+    // Compute $\cos\,\theta'$ and test against $\cos\,\theta_\roman{e}$
+    Float sinTheta_o = safeSqrt(1 - cosTheta_o * cosTheta_o);
+    Float cosTheta_x =
+        cosSubClamped(sinTheta_w, cosTheta_w, sinTheta_o, cosTheta_o);
+    Float sinTheta_x =
+        sinSubClamped(sinTheta_w, cosTheta_w, sinTheta_o, cosTheta_o);
+    Float cosThetap =
+        cosSubClamped(sinTheta_x, cosTheta_x, sinTheta_b, cosTheta_b);
+    if (cosThetap < cosTheta_e) return 0;
+
+    // Return final importance at reference point
+    Float importance = phi * cosThetap / d2;
+    // Account for $\cos\theta_\roman{i}$ in importance at surfaces
+    if (n != Normal3f(0, 0, 0)) {
+        Float cosTheta_i = AbsDot(wi, n);
+        Float sinTheta_i = safeSqrt(1 - cosTheta_i * cosTheta_i);
+        Float cosThetap_i =
+            cosSubClamped(sinTheta_i, cosTheta_i, sinTheta_b, cosTheta_b);
+        importance *= cosThetap_i;
+    }
+    return std::max<Float>(importance, 0);
+}
+
+LightBounds Union(const LightBounds &a, const LightBounds &b) {
+    // If one _LightBounds_ has zero power, return the other
+    if (a.phi == 0) return b;
+    if (b.phi == 0) return a;
+
+    // Find average direction and updated angles for _LightBounds_
+    DirectionCone cone = Union(DirectionCone(a.w, a.cosTheta_o),
+                               DirectionCone(b.w, b.cosTheta_o));
+    Float cosTheta_e = std::min(a.cosTheta_e, b.cosTheta_e);
+
+    // Return final _LightBounds_ union
+    return LightBounds(Union(a.bounds, b.bounds), cone.w, a.phi + b.phi,
+                       cone.cosTheta, cosTheta_e, a.twoSided | b.twoSided);
+}
+
 bool VisibilityTester::Unoccluded(const Scene &scene) const {
     return !scene.IntersectP(p0.SpawnRayTo(p1));
 }
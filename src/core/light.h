@@ -58,6 +58,40 @@ inline bool IsDeltaLight(int flags) {
            flags & (int)LightFlags::DeltaDirection;
 }
 
+// LightBounds Declarations
+
+// LightBounds conservatively describes where and in which directions a
+// light emits: _bounds_ contains the emitting points, the normal cone
+// around _w_ with half-angle $\theta_o$ bounds the emitters' orientations,
+// and emission falls to zero more than $\theta_e$ beyond that cone. _phi_ is the
+// power of an isotropic point emitter with the light's peak intensity.
+struct LightBounds {
+    // LightBounds Public Methods
+    LightBounds() {}
+    LightBounds(const Bounds3f &bounds, const Vector3f &w, Float phi,
+                Float cosTheta_o, Float cosTheta_e, bool twoSided)
+        : bounds(bounds),
+          w(w),
+          phi(phi),
+          cosTheta_o(cosTheta_o),
+          cosTheta_e(cosTheta_e),
+          twoSided(twoSided) {}
+    Point3f Centroid() const { return (bounds.pMin + bounds.pMax) / 2; }
+    // Returns a conservative estimate of the contribution of the bounded
+    // lights at the point _p_; _n_ is the surface normal at _p_, or zero
+    // for points in participating media.
+    Float Importance(const Point3f &p, const Normal3f &n) const;
+
+    // LightBounds Public Data
+    Bounds3f bounds;
+    Vector3f w;
+    Float phi = 0;
+    Float cosTheta_o = 1, cosTheta_e = 1;
+    bool twoSided = false;
+};
+
+LightBounds Union(const LightBounds &a, const LightBounds &b);
+
 // Light Declarations
 class Light {
   public:
@@ -77,6 +111,12 @@ class Light {
                                Float *pdfDir) const = 0;
     virtual void Pdf_Le(const Ray &ray, const Normal3f &nLight, Float *pdfPos,
                         Float *pdfDir) const = 0;
+    // Initializes _bounds_ and returns true for lights with finite spatial
+    // extent; infinite and distant lights return false.
+    virtual bool Bounds(LightBounds *bounds) const { return false; }
+    // Returns the light's offset in Scene::lights, which is also its index
+    // in light sampling distributions, or -1 if it isn't in a scene.
+    int Index() const { return index; }
 
     // Light Public Data
     const int flags;
@@ -86,6 +126,10 @@ class Light {
   protected:
     // Light Protected Data
     const Transform LightToWorld, WorldToLight;
+
+  private:
+    friend class Scene;
+    int index = -1;
 };
 
 class VisibilityTester {
@@ -109,6 +153,13 @@ class AreaLight : public Light {
     AreaLight(const Transform &LightToWorld, const MediumInterface &medium,
               int nSamples);
     virtual Spectrum L(const Interaction &intr, const Vector3f &w) const = 0;
+    // Returns the same density as Pdf_Li() for a direction |wi| along
+    // which the caller has already found the point |lightIsect| on this
+    // light, so lights needn't search for it themselves.
+    virtual Float Pdf_LiAt(const Interaction &ref, const Vector3f &wi,
+                           const SurfaceInteraction &lightIsect) const {
+        return Pdf_Li(ref, wi);
+    }
 };
 
 }  // namespace pbrt
@@ -30,16 +30,17 @@
 
  */
 
-// TODO (maybe): have integrators pre-prime the cache by rendering a very
-// low res image first?
-
 #include "lightdistrib.h"
+#include "camera.h"
+#include "film.h"
 #include "lowdiscrepancy.h"
 #include "parallel.h"
 #include "scene.h"
 #include "stats.h"
 #include "integrator.h"
+#include <algorithm>
 #include <numeric>
+#include <thread>
 
 namespace pbrt {
 
@@ -56,6 +57,12 @@ std::unique_ptr<LightDistribution> CreateLightSampleDistribution(
     else if (name == "spatial")
         return std::unique_ptr<LightDistribution>{
             new SpatialLightDistribution(scene)};
+    else if (name == "visibility")
+        return std::unique_ptr<LightDistribution>{
+            new SpatialLightDistribution(scene, 64, 64, true)};
+    else if (name == "bvh")
+        return std::unique_ptr<LightDistribution>{
+            new BVHLightDistribution(scene)};
     else {
         Error(
             "Light sample distribution type \"%s\" unknown. Using \"spatial\".",
@@ -65,6 +72,34 @@ std::unique_ptr<LightDistribution> CreateLightSampleDistribution(
     }
 }
 
+void PrebuildLightDistribution(LightDistribution *lightDistrib,
+                               const Scene &scene, const Camera &camera,
+                               int resolution) {
+    // There's nothing to sample in a scene without lights.
+    if (scene.lights.empty()) return;
+
+    // Trace rays through the centers of a coarse grid of cells over the
+    // film and prebuild the distributions at the first intersections.
+    Bounds2f bounds(camera.film->croppedPixelBounds);
+    Vector2f diag = bounds.Diagonal();
+    Float cellSize = std::max(diag.x, diag.y) / resolution;
+    int nx = std::max(1, int(std::ceil(diag.x / cellSize)));
+    int ny = std::max(1, int(std::ceil(diag.y / cellSize)));
+    std::vector<Point3f> points;
+    for (int y = 0; y < ny; ++y)
+        for (int x = 0; x < nx; ++x) {
+            CameraSample cs;
+            cs.pFilm = bounds.Lerp(Point2f((x + .5f) / nx, (y + .5f) / ny));
+            cs.pLens = Point2f(.5f, .5f);
+            cs.time = 0;
+            Ray ray;
+            SurfaceInteraction isect;
+            if (camera.GenerateRay(cs, &ray) > 0 && scene.Intersect(ray, &isect))
+                points.push_back(isect.p);
+        }
+    lightDistrib->Prebuild(points);
+}
+
 UniformLightDistribution::UniformLightDistribution(const Scene &scene) {
     std::vector<Float> prob(scene.lights.size(), Float(1));
     distrib.reset(new Distribution1D(&prob[0], int(prob.size())));
@@ -87,15 +122,97 @@ const Distribution1D *PowerLightDistribution::Lookup(const Point3f &p) const {
 STAT_COUNTER("SpatialLightDistribution/Distributions created", nCreated);
 STAT_RATIO("SpatialLightDistribution/Lookups per distribution", nLookups, nDistributions);
 STAT_INT_DISTRIBUTION("SpatialLightDistribution/Hash probes per lookup", nProbesPerLookup);
+STAT_RATIO("SpatialLightDistribution/Lights stored per voxel", nStoredLights,
+           nVoxelDistributions);
+STAT_COUNTER("SpatialLightDistribution/Chunks computed while waiting",
+             nHelperChunks);
+STAT_COUNTER("SpatialLightDistribution/Dense distributions", nDenseDistributions);
+STAT_MEMORY_COUNTER("Memory/Spatial light distributions",
+                    spatialLightDistribBytes);
+STAT_COUNTER("SpatialLightDistribution/Visibility updates", nVisibilityUpdates);
+STAT_PERCENT("SpatialLightDistribution/Unoccluded shadow rays",
+             nUnoccludedShadowRays, nRecordedShadowRays);
 
 // Voxel coordinates are packed into a uint64_t for hash table lookups;
 // 10 bits are allocated to each coordinate.  invalidPackedPos is an impossible
 // packed coordinate value, which we use to represent
 static const uint64_t invalidPackedPos = 0xffffffffffffffff;
 
+// The number of lights whose contributions are estimated together when
+// computing a voxel's distribution.
+static const int lightsPerChunk = 64;
+
+// The number of points in each voxel at which the lights' contributions
+// are estimated.
+static const int nVoxelSamples = 128;
+
+// When learning visibility, a voxel's distribution is updated after 256,
+// 512, 1024, ... shadow rays have been recorded for it, and then every
+// maxVisibilityUpdateInterval rays.
+static const uint64_t maxVisibilityUpdateInterval = 65536;
+
+// The fraction of probability given to the distribution that ignores
+// visibility when it is mixed with the one that accounts for it.
+static const Float defensiveFraction = .1f;
+
+SpatialLightDistribution::VoxelDistribution::VoxelDistribution(
+    std::vector<int> l, const Float *weights, int nLights)
+    : lights(std::move(l)),
+      distrib(weights, lights.empty() ? nLights : int(lights.size()) + 1),
+      nRemainder(lights.empty() ? 0 : nLights - int(lights.size())),
+      dense(nullptr) {}
+
+SpatialLightDistribution::VoxelDistribution::~VoxelDistribution() {
+    delete dense.load();
+}
+
+int SpatialLightDistribution::VoxelDistribution::Sample(Float u,
+                                                        Float *pdf) const {
+    Float uRemapped;
+    int index = distrib.SampleDiscrete(u, pdf, &uRemapped);
+    if (lights.empty()) return index;
+    if (index < int(lights.size())) return lights[index];
+
+    // Uniformly sample one of the lights that isn't stored individually:
+    // find the _r_th light index that isn't in the sorted _lights_ array.
+    int r = std::min(int(uRemapped * nRemainder), nRemainder - 1);
+    if (pdf) *pdf /= nRemainder;
+    for (int l : lights) {
+        if (l > r) break;
+        ++r;
+    }
+    return r;
+}
+
+Float SpatialLightDistribution::VoxelDistribution::PDF(int lightIndex) const {
+    int entry = Entry(lightIndex);
+    Float pdf = distrib.DiscretePDF(entry);
+    return (nRemainder > 0 && entry == int(lights.size())) ? pdf / nRemainder
+                                                           : pdf;
+}
+
+int SpatialLightDistribution::VoxelDistribution::Entry(int lightIndex) const {
+    if (lights.empty()) return lightIndex;
+    auto iter = std::lower_bound(lights.begin(), lights.end(), lightIndex);
+    if (iter != lights.end() && *iter == lightIndex)
+        return int(iter - lights.begin());
+    return int(lights.size());
+}
+
+size_t SpatialLightDistribution::VoxelDistribution::BytesUsed() const {
+    return sizeof(*this) + lights.capacity() * sizeof(int) +
+           distrib.BytesUsed();
+}
+
 SpatialLightDistribution::SpatialLightDistribution(const Scene &scene,
-                                                   int maxVoxels)
-    : scene(scene) {
+                                                   int maxVoxels,
+                                                   int maxVoxelLights,
+                                                   bool learnVisibility)
+    : scene(scene),
+      maxVoxelLights(maxVoxelLights),
+      nChunks((int(scene.lights.size()) + lightsPerChunk - 1) /
+              lightsPerChunk),
+      learnVisibility(learnVisibility) {
     // Compute the number of voxels so that the widest scene bounding box
     // dimension has maxVoxels voxels and the other dimensions have a number
     // of voxels so that voxels are roughly cube shaped.
@@ -109,13 +226,16 @@ SpatialLightDistribution::SpatialLightDistribution(const Scene &scene,
         // to imagine that this would ever be a problem.
         CHECK_LT(nVoxels[i], 1 << 20);
     }
+    CHECK_GT(maxVoxelLights, 0);
 
     hashTableSize = 4 * nVoxels[0] * nVoxels[1] * nVoxels[2];
     hashTable.reset(new HashEntry[hashTableSize]);
     for (int i = 0; i < hashTableSize; ++i) {
         hashTable[i].packedPos.store(invalidPackedPos);
+        hashTable[i].build.store(nullptr);
         hashTable[i].distribution.store(nullptr);
     }
+    spatialLightDistribBytes += hashTableSize * sizeof(HashEntry);
 
     LOG(INFO) << "SpatialLightDistribution: scene bounds " << b <<
         ", voxel res (" << nVoxels[0] << ", " << nVoxels[1] << ", " <<
@@ -123,21 +243,145 @@ SpatialLightDistribution::SpatialLightDistribution(const Scene &scene,
 }
 
 SpatialLightDistribution::~SpatialLightDistribution() {
-    // Gather statistics about how well the computed distributions are across
-    // the buckets.
     for (size_t i = 0; i < hashTableSize; ++i) {
         HashEntry &entry = hashTable[i];
-        if (entry.distribution.load())
-            delete entry.distribution.load();
+        delete entry.distribution.load();
+        delete entry.build.load();
     }
+    for (VoxelDistribution *dist : retired) delete dist;
 }
 
 const Distribution1D *SpatialLightDistribution::Lookup(const Point3f &p) const {
-    ProfilePhase _(Prof::LightDistribLookup);
-    ++nLookups;
+    const VoxelDistribution *vd = LookupVoxel(VoxelCoords(p));
+    if (vd->lights.empty()) return &vd->distrib;
+
+    // Expand the sparse distribution to one over all of the lights the
+    // first time it's needed. Racing threads may both do so; only one of
+    // the results is kept.
+    Distribution1D *dense = vd->dense.load(std::memory_order_acquire);
+    if (!dense) {
+        std::vector<Float> pdfs(scene.lights.size());
+        for (size_t i = 0; i < pdfs.size(); ++i) pdfs[i] = vd->PDF(int(i));
+        Distribution1D *newDense =
+            new Distribution1D(&pdfs[0], int(pdfs.size()));
+        if (vd->dense.compare_exchange_strong(dense, newDense)) {
+            dense = newDense;
+            ++nDenseDistributions;
+            spatialLightDistribBytes +=
+                sizeof(Distribution1D) + 2 * (pdfs.size() + 1) * sizeof(Float);
+        } else
+            delete newDense;
+    }
+    return dense;
+}
+
+int SpatialLightDistribution::SampleDiscrete(const Point3f &p,
+                                             const Normal3f &n, Float u,
+                                             Float *pdf) const {
+    return LookupVoxel(VoxelCoords(p))->Sample(u, pdf);
+}
+
+Float SpatialLightDistribution::DiscretePDF(const Point3f &p,
+                                            const Normal3f &n,
+                                            int lightIndex) const {
+    return LookupVoxel(VoxelCoords(p))->PDF(lightIndex);
+}
+
+void SpatialLightDistribution::Prebuild(const std::vector<Point3f> &points) {
+    // Without lights there are no chunks for BuildVoxel() to finish, so
+    // the distributions would never be published.
+    if (nChunks == 0) return;
+
+    // Find the distinct voxels that the points are in and then compute
+    // their distributions in parallel.
+    std::vector<uint64_t> packed;
+    packed.reserve(points.size());
+    for (const Point3f &p : points) {
+        Point3i pi = VoxelCoords(p);
+        packed.push_back((uint64_t(pi[0]) << 40) | (uint64_t(pi[1]) << 20) |
+                         pi[2]);
+    }
+    std::sort(packed.begin(), packed.end());
+    packed.erase(std::unique(packed.begin(), packed.end()), packed.end());
+    ParallelFor([&](int64_t i) {
+        uint64_t pp = packed[i];
+        LookupVoxel(Point3i(int(pp >> 40), int((pp >> 20) & 0xfffff),
+                            int(pp & 0xfffff)));
+    }, packed.size(), 8);
+    LOG(INFO) << "SpatialLightDistribution: prebuilt " << packed.size() <<
+        " voxel distributions for " << points.size() << " points";
+}
+
+void SpatialLightDistribution::RecordVisibility(const Point3f &p,
+                                                int lightIndex,
+                                                Float visibility) const {
+    if (!learnVisibility) return;
+    std::atomic<VoxelDistribution *> *distribution;
+    const VoxelDistribution *vd = LookupVoxel(VoxelCoords(p), &distribution);
+    VoxelVisibility &vv = *vd->visibility;
+    int entry = vd->Entry(lightIndex);
+    ++vv.traced[entry];
+    ++nRecordedShadowRays;
+    if (visibility > 0) {
+        ++vv.unoccluded[entry];
+        ++nUnoccludedShadowRays;
+    }
+
+    // Exactly one thread sees the count reach the next update point, so
+    // only that one computes the updated distribution.
+    uint64_t nRecorded = ++vv.nRecorded;
+    if (nRecorded == vv.nextUpdate.load()) {
+        vv.nextUpdate.store(nRecorded +
+                            std::min(nRecorded, maxVisibilityUpdateInterval));
+        UpdateVisibility(vd, *distribution);
+    }
+}
+
+void SpatialLightDistribution::UpdateVisibility(
+    const VoxelDistribution *current,
+    std::atomic<VoxelDistribution *> &distribution) const {
+    ProfilePhase _(Prof::LightDistribCreation);
+    ++nVisibilityUpdates;
+    // Scale each entry's weight by the fraction of its shadow rays that
+    // were unoccluded; entries without any shadow rays yet keep their
+    // weights.
+    const VoxelVisibility &vv = *current->visibility;
+    size_t nEntries = vv.baseWeights.size();
+    std::vector<Float> visibleWeights(nEntries);
+    Float baseSum = 0, visibleSum = 0;
+    for (size_t i = 0; i < nEntries; ++i) {
+        Float fraction = Float(vv.unoccluded[i].load() + 1) /
+                         Float(vv.traced[i].load() + 1);
+        visibleWeights[i] = vv.baseWeights[i] * fraction;
+        baseSum += vv.baseWeights[i];
+        visibleSum += visibleWeights[i];
+    }
+
+    // Mix the two distributions so that every light keeps at least
+    // defensiveFraction of its original probability.
+    std::vector<Float> weights(nEntries);
+    for (size_t i = 0; i < nEntries; ++i)
+        weights[i] = (1 - defensiveFraction) * visibleWeights[i] / visibleSum +
+                     defensiveFraction * vv.baseWeights[i] / baseSum;
+    VoxelDistribution *updated = new VoxelDistribution(
+        current->lights, &weights[0], int(scene.lights.size()));
+    updated->visibility = current->visibility;
+
+    // A slow thread may find that a later update has already replaced
+    // |current|, in which case its result is discarded.
+    VoxelDistribution *expected = const_cast<VoxelDistribution *>(current);
+    if (!distribution.compare_exchange_strong(expected, updated)) {
+        delete updated;
+        return;
+    }
+    spatialLightDistribBytes += updated->BytesUsed();
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    retired.push_back(const_cast<VoxelDistribution *>(current));
+}
 
-    // First, compute integer voxel coordinates for the given point |p|
-    // with respect to the overall voxel grid.
+Point3i SpatialLightDistribution::VoxelCoords(const Point3f &p) const {
+    // Compute integer voxel coordinates for the given point |p| with
+    // respect to the overall voxel grid.
     Vector3f offset = scene.WorldBound().Offset(p);  // offset in [0,1].
     Point3i pi;
     for (int i = 0; i < 3; ++i)
@@ -145,6 +389,15 @@ const Distribution1D *SpatialLightDistribution::Lookup(const Point3f &p) const {
         // robust to computed intersection points being slightly outside
         // the scene bounds due to floating-point roundoff error.
         pi[i] = Clamp(int(offset[i] * nVoxels[i]), 0, nVoxels[i] - 1);
+    return pi;
+}
+
+const SpatialLightDistribution::VoxelDistribution *
+SpatialLightDistribution::LookupVoxel(
+    const Point3i &pi,
+    std::atomic<VoxelDistribution *> **distribution) const {
+    ProfilePhase _(Prof::LightDistribLookup);
+    ++nLookups;
 
     // Pack the 3D integer voxel coordinates into a single 64-bit value.
     uint64_t packedPos = (uint64_t(pi[0]) << 40) | (uint64_t(pi[1]) << 20) | pi[2];
@@ -178,25 +431,30 @@ const Distribution1D *SpatialLightDistribution::Lookup(const Point3f &p) const {
         if (entryPackedPos == packedPos) {
             // Yes! Most of the time, there should already by a light
             // sampling distribution available.
-            Distribution1D *dist = entry.distribution.load(std::memory_order_acquire);
+            VoxelDistribution *dist =
+                entry.distribution.load(std::memory_order_acquire);
             if (dist == nullptr) {
                 // Rarely, another thread will have already done a lookup
                 // at this point, found that there isn't a sampling
                 // distribution, and will already be computing the
-                // distribution for the point.  In this case, we spin until
-                // the sampling distribution is ready.  We assume that this
-                // is a rare case, so don't do anything more sophisticated
-                // than spinning.
-                ProfilePhase _(Prof::LightDistribSpinWait);
-                while ((dist = entry.distribution.load(std::memory_order_acquire)) ==
-                       nullptr)
-                    // spin :-(. If we were fancy, we'd have any threads
-                    // that hit this instead help out with computing the
-                    // distribution for the voxel...
-                    ;
+                // distribution for the point.  In this case, we help out
+                // with the lights that haven't been started yet.  The
+                // entry's build pointer may not have been published yet
+                // by the thread that claimed the entry, in which case we
+                // briefly yield until it is.
+                VoxelBuild *build;
+                while ((build = entry.build.load(std::memory_order_acquire)) ==
+                       nullptr &&
+                       (dist = entry.distribution.load(
+                            std::memory_order_acquire)) == nullptr) {
+                    ProfilePhase _(Prof::LightDistribWait);
+                    std::this_thread::yield();
+                }
+                if (!dist) dist = BuildVoxel(build, entry.distribution, true);
             }
             // We have a valid sampling distribution.
             ReportValue(nProbesPerLookup, nProbes);
+            if (distribution) *distribution = &entry.distribution;
             return dist;
         } else if (entryPackedPos != invalidPackedPos) {
             // The hash table entry we're checking has already been
@@ -214,27 +472,58 @@ const Distribution1D *SpatialLightDistribution::Lookup(const Point3f &p) const {
             uint64_t invalid = invalidPackedPos;
             if (entry.packedPos.compare_exchange_weak(invalid, packedPos)) {
                 // Success; we've claimed this position for this voxel's
-                // distribution. Now compute the sampling distribution and
-                // add it to the hash table. As long as packedPos has been
-                // set but the entry's distribution pointer is nullptr, any
-                // other threads looking up the distribution for this voxel
-                // will spin wait until the distribution pointer is
-                // written.
-                Distribution1D *dist = ComputeDistribution(pi);
-                entry.distribution.store(dist, std::memory_order_release);
+                // distribution. Publish the state for computing it so
+                // that other threads looking up the distribution for
+                // this voxel can help, and then compute it.
+                ++nCreated;
+                ++nDistributions;
+                VoxelBuild *build =
+                    new VoxelBuild(pi, int(scene.lights.size()));
+                entry.build.store(build, std::memory_order_release);
+                VoxelDistribution *dist =
+                    BuildVoxel(build, entry.distribution, false);
                 ReportValue(nProbesPerLookup, nProbes);
+                if (distribution) *distribution = &entry.distribution;
                 return dist;
             }
         }
     }
 }
 
-Distribution1D *
-SpatialLightDistribution::ComputeDistribution(Point3i pi) const {
-    ProfilePhase _(Prof::LightDistribCreation);
-    ++nCreated;
-    ++nDistributions;
+SpatialLightDistribution::VoxelDistribution *
+SpatialLightDistribution::BuildVoxel(VoxelBuild *build,
+                                     std::atomic<VoxelDistribution *> &result,
+                                     bool helping) const {
+    // Claim chunks of lights until all of them have been started; the
+    // thread that finishes the last one computes the distribution.
+    int chunk;
+    while ((chunk = build->nextChunk++) < nChunks) {
+        if (helping) ++nHelperChunks;
+        int start = chunk * lightsPerChunk;
+        int end = std::min(start + lightsPerChunk, int(scene.lights.size()));
+        ComputeContributions(build->pi, start, end, &build->contrib[start]);
+        if (++build->chunksDone == nChunks) {
+            VoxelDistribution *dist =
+                CreateVoxelDistribution(build->pi, build->contrib.get());
+            // No other thread will touch the contributions again.
+            build->contrib.reset();
+            result.store(dist, std::memory_order_release);
+            return dist;
+        }
+    }
+
+    // Other threads are still working on their chunks; wait for them.
+    ProfilePhase _(Prof::LightDistribWait);
+    VoxelDistribution *dist;
+    while ((dist = result.load(std::memory_order_acquire)) == nullptr)
+        std::this_thread::yield();
+    return dist;
+}
 
+void SpatialLightDistribution::ComputeContributions(const Point3i &pi,
+                                                    int start, int end,
+                                                    Float *contrib) const {
+    ProfilePhase _(Prof::LightDistribCreation);
     // Compute the world-space bounding box of the voxel corresponding to
     // |pi|.
     Point3f p0(Float(pi[0]) / Float(nVoxels[0]),
@@ -246,15 +535,14 @@ SpatialLightDistribution::ComputeDistribution(Point3i pi) const {
     Bounds3f voxelBounds(scene.WorldBound().Lerp(p0),
                          scene.WorldBound().Lerp(p1));
 
-    // Compute the sampling distribution. Sample a number of points inside
+    // Compute the lights' contributions. Sample a number of points inside
     // voxelBounds using a 3D Halton sequence; at each one, sample each
     // light source and compute a weight based on Li/pdf for the light's
     // sample (ignoring visibility between the point in the voxel and the
     // point on the light source) as an approximation to how much the light
     // is likely to contribute to illumination in the voxel.
-    int nSamples = 128;
-    std::vector<Float> lightContrib(scene.lights.size(), Float(0));
-    for (int i = 0; i < nSamples; ++i) {
+    for (int j = start; j < end; ++j) contrib[j - start] = 0;
+    for (int i = 0; i < nVoxelSamples; ++i) {
         Point3f po = voxelBounds.Lerp(Point3f(
             RadicalInverse(0, i), RadicalInverse(1, i), RadicalInverse(2, i)));
         Interaction intr(po, Normal3f(), Vector3f(), Vector3f(1, 0, 0),
@@ -263,40 +551,373 @@ SpatialLightDistribution::ComputeDistribution(Point3i pi) const {
         // Use the next two Halton dimensions to sample a point on the
         // light source.
         Point2f u(RadicalInverse(3, i), RadicalInverse(4, i));
-        for (size_t j = 0; j < scene.lights.size(); ++j) {
+        for (int j = start; j < end; ++j) {
             Float pdf;
             Vector3f wi;
             VisibilityTester vis;
             Spectrum Li = scene.lights[j]->Sample_Li(intr, u, &wi, &pdf, &vis);
-            if (pdf > 0) {
+            // The first Halton point is the voxel's corner, which may
+            // coincide with a point light; skip the resulting infinite
+            // contributions, which would otherwise swamp all the others.
+            Float c = (pdf > 0) ? Li.y() / pdf : 0;
+            if (std::isfinite(c))
                 // TODO: look at tracing shadow rays / computing beam
                 // transmittance.  Probably shouldn't give those full weight
                 // but instead e.g. have an occluded shadow ray scale down
                 // the contribution by 10 or something.
-                lightContrib[j] += Li.y() / pdf;
-            }
+                contrib[j - start] += c;
         }
     }
+}
+
+SpatialLightDistribution::VoxelDistribution *
+SpatialLightDistribution::CreateVoxelDistribution(const Point3i &pi,
+                                                  Float *contrib) const {
+    ProfilePhase _(Prof::LightDistribCreation);
+    int nLights = int(scene.lights.size());
 
     // We don't want to leave any lights with a zero probability; it's
     // possible that a light contributes to points in the voxel even though
     // we didn't find such a point when sampling above.  Therefore, compute
     // a minimum (small) weight and ensure that all lights are given at
     // least the corresponding probability.
-    Float sumContrib =
-        std::accumulate(lightContrib.begin(), lightContrib.end(), Float(0));
-    Float avgContrib = sumContrib / (nSamples * lightContrib.size());
+    Float sumContrib = std::accumulate(contrib, contrib + nLights, Float(0));
+    Float avgContrib = sumContrib / (nVoxelSamples * nLights);
     Float minContrib = (avgContrib > 0) ? .001 * avgContrib : 1;
-    for (size_t i = 0; i < lightContrib.size(); ++i) {
+    for (int i = 0; i < nLights; ++i) {
         VLOG(2) << "Voxel pi = " << pi << ", light " << i << " contrib = "
-                << lightContrib[i];
-        lightContrib[i] = std::max(lightContrib[i], minContrib);
+                << contrib[i];
+        contrib[i] = std::max(contrib[i], minContrib);
     }
     LOG(INFO) << "Initialized light distribution in voxel pi= " <<  pi <<
         ", avgContrib = " << avgContrib;
 
-    // Compute a sampling distribution from the accumulated contributions.
-    return new Distribution1D(&lightContrib[0], int(lightContrib.size()));
+    VoxelDistribution *dist;
+    if (nLights <= maxVoxelLights) {
+        dist = new VoxelDistribution({}, contrib, nLights);
+        nStoredLights += nLights;
+    } else {
+        // Keep the maxVoxelLights lights with the largest contributions
+        // and give the sum of the others' to the remainder entry.
+        std::vector<int> lights(nLights);
+        std::iota(lights.begin(), lights.end(), 0);
+        std::nth_element(lights.begin(), lights.begin() + maxVoxelLights,
+                         lights.end(), [contrib](int a, int b) {
+                             return contrib[a] > contrib[b];
+                         });
+        std::vector<Float> weights(maxVoxelLights + 1, Float(0));
+        for (int i = maxVoxelLights; i < nLights; ++i)
+            weights[maxVoxelLights] += contrib[lights[i]];
+        lights.resize(maxVoxelLights);
+        lights.shrink_to_fit();
+        std::sort(lights.begin(), lights.end());
+        for (int i = 0; i < maxVoxelLights; ++i)
+            weights[i] = contrib[lights[i]];
+        dist = new VoxelDistribution(std::move(lights), &weights[0], nLights);
+        nStoredLights += maxVoxelLights;
+    }
+    if (learnVisibility) {
+        dist->visibility.reset(new VoxelVisibility(dist->distrib.func));
+        spatialLightDistribBytes += sizeof(VoxelVisibility) +
+            dist->distrib.func.size() *
+                (sizeof(Float) + 2 * sizeof(std::atomic<uint32_t>));
+    }
+    ++nVoxelDistributions;
+    spatialLightDistribBytes += dist->BytesUsed();
+    return dist;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// BVHLightDistribution
+
+STAT_MEMORY_COUNTER("Memory/Light BVH", lightBVHBytes);
+STAT_COUNTER("BVHLightDistribution/Nodes", nLightBVHNodes);
+STAT_COUNTER("BVHLightDistribution/Unbounded lights", nUnboundedLights);
+
+// Marks lights that aren't in the BVH in lightBitTrail; paths through the
+// tree never set the high bit since its depth is limited to 63.
+static const uint64_t notInBVH = 0xffffffffffffffff;
+
+BVHLightDistribution::BVHLightDistribution(const Scene &scene)
+    : lightBitTrail(scene.lights.size(), notInBVH),
+      powerDistrib(ComputeLightPowerDistribution(scene)) {
+    // Gather the bounds of lights with finite extent and nonzero power
+    std::vector<std::pair<int, LightBounds>> bvhLights;
+    for (size_t i = 0; i < scene.lights.size(); ++i) {
+        LightBounds lb;
+        if (!scene.lights[i]->Bounds(&lb)) {
+            infiniteLights.push_back(int(i));
+            ++nUnboundedLights;
+        } else if (lb.phi > 0)
+            bvhLights.push_back(std::make_pair(int(i), lb));
+    }
+    if (!bvhLights.empty()) BuildBVH(bvhLights, 0, int(bvhLights.size()), 0, 0);
+    nLightBVHNodes += nodes.size();
+    lightBVHBytes += nodes.size() * sizeof(LightBVHNode) +
+                     lightBitTrail.size() * sizeof(uint64_t) +
+                     infiniteLights.size() * sizeof(int);
+    LOG(INFO) << "BVHLightDistribution: " << bvhLights.size() <<
+        " lights in " << nodes.size() << " nodes, " << infiniteLights.size() <<
+        " unbounded lights";
+}
+
+std::pair<int, LightBounds> BVHLightDistribution::BuildBVH(
+    std::vector<std::pair<int, LightBounds>> &bvhLights, int start, int end,
+    uint64_t bitTrail, int depth) {
+    CHECK_LT(start, end);
+    // Initialize leaf node if only a single light remains
+    if (end - start == 1) {
+        int nodeIndex = int(nodes.size());
+        const std::pair<int, LightBounds> &light = bvhLights[start];
+        nodes.push_back({light.second, light.first, true});
+        lightBitTrail[light.first] = bitTrail;
+        return std::make_pair(nodeIndex, light.second);
+    }
+    CHECK_LT(depth, 63);
+
+    // Choose split dimension and position using modified SAH
+    // Compute bounds and centroid bounds for lights
+    Bounds3f bounds, centroidBounds;
+    for (int i = start; i < end; ++i) {
+        const LightBounds &lb = bvhLights[i].second;
+        bounds = Union(bounds, lb.bounds);
+        centroidBounds = Union(centroidBounds, lb.Centroid());
+    }
+
+    Float minCost = Infinity;
+    int minCostSplitBucket = -1, minCostSplitDim = -1;
+    constexpr int nBuckets = 12;
+    for (int dim = 0; dim < 3; ++dim) {
+        // Compute minimum cost bucket for splitting along dimension _dim_
+        if (centroidBounds.pMax[dim] == centroidBounds.pMin[dim]) continue;
+        // Compute _LightBounds_ for each bucket
+        LightBounds bucketLightBounds[nBuckets];
+        for (int i = start; i < end; ++i) {
+            Point3f pc = bvhLights[i].second.Centroid();
+            int b = nBuckets * centroidBounds.Offset(pc)[dim];
+            if (b == nBuckets) b = nBuckets - 1;
+            bucketLightBounds[b] =
+                Union(bucketLightBounds[b], bvhLights[i].second);
+        }
+
+        // Compute costs for splitting lights after each bucket
+        for (int i = 0; i < nBuckets - 1; ++i) {
+            // Find _LightBounds_ for lights below and above bucket split
+            LightBounds b0, b1;
+            for (int j = 0; j <= i; ++j)
+                b0 = Union(b0, bucketLightBounds[j]);
+            for (int j = i + 1; j < nBuckets; ++j)
+                b1 = Union(b1, bucketLightBounds[j]);
+
+            Float cost = EvaluateCost(b0, bounds, dim) +
+                         EvaluateCost(b1, bounds, dim);
+            if (cost > 0 && cost < minCost) {
+                minCost = cost;
+                minCostSplitBucket = i;
+                minCostSplitDim = dim;
+            }
+        }
+    }
+
+    // Partition lights according to chosen split
+    int mid;
+    if (minCostSplitDim == -1)
+        mid = (start + end) / 2;
+    else {
+        const auto *pmid = std::partition(
+            &bvhLights[start], &bvhLights[end - 1] + 1,
+            [=](const std::pair<int, LightBounds> &l) {
+                int b = nBuckets *
+                        centroidBounds.Offset(l.second.Centroid())[minCostSplitDim];
+                if (b == nBuckets) b = nBuckets - 1;
+                return b <= minCostSplitBucket;
+            });
+        mid = int(pmid - &bvhLights[0]);
+        if (mid == start || mid == end) mid = (start + end) / 2;
+    }
+
+    // Allocate interior node and recursively initialize children
+    int nodeIndex = int(nodes.size());
+    nodes.push_back({LightBounds(), -1, false});
+    std::pair<int, LightBounds> child0 =
+        BuildBVH(bvhLights, start, mid, bitTrail, depth + 1);
+    CHECK_EQ(nodeIndex + 1, child0.first);
+    std::pair<int, LightBounds> child1 = BuildBVH(
+        bvhLights, mid, end, bitTrail | (uint64_t(1) << depth), depth + 1);
+
+    // Initialize interior node and return node index and bounds
+    LightBounds lb = Union(child0.second, child1.second);
+    nodes[nodeIndex] = {lb, child1.first, false};
+    return std::make_pair(nodeIndex, lb);
+}
+
+Float BVHLightDistribution::EvaluateCost(const LightBounds &b,
+                                         const Bounds3f &bounds,
+                                         int dim) const {
+    // Evaluate direction bounds measure for _LightBounds_
+    Float theta_o = std::acos(Clamp(b.cosTheta_o, -1, 1));
+    Float theta_e = std::acos(Clamp(b.cosTheta_e, -1, 1));
+    Float theta_w = std::min(theta_o + theta_e, Pi);
+    Float sinTheta_o = std::sqrt(std::max<Float>(0, 1 - b.cosTheta_o *
+                                                            b.cosTheta_o));
+    Float M_omega = 2 * Pi * (1 - b.cosTheta_o) +
+                    Pi / 2 * (2 * theta_w * sinTheta_o -
+                              std::cos(theta_o - 2 * theta_w) -
+                              2 * theta_o * sinTheta_o + b.cosTheta_o);
+
+    // Return complete cost estimate for _LightBounds_, penalizing thin
+    // splits along short dimensions of the parent's bounds
+    Vector3f d = bounds.Diagonal();
+    Float Kr = MaxComponent(d) / d[dim];
+    return b.phi * M_omega * Kr * b.bounds.SurfaceArea();
+}
+
+const Distribution1D *BVHLightDistribution::Lookup(const Point3f &p) const {
+    return powerDistrib.get();
+}
+
+int BVHLightDistribution::SampleDiscrete(const Point3f &p, const Normal3f &n,
+                                         Float u, Float *pdf) const {
+    ProfilePhase _(Prof::LightDistribLookup);
+    // Sample an unbounded light with probability _pInfinite_
+    Float pInfinite = InfiniteLightProbability();
+    if (u < pInfinite) {
+        u /= pInfinite;
+        int index = std::min(int(u * infiniteLights.size()),
+                             int(infiniteLights.size()) - 1);
+        *pdf = pInfinite / infiniteLights.size();
+        return infiniteLights[index];
+    }
+
+    // Traverse the light BVH to sample a bounded light
+    *pdf = 0;
+    if (nodes.empty()) return 0;
+    u = std::min((u - pInfinite) / (1 - pInfinite), OneMinusEpsilon);
+    int lightIndex = SampleCluster(0, p, n, u, pdf);
+    *pdf *= 1 - pInfinite;
+    return *pdf > 0 ? lightIndex : 0;
+}
+
+int BVHLightDistribution::SampleCluster(int nodeIndex, const Point3f &p,
+                                        const Normal3f &n, Float u,
+                                        Float *pdf) const {
+    int rootIndex = nodeIndex;
+    Float pmf = 1;
+    *pdf = 0;
+    while (true) {
+        const LightBVHNode &node = nodes[nodeIndex];
+        if (node.isLeaf) {
+            // Return the leaf's light unless it can't contribute at _p_
+            if (nodeIndex != rootIndex ||
+                node.lightBounds.Importance(p, n) > 0) {
+                *pdf = pmf;
+                return node.childOrLightIndex;
+            }
+            return 0;
+        }
+        // Choose a child with probability proportional to its importance
+        Float ci0 = nodes[nodeIndex + 1].lightBounds.Importance(p, n);
+        Float ci1 = nodes[node.childOrLightIndex].lightBounds.Importance(p, n);
+        if (ci0 == 0 && ci1 == 0) return 0;
+        Float p0 = ci0 / (ci0 + ci1);
+        if (u < p0) {
+            pmf *= p0;
+            u = std::min(u / p0, OneMinusEpsilon);
+            nodeIndex = nodeIndex + 1;
+        } else {
+            pmf *= 1 - p0;
+            u = std::min((u - p0) / (1 - p0), OneMinusEpsilon);
+            nodeIndex = node.childOrLightIndex;
+        }
+    }
+}
+
+int BVHLightDistribution::ComputeCut(const Point3f &p, const Normal3f &n,
+                                     Float maxError, int maxCutSize,
+                                     int *cut) const {
+    ProfilePhase _(Prof::LightDistribLookup);
+    if (nodes.empty() || maxCutSize < 1) return 0;
+    Float rootImportance = nodes[0].lightBounds.Importance(p, n);
+    if (rootImportance == 0) return 0;
+    if (nodes[0].isLeaf) {
+        cut[0] = 0;
+        return 1;
+    }
+
+    // Leaves that enter the cut are final and are stored at the start of
+    // _cut_; interior nodes wait in a max-heap ordered by importance.
+    struct Cluster {
+        Float importance;
+        int nodeIndex;
+        bool operator<(const Cluster &c) const {
+            return importance < c.importance;
+        }
+    };
+    Cluster *heap = ALLOCA(Cluster, maxCutSize);
+    int nHeap = 0, nLeaves = 0;
+    heap[nHeap++] = {rootImportance, 0};
+    Float totalImportance = rootImportance;
+    while (nHeap > 0 && nLeaves + nHeap < maxCutSize) {
+        // Stop once the least accurate cluster is within the error bound
+        if (heap[0].importance <= maxError * totalImportance) break;
+
+        // Replace the cluster with its children that can contribute
+        std::pop_heap(heap, heap + nHeap);
+        Cluster cluster = heap[--nHeap];
+        int nodeIndex = cluster.nodeIndex;
+        totalImportance -= cluster.importance;
+        for (int child : {nodeIndex + 1, nodes[nodeIndex].childOrLightIndex}) {
+            Float importance = nodes[child].lightBounds.Importance(p, n);
+            if (importance == 0) continue;
+            totalImportance += importance;
+            if (nodes[child].isLeaf)
+                cut[nLeaves++] = child;
+            else {
+                heap[nHeap++] = {importance, child};
+                std::push_heap(heap, heap + nHeap);
+            }
+        }
+    }
+    for (int i = 0; i < nHeap; ++i) cut[nLeaves++] = heap[i].nodeIndex;
+    return nLeaves;
+}
+
+Float BVHLightDistribution::DiscretePDF(const Point3f &p, const Normal3f &n,
+                                        int lightIndex) const {
+    ProfilePhase _(Prof::LightDistribLookup);
+    // Handle lights that aren't stored in the BVH
+    uint64_t bitTrail = lightBitTrail[lightIndex];
+    Float pInfinite = InfiniteLightProbability();
+    if (bitTrail == notInBVH) {
+        if (std::find(infiniteLights.begin(), infiniteLights.end(),
+                      lightIndex) != infiniteLights.end())
+            return pInfinite / infiniteLights.size();
+        return 0;
+    }
+
+    // Compute the light's probability by following its path from the root
+    Float pmf = 1 - pInfinite;
+    int nodeIndex = 0;
+    while (true) {
+        const LightBVHNode &node = nodes[nodeIndex];
+        if (node.isLeaf) {
+            CHECK_EQ(lightIndex, node.childOrLightIndex);
+            return (nodeIndex > 0 || node.lightBounds.Importance(p, n) > 0)
+                       ? pmf
+                       : 0;
+        }
+        Float ci0 = nodes[nodeIndex + 1].lightBounds.Importance(p, n);
+        Float ci1 = nodes[node.childOrLightIndex].lightBounds.Importance(p, n);
+        if (ci0 == 0 && ci1 == 0) return 0;
+        if (bitTrail & 1) {
+            pmf *= ci1 / (ci0 + ci1);
+            nodeIndex = node.childOrLightIndex;
+        } else {
+            pmf *= ci0 / (ci0 + ci1);
+            nodeIndex = nodeIndex + 1;
+        }
+        bitTrail >>= 1;
+    }
 }
 
 }  // namespace pbrt
@@ -36,6 +36,7 @@
 #include "pbrt.h"
 #include "geometry.h"
 #include "sampling.h"
+#include "light.h"
 #include <atomic>
 #include <functional>
 #include <mutex>
@@ -54,11 +55,47 @@ class LightDistribution {
     // Given a point |p| in space, this method returns a (hopefully
     // effective) sampling distribution for light sources at that point.
     virtual const Distribution1D *Lookup(const Point3f &p) const = 0;
+
+    // Samples a light source for the point |p| with surface normal |n|
+    // (zero for points in participating media) and returns its index in
+    // scene.lights along with the probability of having chosen it. The
+    // default implementation samples the distribution from Lookup();
+    // distributions that can't afford a Distribution1D for each point
+    // override these methods.
+    virtual int SampleDiscrete(const Point3f &p, const Normal3f &n, Float u,
+                               Float *pdf) const {
+        return Lookup(p)->SampleDiscrete(u, pdf);
+    }
+    // Returns the probability that SampleDiscrete() chooses the light
+    // |lightIndex| for the given point.
+    virtual Float DiscretePDF(const Point3f &p, const Normal3f &n,
+                              int lightIndex) const {
+        return Lookup(p)->DiscretePDF(lightIndex);
+    }
+
+    // Computes the distributions for the given points ahead of rendering,
+    // e.g. for points found by a coarse first pass over the image, for
+    // distributions that are otherwise built lazily.
+    virtual void Prebuild(const std::vector<Point3f> &points) {}
+
+    // Reports the outcome of a shadow ray traced from |p| toward a sample
+    // on light |lightIndex|: |visibility| is its transmittance, zero if
+    // the ray was blocked. Distributions that learn visibility override
+    // this method.
+    virtual void RecordVisibility(const Point3f &p, int lightIndex,
+                                  Float visibility) const {}
 };
 
 std::unique_ptr<LightDistribution> CreateLightSampleDistribution(
     const std::string &name, const Scene &scene);
 
+// Traces a coarse grid of camera rays with |resolution| rays along the
+// film's larger dimension and prebuilds |lightDistrib|'s distributions at
+// the points that they hit.
+void PrebuildLightDistribution(LightDistribution *lightDistrib,
+                               const Scene &scene, const Camera &camera,
+                               int resolution = 64);
+
 // The simplest possible implementation of LightDistribution: this returns
 // a uniform distribution over all light sources, ignoring the provided
 // point. This approach works well for very simple scenes, but is quite
@@ -70,6 +107,16 @@ class UniformLightDistribution : public LightDistribution {
   public:
     UniformLightDistribution(const Scene &scene);
     const Distribution1D *Lookup(const Point3f &p) const;
+    int SampleDiscrete(const Point3f &p, const Normal3f &n, Float u,
+                       Float *pdf) const {
+        int nLights = distrib->Count();
+        if (pdf) *pdf = Float(1) / nLights;
+        return std::min(int(u * nLights), nLights - 1);
+    }
+    Float DiscretePDF(const Point3f &p, const Normal3f &n,
+                      int lightIndex) const {
+        return Float(1) / distrib->Count();
+    }
 
   private:
     std::unique_ptr<Distribution1D> distrib;
@@ -96,34 +143,193 @@ class PowerLightDistribution : public LightDistribution {
 // A spatially-varying light distribution that adjusts the probability of
 // sampling a light source based on an estimate of its contribution to a
 // region of space.  A fixed voxel grid is imposed over the scene bounds
-// and a sampling distribution is computed as needed for each voxel.
+// and a sampling distribution is computed as needed for each voxel.  Each
+// voxel stores only its |maxVoxelLights| most important lights, sampled in
+// proportion to their estimated contributions; the remaining lights share
+// the rest of the probability uniformly.
+//
+// If |learnVisibility| is set, the distribution also counts how many of
+// the shadow rays traced from each voxel toward each of its lights were
+// unoccluded and periodically reweights the voxel's lights by those
+// fractions.  The result is mixed with the original distribution so that
+// lights that were unlucky early on are still sampled.
 class SpatialLightDistribution : public LightDistribution {
   public:
-    SpatialLightDistribution(const Scene &scene, int maxVoxels = 64);
+    SpatialLightDistribution(const Scene &scene, int maxVoxels = 64,
+                             int maxVoxelLights = 64,
+                             bool learnVisibility = false);
     ~SpatialLightDistribution();
+    // Returns a full-length distribution for the voxel containing |p|,
+    // which is expanded from the voxel's sparse distribution on first use.
     const Distribution1D *Lookup(const Point3f &p) const;
+    int SampleDiscrete(const Point3f &p, const Normal3f &n, Float u,
+                       Float *pdf) const;
+    Float DiscretePDF(const Point3f &p, const Normal3f &n,
+                      int lightIndex) const;
+    void Prebuild(const std::vector<Point3f> &points);
+    void RecordVisibility(const Point3f &p, int lightIndex,
+                          Float visibility) const;
 
   private:
-    // Compute the sampling distribution for the voxel with integer
-    // coordiantes given by "pi".
-    Distribution1D *ComputeDistribution(Point3i pi) const;
+    // Shadow ray statistics for each entry of a voxel's distribution,
+    // shared by the successive distributions computed for the voxel.
+    struct VoxelVisibility {
+        VoxelVisibility(const std::vector<Float> &weights)
+            : baseWeights(weights),
+              traced(new std::atomic<uint32_t>[weights.size()]()),
+              unoccluded(new std::atomic<uint32_t>[weights.size()]()) {}
+        // The entries' weights estimated without visibility
+        const std::vector<Float> baseWeights;
+        std::unique_ptr<std::atomic<uint32_t>[]> traced, unoccluded;
+        std::atomic<uint64_t> nRecorded{0}, nextUpdate{256};
+    };
+
+    // The sampling distribution for a voxel: |lights| holds the sorted
+    // indices of the lights sampled according to |distrib|; its final
+    // entry, present when not all lights are stored, gives the
+    // probability of uniformly sampling one of the others.
+    struct VoxelDistribution {
+        VoxelDistribution(std::vector<int> lights, const Float *weights,
+                          int nLights);
+        ~VoxelDistribution();
+        int Sample(Float u, Float *pdf) const;
+        Float PDF(int lightIndex) const;
+        // Returns the entry of |distrib| that light |lightIndex| is
+        // sampled with.
+        int Entry(int lightIndex) const;
+        size_t BytesUsed() const;
+
+        std::vector<int> lights;
+        Distribution1D distrib;
+        int nRemainder;
+        mutable std::atomic<Distribution1D *> dense;
+        std::shared_ptr<VoxelVisibility> visibility;
+    };
+
+    // Voxel distributions are computed cooperatively: the lights are
+    // split into chunks, and every thread that looks up a voxel while its
+    // distribution is being computed claims chunks and estimates their
+    // contributions, rather than waiting for the thread that got there
+    // first.
+    struct VoxelBuild {
+        VoxelBuild(const Point3i &pi, int nLights)
+            : pi(pi), contrib(new Float[nLights]) {}
+        const Point3i pi;
+        std::unique_ptr<Float[]> contrib;
+        std::atomic<int> nextChunk{0}, chunksDone{0};
+    };
+
+    // Returns the integer coordinates of the voxel containing |p|.
+    Point3i VoxelCoords(const Point3f &p) const;
+    // Returns the sampling distribution for the voxel "pi", computing it
+    // first if necessary.  The voxel's distribution is returned in
+    // |distribution| if it's non-null.
+    const VoxelDistribution *LookupVoxel(
+        const Point3i &pi,
+        std::atomic<VoxelDistribution *> **distribution = nullptr) const;
+    // Computes chunks of the distribution under construction in |build|
+    // until none remain and returns it once it is available; |helping|
+    // indicates that another thread claimed the voxel.
+    VoxelDistribution *BuildVoxel(VoxelBuild *build,
+                                  std::atomic<VoxelDistribution *> &result,
+                                  bool helping) const;
+    // Estimates the contributions of lights |start| through |end|-1 to
+    // the voxel with integer coordinates given by "pi".
+    void ComputeContributions(const Point3i &pi, int start, int end,
+                              Float *contrib) const;
+    VoxelDistribution *CreateVoxelDistribution(const Point3i &pi,
+                                               Float *contrib) const;
+    // Replaces the voxel distribution |current| with one that accounts
+    // for the visibility recorded so far.
+    void UpdateVisibility(const VoxelDistribution *current,
+                          std::atomic<VoxelDistribution *> &distribution) const;
 
     const Scene &scene;
     int nVoxels[3];
+    const int maxVoxelLights, nChunks;
+    const bool learnVisibility;
+    // Distributions replaced by UpdateVisibility(); other threads may
+    // still be using them, so they're freed in the destructor.
+    mutable std::mutex retiredMutex;
+    mutable std::vector<VoxelDistribution *> retired;
 
     // The hash table is a fixed number of HashEntry structs (where we
     // allocate more than enough entries in the SpatialLightDistribution
     // constructor). During rendering, the table is allocated without
-    // locks, using atomic operations. (See the Lookup() method
+    // locks, using atomic operations. (See the LookupVoxel() method
     // implementation for details.)
     struct HashEntry {
         std::atomic<uint64_t> packedPos;
-        std::atomic<Distribution1D *> distribution;
+        std::atomic<VoxelBuild *> build;
+        std::atomic<VoxelDistribution *> distribution;
     };
     mutable std::unique_ptr<HashEntry[]> hashTable;
     size_t hashTableSize;
 };
 
+// BVHLightDistribution organizes the lights with finite extent in a
+// bounding volume hierarchy whose nodes store the LightBounds of the
+// lights below them. Sampling a light for a point descends the tree,
+// choosing each child in proportion to its estimated contribution at the
+// point, so that both sampling and PDF evaluation take O(log n) time and
+// no per-point distributions are stored. Lights without bounds (infinite
+// and distant lights) are sampled uniformly with a fixed probability.
+// Lookup() returns a distribution proportional to light power for callers
+// that need a single distribution everywhere, like BDPT's light subpaths.
+class BVHLightDistribution : public LightDistribution {
+  public:
+    BVHLightDistribution(const Scene &scene);
+    const Distribution1D *Lookup(const Point3f &p) const;
+    int SampleDiscrete(const Point3f &p, const Normal3f &n, Float u,
+                       Float *pdf) const;
+    Float DiscretePDF(const Point3f &p, const Normal3f &n,
+                      int lightIndex) const;
+    // Stores in _cut_ the indices of BVH nodes that partition the bounded
+    // lights that can contribute at _p_, refining the node with the
+    // largest importance until no interior node's importance exceeds
+    // _maxError_ times the cut's total or the cut has _maxCutSize_ nodes.
+    // Returns the number of nodes in the cut.
+    int ComputeCut(const Point3f &p, const Normal3f &n, Float maxError,
+                   int maxCutSize, int *cut) const;
+    // Samples one of the lights below the BVH node _nodeIndex_ with
+    // probability proportional to the importance of the subtrees along
+    // the way; *pdf is zero if none of them can contribute at _p_.
+    int SampleCluster(int nodeIndex, const Point3f &p, const Normal3f &n,
+                      Float u, Float *pdf) const;
+    const std::vector<int> &UnboundedLights() const { return infiniteLights; }
+
+  private:
+    // BVHLightDistribution Private Declarations
+    struct LightBVHNode {
+        LightBounds lightBounds;
+        // The second child's offset for interior nodes (the first child
+        // immediately follows its parent) and the light's index in
+        // scene.lights for leaves.
+        int childOrLightIndex;
+        bool isLeaf;
+    };
+
+    // BVHLightDistribution Private Methods
+    std::pair<int, LightBounds> BuildBVH(
+        std::vector<std::pair<int, LightBounds>> &bvhLights, int start,
+        int end, uint64_t bitTrail, int depth);
+    Float EvaluateCost(const LightBounds &b, const Bounds3f &bounds,
+                       int dim) const;
+    Float InfiniteLightProbability() const {
+        if (infiniteLights.empty()) return 0;
+        return Float(infiniteLights.size()) /
+               Float(infiniteLights.size() + (nodes.empty() ? 0 : 1));
+    }
+
+    // BVHLightDistribution Private Data
+    std::vector<LightBVHNode> nodes;
+    std::vector<int> infiniteLights;
+    // For each light, the path from the root to its leaf: bit i gives the
+    // child taken at depth i.
+    std::vector<uint64_t> lightBitTrail;
+    std::unique_ptr<Distribution1D> powerDistrib;
+};
+
 }  // namespace pbrt
 
 #endif  // PBRT_CORE_LIGHTDISTRIB_H
@@ -62,6 +62,7 @@ inline float SobolSampleFloat(int64_t index, int dimension,
                               uint32_t scramble = 0);
 inline double SobolSampleDouble(int64_t index, int dimension,
                                 uint64_t scramble = 0);
+inline uint32_t SobolSampleBits32(int64_t index, int dimension);
 
 // Low Discrepancy Inline Functions
 inline uint32_t ReverseBits32(uint32_t n) {
@@ -79,6 +80,20 @@ inline uint64_t ReverseBits64(uint64_t n) {
     return (n0 << 32) | n1;
 }
 
+// Applies a nested uniform (Owen) scramble to the bits of _v_, read as a
+// binary fraction, using the hash-based permutation from Burley's
+// "Practical Hash-based Owen Scrambling": each bit is flipped according to
+// a hash of _seed_ and the more significant bits.
+inline uint32_t OwenScramble(uint32_t v, uint32_t seed) {
+    v = ReverseBits32(v);
+    v += seed;
+    v ^= v * 0x6c50b47cu;
+    v ^= v * 0xb82f1e52u;
+    v ^= v * 0xc7afe638u;
+    v ^= v * 0x8d22f6e6u;
+    return ReverseBits32(v);
+}
+
 template <int base>
 inline uint64_t InverseRadicalInverse(uint64_t inverse, int nDigits) {
     uint64_t index = 0;
@@ -273,6 +288,15 @@ inline float SobolSampleFloat(int64_t a, int dimension, uint32_t scramble) {
 #endif
 }
 
+// Returns the 32-bit fixed-point Sobol$'$ sample _a_ for _dimension_
+inline uint32_t SobolSampleBits32(int64_t a, int dimension) {
+    CHECK_LT(dimension, NumSobolDimensions);
+    uint32_t v = 0;
+    for (int i = dimension * SobolMatrixSize; a != 0; a >>= 1, i++)
+        if (a & 1) v ^= SobolMatrices32[i];
+    return v;
+}
+
 inline double SobolSampleDouble(int64_t a, int dimension, uint64_t scramble) {
   CHECK_LT(dimension, NumSobolDimensions) <<
       "Integrator has consumed too many Sobol' dimensions; you "
@@ -190,6 +190,30 @@ bool GetMediumScatteringProperties(const std::string &name, Spectrum *sigma_a,
     return false;
 }
 
+Spectrum SampleHomogeneousFreeFlight(const Spectrum &sigma_t,
+                                     const Spectrum &sigma_s, Float tMax,
+                                     const Point2f &u, Float *t,
+                                     bool *sampledMedium) {
+    // Sample a channel and distance up to _tMax_, both in world-space units
+    int channel = std::min((int)(u[0] * Spectrum::nSamples),
+                           Spectrum::nSamples - 1);
+    Float dist = -std::log(1 - u[1]) / sigma_t[channel];
+    *t = std::min(dist, tMax);
+    *sampledMedium = *t < tMax;
+
+    // Compute the transmittance and sampling density
+    Spectrum Tr = Exp(-sigma_t * std::min(*t, MaxFloat));
+    Spectrum density = *sampledMedium ? (sigma_t * Tr) : Tr;
+    Float pdf = 0;
+    for (int i = 0; i < Spectrum::nSamples; ++i) pdf += density[i];
+    pdf *= 1 / (Float)Spectrum::nSamples;
+    if (pdf == 0) {
+        CHECK(Tr.IsBlack());
+        pdf = 1;
+    }
+    return *sampledMedium ? (Tr * sigma_s / pdf) : (Tr / pdf);
+}
+
 // HenyeyGreenstein Method Definitions
 Float HenyeyGreenstein::Sample_p(const Vector3f &wo, Vector3f *wi,
                                  const Point2f &u) const {
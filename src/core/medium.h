@@ -64,6 +64,10 @@ inline std::ostream &operator<<(std::ostream &os, const PhaseFunction &p) {
 
 bool GetMediumScatteringProperties(const std::string &name, Spectrum *sigma_a,
                                    Spectrum *sigma_s);
+Spectrum SampleHomogeneousFreeFlight(const Spectrum &sigma_t,
+                                     const Spectrum &sigma_s, Float tMax,
+                                     const Point2f &u, Float *t,
+                                     bool *sampledMedium);
 
 // Media Inline Functions
 inline Float PhaseHG(Float cosTheta, Float g) {
@@ -44,11 +44,15 @@
 #include "texture.h"
 #include "stats.h"
 #include "parallel.h"
+#include "texcache.h"
+#include <array>
+#include <mutex>
 
 namespace pbrt {
 
 STAT_COUNTER("Texture/EWA lookups", nEWALookups);
 STAT_COUNTER("Texture/Trilinear lookups", nTrilerpLookups);
+STAT_COUNTER("Texture/Anisotropic lookups", nAnisoLookups);
 STAT_MEMORY_COUNTER("Memory/Texture MIP maps", mipMapMemory);
 
 // MIPMap Helper Declarations
@@ -58,22 +62,70 @@ struct ResampleWeight {
     Float weight[4];
 };
 
+// In-memory encodings of MIPMap texels. _Half_ stores each channel as a
+// 16-bit float. _SRGB8_ and _Linear8_ store a byte per channel that is
+// decoded through a lookup table. _SRGBBC_ and _LinearBC_ compress each
+// 4x4 block of RGB texels to two endpoint colors, encoded with the
+// corresponding byte table, and 2-bit interpolation indices.
+enum class TexelFormat { Float, Half, SRGB8, Linear8, SRGBBC, LinearBC };
+
+// Per-channel access to texel values for the compact texel formats
+template <typename T>
+struct TexelTraits {
+    static const int nChannels = T::nSamples;
+    static Float Get(const T &v, int c) { return v[c]; }
+    static void Set(T *v, int c, Float x) { (*v)[c] = x; }
+};
+
+template <>
+struct TexelTraits<Float> {
+    static const int nChannels = 1;
+    static Float Get(Float v, int c) { return v; }
+    static void Set(Float *v, int c, Float x) { *v = x; }
+};
+
+struct BCBlock {
+    uint8_t endpoints[2][3];
+    // 2-bit palette indices of the texels, one byte per row
+    uint8_t indices[4];
+};
+
 // MIPMap Declarations
 template <typename T>
 class MIPMap {
   public:
     // MIPMap Public Methods
     MIPMap(const Point2i &resolution, const T *data, bool doTri = false,
-           Float maxAniso = 8.f, ImageWrap wrapMode = ImageWrap::Repeat);
+           Float maxAniso = 8.f, ImageWrap wrapMode = ImageWrap::Repeat,
+           int maxProbes = 0, TexelFormat format = TexelFormat::Float,
+           Float encodingScale = 1);
+    MIPMap(std::unique_ptr<TiledImage> image,
+           std::function<T(const RGBSpectrum &)> convert, bool doTri = false,
+           Float maxAniso = 8.f, ImageWrap wrapMode = ImageWrap::Repeat,
+           int maxProbes = 0);
+    ~MIPMap();
     int Width() const { return resolution[0]; }
     int Height() const { return resolution[1]; }
-    int Levels() const { return pyramid.size(); }
-    const T &Texel(int level, int s, int t) const;
+    int Levels() const { return levelResolution.size(); }
+    const Point2i &LevelResolution(int level) const {
+        return levelResolution[level];
+    }
+    T Texel(int level, int s, int t) const;
     T Lookup(const Point2f &st, Float width = 0.f) const;
     T Lookup(const Point2f &st, Vector2f dstdx, Vector2f dstdy) const;
 
   private:
+    // MIPMap Private Declarations
+    // The tile of a tiled MIPMap that a lookup last read from, so that
+    // neighboring texels don't each go through the _TextureCache_
+    struct TileHandle {
+        int level = -1;
+        Point2i tile;
+        std::shared_ptr<const void> texels;
+    };
+
     // MIPMap Private Methods
+    T texel(int level, int s, int t, TileHandle *handle) const;
     std::unique_ptr<ResampleWeight[]> resampleWeights(int oldRes, int newRes) {
         CHECK_GE(newRes, oldRes);
         std::unique_ptr<ResampleWeight[]> wt(new ResampleWeight[newRes]);
@@ -99,26 +151,56 @@ class MIPMap {
     SampledSpectrum clamp(const SampledSpectrum &v) {
         return v.Clamp(0.f, Infinity);
     }
+    T trilinear(const Point2f &st, Float width) const;
     T triangle(int level, const Point2f &st) const;
     T EWA(int level, Point2f st, Vector2f dst0, Vector2f dst1) const;
+    T anisotropic(const Point2f &st, const Vector2f &dst0, Float majorLength,
+                  Float minorLength) const;
+    static void InitWeightLut();
+    size_t compact(TexelFormat format, Float scale);
+    uint8_t encodeByte(Float v) const;
+    void encodeBCBlock(int level, int bs, int bt, BCBlock *block) const;
+    T decodeBC(int level, int s, int t) const;
 
     // MIPMap Private Data
     const bool doTrilinear;
     const Float maxAnisotropy;
     const ImageWrap wrapMode;
+    // If nonzero, anisotropic lookups average at most this many trilinear
+    // probes along the ellipse's major axis instead of EWA filtering
+    const int maxProbes;
     Point2i resolution;
+    std::vector<Point2i> levelResolution;
     std::vector<std::unique_ptr<BlockedArray<T>>> pyramid;
+
+    // Texels of tiled MIPMaps are paged in through the _TextureCache_
+    std::unique_ptr<TiledImage> tiledImage;
+    std::function<T(const RGBSpectrum &)> convert;
+    int cacheId = -1;
+
+    // Compactly encoded levels replace _pyramid_ unless _format_ is
+    // _TexelFormat::Float_
+    typedef std::array<uint8_t, TexelTraits<T>::nChannels> ByteTexel;
+    typedef std::array<uint16_t, TexelTraits<T>::nChannels> HalfTexel;
+    TexelFormat format = TexelFormat::Float;
+    Float byteDecode[256];
+    std::vector<std::unique_ptr<BlockedArray<ByteTexel>>> bytePyramid;
+    std::vector<std::unique_ptr<BlockedArray<HalfTexel>>> halfPyramid;
+    std::vector<std::vector<BCBlock>> bcPyramid;
     static PBRT_CONSTEXPR int WeightLUTSize = 128;
+    static PBRT_CONSTEXPR int EWARowChunk = 64;
     static Float weightLut[WeightLUTSize];
 };
 
 // MIPMap Method Definitions
 template <typename T>
 MIPMap<T>::MIPMap(const Point2i &res, const T *img, bool doTrilinear,
-                  Float maxAnisotropy, ImageWrap wrapMode)
+                  Float maxAnisotropy, ImageWrap wrapMode, int maxProbes,
+                  TexelFormat format, Float encodingScale)
     : doTrilinear(doTrilinear),
       maxAnisotropy(maxAnisotropy),
       wrapMode(wrapMode),
+      maxProbes(maxProbes),
       resolution(res) {
     ProfilePhase _(Prof::MIPMapCreation);
 
@@ -184,12 +266,44 @@ MIPMap<T>::MIPMap(const Point2i &res, const T *img, bool doTrilinear,
     // Initialize levels of MIPMap from image
     int nLevels = 1 + Log2Int(std::max(resolution[0], resolution[1]));
     pyramid.resize(nLevels);
+    for (int i = 0; i < nLevels; ++i)
+        levelResolution.push_back(Point2i(std::max(1, resolution[0] >> i),
+                                          std::max(1, resolution[1] >> i)));
 
     // Initialize most detailed level of MIPMap
-    pyramid[0].reset(
-        new BlockedArray<T>(resolution[0], resolution[1],
-                            resampledImage ? resampledImage.get() : img));
-    for (int i = 1; i < nLevels; ++i) {
+    const T *level0 = resampledImage ? resampledImage.get() : img;
+    pyramid[0].reset(new BlockedArray<T>(resolution[0], resolution[1]));
+    ParallelFor([&](int t) {
+        for (int s = 0; s < resolution[0]; ++s)
+            (*pyramid[0])(s, t) = level0[t * resolution[0] + s];
+    }, resolution[1], 16);
+
+    // Initialize the finer levels of MIPMap in a single parallel pass over
+    // square blocks of the most detailed level; the texels a block's
+    // sub-pyramid is filtered from all lie inside the block, so no
+    // boundary handling is needed for these levels.
+    int nBlockLevels =
+        std::min(6, Log2Int(std::min(resolution[0], resolution[1])));
+    for (int i = 1; i <= nBlockLevels; ++i)
+        pyramid[i].reset(new BlockedArray<T>(levelResolution[i][0],
+                                             levelResolution[i][1]));
+    int blockSize = 1 << nBlockLevels;
+    Point2i nBlocks(resolution[0] / blockSize, resolution[1] / blockSize);
+    ParallelFor2D([&](Point2i block) {
+        for (int i = 1; i <= nBlockLevels; ++i) {
+            const BlockedArray<T> &prev = *pyramid[i - 1];
+            BlockedArray<T> &cur = *pyramid[i];
+            int size = blockSize >> i;
+            for (int t = block.y * size; t < (block.y + 1) * size; ++t)
+                for (int s = block.x * size; s < (block.x + 1) * size; ++s)
+                    cur(s, t) = .25f * (prev(2 * s, 2 * t) +
+                                        prev(2 * s + 1, 2 * t) +
+                                        prev(2 * s, 2 * t + 1) +
+                                        prev(2 * s + 1, 2 * t + 1));
+        }
+    }, nBlocks);
+
+    for (int i = nBlockLevels + 1; i < nLevels; ++i) {
         // Initialize $i$th MIPMap level from $i-1$st level
         int sRes = std::max(1, pyramid[i - 1]->uSize() / 2);
         int tRes = std::max(1, pyramid[i - 1]->vSize() / 2);
@@ -206,45 +320,293 @@ MIPMap<T>::MIPMap(const Point2i &res, const T *img, bool doTrilinear,
         }, tRes, 16);
     }
 
-    // Initialize EWA filter weights if needed
-    if (weightLut[0] == 0.) {
+    InitWeightLut();
+    if (format != TexelFormat::Float && encodingScale > 0)
+        mipMapMemory += compact(format, encodingScale);
+    else
+        mipMapMemory += (4 * resolution[0] * resolution[1] * sizeof(T)) / 3;
+}
+
+template <typename T>
+size_t MIPMap<T>::compact(TexelFormat fmt, Float scale) {
+    const int nc = TexelTraits<T>::nChannels;
+    // Block compression only handles RGB texels; store others with a byte
+    // per channel with the same encoding
+    if (fmt == TexelFormat::SRGBBC && nc != 3) fmt = TexelFormat::SRGB8;
+    if (fmt == TexelFormat::LinearBC && nc != 3) fmt = TexelFormat::Linear8;
+
+    // Initialize table for decoding byte-encoded channels
+    bool linear = fmt == TexelFormat::Linear8 || fmt == TexelFormat::LinearBC;
+    for (int i = 0; i < 256; ++i)
+        byteDecode[i] =
+            scale * (linear ? i / 255.f : InverseGammaCorrect(i / 255.f));
+
+    // Encode each level of the pyramid and release its full-precision texels
+    size_t bytes = 0;
+    for (int level = 0; level < Levels(); ++level) {
+        const BlockedArray<T> &l = *pyramid[level];
+        int sRes = l.uSize(), tRes = l.vSize();
+        switch (fmt) {
+        case TexelFormat::Half:
+            halfPyramid.emplace_back(new BlockedArray<HalfTexel>(sRes, tRes));
+            ParallelFor([&](int t) {
+                for (int s = 0; s < sRes; ++s)
+                    for (int c = 0; c < nc; ++c)
+                        (*halfPyramid[level])(s, t)[c] =
+                            FloatToHalf(TexelTraits<T>::Get(l(s, t), c));
+            }, tRes, 16);
+            bytes += sRes * tRes * sizeof(HalfTexel);
+            break;
+        case TexelFormat::SRGB8:
+        case TexelFormat::Linear8:
+            bytePyramid.emplace_back(new BlockedArray<ByteTexel>(sRes, tRes));
+            ParallelFor([&](int t) {
+                for (int s = 0; s < sRes; ++s)
+                    for (int c = 0; c < nc; ++c)
+                        (*bytePyramid[level])(s, t)[c] =
+                            encodeByte(TexelTraits<T>::Get(l(s, t), c));
+            }, tRes, 16);
+            bytes += sRes * tRes * sizeof(ByteTexel);
+            break;
+        case TexelFormat::SRGBBC:
+        case TexelFormat::LinearBC: {
+            int sBlocks = (sRes + 3) / 4, tBlocks = (tRes + 3) / 4;
+            bcPyramid.push_back(std::vector<BCBlock>(sBlocks * tBlocks));
+            ParallelFor([&](int bt) {
+                for (int bs = 0; bs < sBlocks; ++bs)
+                    encodeBCBlock(level, bs, bt,
+                                  &bcPyramid[level][bt * sBlocks + bs]);
+            }, tBlocks, 4);
+            bytes += sBlocks * tBlocks * sizeof(BCBlock);
+            break;
+        }
+        default:
+            LOG(FATAL) << "Unexpected texel format";
+        }
+        pyramid[level].reset();
+    }
+    pyramid.clear();
+    format = fmt;
+    return bytes;
+}
+
+template <typename T>
+uint8_t MIPMap<T>::encodeByte(Float v) const {
+    // Find the byte whose decoded value is closest to _v_
+    int i = std::lower_bound(byteDecode, byteDecode + 256, v) - byteDecode;
+    if (i == 256) return 255;
+    if (i > 0 && v - byteDecode[i - 1] < byteDecode[i] - v) --i;
+    return i;
+}
+
+template <typename T>
+void MIPMap<T>::encodeBCBlock(int level, int bs, int bt,
+                              BCBlock *block) const {
+    // Gather the block's texels, clamping at the edges of the level
+    const BlockedArray<T> &l = *pyramid[level];
+    Vector3f texel[16], mean;
+    for (int i = 0; i < 16; ++i) {
+        int s = std::min(4 * bs + (i & 3), l.uSize() - 1);
+        int t = std::min(4 * bt + (i >> 2), l.vSize() - 1);
+        for (int c = 0; c < 3; ++c)
+            texel[i][c] = TexelTraits<T>::Get(l(s, t), c);
+        mean += texel[i] / 16;
+    }
+
+    // Find the principal axis of the texels; the palette is interpolated
+    // linearly between the decoded endpoints, so fit in that space
+    Float cov[3][3] = {};
+    for (int i = 0; i < 16; ++i)
+        for (int a = 0; a < 3; ++a)
+            for (int b = 0; b < 3; ++b)
+                cov[a][b] += (texel[i][a] - mean[a]) * (texel[i][b] - mean[b]);
+    // Start from the covariance matrix's largest row
+    Vector3f axis(cov[0][0], cov[0][1], cov[0][2]);
+    for (int a = 1; a < 3; ++a) {
+        Vector3f row(cov[a][0], cov[a][1], cov[a][2]);
+        if (row.LengthSquared() > axis.LengthSquared()) axis = row;
+    }
+    if (axis.LengthSquared() == 0) axis = Vector3f(1, 1, 1);
+    axis = Normalize(axis);
+    for (int iter = 0; iter < 8; ++iter) {
+        Vector3f next(Dot(Vector3f(cov[0][0], cov[0][1], cov[0][2]), axis),
+                      Dot(Vector3f(cov[1][0], cov[1][1], cov[1][2]), axis),
+                      Dot(Vector3f(cov[2][0], cov[2][1], cov[2][2]), axis));
+        if (next.LengthSquared() == 0) break;
+        axis = Normalize(next);
+    }
+
+    // Place the endpoints at the extremes of the texels along the axis
+    Float tMin = Infinity, tMax = -Infinity;
+    for (int i = 0; i < 16; ++i) {
+        Float t = Dot(texel[i] - mean, axis);
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    Vector3f palette[4];
+    for (int c = 0; c < 3; ++c) {
+        block->endpoints[0][c] = encodeByte(mean[c] + tMin * axis[c]);
+        block->endpoints[1][c] = encodeByte(mean[c] + tMax * axis[c]);
+        palette[0][c] = byteDecode[block->endpoints[0][c]];
+        palette[1][c] = byteDecode[block->endpoints[1][c]];
+    }
+    palette[2] = (2 * palette[0] + palette[1]) / 3;
+    palette[3] = (palette[0] + 2 * palette[1]) / 3;
+
+    // Choose the closest palette entry for each texel
+    for (int row = 0; row < 4; ++row) {
+        block->indices[row] = 0;
+        for (int col = 0; col < 4; ++col) {
+            const Vector3f &v = texel[4 * row + col];
+            int best = 0;
+            for (int j = 1; j < 4; ++j)
+                if ((palette[j] - v).LengthSquared() <
+                    (palette[best] - v).LengthSquared())
+                    best = j;
+            block->indices[row] |= best << (2 * col);
+        }
+    }
+}
+
+template <typename T>
+T MIPMap<T>::decodeBC(int level, int s, int t) const {
+    int sBlocks = (levelResolution[level][0] + 3) / 4;
+    const BCBlock &block = bcPyramid[level][(t / 4) * sBlocks + s / 4];
+    int index = (block.indices[t & 3] >> (2 * (s & 3))) & 3;
+    T v;
+    for (int c = 0; c < TexelTraits<T>::nChannels; ++c) {
+        Float v0 = byteDecode[block.endpoints[0][c]];
+        Float v1 = byteDecode[block.endpoints[1][c]];
+        Float palette[4] = {v0, v1, (2 * v0 + v1) / 3, (v0 + 2 * v1) / 3};
+        TexelTraits<T>::Set(&v, c, palette[index]);
+    }
+    return v;
+}
+
+template <typename T>
+MIPMap<T>::MIPMap(std::unique_ptr<TiledImage> image,
+                  std::function<T(const RGBSpectrum &)> convert,
+                  bool doTrilinear, Float maxAnisotropy, ImageWrap wrapMode,
+                  int maxProbes)
+    : doTrilinear(doTrilinear),
+      maxAnisotropy(maxAnisotropy),
+      wrapMode(wrapMode),
+      maxProbes(maxProbes),
+      resolution(image->LevelResolution(0)),
+      tiledImage(std::move(image)),
+      convert(std::move(convert)) {
+    for (int i = 0; i < tiledImage->Levels(); ++i)
+        levelResolution.push_back(tiledImage->LevelResolution(i));
+
+    // Register tile loader that converts file texels to type _T_
+    cacheId = TextureCache::GetCache()->AddImage(
+        [this](int level, const Point2i &tile, size_t *bytes) {
+            int nTexels = tiledImage->TileSize() * tiledImage->TileSize();
+            std::unique_ptr<RGBSpectrum[]> rgb(new RGBSpectrum[nTexels]);
+            std::shared_ptr<T> texels(new T[nTexels],
+                                      std::default_delete<T[]>());
+            if (tiledImage->ReadTile(level, tile, rgb.get()))
+                for (int i = 0; i < nTexels; ++i)
+                    texels.get()[i] = this->convert(rgb[i]);
+            else
+                for (int i = 0; i < nTexels; ++i) texels.get()[i] = T(0.f);
+            *bytes = nTexels * sizeof(T);
+            return std::shared_ptr<const void>(texels);
+        });
+    InitWeightLut();
+}
+
+template <typename T>
+MIPMap<T>::~MIPMap() {
+    if (cacheId >= 0) TextureCache::GetCache()->RemoveImage(cacheId);
+}
+
+template <typename T>
+void MIPMap<T>::InitWeightLut() {
+    // Initialize EWA filter weights if needed; _MIPMap_s may be created by
+    // multiple threads concurrently
+    static std::once_flag weightLutInitialized;
+    std::call_once(weightLutInitialized, []() {
         for (int i = 0; i < WeightLUTSize; ++i) {
             Float alpha = 2;
             Float r2 = Float(i) / Float(WeightLUTSize - 1);
             weightLut[i] = std::exp(-alpha * r2) - std::exp(-alpha);
         }
-    }
-    mipMapMemory += (4 * resolution[0] * resolution[1] * sizeof(T)) / 3;
+    });
 }
 
 template <typename T>
-const T &MIPMap<T>::Texel(int level, int s, int t) const {
-    CHECK_LT(level, pyramid.size());
-    const BlockedArray<T> &l = *pyramid[level];
+T MIPMap<T>::Texel(int level, int s, int t) const {
+    TileHandle handle;
+    return texel(level, s, t, &handle);
+}
+
+template <typename T>
+T MIPMap<T>::texel(int level, int s, int t, TileHandle *handle) const {
+    CHECK_LT(level, Levels());
+    const Point2i &res = levelResolution[level];
     // Compute texel $(s,t)$ accounting for boundary conditions
     switch (wrapMode) {
     case ImageWrap::Repeat:
-        s = Mod(s, l.uSize());
-        t = Mod(t, l.vSize());
+        s = Mod(s, res[0]);
+        t = Mod(t, res[1]);
         break;
     case ImageWrap::Clamp:
-        s = Clamp(s, 0, l.uSize() - 1);
-        t = Clamp(t, 0, l.vSize() - 1);
+        s = Clamp(s, 0, res[0] - 1);
+        t = Clamp(t, 0, res[1] - 1);
         break;
     case ImageWrap::Black: {
-        static const T black = 0.f;
-        if (s < 0 || s >= (int)l.uSize() || t < 0 || t >= (int)l.vSize())
-            return black;
+        if (s < 0 || s >= res[0] || t < 0 || t >= res[1]) return T(0.f);
         break;
     }
     }
-    return l(s, t);
+    if (tiledImage) {
+        // Fetch texel from its tile, going through the _TextureCache_ only
+        // if it isn't the tile that _handle_ already holds
+        int tileSize = tiledImage->TileSize();
+        Point2i tile(s / tileSize, t / tileSize);
+        if (handle->level != level || handle->tile != tile) {
+            handle->texels =
+                TextureCache::GetCache()->GetTile(cacheId, level, tile);
+            handle->level = level;
+            handle->tile = tile;
+        }
+        return static_cast<const T *>(
+            handle->texels.get())[(t % tileSize) * tileSize + s % tileSize];
+    }
+    switch (format) {
+    case TexelFormat::Half: {
+        const HalfTexel &h = (*halfPyramid[level])(s, t);
+        T v;
+        for (int c = 0; c < TexelTraits<T>::nChannels; ++c)
+            TexelTraits<T>::Set(&v, c, HalfToFloat(h[c]));
+        return v;
+    }
+    case TexelFormat::SRGB8:
+    case TexelFormat::Linear8: {
+        const ByteTexel &b = (*bytePyramid[level])(s, t);
+        T v;
+        for (int c = 0; c < TexelTraits<T>::nChannels; ++c)
+            TexelTraits<T>::Set(&v, c, byteDecode[b[c]]);
+        return v;
+    }
+    case TexelFormat::SRGBBC:
+    case TexelFormat::LinearBC:
+        return decodeBC(level, s, t);
+    default:
+        return (*pyramid[level])(s, t);
+    }
 }
 
 template <typename T>
 T MIPMap<T>::Lookup(const Point2f &st, Float width) const {
     ++nTrilerpLookups;
     ProfilePhase p(Prof::TexFiltTrilerp);
+    return trilinear(st, width);
+}
+
+template <typename T>
+T MIPMap<T>::trilinear(const Point2f &st, Float width) const {
     // Compute MIPMap level for trilinear filtering
     Float level = Levels() - 1 + Log2(std::max(width, (Float)1e-8));
 
@@ -263,14 +625,30 @@ T MIPMap<T>::Lookup(const Point2f &st, Float width) const {
 template <typename T>
 T MIPMap<T>::triangle(int level, const Point2f &st) const {
     level = Clamp(level, 0, Levels() - 1);
-    Float s = st[0] * pyramid[level]->uSize() - 0.5f;
-    Float t = st[1] * pyramid[level]->vSize() - 0.5f;
+    const Point2i &res = levelResolution[level];
+    Float s = st[0] * res[0] - 0.5f;
+    Float t = st[1] * res[1] - 0.5f;
     int s0 = std::floor(s), t0 = std::floor(t);
     Float ds = s - s0, dt = t - t0;
-    return (1 - ds) * (1 - dt) * Texel(level, s0, t0) +
-           (1 - ds) * dt * Texel(level, s0, t0 + 1) +
-           ds * (1 - dt) * Texel(level, s0 + 1, t0) +
-           ds * dt * Texel(level, s0 + 1, t0 + 1);
+    T v00, v01, v10, v11;
+    if (!pyramid.empty() && s0 >= 0 && s0 + 1 < res[0] && t0 >= 0 &&
+        t0 + 1 < res[1]) {
+        // Fetch texels directly from the pyramid level, row by row, when
+        // no boundary handling is needed
+        const BlockedArray<T> &l = *pyramid[level];
+        v00 = l(s0, t0);
+        v10 = l(s0 + 1, t0);
+        v01 = l(s0, t0 + 1);
+        v11 = l(s0 + 1, t0 + 1);
+    } else {
+        TileHandle handle;
+        v00 = texel(level, s0, t0, &handle);
+        v10 = texel(level, s0 + 1, t0, &handle);
+        v01 = texel(level, s0, t0 + 1, &handle);
+        v11 = texel(level, s0 + 1, t0 + 1, &handle);
+    }
+    return (1 - ds) * (1 - dt) * v00 + (1 - ds) * dt * v01 +
+           ds * (1 - dt) * v10 + ds * dt * v11;
 }
 
 template <typename T>
@@ -280,8 +658,6 @@ T MIPMap<T>::Lookup(const Point2f &st, Vector2f dst0, Vector2f dst1) const {
                                std::max(std::abs(dst1[0]), std::abs(dst1[1])));
         return Lookup(st, width);
     }
-    ++nEWALookups;
-    ProfilePhase p(Prof::TexFiltEWA);
     // Compute ellipse minor and major axes
     if (dst0.LengthSquared() < dst1.LengthSquared()) std::swap(dst0, dst1);
     Float majorLength = dst0.Length();
@@ -294,8 +670,15 @@ T MIPMap<T>::Lookup(const Point2f &st, Vector2f dst0, Vector2f dst1) const {
         minorLength *= scale;
     }
     if (minorLength == 0) return triangle(0, st);
+    if (maxProbes > 0) {
+        ++nAnisoLookups;
+        ProfilePhase p(Prof::TexFiltAniso);
+        return anisotropic(st, dst0, majorLength, minorLength);
+    }
 
     // Choose level of detail for EWA lookup and perform EWA filtering
+    ++nEWALookups;
+    ProfilePhase p(Prof::TexFiltEWA);
     Float lod = std::max((Float)0, Levels() - (Float)1 + Log2(minorLength));
     int ilod = std::floor(lod);
     return Lerp(lod - ilod, EWA(ilod, st, dst0, dst1),
@@ -306,12 +689,13 @@ template <typename T>
 T MIPMap<T>::EWA(int level, Point2f st, Vector2f dst0, Vector2f dst1) const {
     if (level >= Levels()) return Texel(Levels() - 1, 0, 0);
     // Convert EWA coordinates to appropriate scale for level
-    st[0] = st[0] * pyramid[level]->uSize() - 0.5f;
-    st[1] = st[1] * pyramid[level]->vSize() - 0.5f;
-    dst0[0] *= pyramid[level]->uSize();
-    dst0[1] *= pyramid[level]->vSize();
-    dst1[0] *= pyramid[level]->uSize();
-    dst1[1] *= pyramid[level]->vSize();
+    const Point2i &res = levelResolution[level];
+    st[0] = st[0] * res[0] - 0.5f;
+    st[1] = st[1] * res[1] - 0.5f;
+    dst0[0] *= res[0];
+    dst0[1] *= res[1];
+    dst1[0] *= res[0];
+    dst1[1] *= res[1];
 
     // Compute ellipse coefficients to bound EWA filter region
     Float A = dst0[1] * dst0[1] + dst1[1] * dst1[1] + 1;
@@ -331,27 +715,79 @@ T MIPMap<T>::EWA(int level, Point2f st, Vector2f dst0, Vector2f dst1) const {
     int t0 = std::ceil(st[1] - 2 * invDet * vSqrt);
     int t1 = std::floor(st[1] + 2 * invDet * vSqrt);
 
-    // Scan over ellipse bound and compute quadratic equation
+    // Filter the texels inside the ellipse one row at a time
+    bool inBounds = !pyramid.empty() && s0 >= 0 && s1 < res[0] && t0 >= 0 &&
+                    t1 < res[1];
     T sum(0.f);
     Float sumWts = 0;
+    Float weights[EWARowChunk];
+    TileHandle handle;
     for (int it = t0; it <= t1; ++it) {
         Float tt = it - st[1];
-        for (int is = s0; is <= s1; ++is) {
-            Float ss = is - st[0];
-            // Compute squared radius and filter texel if inside ellipse
-            Float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
-            if (r2 < 1) {
-                int index =
-                    std::min((int)(r2 * WeightLUTSize), WeightLUTSize - 1);
-                Float weight = weightLut[index];
-                sum += Texel(level, is, it) * weight;
-                sumWts += weight;
+        // Find the row's span of texels inside the ellipse by solving
+        // $A s^2 + B t s + C t^2 = 1$ for $s$, rounding outward
+        Float b = B * tt, c = C * tt * tt - 1;
+        Float discrim = b * b - 4 * A * c;
+        if (discrim < 0) continue;
+        Float rootDiscrim = std::sqrt(discrim), inv2A = 1 / (2 * A);
+        int rs0 = std::max(
+            s0, (int)std::floor(st[0] + (-b - rootDiscrim) * inv2A));
+        int rs1 = std::min(
+            s1, (int)std::ceil(st[0] + (-b + rootDiscrim) * inv2A));
+
+        for (int cs = rs0; cs <= rs1; cs += EWARowChunk) {
+            int n = std::min(EWARowChunk, rs1 - cs + 1);
+            // Compute filter weights for a chunk of the row; the loop has
+            // no texel fetches or branches so that it can be vectorized
+            for (int i = 0; i < n; ++i) {
+                Float ss = cs + i - st[0];
+                Float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
+                int index = Clamp((int)(r2 * WeightLUTSize), 0,
+                                  WeightLUTSize - 1);
+                weights[i] = (r2 < 1) ? weightLut[index] : 0;
+            }
+
+            // Accumulate the chunk's weighted texels
+            if (inBounds) {
+                const BlockedArray<T> &l = *pyramid[level];
+                for (int i = 0; i < n; ++i)
+                    if (weights[i] > 0) {
+                        sum += l(cs + i, it) * weights[i];
+                        sumWts += weights[i];
+                    }
+            } else {
+                for (int i = 0; i < n; ++i)
+                    if (weights[i] > 0) {
+                        sum += texel(level, cs + i, it, &handle) * weights[i];
+                        sumWts += weights[i];
+                    }
             }
         }
     }
     return sum / sumWts;
 }
 
+template <typename T>
+T MIPMap<T>::anisotropic(const Point2f &st, const Vector2f &dst0,
+                         Float majorLength, Float minorLength) const {
+    // Place trilinear probes along the ellipse's major axis
+    int nProbes =
+        Clamp((int)std::ceil(majorLength / minorLength), 1, maxProbes);
+    Float width = std::max(minorLength, majorLength / nProbes);
+
+    // Weight probes with the EWA filter's Gaussian falloff
+    T sum(0.f);
+    Float sumWts = 0;
+    for (int i = 0; i < nProbes; ++i) {
+        Float x = 2 * (i + 0.5f) / nProbes - 1;
+        int index = std::min((int)(x * x * WeightLUTSize), WeightLUTSize - 1);
+        Float weight = std::max(weightLut[index], (Float)1e-4);
+        sum += trilinear(st + x * dst0, width) * weight;
+        sumWts += weight;
+    }
+    return sum / sumWts;
+}
+
 template <typename T>
 Float MIPMap<T>::weightLut[WeightLUTSize];
 
@@ -109,6 +109,17 @@ void Barrier::Wait() {
 
 static std::condition_variable workListCondition;
 
+// Removes _loop_ from the work list if it is still there. Other threads may
+// have pushed loops or asynchronous tasks in front of it, so it isn't
+// necessarily at the head. The caller must hold _workListMutex_.
+static void removeFromWorkList(ParallelForLoop *loop) {
+    for (ParallelForLoop **l = &workList; *l; l = &(*l)->next)
+        if (*l == loop) {
+            *l = loop->next;
+            return;
+        }
+}
+
 static void workerThreadFunc(int tIndex, std::shared_ptr<Barrier> barrier) {
     LOG(INFO) << "Started execution in worker thread " << tIndex;
     ThreadIndex = tIndex;
@@ -213,7 +224,7 @@ void ParallelFor(std::function<void(int64_t)> func, int64_t count,
 
         // Update _loop_ to reflect iterations this thread will run
         loop.nextIndex = indexEnd;
-        if (loop.nextIndex == loop.maxIndex) workList = loop.next;
+        if (loop.nextIndex == loop.maxIndex) removeFromWorkList(&loop);
         loop.activeWorkers++;
 
         // Run loop indices in _[indexStart, indexEnd)_
@@ -238,6 +249,52 @@ void ParallelFor(std::function<void(int64_t)> func, int64_t count,
     }
 }
 
+AsyncTask::AsyncTask(std::function<void()> func)
+    : loop(new ParallelForLoop([func](int64_t) { func(); }, 1, 1,
+                               CurrentProfilerState())) {}
+
+AsyncTask::~AsyncTask() {
+    // Make sure that no worker is still referring to _loop_
+    Wait();
+}
+
+void AsyncTask::Wait() {
+    std::unique_lock<std::mutex> lock(workListMutex);
+    if (loop->nextIndex == 0) {
+        // Run the task in the current thread since no worker has started it
+        loop->nextIndex = 1;
+        removeFromWorkList(loop.get());
+        loop->activeWorkers++;
+        lock.unlock();
+        uint64_t oldState = ProfilerState;
+        ProfilerState = loop->profilerState;
+        loop->func1D(0);
+        ProfilerState = oldState;
+        lock.lock();
+        loop->activeWorkers--;
+        workListCondition.notify_all();
+    } else
+        workListCondition.wait(lock, [this]() { return loop->Finished(); });
+}
+
+std::shared_ptr<AsyncTask> RunAsync(std::function<void()> func) {
+    CHECK(threads.size() > 0 || MaxThreadIndex() == 1);
+    std::shared_ptr<AsyncTask> task(new AsyncTask(std::move(func)));
+
+    // Run the task immediately if not using threads
+    if (threads.empty()) {
+        task->Wait();
+        return task;
+    }
+
+    // Enqueue the task's loop and notify worker threads
+    std::lock_guard<std::mutex> lock(workListMutex);
+    task->loop->next = workList;
+    workList = task->loop.get();
+    workListCondition.notify_all();
+    return task;
+}
+
 PBRT_THREAD_LOCAL int ThreadIndex;
 
 int MaxThreadIndex() {
@@ -273,7 +330,7 @@ void ParallelFor2D(std::function<void(Point2i)> func, const Point2i &count) {
 
         // Update _loop_ to reflect iterations this thread will run
         loop.nextIndex = indexEnd;
-        if (loop.nextIndex == loop.maxIndex) workList = loop.next;
+        if (loop.nextIndex == loop.maxIndex) removeFromWorkList(&loop);
         loop.activeWorkers++;
 
         // Run loop indices in _[indexStart, indexEnd)_
@@ -45,6 +45,7 @@
 #include <condition_variable>
 #include <functional>
 #include <atomic>
+#include <memory>
 
 namespace pbrt {
 
@@ -98,6 +99,23 @@ class Barrier {
     int count;
 };
 
+// AsyncTask is a handle to a function started with RunAsync(), which runs
+// the function on one of the worker threads while the caller continues.
+// Wait() returns once the function has finished; if no worker has picked
+// it up yet, it is run in the calling thread instead.
+class ParallelForLoop;
+class AsyncTask {
+  public:
+    ~AsyncTask();
+    void Wait();
+
+  private:
+    friend std::shared_ptr<AsyncTask> RunAsync(std::function<void()> func);
+    AsyncTask(std::function<void()> func);
+    std::unique_ptr<ParallelForLoop> loop;
+};
+
+std::shared_ptr<AsyncTask> RunAsync(std::function<void()> func);
 void ParallelFor(std::function<void(int64_t)> func, int64_t count,
                  int chunkSize = 1);
 extern PBRT_THREAD_LOCAL int ThreadIndex;
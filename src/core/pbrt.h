@@ -142,6 +142,7 @@ class BSDF;
 class Material;
 template <typename T>
 class Texture;
+class TextureCompiler;
 class Medium;
 class MediumInteraction;
 struct MediumInterface;
@@ -152,6 +153,7 @@ struct BSSRDFTable;
 class Light;
 class VisibilityTester;
 class AreaLight;
+class LightDistribution;
 struct Distribution1D;
 class Distribution2D;
 #ifdef PBRT_FLOAT_AS_DOUBLE
@@ -176,6 +178,8 @@ struct Options {
         cropWindow[1][1] = 1;
     }
     int nThreads = 0;
+    int textureCacheMB = 1024;
+    int ptexCacheMB = 4096, ptexMaxFiles = 100;
     bool quickRender = false;
     bool quiet = false;
     bool cat = false, toPly = false;
@@ -238,6 +242,42 @@ inline double BitsToFloat(uint64_t ui) {
     return f;
 }
 
+// Converts to and from IEEE 754 half precision, rounding to nearest even.
+// Finite values beyond the half range saturate to the largest half.
+inline uint16_t FloatToHalf(float f) {
+    uint32_t bits = FloatToBits(f);
+    uint16_t sign = (bits >> 16) & 0x8000;
+    bits &= 0x7fffffff;
+    if (bits >= 0x7f800000)
+        return sign | (bits > 0x7f800000 ? 0x7e00 : 0x7c00);
+    if (bits >= 0x477ff000) return sign | 0x7bff;
+    if (bits < 0x38800000) {
+        // Handle values that map to half subnormals or zero
+        if (bits < 0x33000000) return sign;
+        uint32_t mant = (bits & 0x7fffff) | 0x800000;
+        int shift = 126 - int(bits >> 23);
+        uint32_t h = mant >> shift, rem = mant & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (h & 1))) ++h;
+        return sign | h;
+    }
+    uint32_t h = (((bits >> 23) - 112) << 10) | ((bits & 0x7fffff) >> 13);
+    uint32_t rem = bits & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) ++h;
+    return sign | h;
+}
+
+inline float HalfToFloat(uint16_t h) {
+    uint32_t sign = uint32_t(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f, mant = h & 0x3ff;
+    if (exp == 0) {
+        float v = mant * (1.f / 16777216.f);
+        return sign ? -v : v;
+    }
+    if (exp == 31) return BitsToFloat(sign | 0x7f800000 | (mant << 13));
+    return BitsToFloat(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
 inline float NextFloatUp(float v) {
     // Handle infinity and negative zero for _NextFloatUp()_
     if (std::isinf(v) && v > 0.) return v;
@@ -399,6 +439,15 @@ inline int CountTrailingZeros(uint32_t v) {
 #endif
 }
 
+inline uint64_t MixBits(uint64_t v) {
+    v ^= (v >> 31);
+    v *= 0x7fb5d329728ea185ull;
+    v ^= (v >> 27);
+    v *= 0x81dadef4bc2dd44dull;
+    v ^= (v >> 33);
+    return v;
+}
+
 template <typename Predicate>
 int FindInterval(int size, const Predicate &pred) {
     int first = 0, len = size;
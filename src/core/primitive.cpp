@@ -41,8 +41,25 @@ namespace pbrt {
 
 STAT_MEMORY_COUNTER("Memory/Primitives", primitiveMemory);
 
+// Maximum number of times a probe segment is allowed to re-enter one shape
+static PBRT_CONSTEXPR int MaxShapeProbeHits = 8;
+
 // Primitive Method Definitions
 Primitive::~Primitive() {}
+void Primitive::IntersectProbe(const Ray &r, const Material *material,
+                               ProbeReservoir *reservoir) const {
+    // Gather probe candidates using repeated closest-hit queries along _r_
+    Point3f pTarget = r(r.tMax);
+    Ray ray = r;
+    SurfaceInteraction isect;
+    while (Intersect(ray, &isect)) {
+        if (isect.primitive->GetMaterial() == material && reservoir->Accept())
+            *reservoir->isect = isect;
+        ray = isect.SpawnRayTo(pTarget);
+        if (ray.d == Vector3f(0, 0, 0)) break;
+    }
+}
+
 const AreaLight *Aggregate::GetAreaLight() const {
     LOG(FATAL) <<
         "Aggregate::GetAreaLight() method"
@@ -95,6 +112,20 @@ bool TransformedPrimitive::IntersectP(const Ray &r) const {
     return primitive->IntersectP(InterpolatedWorldToPrim(r));
 }
 
+void TransformedPrimitive::IntersectProbe(const Ray &r,
+                                          const Material *material,
+                                          ProbeReservoir *reservoir) const {
+    Transform InterpolatedPrimToWorld;
+    PrimitiveToWorld.Interpolate(r.time, &InterpolatedPrimToWorld);
+    Ray ray = Inverse(InterpolatedPrimToWorld)(r);
+    int selected = reservoir->selected;
+    primitive->IntersectProbe(ray, material, reservoir);
+    // Transform newly selected probe hit to world space
+    if (reservoir->selected != selected &&
+        !InterpolatedPrimToWorld.IsIdentity())
+        *reservoir->isect = InterpolatedPrimToWorld(*reservoir->isect);
+}
+
 // GeometricPrimitive Method Definitions
 GeometricPrimitive::GeometricPrimitive(const std::shared_ptr<Shape> &shape,
                                        const std::shared_ptr<Material> &material,
@@ -129,6 +160,33 @@ bool GeometricPrimitive::Intersect(const Ray &r,
     return true;
 }
 
+void GeometricPrimitive::IntersectProbe(const Ray &r,
+                                        const Material *probeMaterial,
+                                        ProbeReservoir *reservoir) const {
+    // Only surfaces with the probing material are candidates
+    if (material.get() != probeMaterial) return;
+    Ray ray = r;
+    Point3f pTarget = r(r.tMax);
+    SurfaceInteraction isect;
+    Float tHit;
+    for (int i = 0; i < MaxShapeProbeHits; ++i) {
+        if (!shape->Intersect(ray, &tHit, &isect)) return;
+        if (reservoir->Accept()) {
+            // Finish initializing the selected candidate's interaction
+            SurfaceInteraction *si = reservoir->isect;
+            *si = isect;
+            si->primitive = this;
+            if (mediumInterface.IsMediumTransition())
+                si->mediumInterface = mediumInterface;
+            else
+                si->mediumInterface = MediumInterface(ray.medium);
+        }
+        // Continue past the hit in case the segment crosses the shape again
+        ray = isect.SpawnRayTo(pTarget);
+        if (ray.d == Vector3f(0, 0, 0)) return;
+    }
+}
+
 const AreaLight *GeometricPrimitive::GetAreaLight() const {
     return areaLight.get();
 }
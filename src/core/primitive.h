@@ -44,9 +44,33 @@
 #include "material.h"
 #include "medium.h"
 #include "transform.h"
+#include "rng.h"
 
 namespace pbrt {
 
+// ProbeReservoir Declarations
+struct ProbeReservoir {
+    // ProbeReservoir Public Methods
+    ProbeReservoir(Float u, SurfaceInteraction *isect) : u(u), isect(isect) {}
+    bool Accept() {
+        // Select the new candidate with probability $1/\roman{nFound}$ and
+        // remap _u_ so that it remains uniformly distributed
+        Float p = 1 / (Float)++nFound;
+        if (u < p) {
+            u = std::min(u / p, OneMinusEpsilon);
+            selected = nFound;
+            return true;
+        }
+        u = std::min((u - p) / (1 - p), OneMinusEpsilon);
+        return false;
+    }
+
+    // ProbeReservoir Public Data
+    Float u;
+    SurfaceInteraction *isect;
+    int nFound = 0, selected = 0;
+};
+
 // Primitive Declarations
 class Primitive {
   public:
@@ -61,6 +85,8 @@ class Primitive {
                                             MemoryArena &arena,
                                             TransportMode mode,
                                             bool allowMultipleLobes) const = 0;
+    virtual void IntersectProbe(const Ray &r, const Material *material,
+                                ProbeReservoir *reservoir) const;
 };
 
 // GeometricPrimitive Declarations
@@ -70,6 +96,8 @@ class GeometricPrimitive : public Primitive {
     virtual Bounds3f WorldBound() const;
     virtual bool Intersect(const Ray &r, SurfaceInteraction *isect) const;
     virtual bool IntersectP(const Ray &r) const;
+    void IntersectProbe(const Ray &r, const Material *material,
+                        ProbeReservoir *reservoir) const;
     GeometricPrimitive(const std::shared_ptr<Shape> &shape,
                        const std::shared_ptr<Material> &material,
                        const std::shared_ptr<AreaLight> &areaLight,
@@ -96,6 +124,8 @@ class TransformedPrimitive : public Primitive {
                          const AnimatedTransform &PrimitiveToWorld);
     bool Intersect(const Ray &r, SurfaceInteraction *in) const;
     bool IntersectP(const Ray &r) const;
+    void IntersectProbe(const Ray &r, const Material *material,
+                        ProbeReservoir *reservoir) const;
     const AreaLight *GetAreaLight() const { return nullptr; }
     const Material *GetMaterial() const { return nullptr; }
     void ComputeScatteringFunctions(SurfaceInteraction *isect,
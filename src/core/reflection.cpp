@@ -685,11 +685,12 @@ Spectrum BSDF::f(const Vector3f &woW, const Vector3f &wiW,
     bool reflect = Dot(wiW, ng) * Dot(woW, ng) > 0;
     Spectrum f(0.f);
     for (int i = 0; i < nBxDFs; ++i)
-        if (bxdfs[i]->MatchesFlags(flags) &&
+        if ((selectedLobe < 0 || i == selectedLobe) &&
+            bxdfs[i]->MatchesFlags(flags) &&
             ((reflect && (bxdfs[i]->type & BSDF_REFLECTION)) ||
              (!reflect && (bxdfs[i]->type & BSDF_TRANSMISSION))))
             f += bxdfs[i]->f(wo, wi);
-    return f;
+    return f * lobeScale;
 }
 
 Spectrum BSDF::rho(int nSamples, const Point2f *samples1,
@@ -711,40 +712,96 @@ Spectrum BSDF::rho(const Vector3f &woWorld, int nSamples, const Point2f *samples
     return ret;
 }
 
+int BSDF::LobeProbabilities(const Vector3f &wo, BxDFType flags,
+                            Float *prob) const {
+    // Only the selected lobe can be chosen in single-lobe mode
+    if (selectedLobe >= 0) {
+        for (int i = 0; i < nBxDFs; ++i) prob[i] = 0;
+        if (!bxdfs[selectedLobe]->MatchesFlags(flags)) return 0;
+        prob[selectedLobe] = 1;
+        return 1;
+    }
+
+    // Weight matching lobes by their estimated albedo for _wo_
+    int matchingComps = 0;
+    Float albedoSum = 0;
+    for (int i = 0; i < nBxDFs; ++i) {
+        prob[i] = 0;
+        if (bxdfs[i]->MatchesFlags(flags)) {
+            ++matchingComps;
+            prob[i] = std::max<Float>(0, bxdfs[i]->EstimateAlbedo(wo));
+            albedoSum += prob[i];
+        }
+    }
+    if (matchingComps <= 1 || albedoSum == 0) {
+        for (int i = 0; i < nBxDFs; ++i)
+            if (bxdfs[i]->MatchesFlags(flags)) prob[i] = 1.f / matchingComps;
+        return matchingComps;
+    }
+
+    // Mix in uniform selection so that lobes whose albedo is
+    // underestimated are still sampled occasionally
+    const Float uniformFraction = 0.1f;
+    for (int i = 0; i < nBxDFs; ++i)
+        if (bxdfs[i]->MatchesFlags(flags))
+            prob[i] = (1 - uniformFraction) * prob[i] / albedoSum +
+                      uniformFraction / matchingComps;
+    return matchingComps;
+}
+
+void BSDF::SelectSingleLobe(const Vector3f &woWorld, Float u) {
+    selectedLobe = -1;
+    lobeScale = 1;
+    Vector3f wo = WorldToLocal(woWorld);
+    if (nBxDFs <= 1 || wo.z == 0) return;
+
+    // Choose a lobe proportionally to its selection probability and
+    // account for the choice with _lobeScale_
+    Float prob[MaxBxDFs], cdf = 0;
+    LobeProbabilities(wo, BSDF_ALL, prob);
+    for (int i = 0; i < nBxDFs; ++i) {
+        if (prob[i] == 0) continue;
+        selectedLobe = i;
+        if (u < cdf + prob[i]) break;
+        cdf += prob[i];
+    }
+    lobeScale = 1 / prob[selectedLobe];
+}
+
 Spectrum BSDF::Sample_f(const Vector3f &woWorld, Vector3f *wiWorld,
                         const Point2f &u, Float *pdf, BxDFType type,
                         BxDFType *sampledType) const {
     ProfilePhase pp(Prof::BSDFSampling);
+    Vector3f wi, wo = WorldToLocal(woWorld);
+    *pdf = 0;
+    if (wo.z == 0) return 0.;
+
     // Choose which _BxDF_ to sample
-    int matchingComps = NumComponents(type);
+    Float prob[MaxBxDFs];
+    int matchingComps = LobeProbabilities(wo, type, prob);
     if (matchingComps == 0) {
-        *pdf = 0;
         if (sampledType) *sampledType = BxDFType(0);
         return Spectrum(0);
     }
-    int comp =
-        std::min((int)std::floor(u[0] * matchingComps), matchingComps - 1);
-
-    // Get _BxDF_ pointer for chosen component
-    BxDF *bxdf = nullptr;
-    int count = comp;
-    for (int i = 0; i < nBxDFs; ++i)
-        if (bxdfs[i]->MatchesFlags(type) && count-- == 0) {
-            bxdf = bxdfs[i];
-            break;
-        }
-    CHECK(bxdf != nullptr);
+    int comp = -1;
+    Float cdf = 0;
+    for (int i = 0; i < nBxDFs; ++i) {
+        if (prob[i] == 0) continue;
+        comp = i;
+        if (u[0] < cdf + prob[i]) break;
+        cdf += prob[i];
+    }
+    CHECK_GE(comp, 0);
+    BxDF *bxdf = bxdfs[comp];
     VLOG(2) << "BSDF::Sample_f chose comp = " << comp << " / matching = " <<
-        matchingComps << ", bxdf: " << bxdf->ToString();
+        matchingComps << ", prob = " << prob[comp] << ", bxdf: " <<
+        bxdf->ToString();
 
     // Remap _BxDF_ sample _u_ to $[0,1)^2$
-    Point2f uRemapped(std::min(u[0] * matchingComps - comp, OneMinusEpsilon),
-                      u[1]);
+    Point2f uRemapped(
+        Clamp((u[0] - cdf) / prob[comp], 0, OneMinusEpsilon), u[1]);
 
     // Sample chosen _BxDF_
-    Vector3f wi, wo = WorldToLocal(woWorld);
-    if (wo.z == 0) return 0.;
-    *pdf = 0;
     if (sampledType) *sampledType = bxdf->type;
     Spectrum f = bxdf->Sample_f(wo, &wi, uRemapped, pdf, sampledType);
     VLOG(2) << "For wo = " << wo << ", sampled f = " << f << ", pdf = "
@@ -757,22 +814,23 @@ Spectrum BSDF::Sample_f(const Vector3f &woWorld, Vector3f *wiWorld,
     *wiWorld = LocalToWorld(wi);
 
     // Compute overall PDF with all matching _BxDF_s
+    *pdf *= prob[comp];
     if (!(bxdf->type & BSDF_SPECULAR) && matchingComps > 1)
         for (int i = 0; i < nBxDFs; ++i)
-            if (bxdfs[i] != bxdf && bxdfs[i]->MatchesFlags(type))
-                *pdf += bxdfs[i]->Pdf(wo, wi);
-    if (matchingComps > 1) *pdf /= matchingComps;
+            if (i != comp && prob[i] > 0)
+                *pdf += prob[i] * bxdfs[i]->Pdf(wo, wi);
 
     // Compute value of BSDF for sampled direction
     if (!(bxdf->type & BSDF_SPECULAR)) {
         bool reflect = Dot(*wiWorld, ng) * Dot(woWorld, ng) > 0;
         f = 0.;
         for (int i = 0; i < nBxDFs; ++i)
-            if (bxdfs[i]->MatchesFlags(type) &&
+            if (prob[i] > 0 &&
                 ((reflect && (bxdfs[i]->type & BSDF_REFLECTION)) ||
                  (!reflect && (bxdfs[i]->type & BSDF_TRANSMISSION))))
                 f += bxdfs[i]->f(wo, wi);
     }
+    f *= lobeScale;
     VLOG(2) << "Overall f = " << f << ", pdf = " << *pdf << ", ratio = "
             << ((*pdf > 0) ? (f / *pdf) : Spectrum(0.));
     return f;
@@ -784,15 +842,11 @@ Float BSDF::Pdf(const Vector3f &woWorld, const Vector3f &wiWorld,
     if (nBxDFs == 0.f) return 0.f;
     Vector3f wo = WorldToLocal(woWorld), wi = WorldToLocal(wiWorld);
     if (wo.z == 0) return 0.;
-    Float pdf = 0.f;
-    int matchingComps = 0;
+    Float prob[MaxBxDFs], pdf = 0.f;
+    LobeProbabilities(wo, flags, prob);
     for (int i = 0; i < nBxDFs; ++i)
-        if (bxdfs[i]->MatchesFlags(flags)) {
-            ++matchingComps;
-            pdf += bxdfs[i]->Pdf(wo, wi);
-        }
-    Float v = matchingComps > 0 ? pdf / matchingComps : 0.f;
-    return v;
+        if (prob[i] > 0) pdf += prob[i] * bxdfs[i]->Pdf(wo, wi);
+    return pdf;
 }
 
 std::string BSDF::ToString() const {
@@ -194,6 +194,7 @@ class BSDF {
                       BxDFType *sampledType = nullptr) const;
     Float Pdf(const Vector3f &wo, const Vector3f &wi,
               BxDFType flags = BSDF_ALL) const;
+    void SelectSingleLobe(const Vector3f &woWorld, Float u);
     std::string ToString() const;
 
     // BSDF Public Data
@@ -202,6 +203,8 @@ class BSDF {
   private:
     // BSDF Private Methods
     ~BSDF() {}
+    int LobeProbabilities(const Vector3f &wo, BxDFType flags,
+                          Float *prob) const;
 
     // BSDF Private Data
     const Normal3f ns, ng;
@@ -209,7 +212,10 @@ class BSDF {
     int nBxDFs = 0;
     static PBRT_CONSTEXPR int MaxBxDFs = 8;
     BxDF *bxdfs[MaxBxDFs];
+    int selectedLobe = -1;
+    Float lobeScale = 1;
     friend class MixMaterial;
+    friend class LayeredMaterial;
 };
 
 inline std::ostream &operator<<(std::ostream &os, const BSDF &bsdf) {
@@ -233,6 +239,7 @@ class BxDF {
     virtual Spectrum rho(int nSamples, const Point2f *samples1,
                          const Point2f *samples2) const;
     virtual Float Pdf(const Vector3f &wo, const Vector3f &wi) const;
+    virtual Float EstimateAlbedo(const Vector3f &wo) const { return 1; }
     virtual std::string ToString() const = 0;
 
     // BxDF Public Data
@@ -261,6 +268,9 @@ class ScaledBxDF : public BxDF {
     Spectrum Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &sample,
                       Float *pdf, BxDFType *sampledType) const;
     Float Pdf(const Vector3f &wo, const Vector3f &wi) const;
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return scale.MaxComponentValue() * bxdf->EstimateAlbedo(wo);
+    }
     std::string ToString() const;
 
   private:
@@ -324,6 +334,9 @@ class SpecularReflection : public BxDF {
     Spectrum Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &sample,
                       Float *pdf, BxDFType *sampledType) const;
     Float Pdf(const Vector3f &wo, const Vector3f &wi) const { return 0; }
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return (R * fresnel->Evaluate(CosTheta(wo))).MaxComponentValue();
+    }
     std::string ToString() const;
 
   private:
@@ -349,6 +362,10 @@ class SpecularTransmission : public BxDF {
     Spectrum Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &sample,
                       Float *pdf, BxDFType *sampledType) const;
     Float Pdf(const Vector3f &wo, const Vector3f &wi) const { return 0; }
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return (T * (Spectrum(1.) - fresnel.Evaluate(CosTheta(wo))))
+            .MaxComponentValue();
+    }
     std::string ToString() const;
 
   private:
@@ -376,6 +393,10 @@ class FresnelSpecular : public BxDF {
     Spectrum Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &u,
                       Float *pdf, BxDFType *sampledType) const;
     Float Pdf(const Vector3f &wo, const Vector3f &wi) const { return 0; }
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        Float F = FrDielectric(CosTheta(wo), etaA, etaB);
+        return (F * R + (1 - F) * T).MaxComponentValue();
+    }
     std::string ToString() const;
 
   private:
@@ -393,6 +414,9 @@ class LambertianReflection : public BxDF {
     Spectrum f(const Vector3f &wo, const Vector3f &wi) const;
     Spectrum rho(const Vector3f &, int, const Point2f *) const { return R; }
     Spectrum rho(int, const Point2f *, const Point2f *) const { return R; }
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return R.MaxComponentValue();
+    }
     std::string ToString() const;
 
   private:
@@ -411,6 +435,9 @@ class LambertianTransmission : public BxDF {
     Spectrum Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &u,
                       Float *pdf, BxDFType *sampledType) const;
     Float Pdf(const Vector3f &wo, const Vector3f &wi) const;
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return T.MaxComponentValue();
+    }
     std::string ToString() const;
 
   private:
@@ -429,6 +456,9 @@ class OrenNayar : public BxDF {
         A = 1.f - (sigma2 / (2.f * (sigma2 + 0.33f)));
         B = 0.45f * sigma2 / (sigma2 + 0.09f);
     }
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return R.MaxComponentValue();
+    }
     std::string ToString() const;
 
   private:
@@ -450,6 +480,9 @@ class MicrofacetReflection : public BxDF {
     Spectrum Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &u,
                       Float *pdf, BxDFType *sampledType) const;
     Float Pdf(const Vector3f &wo, const Vector3f &wi) const;
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return (R * fresnel->Evaluate(CosTheta(wo))).MaxComponentValue();
+    }
     std::string ToString() const;
 
   private:
@@ -476,6 +509,10 @@ class MicrofacetTransmission : public BxDF {
     Spectrum Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &u,
                       Float *pdf, BxDFType *sampledType) const;
     Float Pdf(const Vector3f &wo, const Vector3f &wi) const;
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return (T * (Spectrum(1.) - fresnel.Evaluate(CosTheta(wo))))
+            .MaxComponentValue();
+    }
     std::string ToString() const;
 
   private:
@@ -500,6 +537,9 @@ class FresnelBlend : public BxDF {
     Spectrum Sample_f(const Vector3f &wi, Vector3f *sampled_f, const Point2f &u,
                       Float *pdf, BxDFType *sampledType) const;
     Float Pdf(const Vector3f &wo, const Vector3f &wi) const;
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return (Rd + SchlickFresnel(AbsCosTheta(wo))).MaxComponentValue();
+    }
     std::string ToString() const;
 
   private:
@@ -529,6 +569,8 @@ class FourierBSDF : public BxDF {
 
 // BSDF Inline Method Definitions
 inline int BSDF::NumComponents(BxDFType flags) const {
+    if (selectedLobe >= 0)
+        return bxdfs[selectedLobe]->MatchesFlags(flags) ? 1 : 0;
     int num = 0;
     for (int i = 0; i < nBxDFs; ++i)
         if (bxdfs[i]->MatchesFlags(flags)) ++num;
@@ -35,6 +35,7 @@
 #include "sampling.h"
 #include "geometry.h"
 #include "shape.h"
+#include "parallel.h"
 
 namespace pbrt {
 
@@ -170,4 +171,86 @@ Distribution2D::Distribution2D(const Float *func, int nu, int nv) {
     pMarginal.reset(new Distribution1D(&marginalFunc[0], nv));
 }
 
+AliasTable::AliasTable(const Float *weights, int n) : bins(n) {
+    CHECK_GT(n, 0);
+    double sum = 0;
+    for (int i = 0; i < n; ++i) {
+        CHECK_GE(weights[i], 0);
+        sum += weights[i];
+    }
+    // Partition the items by whether their probabilities scaled by _n_ are
+    // under or over one, then fill each under-full bin with an alias to an
+    // over-full item (Vose's algorithm)
+    std::vector<std::pair<int, double>> under, over;
+    under.reserve(n);
+    over.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        double p = (sum > 0) ? weights[i] / sum : 1. / n;
+        bins[i].pmf = p;
+        double pn = p * n;
+        if (pn < 1)
+            under.push_back(std::make_pair(i, pn));
+        else
+            over.push_back(std::make_pair(i, pn));
+    }
+    while (!under.empty() && !over.empty()) {
+        std::pair<int, double> u = under.back(), o = over.back();
+        under.pop_back();
+        over.pop_back();
+        bins[u.first].q = u.second;
+        bins[u.first].alias = o.first;
+        // The over-full item gives up the rest of the under-full bin
+        double excess = u.second + o.second - 1;
+        if (excess < 1)
+            under.push_back(std::make_pair(o.first, excess));
+        else
+            over.push_back(std::make_pair(o.first, excess));
+    }
+    // Any remaining items' probabilities are one up to roundoff error
+    for (const std::pair<int, double> &u : under) {
+        bins[u.first].q = 1;
+        bins[u.first].alias = u.first;
+    }
+    for (const std::pair<int, double> &o : over) {
+        bins[o.first].q = 1;
+        bins[o.first].alias = o.first;
+    }
+}
+
+HierarchicalDistribution2D::HierarchicalDistribution2D(const Float *func,
+                                                       int nu, int nv) {
+    CHECK(IsPowerOf2(nu) && IsPowerOf2(nv));
+    levels.push_back(std::vector<Float>(func, func + nu * nv));
+    resolution.push_back(Point2i(nu, nv));
+    for (int i = 0; i < nu * nv; ++i) CHECK_GE(func[i], 0);
+
+    // Sum blocks of each level's values to compute the next coarser level
+    while (nu > 1 || nv > 1) {
+        int nx = (nu > 1) ? 2 : 1, ny = (nv > 1) ? 2 : 1;
+        nu /= nx;
+        nv /= ny;
+        const std::vector<Float> &fine = levels.back();
+        int fineWidth = resolution.back().x;
+        std::vector<Float> coarse(nu * nv);
+        ParallelFor([&](int64_t y) {
+            for (int x = 0; x < nu; ++x) {
+                Float sum = 0;
+                for (int r = 0; r < ny; ++r)
+                    for (int c = 0; c < nx; ++c)
+                        sum += fine[(y * ny + r) * fineWidth + x * nx + c];
+                coarse[y * nu + x] = sum;
+            }
+        }, nv, 64);
+        levels.push_back(std::move(coarse));
+        resolution.push_back(Point2i(nu, nv));
+    }
+}
+
+size_t HierarchicalDistribution2D::BytesUsed() const {
+    size_t bytes = sizeof(*this) + resolution.capacity() * sizeof(Point2i);
+    for (const std::vector<Float> &level : levels)
+        bytes += sizeof(level) + level.capacity() * sizeof(Float);
+    return bytes;
+}
+
 }  // namespace pbrt
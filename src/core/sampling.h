@@ -52,9 +52,62 @@ void StratifiedSample1D(Float *samples, int nsamples, RNG &rng,
 void StratifiedSample2D(Point2f *samples, int nx, int ny, RNG &rng,
                         bool jitter = true);
 void LatinHypercube(Float *samples, int nSamples, int nDim, RNG &rng);
+
+// AliasTable samples one of a fixed set of items with probability
+// proportional to its weight in constant time using Walker's alias method:
+// each of its bins holds an item and, for the rest of the bin's
+// probability, an alias to another item.
+class AliasTable {
+  public:
+    // AliasTable Public Methods
+    AliasTable() = default;
+    AliasTable(const Float *weights, int n);
+    // Returns the index of the sampled item; if non-null, |pmf| is set to
+    // its probability and |uRemapped| to a new uniform sample in $[0,1)$
+    // derived from |u|.
+    int Sample(Float u, Float *pmf = nullptr, Float *uRemapped = nullptr) const {
+        int n = int(bins.size());
+        int offset = std::min(int(u * n), n - 1);
+        Float up = std::min(u * n - offset, OneMinusEpsilon);
+        const Bin &bin = bins[offset];
+        if (up < bin.q) {
+            if (pmf) *pmf = bin.pmf;
+            if (uRemapped) *uRemapped = std::min(up / bin.q, OneMinusEpsilon);
+            return offset;
+        }
+        if (pmf) *pmf = bins[bin.alias].pmf;
+        if (uRemapped)
+            *uRemapped =
+                std::min((up - bin.q) / (1 - bin.q), OneMinusEpsilon);
+        return bin.alias;
+    }
+    Float PMF(int index) const { return bins[index].pmf; }
+    int Count() const { return int(bins.size()); }
+    bool Empty() const { return bins.empty(); }
+    size_t BytesUsed() const { return bins.capacity() * sizeof(Bin); }
+
+  private:
+    // AliasTable Private Data
+    struct Bin {
+        // The probability of choosing the bin's own item once the bin has
+        // been chosen, and that item's overall probability
+        Float q, pmf;
+        int alias;
+    };
+    std::vector<Bin> bins;
+};
+
+// Distribution1D represents a piecewise-constant 1D function and samples
+// it by inverting its CDF with a binary search. If |aliasSampling| is
+// true, it also builds an alias table and uses it to sample in constant
+// time. The alias table doesn't map |u| to the domain monotonically,
+// though, so it breaks up the stratification of low-discrepancy samples;
+// it's best suited to large distributions sampled with independent
+// values, like light selection.
 struct Distribution1D {
     // Distribution1D Public Methods
-    Distribution1D(const Float *f, int n) : func(f, f + n), cdf(n + 1) {
+    Distribution1D(const Float *f, int n, bool aliasSampling = false)
+        : func(f, f + n), cdf(n + 1) {
         // Compute integral of step function at $x_i$
         cdf[0] = 0;
         for (int i = 1; i < n + 1; ++i) cdf[i] = cdf[i - 1] + func[i - 1] / n;
@@ -66,9 +119,20 @@ struct Distribution1D {
         } else {
             for (int i = 1; i < n + 1; ++i) cdf[i] /= funcInt;
         }
+        if (aliasSampling) aliasTable = AliasTable(f, n);
     }
     int Count() const { return (int)func.size(); }
+    bool AliasSampling() const { return !aliasTable.Empty(); }
     Float SampleContinuous(Float u, Float *pdf, int *off = nullptr) const {
+        if (AliasSampling()) {
+            // Choose a segment with the alias table and use the remapped
+            // sample to choose a point inside it
+            Float du;
+            int offset = aliasTable.Sample(u, nullptr, &du);
+            if (off) *off = offset;
+            if (pdf) *pdf = (funcInt > 0) ? func[offset] / funcInt : 0;
+            return (offset + du) / Count();
+        }
         // Find surrounding CDF segments and _offset_
         int offset = FindInterval((int)cdf.size(),
                                   [&](int index) { return cdf[index] <= u; });
@@ -89,6 +153,12 @@ struct Distribution1D {
     }
     int SampleDiscrete(Float u, Float *pdf = nullptr,
                        Float *uRemapped = nullptr) const {
+        if (AliasSampling()) {
+            int offset = aliasTable.Sample(u, nullptr, uRemapped);
+            if (pdf)
+                *pdf = (funcInt > 0) ? func[offset] / (funcInt * Count()) : 0;
+            return offset;
+        }
         // Find surrounding CDF segments and _offset_
         int offset = FindInterval((int)cdf.size(),
                                   [&](int index) { return cdf[index] <= u; });
@@ -103,9 +173,15 @@ struct Distribution1D {
         return func[index] / (funcInt * Count());
     }
 
+    size_t BytesUsed() const {
+        return (func.capacity() + cdf.capacity()) * sizeof(Float) +
+               aliasTable.BytesUsed();
+    }
+
     // Distribution1D Public Data
     std::vector<Float> func, cdf;
     Float funcInt;
+    AliasTable aliasTable;
 };
 
 Point2f RejectionSampleDisk(RNG &rng);
@@ -146,6 +222,152 @@ class Distribution2D {
     std::unique_ptr<Distribution1D> pMarginal;
 };
 
+// HierarchicalDistribution2D samples a piecewise-constant 2D function with
+// power-of-two resolution by hierarchical sample warping: it stores the
+// function's sums over a MIP pyramid and, starting from the coarsest
+// level, warps the sample to choose among each node's children in
+// proportion to their sums.  The sampling methods optionally take a
+// function that returns an additional weight for a node given its extent
+// in [0,1]^2, which is applied at the first |nWeightedLevels| levels below
+// the root, e.g. to account for a product with another function.
+class HierarchicalDistribution2D {
+  public:
+    // HierarchicalDistribution2D Public Methods
+    HierarchicalDistribution2D(const Float *func, int nu, int nv);
+    Point2f SampleContinuous(const Point2f &u, Float *pdf) const {
+        return SampleContinuous(u, pdf, [](const Bounds2f &) { return 1; },
+                                0);
+    }
+    template <typename NodeWeight>
+    Point2f SampleContinuous(const Point2f &uSample, Float *pdf,
+                             NodeWeight nodeWeight, int nWeightedLevels) const;
+    Float Pdf(const Point2f &p) const {
+        return Pdf(p, [](const Bounds2f &) { return 1; }, 0);
+    }
+    template <typename NodeWeight>
+    Float Pdf(const Point2f &p, NodeWeight nodeWeight,
+              int nWeightedLevels) const;
+    size_t BytesUsed() const;
+
+  private:
+    // HierarchicalDistribution2D Private Methods
+    Float Value(int level, int x, int y) const {
+        return levels[level][y * resolution[level].x + x];
+    }
+    Bounds2f NodeBounds(int level, int x, int y) const {
+        const Point2i &res = resolution[level];
+        return Bounds2f(Point2f(Float(x) / res.x, Float(y) / res.y),
+                        Point2f(Float(x + 1) / res.x, Float(y + 1) / res.y));
+    }
+    // Computes the possibly weighted values of the children of node
+    // "(x,y)" at |level|+1 and returns their sum; |nx| and |ny| are set to
+    // the number of children along each axis.
+    template <typename NodeWeight>
+    Float Children(int level, int x, int y, bool weighted,
+                   NodeWeight nodeWeight, Float w[2][2], int *nx,
+                   int *ny) const {
+        *nx = resolution[level].x / resolution[level + 1].x;
+        *ny = resolution[level].y / resolution[level + 1].y;
+        Float sum = 0;
+        for (int r = 0; r < 2; ++r)
+            for (int c = 0; c < 2; ++c) {
+                w[r][c] = 0;
+                if (r >= *ny || c >= *nx) continue;
+                int cx = x * *nx + c, cy = y * *ny + r;
+                w[r][c] = Value(level, cx, cy);
+                if (weighted && w[r][c] > 0)
+                    w[r][c] *= nodeWeight(NodeBounds(level, cx, cy));
+                sum += w[r][c];
+            }
+        return sum;
+    }
+
+    // HierarchicalDistribution2D Private Data
+    // levels[0] holds the function's values; each following level holds
+    // the sums of 2x2 (or 2x1 or 1x2) blocks of the previous one.
+    std::vector<std::vector<Float>> levels;
+    std::vector<Point2i> resolution;
+};
+
+template <typename NodeWeight>
+Point2f HierarchicalDistribution2D::SampleContinuous(
+    const Point2f &uSample, Float *pdf, NodeWeight nodeWeight,
+    int nWeightedLevels) const {
+    // Descend from the root, choosing a row and then a column of children
+    // at each level and remapping _u_ to $[0,1)$ after each choice
+    Point2f u = uSample;
+    int x = 0, y = 0;
+    Float prob = 1;
+    int top = int(levels.size()) - 1;
+    for (int level = top - 1; level >= 0; --level) {
+        Float w[2][2];
+        int nx, ny;
+        bool weighted = top - 1 - level < nWeightedLevels;
+        Float sum = Children(level, x, y, weighted, nodeWeight, w, &nx, &ny);
+        if (sum == 0) {
+            *pdf = 0;
+            return Point2f();
+        }
+        int row = 0;
+        Float rowSum = w[0][0] + w[0][1];
+        if (ny == 2) {
+            Float p0 = rowSum / sum;
+            if (u[1] < p0)
+                u[1] = std::min(u[1] / p0, OneMinusEpsilon);
+            else {
+                u[1] = std::min((u[1] - p0) / (1 - p0), OneMinusEpsilon);
+                row = 1;
+                rowSum = sum - rowSum;
+            }
+        }
+        int col = 0;
+        if (nx == 2) {
+            Float p0 = w[row][0] / rowSum;
+            if (u[0] < p0)
+                u[0] = std::min(u[0] / p0, OneMinusEpsilon);
+            else {
+                u[0] = std::min((u[0] - p0) / (1 - p0), OneMinusEpsilon);
+                col = 1;
+            }
+        }
+        prob *= w[row][col] / sum;
+        x = x * nx + col;
+        y = y * ny + row;
+    }
+
+    // Sample uniformly within the chosen texel
+    *pdf = prob * resolution[0].x * resolution[0].y;
+    return Point2f((x + u[0]) / resolution[0].x, (y + u[1]) / resolution[0].y);
+}
+
+template <typename NodeWeight>
+Float HierarchicalDistribution2D::Pdf(const Point2f &p, NodeWeight nodeWeight,
+                                      int nWeightedLevels) const {
+    int x0 = Clamp(int(p[0] * resolution[0].x), 0, resolution[0].x - 1);
+    int y0 = Clamp(int(p[1] * resolution[0].y), 0, resolution[0].y - 1);
+    Float prob = 1;
+    int top = int(levels.size()) - 1;
+    int level = top;
+    // Follow the weighted levels' choices down to the node containing _p_;
+    // below them, the probability of reaching the texel is just the ratio
+    // of its value to the node's.
+    for (int i = 0; i < nWeightedLevels && level > 0; ++i, --level) {
+        int x = x0 / (resolution[0].x / resolution[level].x);
+        int y = y0 / (resolution[0].y / resolution[level].y);
+        Float w[2][2];
+        int nx, ny;
+        Float sum = Children(level - 1, x, y, true, nodeWeight, w, &nx, &ny);
+        Float wp = w[y0 / (resolution[0].y / resolution[level - 1].y) - y * ny]
+                    [x0 / (resolution[0].x / resolution[level - 1].x) - x * nx];
+        if (wp == 0) return 0;
+        prob *= wp / sum;
+    }
+    Float node = Value(level, x0 / (resolution[0].x / resolution[level].x),
+                       y0 / (resolution[0].y / resolution[level].y));
+    if (node == 0) return 0;
+    return prob * Value(0, x0, y0) / node * resolution[0].x * resolution[0].y;
+}
+
 // Sampling Inline Functions
 template <typename T>
 void Shuffle(T *samp, int count, int nDimensions, RNG &rng) {
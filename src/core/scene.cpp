@@ -40,6 +40,8 @@ namespace pbrt {
 STAT_COUNTER("Intersections/Regular ray intersection tests",
              nIntersectionTests);
 STAT_COUNTER("Intersections/Shadow ray intersection tests", nShadowTests);
+STAT_COUNTER("Intersections/BSSRDF probe ray intersection tests",
+             nProbeTests);
 
 // Scene Method Definitions
 bool Scene::Intersect(const Ray &ray, SurfaceInteraction *isect) const {
@@ -54,6 +56,13 @@ bool Scene::IntersectP(const Ray &ray) const {
     return aggregate->IntersectP(ray);
 }
 
+void Scene::IntersectProbe(const Ray &ray, const Material *material,
+                           ProbeReservoir *reservoir) const {
+    ++nProbeTests;
+    DCHECK_NE(ray.d, Vector3f(0,0,0));
+    aggregate->IntersectProbe(ray, material, reservoir);
+}
+
 bool Scene::IntersectTr(Ray ray, Sampler &sampler, SurfaceInteraction *isect,
                         Spectrum *Tr) const {
     *Tr = Spectrum(1.f);
@@ -55,6 +55,7 @@ class Scene {
         : lights(lights), aggregate(aggregate) {
         // Scene Constructor Implementation
         worldBound = aggregate->WorldBound();
+        for (size_t i = 0; i < lights.size(); ++i) lights[i]->index = int(i);
         for (const auto &light : lights) {
             light->Preprocess(*this);
             if (light->flags & (int)LightFlags::Infinite)
@@ -64,6 +65,8 @@ class Scene {
     const Bounds3f &WorldBound() const { return worldBound; }
     bool Intersect(const Ray &ray, SurfaceInteraction *isect) const;
     bool IntersectP(const Ray &ray) const;
+    void IntersectProbe(const Ray &ray, const Material *material,
+                        ProbeReservoir *reservoir) const;
     bool IntersectTr(Ray ray, Sampler &sampler, SurfaceInteraction *isect,
                      Spectrum *transmittance) const;
 
@@ -82,6 +82,12 @@ class Shape {
     // used in this case.
     virtual Float SolidAngle(const Point3f &p, int nSamples = 512) const;
 
+    // Returns a cone that bounds the shape's world-space surface normals,
+    // oriented as in the interactions that Sample() returns.
+    virtual DirectionCone NormalBounds() const {
+        return DirectionCone::EntireSphere();
+    }
+
     // Shape Public Data
     const Transform *ObjectToWorld, *WorldToObject;
     const bool reverseOrientation;
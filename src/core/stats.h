@@ -154,7 +154,7 @@ enum class Prof {
     BDPTGenerateSubpath,
     BDPTConnectSubpaths,
     LightDistribLookup,
-    LightDistribSpinWait,
+    LightDistribWait,
     LightDistribCreation,
     DirectLighting,
     BSDFEvaluation,
@@ -185,7 +185,9 @@ enum class Prof {
     GetSample,
     TexFiltTrilerp,
     TexFiltEWA,
+    TexFiltAniso,
     TexFiltPtex,
+    TexCacheTileRead,
     NumProfCategories
 };
 
@@ -209,7 +211,7 @@ static const char *ProfNames[] = {
     "BDPT subpath generation",
     "BDPT subpath connections",
     "SpatialLightDistribution lookup",
-    "SpatialLightDistribution spin wait",
+    "SpatialLightDistribution wait",
     "SpatialLightDistribution creation",
     "Direct lighting",
     "BSDF::f()",
@@ -240,7 +242,9 @@ static const char *ProfNames[] = {
     "Sampler::GetSample[12]D()",
     "MIPMap::Lookup() (trilinear)",
     "MIPMap::Lookup() (EWA)",
+    "MIPMap::Lookup() (anisotropic)",
     "Ptex lookup",
+    "TextureCache tile read",
 };
 
 static_assert((int)Prof::NumProfCategories ==
@@ -0,0 +1,272 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+// core/texcache.cpp*
+#include "texcache.h"
+#include "stats.h"
+#include <string.h>
+
+namespace pbrt {
+
+STAT_PERCENT("Texture/Tile cache misses", nTileMisses, nTileLookups);
+STAT_MEMORY_COUNTER("Memory/Texture tiles read", tileBytesRead);
+
+// TiledImage Method Definitions
+static const char TiledImageMagic[8] = {'P', 'B', 'R', 'T', 'T', 'M', 'I', 'P'};
+static const int32_t TiledImageVersion = 1;
+
+TiledImage::TiledImage(const std::string &filename, int tileSize,
+                       std::vector<Point2i> levelRes)
+    : filename(filename),
+      tileSize(tileSize),
+      levelResolution(std::move(levelRes)),
+      in(filename, std::ios::binary) {
+    // Compute file offsets of the first tile of each level
+    int64_t tileBytes = int64_t(tileSize) * tileSize * 3 * sizeof(float);
+    int64_t offset = sizeof(TiledImageMagic) + 3 * sizeof(int32_t) +
+                     levelResolution.size() * 2 * sizeof(int32_t);
+    for (const Point2i &res : levelResolution) {
+        levelOffset.push_back(offset);
+        int64_t nTiles = int64_t((res.x + tileSize - 1) / tileSize) *
+                         ((res.y + tileSize - 1) / tileSize);
+        offset += nTiles * tileBytes;
+    }
+}
+
+std::unique_ptr<TiledImage> TiledImage::Open(const std::string &filename) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        Error("%s: unable to open tiled image", filename.c_str());
+        return nullptr;
+    }
+    char magic[sizeof(TiledImageMagic)];
+    int32_t header[3];
+    if (!in.read(magic, sizeof(magic)) ||
+        memcmp(magic, TiledImageMagic, sizeof(magic)) != 0 ||
+        !in.read((char *)header, sizeof(header))) {
+        Error("%s: not a tiled image file", filename.c_str());
+        return nullptr;
+    }
+    if (header[0] != TiledImageVersion) {
+        Error("%s: unsupported tiled image version %d", filename.c_str(),
+              header[0]);
+        return nullptr;
+    }
+    int tileSize = header[1], nLevels = header[2];
+    if (tileSize <= 0 || nLevels <= 0 || nLevels > 32) {
+        Error("%s: corrupt tiled image header", filename.c_str());
+        return nullptr;
+    }
+    std::vector<Point2i> levelResolution(nLevels);
+    for (Point2i &res : levelResolution) {
+        int32_t r[2];
+        if (!in.read((char *)r, sizeof(r)) || r[0] <= 0 || r[1] <= 0) {
+            Error("%s: corrupt tiled image header", filename.c_str());
+            return nullptr;
+        }
+        res = Point2i(r[0], r[1]);
+    }
+    return std::unique_ptr<TiledImage>(
+        new TiledImage(filename, tileSize, std::move(levelResolution)));
+}
+
+bool TiledImage::ReadTile(int level, const Point2i &tile,
+                          RGBSpectrum *texels) const {
+    CHECK_LT(level, Levels());
+    const Point2i &res = levelResolution[level];
+    int nTilesX = (res.x + tileSize - 1) / tileSize;
+    int nTexels = tileSize * tileSize;
+    int64_t offset = levelOffset[level] +
+                     (int64_t(tile.y) * nTilesX + tile.x) * nTexels * 3 *
+                         int64_t(sizeof(float));
+    std::vector<float> buf(3 * nTexels);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        in.clear();
+        in.seekg(offset);
+        if (!in.read((char *)buf.data(), buf.size() * sizeof(float))) {
+            Error("%s: unable to read tile (%d, %d) of level %d",
+                  filename.c_str(), tile.x, tile.y, level);
+            return false;
+        }
+    }
+    for (int i = 0; i < nTexels; ++i) {
+        Float rgb[3] = {buf[3 * i], buf[3 * i + 1], buf[3 * i + 2]};
+        texels[i] = RGBSpectrum::FromRGB(rgb);
+    }
+    return true;
+}
+
+bool WriteTiledImage(
+    const std::string &filename, int tileSize,
+    const std::vector<Point2i> &levelResolution,
+    const std::function<RGBSpectrum(int level, int s, int t)> &texel) {
+    std::ofstream out(filename, std::ios::binary);
+    int32_t header[3] = {TiledImageVersion, tileSize,
+                         (int32_t)levelResolution.size()};
+    out.write(TiledImageMagic, sizeof(TiledImageMagic));
+    out.write((const char *)header, sizeof(header));
+    for (const Point2i &res : levelResolution) {
+        int32_t r[2] = {res.x, res.y};
+        out.write((const char *)r, sizeof(r));
+    }
+
+    // Write the tiles of each level in scanline order
+    std::vector<float> buf(3 * tileSize * tileSize);
+    for (size_t level = 0; level < levelResolution.size(); ++level) {
+        const Point2i &res = levelResolution[level];
+        for (int t0 = 0; t0 < res.y; t0 += tileSize)
+            for (int s0 = 0; s0 < res.x; s0 += tileSize) {
+                std::fill(buf.begin(), buf.end(), 0.f);
+                for (int t = t0; t < std::min(t0 + tileSize, res.y); ++t)
+                    for (int s = s0; s < std::min(s0 + tileSize, res.x); ++s) {
+                        Float rgb[3];
+                        texel(level, s, t).ToRGB(rgb);
+                        float *p =
+                            &buf[3 * ((t - t0) * tileSize + (s - s0))];
+                        for (int c = 0; c < 3; ++c) p[c] = rgb[c];
+                    }
+                out.write((const char *)buf.data(),
+                          buf.size() * sizeof(float));
+            }
+    }
+    if (!out) {
+        Error("%s: unable to write tiled image", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+// TextureCache Method Definitions
+TextureCache *TextureCache::GetCache() {
+    // The cache is never freed, so that MIPMaps released during static
+    // destruction can still remove their tiles from it.
+    static TextureCache *cache =
+        new TextureCache(size_t(PbrtOptions.textureCacheMB) << 20);
+    return cache;
+}
+
+TextureCache::TextureCache(size_t maxBytes)
+    : maxShardBytes(std::max<size_t>(1, maxBytes / NumShards)) {}
+
+int TextureCache::AddImage(TileLoader loader) {
+    std::lock_guard<std::mutex> lock(loaderMutex);
+    std::shared_ptr<TileLoader> l = std::make_shared<TileLoader>(loader);
+    for (size_t i = 0; i < loaders.size(); ++i)
+        if (!loaders[i]) {
+            loaders[i] = l;
+            return i;
+        }
+    CHECK_LT(loaders.size(), 1 << 16);
+    loaders.push_back(l);
+    return loaders.size() - 1;
+}
+
+void TextureCache::RemoveImage(int id) {
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto iter = shard.lru.begin(); iter != shard.lru.end();) {
+            if ((iter->key >> 48) == uint64_t(id)) {
+                shard.bytes -= iter->bytes;
+                shard.tiles.erase(iter->key);
+                iter = shard.lru.erase(iter);
+            } else
+                ++iter;
+        }
+    }
+    std::lock_guard<std::mutex> lock(loaderMutex);
+    loaders[id].reset();
+}
+
+std::shared_ptr<const void> TextureCache::GetTile(int id, int level,
+                                                  const Point2i &tile) {
+    ++nTileLookups;
+    DCHECK(level >= 0 && level < 256);
+    DCHECK(tile.x >= 0 && tile.x < (1 << 20) && tile.y >= 0 &&
+           tile.y < (1 << 20));
+    uint64_t key = (uint64_t(id) << 48) | (uint64_t(level) << 40) |
+                   (uint64_t(tile.y) << 20) | uint64_t(tile.x);
+    Shard &shard = shards[MixBits(key) % NumShards];
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    auto iter = shard.tiles.find(key);
+    while (iter != shard.tiles.end() && !iter->second->texels) {
+        // Wait for the thread that is loading the tile
+        shard.tileLoaded.wait(lock);
+        iter = shard.tiles.find(key);
+    }
+    if (iter != shard.tiles.end()) {
+        // Move the tile to the front of the shard's LRU list
+        shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+        return iter->second->texels;
+    }
+
+    // Add a placeholder for the tile and load it without holding the lock
+    ++nTileMisses;
+    shard.lru.push_front({key, nullptr, 0});
+    shard.tiles[key] = shard.lru.begin();
+    lock.unlock();
+    std::shared_ptr<TileLoader> loader;
+    {
+        std::lock_guard<std::mutex> loaderLock(loaderMutex);
+        loader = loaders[id];
+    }
+    size_t bytes = 0;
+    std::shared_ptr<const void> texels;
+    {
+        ProfilePhase _(Prof::TexCacheTileRead);
+        texels = (*loader)(level, tile, &bytes);
+    }
+    tileBytesRead += bytes;
+
+    // Store the tile unless its image was removed while it was loading
+    lock.lock();
+    iter = shard.tiles.find(key);
+    if (iter != shard.tiles.end()) {
+        iter->second->texels = texels;
+        iter->second->bytes = bytes;
+        shard.bytes += bytes;
+    }
+    shard.tileLoaded.notify_all();
+
+    // Evict least recently used tiles until the shard fits its budget
+    for (auto victim = shard.lru.end();
+         shard.bytes > maxShardBytes && victim != shard.lru.begin();) {
+        --victim;
+        if (!victim->texels || victim->key == key) continue;
+        shard.bytes -= victim->bytes;
+        shard.tiles.erase(victim->key);
+        victim = shard.lru.erase(victim);
+    }
+    return texels;
+}
+
+}  // namespace pbrt
@@ -0,0 +1,138 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_CORE_TEXCACHE_H
+#define PBRT_CORE_TEXCACHE_H
+
+// core/texcache.h*
+#include "pbrt.h"
+#include "geometry.h"
+#include "spectrum.h"
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace pbrt {
+
+// TiledImage Declarations
+
+// Tiled MIP-mapped images (".tmip" files) store all levels of a MIP
+// pyramid as square tiles of RGB texels, so that individual tiles can be
+// read on demand. The file starts with the "PBRTTMIP" magic string and a
+// header of 32-bit integers (version, tile size, number of levels, and the
+// resolution of each level), followed by the tiles of each level in
+// scanline order. Each tile holds tileSize*tileSize RGB float triples in
+// native byte order; texels past the edge of a level are zero.
+class TiledImage {
+  public:
+    // TiledImage Public Methods
+    static std::unique_ptr<TiledImage> Open(const std::string &filename);
+    int Levels() const { return levelResolution.size(); }
+    const Point2i &LevelResolution(int level) const {
+        return levelResolution[level];
+    }
+    int TileSize() const { return tileSize; }
+    bool ReadTile(int level, const Point2i &tile, RGBSpectrum *texels) const;
+
+  private:
+    // TiledImage Private Methods
+    TiledImage(const std::string &filename, int tileSize,
+               std::vector<Point2i> levelResolution);
+
+    // TiledImage Private Data
+    const std::string filename;
+    const int tileSize;
+    const std::vector<Point2i> levelResolution;
+    std::vector<int64_t> levelOffset;
+    mutable std::mutex mutex;
+    mutable std::ifstream in;
+};
+
+bool WriteTiledImage(
+    const std::string &filename, int tileSize,
+    const std::vector<Point2i> &levelResolution,
+    const std::function<RGBSpectrum(int level, int s, int t)> &texel);
+
+// TextureCache Declarations
+
+// The TextureCache holds tiles of all tiled textures, evicting the least
+// recently used ones once its memory budget is exceeded. Tiles are handed
+// out as shared pointers, so evicted tiles stay valid while they are in
+// use. Tiles are loaded without holding their shard's lock; other threads
+// that need a tile while it's being loaded wait for it.
+class TextureCache {
+  public:
+    // Returns the tile's texels and their size in bytes
+    typedef std::function<std::shared_ptr<const void>(
+        int level, const Point2i &tile, size_t *bytes)>
+        TileLoader;
+
+    // TextureCache Public Methods
+    static TextureCache *GetCache();
+    TextureCache(size_t maxBytes);
+    int AddImage(TileLoader loader);
+    void RemoveImage(int id);
+    std::shared_ptr<const void> GetTile(int id, int level, const Point2i &tile);
+
+  private:
+    // TextureCache Private Data
+    static PBRT_CONSTEXPR int NumShards = 64;
+    struct CachedTile {
+        uint64_t key;
+        // _nullptr_ while the tile is being loaded
+        std::shared_ptr<const void> texels;
+        size_t bytes;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::condition_variable tileLoaded;
+        std::list<CachedTile> lru;
+        std::unordered_map<uint64_t, std::list<CachedTile>::iterator> tiles;
+        size_t bytes = 0;
+    };
+    const size_t maxShardBytes;
+    Shard shards[NumShards];
+    std::mutex loaderMutex;
+    std::vector<std::shared_ptr<TileLoader>> loaders;
+};
+
+}  // namespace pbrt
+
+#endif  // PBRT_CORE_TEXCACHE_H
@@ -0,0 +1,347 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+// core/texgraph.cpp*
+#include "texgraph.h"
+#include "stats.h"
+#include "textures/constant.h"
+#include <type_traits>
+
+namespace pbrt {
+
+STAT_COUNTER("Texture/Compiled texture graphs", nCompiledGraphs);
+STAT_RATIO("Texture/Texture graph nodes folded per graph", nFoldedNodes,
+           nFoldedGraphs);
+
+// TextureProgram Method Definitions
+void TextureProgram::Run(const SurfaceInteraction &si, Float *floatTemps,
+                         Spectrum *spectrumTemps) const {
+    for (const TextureOp &op : ops) {
+        switch (op.type) {
+        case TextureOp::FloatLeaf:
+            floatTemps[op.dst] = floatLeaves[op.a]->Evaluate(si);
+            break;
+        case TextureOp::SpectrumLeaf:
+            spectrumTemps[op.dst] = spectrumLeaves[op.a]->Evaluate(si);
+            break;
+        case TextureOp::FloatMul:
+            floatTemps[op.dst] =
+                GetFloat(op.a, floatTemps) * GetFloat(op.b, floatTemps);
+            break;
+        case TextureOp::SpectrumMul:
+            spectrumTemps[op.dst] = GetSpectrum(op.a, spectrumTemps) *
+                                    GetSpectrum(op.b, spectrumTemps);
+            break;
+        case TextureOp::FloatMix: {
+            Float amt = GetFloat(op.amount, floatTemps);
+            floatTemps[op.dst] = (1 - amt) * GetFloat(op.a, floatTemps) +
+                                 amt * GetFloat(op.b, floatTemps);
+            break;
+        }
+        case TextureOp::SpectrumMix: {
+            Float amt = GetFloat(op.amount, floatTemps);
+            spectrumTemps[op.dst] =
+                (1 - amt) * GetSpectrum(op.a, spectrumTemps) +
+                amt * GetSpectrum(op.b, spectrumTemps);
+            break;
+        }
+        }
+    }
+}
+
+// TextureCompiler Utility Functions
+static std::vector<Float> &Constants(TextureProgram &program, Float) {
+    return program.floatConstants;
+}
+
+static std::vector<Spectrum> &Constants(TextureProgram &program, Spectrum) {
+    return program.spectrumConstants;
+}
+
+static const std::vector<Float> &Constants(const TextureProgram &program,
+                                           Float) {
+    return program.floatConstants;
+}
+
+static const std::vector<Spectrum> &Constants(const TextureProgram &program,
+                                              Spectrum) {
+    return program.spectrumConstants;
+}
+
+static bool IsZero(Float v) { return v == 0; }
+static bool IsZero(const Spectrum &s) { return s.IsBlack(); }
+static bool IsOne(Float v) { return v == 1; }
+static bool IsOne(const Spectrum &s) { return s == Spectrum(1.f); }
+
+// Returns the leaf, multiply and mix operations that produce values of type
+// _T_
+static void OpTypes(Float, TextureOp::Type *leaf, TextureOp::Type *mul,
+                    TextureOp::Type *mix) {
+    *leaf = TextureOp::FloatLeaf;
+    *mul = TextureOp::FloatMul;
+    *mix = TextureOp::FloatMix;
+}
+
+static void OpTypes(Spectrum, TextureOp::Type *leaf, TextureOp::Type *mul,
+                    TextureOp::Type *mix) {
+    *leaf = TextureOp::SpectrumLeaf;
+    *mul = TextureOp::SpectrumMul;
+    *mix = TextureOp::SpectrumMix;
+}
+
+static std::vector<std::shared_ptr<Texture<Float>>> &Leaves(
+    TextureProgram &program, Float) {
+    return program.floatLeaves;
+}
+
+static std::vector<std::shared_ptr<Texture<Spectrum>>> &Leaves(
+    TextureProgram &program, Spectrum) {
+    return program.spectrumLeaves;
+}
+
+static bool IsFloatOp(TextureOp::Type type) {
+    return type == TextureOp::FloatLeaf || type == TextureOp::FloatMul ||
+           type == TextureOp::FloatMix;
+}
+
+static bool IsLeafOp(TextureOp::Type type) {
+    return type == TextureOp::FloatLeaf || type == TextureOp::SpectrumLeaf;
+}
+
+// Removes the operations of subgraphs that folding discarded after they
+// were compiled, such as the unused inputs of a mix with a constant
+// amount, and renumbers the remaining temporaries and leaves
+static void RemoveDeadOps(TextureProgram *program, int *result,
+                          bool resultIsFloat) {
+    // Mark the temporaries that _result_ depends on
+    std::vector<bool> floatLive(program->nFloatTemps, false);
+    std::vector<bool> spectrumLive(program->nSpectrumTemps, false);
+    auto markLive = [&](int operand, bool isFloat) {
+        if (operand >= 0) (isFloat ? floatLive : spectrumLive)[operand] = true;
+    };
+    markLive(*result, resultIsFloat);
+    for (auto iter = program->ops.rbegin(); iter != program->ops.rend();
+         ++iter) {
+        const TextureOp &op = *iter;
+        bool isFloat = IsFloatOp(op.type);
+        if (!(isFloat ? floatLive : spectrumLive)[op.dst] ||
+            IsLeafOp(op.type))
+            continue;
+        markLive(op.a, isFloat);
+        markLive(op.b, isFloat);
+        if (op.type == TextureOp::FloatMix || op.type == TextureOp::SpectrumMix)
+            markLive(op.amount, true);
+    }
+
+    // Keep the live operations, renumbering temporaries and leaves in order
+    std::vector<int> floatTemp(program->nFloatTemps, -1);
+    std::vector<int> spectrumTemp(program->nSpectrumTemps, -1);
+    std::vector<int> floatLeaf(program->floatLeaves.size(), -1);
+    std::vector<int> spectrumLeaf(program->spectrumLeaves.size(), -1);
+    auto remap = [&](int operand, bool isFloat) {
+        return operand < 0 ? operand
+                           : (isFloat ? floatTemp : spectrumTemp)[operand];
+    };
+    TextureProgram live;
+    live.floatConstants = std::move(program->floatConstants);
+    live.spectrumConstants = std::move(program->spectrumConstants);
+    for (TextureOp op : program->ops) {
+        bool isFloat = IsFloatOp(op.type);
+        if (!(isFloat ? floatLive : spectrumLive)[op.dst]) continue;
+        if (op.type == TextureOp::FloatLeaf) {
+            if (floatLeaf[op.a] < 0) {
+                floatLeaf[op.a] = live.floatLeaves.size();
+                live.floatLeaves.push_back(program->floatLeaves[op.a]);
+            }
+            op.a = floatLeaf[op.a];
+        } else if (op.type == TextureOp::SpectrumLeaf) {
+            if (spectrumLeaf[op.a] < 0) {
+                spectrumLeaf[op.a] = live.spectrumLeaves.size();
+                live.spectrumLeaves.push_back(program->spectrumLeaves[op.a]);
+            }
+            op.a = spectrumLeaf[op.a];
+        } else {
+            op.a = remap(op.a, isFloat);
+            op.b = remap(op.b, isFloat);
+            op.amount = remap(op.amount, true);
+        }
+        std::vector<int> &temps = isFloat ? floatTemp : spectrumTemp;
+        temps[op.dst] = isFloat ? live.nFloatTemps++ : live.nSpectrumTemps++;
+        op.dst = temps[op.dst];
+        live.ops.push_back(op);
+    }
+    *result = remap(*result, resultIsFloat);
+    *program = std::move(live);
+}
+
+// TextureCompiler Method Definitions
+template <typename T>
+int TextureCompiler::Compile(const std::shared_ptr<Texture<T>> &tex) {
+    // Reuse the operand of subgraphs that have already been compiled
+    auto iter = compiled.find(tex.get());
+    if (iter != compiled.end()) return iter->second;
+
+    ++nNodes;
+    int operand;
+    if (!tex->Compile(this, &operand)) {
+        TextureOp::Type leaf, mul, mix;
+        OpTypes(T(), &leaf, &mul, &mix);
+        Leaves(program, T()).push_back(tex);
+        operand = Emit(leaf, Leaves(program, T()).size() - 1);
+    }
+    compiled[tex.get()] = operand;
+    return operand;
+}
+
+template <typename T>
+int TextureCompiler::Constant(const T &value) {
+    std::vector<T> &constants = Constants(program, T());
+    for (size_t i = 0; i < constants.size(); ++i)
+        if (constants[i] == value) {
+            ++nFolded;
+            return ~int(i);
+        }
+    constants.push_back(value);
+    return ~int(constants.size() - 1);
+}
+
+template <typename T>
+bool TextureCompiler::IsConstant(int operand, T *value) const {
+    if (operand >= 0) return false;
+    *value = Constants(program, T())[~operand];
+    return true;
+}
+
+template <typename T>
+int TextureCompiler::Mul(int a, int b) {
+    T va, vb;
+    bool aConstant = IsConstant(a, &va), bConstant = IsConstant(b, &vb);
+    if (aConstant && bConstant) {
+        ++nFolded;
+        return Constant<T>(va * vb);
+    }
+    if ((aConstant && IsZero(va)) || (bConstant && IsZero(vb))) {
+        ++nFolded;
+        return Constant<T>(T(0.f));
+    }
+    if (aConstant && IsOne(va)) {
+        ++nFolded;
+        return b;
+    }
+    if (bConstant && IsOne(vb)) {
+        ++nFolded;
+        return a;
+    }
+    TextureOp::Type leaf, mul, mix;
+    OpTypes(T(), &leaf, &mul, &mix);
+    return Emit(mul, a, b);
+}
+
+template <typename T>
+int TextureCompiler::Mix(int a, int b, int amount) {
+    Float amt;
+    if (IsConstant(amount, &amt)) {
+        T va, vb;
+        if (IsConstant(a, &va) && IsConstant(b, &vb)) {
+            ++nFolded;
+            return Constant<T>((1 - amt) * va + amt * vb);
+        }
+        if (amt == 0 || amt == 1) {
+            ++nFolded;
+            return amt == 0 ? a : b;
+        }
+    }
+    TextureOp::Type leaf, mul, mix;
+    OpTypes(T(), &leaf, &mul, &mix);
+    return Emit(mix, a, b, amount);
+}
+
+int TextureCompiler::Emit(TextureOp::Type type, int a, int b, int amount) {
+    // Share the result of an identical earlier operation
+    bool isLeaf = IsLeafOp(type);
+    std::tuple<int, int, int, int> key(type, a, b, amount);
+    if (!isLeaf) {
+        auto iter = emitted.find(key);
+        if (iter != emitted.end()) {
+            ++nFolded;
+            return iter->second;
+        }
+    }
+
+    // Allocate a temporary for the operation's result
+    bool isFloat = IsFloatOp(type);
+    int dst = isFloat ? program.nFloatTemps++ : program.nSpectrumTemps++;
+    program.ops.push_back(TextureOp{type, dst, a, b, amount});
+    if (!isLeaf) emitted[key] = dst;
+    return dst;
+}
+
+template <typename T>
+std::shared_ptr<Texture<T>> CompileTexture(
+    const std::shared_ptr<Texture<T>> &tex) {
+    if (!tex) return tex;
+    TextureCompiler compiler;
+    int result = compiler.Compile(tex);
+    // Single textures are best evaluated directly
+    if (compiler.nNodes == 1) return tex;
+    TextureProgram &program = compiler.program;
+    RemoveDeadOps(&program, &result, std::is_same<T, Float>::value);
+
+    // Graphs that fold to a constant or a single leaf need no program
+    if (result < 0)
+        return std::make_shared<ConstantTexture<T>>(
+            Constants(program, T())[~result]);
+    std::vector<std::shared_ptr<Texture<T>>> &leaves = Leaves(program, T());
+    if (program.ops.size() == 1 && leaves.size() == 1) return leaves[0];
+    ++nCompiledGraphs;
+    nFoldedNodes += compiler.nFolded;
+    ++nFoldedGraphs;
+    return std::make_shared<CompiledTexture<T>>(tex, std::move(program),
+                                                result);
+}
+
+template int TextureCompiler::Compile(const std::shared_ptr<Texture<Float>> &);
+template int TextureCompiler::Compile(
+    const std::shared_ptr<Texture<Spectrum>> &);
+template int TextureCompiler::Constant(const Float &);
+template int TextureCompiler::Constant(const Spectrum &);
+template int TextureCompiler::Mul<Float>(int, int);
+template int TextureCompiler::Mul<Spectrum>(int, int);
+template int TextureCompiler::Mix<Float>(int, int, int);
+template int TextureCompiler::Mix<Spectrum>(int, int, int);
+template std::shared_ptr<Texture<Float>> CompileTexture(
+    const std::shared_ptr<Texture<Float>> &);
+template std::shared_ptr<Texture<Spectrum>> CompileTexture(
+    const std::shared_ptr<Texture<Spectrum>> &);
+
+}  // namespace pbrt
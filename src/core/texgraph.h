@@ -0,0 +1,186 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_CORE_TEXGRAPH_H
+#define PBRT_CORE_TEXGRAPH_H
+
+// core/texgraph.h*
+#include "pbrt.h"
+#include "texture.h"
+#include "spectrum.h"
+#include <map>
+#include <tuple>
+
+namespace pbrt {
+
+// TextureProgram Declarations
+
+// A _TextureProgram_ is a texture graph flattened into a list of
+// operations. Operands that are nonnegative index the temporaries written
+// by earlier operations; negative operands $o$ index the program's
+// constants as $\lnot o$. Textures that the compiler doesn't understand are
+// called through _Texture::Evaluate()_ as leaf operations.
+struct TextureOp {
+    enum Type {
+        FloatLeaf,
+        SpectrumLeaf,
+        FloatMul,
+        SpectrumMul,
+        FloatMix,
+        SpectrumMix
+    };
+    Type type;
+    // _a_ is the index of the leaf texture for leaf operations
+    int dst, a, b, amount;
+};
+
+struct TextureProgram {
+    // TextureProgram Public Methods
+    void Run(const SurfaceInteraction &si, Float *floatTemps,
+             Spectrum *spectrumTemps) const;
+    const Float &GetFloat(int operand, const Float *temps) const {
+        return operand >= 0 ? temps[operand] : floatConstants[~operand];
+    }
+    const Spectrum &GetSpectrum(int operand, const Spectrum *temps) const {
+        return operand >= 0 ? temps[operand] : spectrumConstants[~operand];
+    }
+
+    // TextureProgram Public Data
+    std::vector<TextureOp> ops;
+    std::vector<Float> floatConstants;
+    std::vector<Spectrum> spectrumConstants;
+    std::vector<std::shared_ptr<Texture<Float>>> floatLeaves;
+    std::vector<std::shared_ptr<Texture<Spectrum>>> spectrumLeaves;
+    int nFloatTemps = 0, nSpectrumTemps = 0;
+};
+
+// TextureCompiler Declarations
+
+// Builds a _TextureProgram_ from a texture graph, folding constant
+// subgraphs, collapsing scales by one and mixes with a constant amount of
+// zero or one, and evaluating each distinct subgraph only once. Textures
+// take part by overriding _Texture::Compile()_.
+class TextureCompiler {
+  public:
+    // TextureCompiler Public Methods
+    template <typename T>
+    int Compile(const std::shared_ptr<Texture<T>> &tex);
+    template <typename T>
+    int Constant(const T &value);
+    template <typename T>
+    int Mul(int a, int b);
+    template <typename T>
+    int Mix(int a, int b, int amount);
+    template <typename T1, typename T2>
+    bool Scale(const std::shared_ptr<Texture<T1>> &tex1,
+               const std::shared_ptr<Texture<T2>> &tex2, int *operand) {
+        // Products of different types are left to _Texture::Evaluate()_
+        return false;
+    }
+    template <typename T>
+    bool Scale(const std::shared_ptr<Texture<T>> &tex1,
+               const std::shared_ptr<Texture<T>> &tex2, int *operand) {
+        *operand = Mul<T>(Compile(tex1), Compile(tex2));
+        return true;
+    }
+
+    // TextureCompiler Public Data
+    TextureProgram program;
+    // Number of distinct texture graph nodes visited and the number that
+    // were folded away or shared with an equivalent node
+    int nNodes = 0, nFolded = 0;
+
+  private:
+    // TextureCompiler Private Methods
+    template <typename T>
+    bool IsConstant(int operand, T *value) const;
+    int Emit(TextureOp::Type type, int a, int b = 0, int amount = 0);
+
+    // TextureCompiler Private Data
+    std::map<const void *, int> compiled;
+    std::map<std::tuple<int, int, int, int>, int> emitted;
+};
+
+// CompiledTexture Declarations
+template <typename T>
+class CompiledTexture : public Texture<T> {
+  public:
+    // CompiledTexture Public Methods
+    CompiledTexture(const std::shared_ptr<Texture<T>> &source,
+                    TextureProgram program, int result)
+        : source(source), program(std::move(program)), result(result) {}
+    T Evaluate(const SurfaceInteraction &si) const;
+    bool Compile(TextureCompiler *compiler, int *operand) const {
+        // Inline the original graph into the enclosing program
+        *operand = compiler->Compile(source);
+        return true;
+    }
+
+  private:
+    // CompiledTexture Private Data
+    std::shared_ptr<Texture<T>> source;
+    TextureProgram program;
+    int result;
+};
+
+template <>
+inline Float CompiledTexture<Float>::Evaluate(
+    const SurfaceInteraction &si) const {
+    Float *floatTemps = ALLOCA(Float, program.nFloatTemps);
+    Spectrum *spectrumTemps = ALLOCA(Spectrum, program.nSpectrumTemps);
+    program.Run(si, floatTemps, spectrumTemps);
+    return program.GetFloat(result, floatTemps);
+}
+
+template <>
+inline Spectrum CompiledTexture<Spectrum>::Evaluate(
+    const SurfaceInteraction &si) const {
+    Float *floatTemps = ALLOCA(Float, program.nFloatTemps);
+    Spectrum *spectrumTemps = ALLOCA(Spectrum, program.nSpectrumTemps);
+    program.Run(si, floatTemps, spectrumTemps);
+    return program.GetSpectrum(result, spectrumTemps);
+}
+
+// Returns a texture equivalent to _tex_ that evaluates its graph with a
+// _TextureProgram_; textures that can't be simplified are returned as is.
+template <typename T>
+std::shared_ptr<Texture<T>> CompileTexture(
+    const std::shared_ptr<Texture<T>> &tex);
+
+}  // namespace pbrt
+
+#endif  // PBRT_CORE_TEXGRAPH_H
@@ -45,6 +45,7 @@ inline Float SmoothStep(Float min, Float max, Float value) {
 
 // Texture Forward Declarations
 inline Float Grad(int x, int y, int z, Float dx, Float dy, Float dz);
+inline Float GradFromHash(int h, Float dx, Float dy, Float dz);
 inline Float NoiseWeight(Float t);
 
 // Perlin Noise Data
@@ -191,12 +192,99 @@ Float Noise(Float x, Float y, Float z) {
 }
 
 Float Noise(const Point3f &p) { return Noise(p.x, p.y, p.z); }
+
+// Number of points that _NoiseBatch()_ evaluates together. Each stage of
+// the batch kernel is a fixed-length loop over the batch; apart from the
+// permutation table lookups, the stages can be vectorized by the compiler.
+static PBRT_CONSTEXPR int NoiseBatchSize = 4;
+
+static void NoiseBatch(const Point3f p[NoiseBatchSize],
+                       Float noise[NoiseBatchSize]) {
+    // Compute noise cell coordinates and offsets
+    int ix[NoiseBatchSize], iy[NoiseBatchSize], iz[NoiseBatchSize];
+    Float dx[NoiseBatchSize], dy[NoiseBatchSize], dz[NoiseBatchSize];
+    for (int i = 0; i < NoiseBatchSize; ++i) {
+        // Round toward negative infinity with a truncating conversion so
+        // that the loop doesn't need to call _std::floor()_
+        ix[i] = int(p[i].x);
+        iy[i] = int(p[i].y);
+        iz[i] = int(p[i].z);
+        ix[i] -= p[i].x < ix[i];
+        iy[i] -= p[i].y < iy[i];
+        iz[i] -= p[i].z < iz[i];
+        dx[i] = p[i].x - ix[i];
+        dy[i] = p[i].y - iy[i];
+        dz[i] = p[i].z - iz[i];
+    }
+
+    // Hash the eight corners of each point's cell, indexed by the corner's
+    // $(x,y,z)$ offsets as the bits $xyz$
+    uint8_t h[8][NoiseBatchSize];
+    for (int i = 0; i < NoiseBatchSize; ++i) {
+        int x = ix[i] & (NoisePermSize - 1), y = iy[i] & (NoisePermSize - 1);
+        int z = iz[i] & (NoisePermSize - 1);
+        for (int cx = 0; cx < 2; ++cx) {
+            int px = NoisePerm[x + cx] + y;
+            for (int cy = 0; cy < 2; ++cy) {
+                int pxy = NoisePerm[px + cy] + z;
+                h[4 * cx + 2 * cy][i] = NoisePerm[pxy] & 15;
+                h[4 * cx + 2 * cy + 1][i] = NoisePerm[pxy + 1] & 15;
+            }
+        }
+    }
+
+    // Compute gradient weights and their trilinear interpolation
+    for (int i = 0; i < NoiseBatchSize; ++i) {
+        Float w000 = GradFromHash(h[0][i], dx[i], dy[i], dz[i]);
+        Float w100 = GradFromHash(h[4][i], dx[i] - 1, dy[i], dz[i]);
+        Float w010 = GradFromHash(h[2][i], dx[i], dy[i] - 1, dz[i]);
+        Float w110 = GradFromHash(h[6][i], dx[i] - 1, dy[i] - 1, dz[i]);
+        Float w001 = GradFromHash(h[1][i], dx[i], dy[i], dz[i] - 1);
+        Float w101 = GradFromHash(h[5][i], dx[i] - 1, dy[i], dz[i] - 1);
+        Float w011 = GradFromHash(h[3][i], dx[i], dy[i] - 1, dz[i] - 1);
+        Float w111 = GradFromHash(h[7][i], dx[i] - 1, dy[i] - 1, dz[i] - 1);
+        Float wx = NoiseWeight(dx[i]), wy = NoiseWeight(dy[i]),
+              wz = NoiseWeight(dz[i]);
+        Float x00 = Lerp(wx, w000, w100);
+        Float x10 = Lerp(wx, w010, w110);
+        Float x01 = Lerp(wx, w001, w101);
+        Float x11 = Lerp(wx, w011, w111);
+        Float y0 = Lerp(wy, x00, x10);
+        Float y1 = Lerp(wy, x01, x11);
+        noise[i] = Lerp(wz, y0, y1);
+    }
+}
+
+void Noise(const Point3f *p, int n, Float *noise) {
+    int start = 0;
+    for (; start + NoiseBatchSize <= n; start += NoiseBatchSize)
+        NoiseBatch(p + start, noise + start);
+    if (start < n) {
+        // Pad the remaining points to a full batch
+        Point3f pBatch[NoiseBatchSize];
+        Float noiseBatch[NoiseBatchSize];
+        for (int i = 0; i < n - start; ++i) pBatch[i] = p[start + i];
+        NoiseBatch(pBatch, noiseBatch);
+        for (int i = 0; i < n - start; ++i) noise[start + i] = noiseBatch[i];
+    }
+}
+
 inline Float Grad(int x, int y, int z, Float dx, Float dy, Float dz) {
     int h = NoisePerm[NoisePerm[NoisePerm[x] + y] + z];
-    h &= 15;
-    Float u = h < 8 || h == 12 || h == 13 ? dx : dy;
-    Float v = h < 4 || h == 12 || h == 13 ? dy : dz;
-    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+    return GradFromHash(h & 15, dx, dy, dz);
+}
+
+inline Float GradFromHash(int h, Float dx, Float dy, Float dz) {
+    // Select the gradient with table lookups rather than branches, which
+    // are unpredictable since _h_ is effectively random; the zero terms
+    // leave the sum of the two selected components unchanged.
+    static const Float gx[16] = {1, -1, 1,  -1, 1, -1, 1,  -1,
+                                 0, 0,  0,  0,  1, -1, 0,  0};
+    static const Float gy[16] = {1, 1,  -1, -1, 0, 0,  0,  0,
+                                 1, -1, 1,  -1, 1, 1,  1,  -1};
+    static const Float gz[16] = {0, 0, 0,  0,  1, 1, -1, -1,
+                                 1, 1, -1, -1, 0, 0, -1, -1};
+    return gx[h] * dx + gy[h] * dy + gz[h] * dz;
 }
 
 inline Float NoiseWeight(Float t) {
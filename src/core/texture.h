@@ -136,12 +136,20 @@ class Texture {
   public:
     // Texture Interface
     virtual T Evaluate(const SurfaceInteraction &) const = 0;
+    // Textures that are built from other textures can describe themselves
+    // to a _TextureCompiler_ (see texgraph.h) by emitting their operations
+    // and returning the operand that holds their value; others are
+    // evaluated as leaves of the compiled graph.
+    virtual bool Compile(TextureCompiler *compiler, int *operand) const {
+        return false;
+    }
     virtual ~Texture() {}
 };
 
 Float Lanczos(Float, Float tau = 2);
 Float Noise(Float x, Float y = .5f, Float z = .5f);
 Float Noise(const Point3f &p);
+void Noise(const Point3f *p, int n, Float *noise);
 Float FBm(const Point3f &p, const Vector3f &dpdx, const Vector3f &dpdy,
           Float omega, int octaves);
 Float Turbulence(const Point3f &p, const Vector3f &dpdx, const Vector3f &dpdy,
@@ -51,7 +51,8 @@ STAT_INT_DISTRIBUTION("Integrator/Path length", pathLength);
 // BDPT Forward Declarations
 int RandomWalk(const Scene &scene, RayDifferential ray, Sampler &sampler,
                MemoryArena &arena, Spectrum beta, Float pdf, int maxDepth,
-               TransportMode mode, Vertex *path);
+               int64_t nPaths, TransportMode mode, Vertex *path,
+               bool singleLobe = false);
 
 // BDPT Utility Functions
 Float CorrectShadingNormal(const SurfaceInteraction &isect, const Vector3f &wo,
@@ -68,10 +69,45 @@ Float CorrectShadingNormal(const SurfaceInteraction &isect, const Vector3f &wo,
         return 1;
 }
 
+// Subpaths carry a ray cone--the radius of the ray's footprint at its
+// origin and the angle by which it spreads--that is expressed as ray
+// differentials, so that texture lookups at subpath vertices filter over
+// the region of the scene that neighboring subpaths sample.
+static void ConeFromDifferentials(const RayDifferential &ray, Float *width,
+                                  Float *spread) {
+    *width = *spread = 0;
+    if (!ray.hasDifferentials) return;
+    *width = std::max(Distance(ray.o, ray.rxOrigin),
+                      Distance(ray.o, ray.ryOrigin));
+    Vector3f d = Normalize(ray.d);
+    *spread = std::max(
+        std::acos(Clamp(Dot(d, Normalize(ray.rxDirection)), -1, 1)),
+        std::acos(Clamp(Dot(d, Normalize(ray.ryDirection)), -1, 1)));
+}
+
+static void SetConeDifferentials(RayDifferential *ray, Float width,
+                                 Float spread) {
+    if (width == 0 && spread == 0) return;
+    Vector3f d = Normalize(ray->d), u, v;
+    CoordinateSystem(d, &u, &v);
+    ray->hasDifferentials = true;
+    ray->rxOrigin = ray->o + width * u;
+    ray->ryOrigin = ray->o + width * v;
+    Float tanSpread = std::tan(std::min(spread, Pi / 4));
+    ray->rxDirection = ray->d + tanSpread * ray->d.Length() * u;
+    ray->ryDirection = ray->d + tanSpread * ray->d.Length() * v;
+}
+
+// Returns the spread angle of the cone of solid angle $1/(n p)$ that one
+// of _n_ directions sampled with density _pdf_ accounts for.
+static Float SampledConeSpread(Float pdf, int64_t n) {
+    return pdf > 0 ? std::min(1 / std::sqrt(Pi * pdf * n), Pi / 4) : Pi / 4;
+}
+
 int GenerateCameraSubpath(const Scene &scene, Sampler &sampler,
                           MemoryArena &arena, int maxDepth,
                           const Camera &camera, const Point2f &pFilm,
-                          Vertex *path) {
+                          Vertex *path, bool singleLobe) {
     if (maxDepth == 0) return 0;
     ProfilePhase _(Prof::BDPTGenerateSubpath);
     // Sample initial ray for camera subpath
@@ -90,15 +126,15 @@ int GenerateCameraSubpath(const Scene &scene, Sampler &sampler,
     VLOG(2) << "Starting camera subpath. Ray: " << ray << ", beta " << beta
             << ", pdfPos " << pdfPos << ", pdfDir " << pdfDir;
     return RandomWalk(scene, ray, sampler, arena, beta, pdfDir, maxDepth - 1,
-                      TransportMode::Radiance, path + 1) +
+                      sampler.samplesPerPixel, TransportMode::Radiance,
+                      path + 1, singleLobe) +
            1;
 }
 
 int GenerateLightSubpath(
     const Scene &scene, Sampler &sampler, MemoryArena &arena, int maxDepth,
-    Float time, const Distribution1D &lightDistr,
-    const std::unordered_map<const Light *, size_t> &lightToIndex,
-    Vertex *path) {
+    Float time, const Distribution1D &lightDistr, const Camera &camera,
+    Vertex *path, bool singleLobe) {
     if (maxDepth == 0) return 0;
     ProfilePhase _(Prof::BDPTGenerateSubpath);
     // Sample initial ray for light subpath
@@ -116,11 +152,25 @@ int GenerateLightSubpath(
     path[0] =
         Vertex::CreateLight(light.get(), ray, nLight, Le, pdfPos * lightPdf);
     Spectrum beta = Le * AbsDot(nLight, ray.d) / (lightPdf * pdfPos * pdfDir);
+    // Initialize ray cone for light subpath from the light's sampling
+    // densities. Every sample on the film traces a light subpath, so the
+    // light's samples are shared among all of them rather than just a
+    // pixel's worth.
+    int64_t nLightPaths =
+        sampler.samplesPerPixel * camera.film->GetSampleBounds().Area();
+    Float width = (light->flags & (int)LightFlags::DeltaPosition)
+                      ? 0
+                      : 1 / std::sqrt(Pi * pdfPos * nLightPaths);
+    Float spread = (light->flags & (int)LightFlags::DeltaDirection)
+                       ? 0
+                       : SampledConeSpread(pdfDir, nLightPaths);
+    SetConeDifferentials(&ray, width, spread);
     VLOG(2) << "Starting light subpath. Ray: " << ray << ", Le " << Le <<
         ", beta " << beta << ", pdfPos " << pdfPos << ", pdfDir " << pdfDir;
     int nVertices =
         RandomWalk(scene, ray, sampler, arena, beta, pdfDir, maxDepth - 1,
-                   TransportMode::Importance, path + 1);
+                   nLightPaths, TransportMode::Importance, path + 1,
+                   singleLobe);
 
     // Correct subpath sampling densities for infinite area lights
     if (path[0].IsInfiniteLight()) {
@@ -133,18 +183,22 @@ int GenerateLightSubpath(
 
         // Set spatial density of _path[0]_ for infinite area light
         path[0].pdfFwd =
-            InfiniteLightDensity(scene, lightDistr, lightToIndex, ray.d);
+            InfiniteLightDensity(scene, lightDistr, ray.d);
     }
     return nVertices + 1;
 }
 
 int RandomWalk(const Scene &scene, RayDifferential ray, Sampler &sampler,
                MemoryArena &arena, Spectrum beta, Float pdf, int maxDepth,
-               TransportMode mode, Vertex *path) {
+               int64_t nPaths, TransportMode mode, Vertex *path,
+               bool singleLobe) {
     if (maxDepth == 0) return 0;
     int bounces = 0;
     // Declare variables for forward and reverse probability densities
     Float pdfFwd = pdf, pdfRev = 0;
+    // Declare variables for the ray cone that tracks the subpath's footprint
+    Float width, spread;
+    ConeFromDifferentials(ray, &width, &spread);
     while (true) {
         // Attempt to create the next subpath vertex in _path_
         MediumInteraction mi;
@@ -165,7 +219,10 @@ int RandomWalk(const Scene &scene, RayDifferential ray, Sampler &sampler,
             // Sample direction and compute reverse density at preceding vertex
             Vector3f wi;
             pdfFwd = pdfRev = mi.phase->Sample_p(-ray.d, &wi, sampler.Get2D());
+            width += spread * Distance(ray.o, mi.p);
+            spread = std::max(spread, SampledConeSpread(pdfFwd, nPaths));
             ray = mi.SpawnRay(wi);
+            SetConeDifferentials(&ray, width, spread);
         } else {
             // Handle surface interaction for path generation
             if (!foundIntersection) {
@@ -181,10 +238,14 @@ int RandomWalk(const Scene &scene, RayDifferential ray, Sampler &sampler,
             // Compute scattering functions for _mode_ and skip over medium
             // boundaries
             isect.ComputeScatteringFunctions(ray, arena, true, mode);
+            width += spread * ray.tMax * ray.d.Length();
             if (!isect.bsdf) {
                 ray = isect.SpawnRay(ray.d);
+                SetConeDifferentials(&ray, width, spread);
                 continue;
             }
+            if (singleLobe)
+                isect.bsdf->SelectSingleLobe(isect.wo, sampler.Get1D());
 
             // Initialize _vertex_ with surface intersection information
             vertex = Vertex::CreateSurface(isect, beta, pdfFwd, prev);
@@ -204,10 +265,14 @@ int RandomWalk(const Scene &scene, RayDifferential ray, Sampler &sampler,
             if (type & BSDF_SPECULAR) {
                 vertex.delta = true;
                 pdfRev = pdfFwd = 0;
+            } else {
+                // Widen the ray cone to the region that the BSDF sample covers
+                spread = std::max(spread, SampledConeSpread(pdfFwd, nPaths));
             }
             beta *= CorrectShadingNormal(isect, wo, wi, mode);
             VLOG(2) << "Random walk beta after shading normal correction " << beta;
             ray = isect.SpawnRay(wi);
+            SetConeDifferentials(&ray, width, spread);
         }
 
         // Compute reverse area density at preceding vertex
@@ -230,7 +295,6 @@ Spectrum G(const Scene &scene, Sampler &sampler, const Vertex &v0,
 Float MISWeight(const Scene &scene, Vertex *lightVertices,
                 Vertex *cameraVertices, Vertex &sampled, int s, int t,
                 const Distribution1D &lightPdf,
-                const std::unordered_map<const Light *, size_t> &lightToIndex,
                 const Point2i &pxCoords,
                 const SAMISRectifier *rectifier,
                 BDPTIntegrator::MisStrategy mode) {
@@ -263,8 +327,7 @@ Float MISWeight(const Scene &scene, Vertex *lightVertices,
     ScopedAssignment<Float> a4;
     if (pt)
         a4 = {&pt->pdfRev, s > 0 ? qs->Pdf(scene, qsMinus, *pt)
-                                 : pt->PdfLightOrigin(scene, *ptMinus, lightPdf,
-                                                      lightToIndex)};
+                                 : pt->PdfLightOrigin(scene, *ptMinus, lightPdf)};
 
     // Update reverse density of vertex $\pt{}_{t-2}$
     ScopedAssignment<Float> a5;
@@ -343,14 +406,6 @@ void BDPTIntegrator::Render(const Scene &scene) {
     std::unique_ptr<LightDistribution> lightDistribution =
         CreateLightSampleDistribution(lightSampleStrategy, scene);
 
-    // Compute a reverse mapping from light pointers to offsets into the
-    // scene lights vector (and, equivalently, offsets into
-    // lightDistr). Added after book text was finalized; this is critical
-    // to reasonable performance with 100s+ of light sources.
-    std::unordered_map<const Light *, size_t> lightToIndex;
-    for (size_t i = 0; i < scene.lights.size(); ++i)
-        lightToIndex[scene.lights[i].get()] = i;
-
     // Partition the image into tiles
     Film *film = camera->film;
     const Bounds2i sampleBounds = film->GetSampleBounds();
@@ -432,7 +487,7 @@ void BDPTIntegrator::Render(const Scene &scene) {
                         Vertex *lightVertices = arena.Alloc<Vertex>(maxDepth + 1);
                         int nCamera = GenerateCameraSubpath(
                             scene, *tileSampler, arena, maxDepth + 2, *camera,
-                            pFilm, cameraVertices);
+                            pFilm, cameraVertices, singleLobe);
                         // Get a distribution for sampling the light at the
                         // start of the light subpath. Because the light path
                         // follows multiple bounces, basing the sampling
@@ -445,8 +500,8 @@ void BDPTIntegrator::Render(const Scene &scene) {
                         // Now trace the light subpath
                         int nLight = GenerateLightSubpath(
                             scene, *tileSampler, arena, maxDepth + 1,
-                            cameraVertices[0].time(), *lightDistr, lightToIndex,
-                            lightVertices);
+                            cameraVertices[0].time(), *lightDistr, *camera,
+                            lightVertices, singleLobe);
 
                         // Execute all BDPT connection strategies
                         Spectrum L(0.f);
@@ -463,7 +518,7 @@ void BDPTIntegrator::Render(const Scene &scene) {
                                 Float misWeight = 0.f;
                                 Spectrum Lpath = ConnectBDPT(
                                     scene, lightVertices, cameraVertices, s, t,
-                                    *lightDistr, lightToIndex, *camera, *tileSampler,
+                                    *lightDistr, *camera, *tileSampler,
                                     &pFilmNew, &misWeight, rectify ? rectifier.get() : nullptr,
                                     misStrategy);
 
@@ -516,7 +571,7 @@ void BDPTIntegrator::Render(const Scene &scene) {
     int64_t prepareMS = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t2).count();
 
     // Rendering with rectified weights
-    renderIterFn(sampler->samplesPerPixel - prepassSamples, 1, "Iterations 2 to " + std::to_string(sampler->samplesPerPixel),
+    renderIterFn(sampler->samplesPerPixel - prepassSamples, prepassSamples, "Iterations 2 to " + std::to_string(sampler->samplesPerPixel),
                  false, enableRectification || useReferenceVariances);
 
     t2 = std::chrono::system_clock::now();
@@ -569,9 +624,7 @@ void BDPTIntegrator::Render(const Scene &scene) {
 
 Spectrum ConnectBDPT(
     const Scene &scene, Vertex *lightVertices, Vertex *cameraVertices, int s,
-    int t, const Distribution1D &lightDistr,
-    const std::unordered_map<const Light *, size_t> &lightToIndex,
-    const Camera &camera, Sampler &sampler, Point2f *pRaster,
+    int t, const Distribution1D &lightDistr, const Camera &camera, Sampler &sampler, Point2f *pRaster,
     Float *misWeightPtr, const SAMISRectifier *rectifier, BDPTIntegrator::MisStrategy misStrategy) {
     ProfilePhase _(Prof::BDPTConnectSubpaths);
     Spectrum L(0.f);
@@ -624,7 +677,7 @@ Spectrum ConnectBDPT(
                 sampled =
                     Vertex::CreateLight(ei, lightWeight / (pdf * lightPdf), 0);
                 sampled.pdfFwd =
-                    sampled.PdfLightOrigin(scene, pt, lightDistr, lightToIndex);
+                    sampled.PdfLightOrigin(scene, pt, lightDistr);
                 L = pt.beta * pt.f(sampled, TransportMode::Radiance) * sampled.beta;
                 if (pt.IsOnSurface()) L *= AbsDot(wi, pt.ns());
                 // Only check visibility if the path would carry radiance.
@@ -651,7 +704,7 @@ Spectrum ConnectBDPT(
     // Compute MIS weight for connection strategy
     Float misWeight =
         L.IsBlack() ? 0.f : MISWeight(scene, lightVertices, cameraVertices,
-                                      sampled, s, t, lightDistr, lightToIndex,
+                                      sampled, s, t, lightDistr,
                                       Point2i(pRaster->x, pRaster->y), rectifier,
                                       misStrategy);
     VLOG(2) << "MIS weight for (s,t) = (" << s << ", " << t << ") connection: "
@@ -719,12 +772,14 @@ BDPTIntegrator *CreateBDPTIntegrator(const ParamSet &params,
     int prepassSamples = params.FindOneInt("presamples", 1);
     bool estimateVariances = params.FindOneBool("estimatevariances", false);
     bool useReferenceVariances = params.FindOneBool("userefvars", false);
+    bool singleLobe = params.FindOneBool("singlelobe", false);
 
     return new BDPTIntegrator(sampler, camera, maxDepth, false,
                               false, pixelBounds, lightStrategy,
                               misStrategy, misMod, rectiMinDepth, rectiMaxDepth,
                               downsamplingFactor, visualizeFactors, clampThreshold,
-                              prepassSamples, estimateVariances, useReferenceVariances);
+                              prepassSamples, estimateVariances, useReferenceVariances,
+                              singleLobe);
 }
 
 }  // namespace pbrt
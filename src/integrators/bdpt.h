@@ -39,7 +39,6 @@
 #define PBRT_INTEGRATORS_BDPT_H
 
 // integrators/bdpt.h*
-#include <unordered_map>
 #include "camera.h"
 #include "integrator.h"
 #include "interaction.h"
@@ -112,15 +111,14 @@ class ScopedAssignment {
     Type *target, backup;
 };
 
-inline Float InfiniteLightDensity(
-    const Scene &scene, const Distribution1D &lightDistr,
-    const std::unordered_map<const Light *, size_t> &lightToDistrIndex,
-    const Vector3f &w) {
+inline Float InfiniteLightDensity(const Scene &scene,
+                                  const Distribution1D &lightDistr,
+                                  const Vector3f &w) {
     Float pdf = 0;
     for (const auto &light : scene.infiniteLights) {
-        CHECK(lightToDistrIndex.find(light.get()) != lightToDistrIndex.end());
-        size_t index = lightToDistrIndex.find(light.get())->second;
-        pdf += light->Pdf_Li(Interaction(), -w) * lightDistr.func[index];
+        CHECK_GE(light->Index(), 0);
+        pdf += light->Pdf_Li(Interaction(), -w) *
+               lightDistr.func[light->Index()];
     }
     return pdf / (lightDistr.funcInt * lightDistr.Count());
 }
@@ -158,7 +156,8 @@ class BDPTIntegrator : public Integrator {
                    Float clampThreshold = 16,
                    int prepassSamples = 1,
                    bool estimateVariances = false,
-                   bool useReferenceVariances = false)
+                   bool useReferenceVariances = false,
+                   bool singleLobe = false)
         : sampler(sampler),
           camera(camera),
           maxDepth(maxDepth),
@@ -175,7 +174,8 @@ class BDPTIntegrator : public Integrator {
           clampThreshold(clampThreshold),
           prepassSamples(prepassSamples),
           estimateVariances(estimateVariances),
-          useReferenceVariances(useReferenceVariances)
+          useReferenceVariances(useReferenceVariances),
+          singleLobe(singleLobe)
         {}
 
     void Render(const Scene &scene);
@@ -199,6 +199,8 @@ class BDPTIntegrator : public Integrator {
     const int prepassSamples;
     const bool estimateVariances;
     const bool useReferenceVariances;
+    // Evaluate a single stochastically chosen BSDF lobe per vertex
+    const bool singleLobe;
 };
 
 struct Vertex {
@@ -440,16 +442,13 @@ struct Vertex {
         return pdf;
     }
     Float PdfLightOrigin(const Scene &scene, const Vertex &v,
-                         const Distribution1D &lightDistr,
-                         const std::unordered_map<const Light *, size_t>
-                             &lightToDistrIndex) const {
+                         const Distribution1D &lightDistr) const {
         Vector3f w = v.p() - p();
         if (w.LengthSquared() == 0) return 0.;
         w = Normalize(w);
         if (IsInfiniteLight()) {
             // Return solid angle density for infinite light sources
-            return InfiniteLightDensity(scene, lightDistr, lightToDistrIndex,
-                                        w);
+            return InfiniteLightDensity(scene, lightDistr, w);
         } else {
             // Return solid angle density for non-infinite light sources
             Float pdfPos, pdfDir, pdfChoice = 0;
@@ -462,9 +461,8 @@ struct Vertex {
             CHECK(light != nullptr);
 
             // Compute the discrete probability of sampling _light_, _pdfChoice_
-            CHECK(lightToDistrIndex.find(light) != lightToDistrIndex.end());
-            size_t index = lightToDistrIndex.find(light)->second;
-            pdfChoice = lightDistr.DiscretePDF(index);
+            CHECK_GE(light->Index(), 0);
+            pdfChoice = lightDistr.DiscretePDF(light->Index());
 
             light->Pdf_Le(Ray(p(), w, Infinity, time()), ng(), &pdfPos, &pdfDir);
             return pdfPos * pdfChoice;
@@ -475,18 +473,15 @@ struct Vertex {
 extern int GenerateCameraSubpath(const Scene &scene, Sampler &sampler,
                                  MemoryArena &arena, int maxDepth,
                                  const Camera &camera, const Point2f &pFilm,
-                                 Vertex *path);
+                                 Vertex *path, bool singleLobe = false);
 
 extern int GenerateLightSubpath(
     const Scene &scene, Sampler &sampler, MemoryArena &arena, int maxDepth,
-    Float time, const Distribution1D &lightDistr,
-    const std::unordered_map<const Light *, size_t> &lightToIndex,
-    Vertex *path);
+    Float time, const Distribution1D &lightDistr, const Camera &camera,
+    Vertex *path, bool singleLobe = false);
 Spectrum ConnectBDPT(
     const Scene &scene, Vertex *lightVertices, Vertex *cameraVertices, int s,
-    int t, const Distribution1D &lightDistr,
-    const std::unordered_map<const Light *, size_t> &lightToIndex,
-    const Camera &camera, Sampler &sampler, Point2f *pRaster,
+    int t, const Distribution1D &lightDistr, const Camera &camera, Sampler &sampler, Point2f *pRaster,
     Float *misWeight = nullptr, const SAMISRectifier *rectifier = nullptr,
     BDPTIntegrator::MisStrategy misStrategy = BDPTIntegrator::MIS_BALANCE);
 BDPTIntegrator *CreateBDPTIntegrator(const ParamSet &params,
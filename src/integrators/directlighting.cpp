@@ -41,6 +41,8 @@
 
 namespace pbrt {
 
+STAT_INT_DISTRIBUTION("Integrator/Lightcut size", cutSize);
+
 // DirectLightingIntegrator Method Definitions
 void DirectLightingIntegrator::Preprocess(const Scene &scene,
                                           Sampler &sampler) {
@@ -56,7 +58,45 @@ void DirectLightingIntegrator::Preprocess(const Scene &scene,
                 sampler.Request2DArray(nLightSamples[j]);
             }
         }
+    } else if (strategy == LightStrategy::Lightcuts)
+        // Cluster the lights with finite extent for choosing cuts
+        lightTree.reset(new BVHLightDistribution(scene));
+}
+
+Spectrum DirectLightingIntegrator::SampleLightcut(const Interaction &it,
+                                                  const Scene &scene,
+                                                  MemoryArena &arena,
+                                                  Sampler &sampler) const {
+    ProfilePhase p(Prof::DirectLighting);
+    // Sample each light that isn't in the light tree
+    Spectrum Ld(0.f);
+    for (int lightIndex : lightTree->UnboundedLights()) {
+        Point2f uLight = sampler.Get2D();
+        Point2f uScattering = sampler.Get2D();
+        Ld += EstimateDirect(it, uScattering, *scene.lights[lightIndex],
+                             uLight, scene, sampler, arena);
     }
+
+    // Choose a cut through the light tree and sample one light per cluster
+    int *cut = arena.Alloc<int>(maxCutSize);
+    int nClusters =
+        lightTree->ComputeCut(it.p, it.n, maxCutError, maxCutSize, cut);
+    ReportValue(cutSize, nClusters);
+    for (int i = 0; i < nClusters; ++i) {
+        // Choosing the cluster's representative light randomly, rather
+        // than using a fixed one as in the original lightcuts, keeps the
+        // estimate unbiased; the error bound then limits its variance.
+        Float clusterPdf;
+        int lightIndex = lightTree->SampleCluster(cut[i], it.p, it.n,
+                                                  sampler.Get1D(), &clusterPdf);
+        Point2f uLight = sampler.Get2D();
+        Point2f uScattering = sampler.Get2D();
+        if (clusterPdf == 0) continue;
+        Ld += EstimateDirect(it, uScattering, *scene.lights[lightIndex],
+                             uLight, scene, sampler, arena) /
+              clusterPdf;
+    }
+    return Ld;
 }
 
 Spectrum DirectLightingIntegrator::Li(const RayDifferential &ray,
@@ -83,6 +123,8 @@ Spectrum DirectLightingIntegrator::Li(const RayDifferential &ray,
         if (strategy == LightStrategy::UniformSampleAll)
             L += UniformSampleAllLights(isect, scene, arena, sampler,
                                         nLightSamples);
+        else if (strategy == LightStrategy::Lightcuts)
+            L += SampleLightcut(isect, scene, arena, sampler);
         else
             L += UniformSampleOneLight(isect, scene, arena, sampler);
     }
@@ -104,6 +146,8 @@ DirectLightingIntegrator *CreateDirectLightingIntegrator(
         strategy = LightStrategy::UniformSampleOne;
     else if (st == "all")
         strategy = LightStrategy::UniformSampleAll;
+    else if (st == "lightcuts")
+        strategy = LightStrategy::Lightcuts;
     else {
         Warning(
             "Strategy \"%s\" for direct lighting unknown. "
@@ -125,8 +169,14 @@ DirectLightingIntegrator *CreateDirectLightingIntegrator(
                 Error("Degenerate \"pixelbounds\" specified.");
         }
     }
+    Float maxCutError = params.FindOneFloat("lightcutserror", .02f);
+    int maxCutSize = params.FindOneInt("maxcutsize", 64);
+    if (maxCutSize < 1) {
+        Warning("\"maxcutsize\" must be at least one. Using 1.");
+        maxCutSize = 1;
+    }
     return new DirectLightingIntegrator(strategy, maxDepth, camera, sampler,
-                                        pixelBounds);
+                                        pixelBounds, maxCutError, maxCutSize);
 }
 
 }  // namespace pbrt
@@ -42,11 +42,12 @@
 #include "pbrt.h"
 #include "integrator.h"
 #include "scene.h"
+#include "lightdistrib.h"
 
 namespace pbrt {
 
 // LightStrategy Declarations
-enum class LightStrategy { UniformSampleAll, UniformSampleOne };
+enum class LightStrategy { UniformSampleAll, UniformSampleOne, Lightcuts };
 
 // DirectLightingIntegrator Declarations
 class DirectLightingIntegrator : public SamplerIntegrator {
@@ -55,19 +56,29 @@ class DirectLightingIntegrator : public SamplerIntegrator {
     DirectLightingIntegrator(LightStrategy strategy, int maxDepth,
                              std::shared_ptr<const Camera> camera,
                              std::shared_ptr<Sampler> sampler,
-                             const Bounds2i &pixelBounds)
+                             const Bounds2i &pixelBounds,
+                             Float maxCutError = .02f, int maxCutSize = 64)
         : SamplerIntegrator(camera, sampler, pixelBounds),
           strategy(strategy),
-          maxDepth(maxDepth) {}
+          maxDepth(maxDepth),
+          maxCutError(maxCutError),
+          maxCutSize(maxCutSize) {}
     Spectrum Li(const RayDifferential &ray, const Scene &scene,
                 Sampler &sampler, MemoryArena &arena, int depth) const;
     void Preprocess(const Scene &scene, Sampler &sampler);
 
   private:
+    // DirectLightingIntegrator Private Methods
+    Spectrum SampleLightcut(const Interaction &it, const Scene &scene,
+                            MemoryArena &arena, Sampler &sampler) const;
+
     // DirectLightingIntegrator Private Data
     const LightStrategy strategy;
     const int maxDepth;
     std::vector<int> nLightSamples;
+    const Float maxCutError;
+    const int maxCutSize;
+    std::unique_ptr<BVHLightDistribution> lightTree;
 };
 
 DirectLightingIntegrator *CreateDirectLightingIntegrator(
@@ -8,6 +8,7 @@
 #include "sampler.h"
 #include "camera.h"
 #include "imageio.h"
+#include "rng.h"
 
 namespace pbrt {
 
@@ -41,13 +42,10 @@ void GuidedDirectIllum::Render(const Scene &scene) {
 }
 
 void GuidedDirectIllum::SetUp(const Scene &scene) {
-    guidedLightDistrib.reset(new SpatialLightDistribution(scene));
-
-    for (size_t i = 0; i < scene.lights.size(); ++i)
-        lightToIdx[scene.lights[i].get()] = i;
+    guidedLightDistrib = CreateLightSampleDistribution(lightSampleStrategy, scene);
 
     if (ourMode != OUR_DISABLED)
-        rectifier.reset(new SAMISRectifier(camera->film, 3, 3, downsamplingFactor, false, // TODO this is ugly, only works because the number of techniques here is also 3, as in bdpt
+        rectifier.reset(new SAMISRectifier(camera->film, nTechniques, nTechniques, downsamplingFactor, false, // TODO this is ugly, only works because the number of techniques equals the "path length", as in bdpt
             [&](int d, int t, Float var, Float mean) {
                 if (var != 0 && mean != 0)
                     return ourMode == OUR_VARIANCE ? (1 / var) : (1 + mean * mean / var);
@@ -107,9 +105,21 @@ void GuidedDirectIllum::RenderIteration(const Scene &scene, const int iter) {
         std::unique_ptr<FilmTile> filmTile =
             camera->film->GetFilmTile(tileBounds);
 
+        // With spatial reuse of RIS reservoirs, the RIS samples are shaded
+        // once all pixels of the tile have been traced, so the other
+        // estimates are kept until then.
+        bool reuse = risCandidates > 0 && risNeighbors > 0;
+        std::vector<ReservoirRecord> records;
+        std::vector<Point2f> pFilms;
+        std::vector<Float> rayWeights;
+        std::vector<Spectrum> Ls;
+
         // Loop over pixels in tile to render them
         for (Point2i pixel : tileBounds) {
+            // Each iteration takes the next sample of every pixel, so
+            // that samplers that ignore the seed don't repeat sample zero
             tileSampler->StartPixel(pixel);
+            tileSampler->SetSampleNumber(iter);
 
             Bounds2i pixelBounds = camera->film->GetSampleBounds();
             if (!InsideExclusive(pixel, pixelBounds))
@@ -124,11 +134,30 @@ void GuidedDirectIllum::RenderIteration(const Scene &scene, const int iter) {
                 1 / std::sqrt((Float)tileSampler->samplesPerPixel));
 
             Spectrum L(0.f);
+            size_t nRecords = records.size();
             if (rayWeight > 0)
-                L = Li(ray, scene, *tileSampler, arena, cameraSample.pFilm, iter);
+                L = Li(ray, scene, *tileSampler, arena, cameraSample.pFilm, iter,
+                       reuse ? &records : nullptr);
 
-            filmTile->AddSample(cameraSample.pFilm, L, rayWeight);
+            if (reuse) {
+                if (records.size() > nRecords) {
+                    records.back().pPixel = pixel;
+                    records.back().pixelIndex = int(Ls.size());
+                }
+                pFilms.push_back(cameraSample.pFilm);
+                rayWeights.push_back(rayWeight);
+                Ls.push_back(L);
+            } else {
+                filmTile->AddSample(cameraSample.pFilm, L, rayWeight);
+                arena.Reset();
+            }
+        }
 
+        if (reuse) {
+            RNG rng(seed);
+            ReuseReservoirs(scene, *guidedLightDistrib, records, tileBounds, rng, Ls);
+            for (size_t i = 0; i < Ls.size(); ++i)
+                filmTile->AddSample(pFilms[i], Ls[i], rayWeights[i]);
             arena.Reset();
         }
 
@@ -178,7 +207,7 @@ void GuidedDirectIllum::WriteFinalImage() {
 
 Spectrum GuidedDirectIllum::Li(const RayDifferential &ray, const Scene &scene,
             Sampler &sampler, MemoryArena &arena, const Point2f& pixel,
-            const int iter)
+            const int iter, std::vector<ReservoirRecord> *records)
 {
     Spectrum L(0.f);
 
@@ -192,26 +221,37 @@ Spectrum GuidedDirectIllum::Li(const RayDifferential &ray, const Scene &scene,
     // Compute scattering functions for surface interaction
     isect.ComputeScatteringFunctions(ray, arena);
     if (!isect.bsdf)
-        return Li(isect.SpawnRay(ray.d), scene, sampler, arena, pixel, iter);
+        return Li(isect.SpawnRay(ray.d), scene, sampler, arena, pixel, iter, records);
     Vector3f wo = isect.wo;
 
     // Compute emitted light if ray hit an area light source
     L += isect.Le(wo);
 
     if (scene.lights.size() > 0) {
-        const Distribution1D *lightDistr = guidedLightDistrib->Lookup(isect.p);
+        const LightDistribution &lightDistr = *guidedLightDistrib;
         if (enableUniform)
             L += SampleLightSurface(pixel, scene, lightDistr, isect, sampler, SAMPLE_UNIFORM);
         if (enableGuided)
             L += SampleLightSurface(pixel, scene, lightDistr, isect, sampler, SAMPLE_GUIDED);
         if (enableBsdfSamples)
             L += SampleBsdf(pixel, scene, lightDistr, isect, sampler);
+        if (risCandidates > 0) {
+            Reservoir reservoir = GenerateReservoir(scene, lightDistr, isect, sampler);
+            if (records) {
+                // Keep the shading point until the tile's reservoirs have
+                // been reused
+                SurfaceInteraction *stored = arena.Alloc<SurfaceInteraction>();
+                *stored = isect;
+                records->push_back({pixel, Point2i(), -1, stored, reservoir});
+            } else
+                L += SampleRIS(pixel, scene, lightDistr, isect, reservoir, reservoir.W());
+        }
     }
 
     return L;
 }
 
-Spectrum GuidedDirectIllum::SampleLightSurface(const Point2f& pixel, const Scene &scene, const Distribution1D *lightDistrib,
+Spectrum GuidedDirectIllum::SampleLightSurface(const Point2f& pixel, const Scene &scene, const LightDistribution &lightDistrib,
     const Interaction &it, Sampler &sampler, SamplingTech tech)
 {
     Spectrum L(0.0f);
@@ -221,7 +261,7 @@ Spectrum GuidedDirectIllum::SampleLightSurface(const Point2f& pixel, const Scene
     int lightIdx;
     Float lightSelectPdf;
     if (tech == SAMPLE_GUIDED)
-        lightIdx = lightDistrib->SampleDiscrete(sampler.Get1D(), &lightSelectPdf);
+        lightIdx = lightDistrib.SampleDiscrete(it.p, it.n, sampler.Get1D(), &lightSelectPdf);
     else {
         lightIdx = std::min((int)(sampler.Get1D() * nLights), nLights - 1);
         lightSelectPdf = Float(1) / nLights;
@@ -265,7 +305,7 @@ Spectrum GuidedDirectIllum::SampleLightSurface(const Point2f& pixel, const Scene
                 if (IsDeltaLight(light.flags))
                     L = f * Li / (lightPdf * lightSelectPdf);
                 else {
-                    Float weight = MisWeight(scene, pixel, &light, lightDistrib, tech, scatteringPdf, lightPdf);
+                    Float weight = MisWeight(scene, pixel, &light, lightDistrib, it, tech, scatteringPdf, lightPdf);
                     Spectrum estimate = f * Li / (lightPdf * lightSelectPdf);
                     L = weight * estimate;
                     LogContrib(pixel, estimate, weight, tech);
@@ -276,7 +316,7 @@ Spectrum GuidedDirectIllum::SampleLightSurface(const Point2f& pixel, const Scene
     return L;
 }
 
-Spectrum GuidedDirectIllum::SampleBsdf(const Point2f& pixel, const Scene &scene, const Distribution1D *lightDistr, const Interaction &it, Sampler &sampler) {
+Spectrum GuidedDirectIllum::SampleBsdf(const Point2f& pixel, const Scene &scene, const LightDistribution &lightDistr, const Interaction &it, Sampler &sampler) {
     Point2f uScattering = sampler.Get2D();
 
     Spectrum f;
@@ -305,13 +345,13 @@ Spectrum GuidedDirectIllum::SampleBsdf(const Point2f& pixel, const Scene &scene,
         SurfaceInteraction lightIsect;
         Ray ray = it.SpawnRay(wi);
         if (!scene.Intersect(ray, &lightIsect)) return Spectrum(0.f);
-        const Light* light = lightIsect.primitive->GetAreaLight();
+        const AreaLight *light = lightIsect.primitive->GetAreaLight();
         if (light == nullptr) return Spectrum(0.f);
 
         // Compute the contribution and MIS weights
         Spectrum Li = lightIsect.Le(-wi);
-        lightPdf = light->Pdf_Li(it, wi);
-        Float weight = MisWeight(scene, pixel, light, lightDistr,
+        lightPdf = light->Pdf_LiAt(it, wi, lightIsect);
+        Float weight = MisWeight(scene, pixel, light, lightDistr, it,
                                  SAMPLE_BSDF, scatteringPdf, lightPdf);
         Spectrum estimate = f * Li / scatteringPdf;
         LogContrib(pixel, estimate, weight, SAMPLE_BSDF);
@@ -321,24 +361,159 @@ Spectrum GuidedDirectIllum::SampleBsdf(const Point2f& pixel, const Scene &scene,
     return Spectrum(0.f);
 }
 
-Float GuidedDirectIllum::MisWeight(const Scene &scene, const Point2f& pixel, const Light* light, const Distribution1D *lightDistr,
-    SamplingTech tech, Float pdfBsdf, Float pdfLight) {
+Spectrum GuidedDirectIllum::UnshadowedContribution(const Light &light, const Interaction &it,
+    const Point2f &uLight, Float *scatteringPdf, Float *lightPdf, VisibilityTester *vis) const
+{
+    Vector3f wi;
+    *lightPdf = 0;
+    *scatteringPdf = 0;
+    Spectrum Li = light.Sample_Li(it, uLight, &wi, lightPdf, vis);
+    if (*lightPdf == 0 || Li.IsBlack()) return Spectrum(0.f);
+
+    Spectrum f;
+    if (it.IsSurfaceInteraction()) {
+        const SurfaceInteraction &isect = (const SurfaceInteraction &)it;
+        f = isect.bsdf->f(isect.wo, wi, BSDF_ALL) *
+            AbsDot(wi, isect.shading.n);
+        *scatteringPdf = isect.bsdf->Pdf(isect.wo, wi, BSDF_ALL);
+    } else {
+        const MediumInteraction &mi = (const MediumInteraction &)it;
+        Float p = mi.phase->p(mi.wo, wi);
+        f = Spectrum(p);
+        *scatteringPdf = p;
+    }
+    if (f.IsBlack()) return Spectrum(0.f);
+    return f * Li / *lightPdf;
+}
+
+GuidedDirectIllum::Reservoir GuidedDirectIllum::GenerateReservoir(const Scene &scene,
+    const LightDistribution &lightDistrib, const Interaction &it, Sampler &sampler) const
+{
+    // Stream candidates from the guided distribution through the
+    // reservoir, weighting them by their unshadowed contribution over the
+    // probability of having chosen them
+    Reservoir reservoir;
+    for (int i = 0; i < risCandidates; ++i) {
+        Float lightSelectPdf;
+        int lightIdx = lightDistrib.SampleDiscrete(it.p, it.n, sampler.Get1D(), &lightSelectPdf);
+        Point2f uLight = sampler.Get2D();
+        Float pHat = 0;
+        if (lightSelectPdf > 0) {
+            Float scatteringPdf, lightPdf;
+            VisibilityTester visibility;
+            pHat = std::max(Float(0), UnshadowedContribution(*scene.lights[lightIdx], it, uLight,
+                                                             &scatteringPdf, &lightPdf, &visibility).y());
+        }
+        reservoir.Update(lightIdx, uLight, pHat, lightSelectPdf > 0 ? pHat / lightSelectPdf : 0,
+                         sampler.Get1D());
+    }
+    reservoir.M = risCandidates;
+    return reservoir;
+}
+
+void GuidedDirectIllum::ReuseReservoirs(const Scene &scene, const LightDistribution &lightDistrib,
+    const std::vector<ReservoirRecord> &records, const Bounds2i &tileBounds, RNG &rng,
+    std::vector<Spectrum> &L)
+{
+    // Find the record of each pixel in the tile
+    Vector2i extent = tileBounds.Diagonal();
+    auto offset = [&](const Point2i &p) {
+        return (p.y - tileBounds.pMin.y) * extent.x + (p.x - tileBounds.pMin.x);
+    };
+    std::vector<int> recordIndex(extent.x * extent.y, -1);
+    for (size_t i = 0; i < records.size(); ++i)
+        recordIndex[offset(records[i].pPixel)] = int(i);
+
+    auto targetFunction = [&](const Reservoir &r, const Interaction &it) {
+        if (r.lightIndex < 0) return Float(0);
+        Float scatteringPdf, lightPdf;
+        VisibilityTester visibility;
+        return std::max(Float(0), UnshadowedContribution(*scene.lights[r.lightIndex], it, r.uLight,
+                                                         &scatteringPdf, &lightPdf, &visibility).y());
+    };
+
+    std::vector<const ReservoirRecord *> neighbors;
+    for (const ReservoirRecord &record : records) {
+        // Resample the pixel's own reservoir and those of distinct random
+        // neighbors, with their samples' target function values at this
+        // shading point
+        const Reservoir &own = record.reservoir;
+        Reservoir combined;
+        combined.Update(own.lightIndex, own.uLight, own.pHat,
+                        own.pHat * own.W() * own.M, rng.UniformFloat());
+        neighbors.clear();
+        for (int i = 0; i < risNeighbors; ++i) {
+            Point2i p(record.pPixel.x + int(rng.UniformUInt32(2 * risRadius + 1)) - risRadius,
+                      record.pPixel.y + int(rng.UniformUInt32(2 * risRadius + 1)) - risRadius);
+            if (!InsideExclusive(p, tileBounds) || recordIndex[offset(p)] < 0) continue;
+            const ReservoirRecord *neighbor = &records[recordIndex[offset(p)]];
+            if (neighbor == &record ||
+                std::find(neighbors.begin(), neighbors.end(), neighbor) != neighbors.end())
+                continue;
+            neighbors.push_back(neighbor);
+
+            const Reservoir &r = neighbor->reservoir;
+            Float pHat = targetFunction(r, *record.isect);
+            combined.Update(r.lightIndex, r.uLight, pHat, pHat * r.W() * r.M,
+                            rng.UniformFloat());
+        }
+        if (combined.lightIndex < 0) continue;
+
+        // Normalize by the number of candidates of the reservoirs that
+        // could have produced the chosen sample, which keeps the estimate
+        // unbiased when neighbors' target functions differ from this one's
+        combined.M = own.M;
+        for (const ReservoirRecord *neighbor : neighbors)
+            if (targetFunction(combined, *neighbor->isect) > 0)
+                combined.M += neighbor->reservoir.M;
+
+        L[record.pixelIndex] += SampleRIS(record.pFilm, scene, lightDistrib, *record.isect,
+                                          combined, combined.W());
+    }
+}
+
+Spectrum GuidedDirectIllum::SampleRIS(const Point2f& pixel, const Scene &scene,
+    const LightDistribution &lightDistrib, const Interaction &it, const Reservoir &reservoir, Float W)
+{
+    if (reservoir.lightIndex < 0 || W == 0) return Spectrum(0.f);
+    const Light &light = *scene.lights[reservoir.lightIndex];
+
+    // Trace the single shadow ray for the chosen sample
+    Float scatteringPdf, lightPdf;
+    VisibilityTester visibility;
+    Spectrum contrib = UnshadowedContribution(light, it, reservoir.uLight, &scatteringPdf,
+                                              &lightPdf, &visibility);
+    if (contrib.IsBlack() || !visibility.Unoccluded(scene)) return Spectrum(0.f);
+
+    Spectrum estimate = contrib * W;
+    if (IsDeltaLight(light.flags)) return estimate;
+    Float weight = MisWeight(scene, pixel, &light, lightDistrib, it, SAMPLE_RIS, scatteringPdf, lightPdf);
+    LogContrib(pixel, estimate, weight, SAMPLE_RIS);
+    return weight * estimate;
+}
+
+Float GuidedDirectIllum::MisWeight(const Scene &scene, const Point2f& pixel, const Light* light, const LightDistribution &lightDistr,
+    const Interaction &it, SamplingTech tech, Float pdfBsdf, Float pdfLight) {
     if (light == nullptr) return 0.; // needed for optimal mis
 
     // compute light selection probabilities
     Float uniformSelPdf = 1 / Float(scene.lights.size());
-    Float guidedSelPdf = lightDistr->DiscretePDF(lightToIdx[light]);
+    Float guidedSelPdf = lightDistr.DiscretePDF(it.p, it.n, light->Index());
 
-    // compute effective sampling densities
+    // compute effective sampling densities; RIS samples have no tractable
+    // density, so the density of its candidates stands in for it, which
+    // keeps the weights deterministic and the combination unbiased
     Float effDensUni = pdfLight * uniformSelPdf;
     Float effDensGuided = pdfLight * guidedSelPdf;
     Float effDensBsdf = pdfBsdf;
+    Float effDensRis = pdfLight * guidedSelPdf;
 
     // if power: square
     if (misMode == MIS_POWER) {
         effDensUni *= effDensUni;
         effDensGuided *= effDensGuided;
         effDensBsdf *= effDensBsdf;
+        effDensRis *= effDensRis;
     }
 
     // if uniform: set all to one
@@ -346,21 +521,24 @@ Float GuidedDirectIllum::MisWeight(const Scene &scene, const Point2f& pixel, con
         effDensUni = 1;
         effDensGuided = 1;
         effDensBsdf = 1;
+        effDensRis = 1;
     }
 
     if (!enableUniform) effDensUni = 0;
     if (!enableGuided) effDensGuided = 0;
     if (!enableBsdfSamples) effDensBsdf = 0;
+    if (risCandidates == 0) effDensRis = 0;
 
     // if our: multiply by relative moments
     if (ourMode != OUR_DISABLED && currentIteration > 0) {
         Point2i pixelInt(pixel.x, pixel.y);
-        effDensUni    *= rectifier->Get(pixelInt, 3, SAMPLE_UNIFORM + 1);
-        effDensGuided *= rectifier->Get(pixelInt, 3, SAMPLE_GUIDED  + 1);
-        effDensBsdf   *= rectifier->Get(pixelInt, 3, SAMPLE_BSDF    + 1);
+        effDensUni    *= rectifier->Get(pixelInt, nTechniques, SAMPLE_UNIFORM + 1);
+        effDensGuided *= rectifier->Get(pixelInt, nTechniques, SAMPLE_GUIDED  + 1);
+        effDensBsdf   *= rectifier->Get(pixelInt, nTechniques, SAMPLE_BSDF    + 1);
+        effDensRis    *= rectifier->Get(pixelInt, nTechniques, SAMPLE_RIS     + 1);
     }
 
-    Float sum = effDensUni + effDensGuided + effDensBsdf;
+    Float sum = effDensUni + effDensGuided + effDensBsdf + effDensRis;
 
     if (tech == SAMPLE_UNIFORM) {
         return effDensUni / sum;
@@ -368,13 +546,15 @@ Float GuidedDirectIllum::MisWeight(const Scene &scene, const Point2f& pixel, con
         return effDensGuided / sum;
     } else if (tech == SAMPLE_BSDF) {
         return effDensBsdf / sum;
+    } else if (tech == SAMPLE_RIS) {
+        return effDensRis / sum;
     } else return 0.0f;
 }
 
 void GuidedDirectIllum::LogContrib(const Point2f& pixel, const Spectrum& value, Float misWeight, SamplingTech tech) {
     // log the contribution if this is the first iteration using our weights
     if (ourMode != OUR_DISABLED && currentIteration == 0)
-        rectifier->AddEstimate(pixel, 3, tech + 1, value, misWeight * value); // TODO refactor in SAMISRectifier: get rid of this + 1
+        rectifier->AddEstimate(pixel, nTechniques, tech + 1, value, misWeight * value); // TODO refactor in SAMISRectifier: get rid of this + 1
 }
 
 GuidedDirectIllum *CreateGuidedDiIntegrator(const ParamSet &params, std::shared_ptr<Sampler> sampler,
@@ -412,10 +592,16 @@ GuidedDirectIllum *CreateGuidedDiIntegrator(const ParamSet &params, std::shared_
     bool visWeights = params.FindOneBool("visualizefactors", false);
     int downsamplingFactor = params.FindOneInt("downsamplingfactor", 16);
     Float weightThreshold = params.FindOneFloat("weightthreshold", 16);
+    int risCandidates = std::max(0, params.FindOneInt("riscandidates", 0));
+    int risNeighbors = std::max(0, params.FindOneInt("risneighbors", 0));
+    int risRadius = std::max(1, params.FindOneInt("risradius", 4));
+    std::string lightStrategy =
+        params.FindOneString("lightsamplestrategy", "spatial");
 
     return new GuidedDirectIllum(sampler, camera, ourMode, misMode, enableBsdfSamples,
                                  enableGuided, enableUniform, visWeights, downsamplingFactor,
-                                 weightThreshold);
+                                 weightThreshold, risCandidates, risNeighbors, risRadius,
+                                 lightStrategy);
 }
 
 
@@ -13,7 +13,6 @@
 #include "lightdistrib.h"
 #include "util/samis.h"
 
-#include <unordered_map>
 
 namespace pbrt {
 
@@ -33,6 +32,13 @@ enum MisMode {
 // multiple light selection strategies via MIS.
 // Mimics the implementation of the Optimal MIS paper [Kondapaneni et al. 2019]
 // Supports only direct lighting, no media, and no delta light sources or specular surfaces.
+//
+// Optionally adds a resampled importance sampling (RIS) technique that draws
+// |risCandidates| light samples from the guided distribution, resamples one
+// of them by its unshadowed contribution and traces a single shadow ray for
+// it [Talbot et al. 2005]. With |risNeighbors| > 0, each pixel also
+// resamples the reservoirs of that many random pixels within |risRadius|
+// of it in the same tile [Bitterli et al. 2020].
 class GuidedDirectIllum : public Integrator {
 public:
     GuidedDirectIllum(std::shared_ptr<Sampler> sampler,
@@ -44,7 +50,11 @@ public:
                       bool enableUniform,
                       bool visWeights,
                       int downsamplingFactor,
-                      Float weightThreshold)
+                      Float weightThreshold,
+                      int risCandidates,
+                      int risNeighbors,
+                      int risRadius,
+                      const std::string &lightSampleStrategy = "spatial")
     : sampler(sampler), camera(camera)
     , ourMode(ourMode), misMode(misMode)
     , enableBsdfSamples(enableBsdfSamples)
@@ -53,6 +63,10 @@ public:
     , visWeights(visWeights)
     , downsamplingFactor(downsamplingFactor)
     , weightThreshold(weightThreshold)
+    , risCandidates(risCandidates)
+    , risNeighbors(risNeighbors)
+    , risRadius(risRadius)
+    , lightSampleStrategy(lightSampleStrategy)
     {
     }
 
@@ -64,17 +78,62 @@ public:
     virtual void ProcessIteration(const Scene &scene, const int iter);
     virtual void WriteFinalImage();
 
-    virtual Spectrum Li(const RayDifferential &ray, const Scene &scene,
-                        Sampler &sampler, MemoryArena &arena, const Point2f& pixel,
-                        const int iter);
-
 protected:
     enum SamplingTech {
         SAMPLE_UNIFORM = 0,
         SAMPLE_GUIDED = 1,
-        SAMPLE_BSDF = 2
+        SAMPLE_BSDF = 2,
+        SAMPLE_RIS = 3
+    };
+    static const int nTechniques = 4;
+
+    // A reservoir holds the light sample chosen by RIS. Light samples are
+    // points (light index, uLight) in the primary sample space of
+    // Light::Sample_Li(), so that they can be reused at other shading
+    // points without a change of variables.
+    struct Reservoir {
+        // Streams in a candidate with the given resampling weight; |u| is
+        // a uniform sample used to decide whether it replaces the current
+        // one.
+        void Update(int candidateLight, const Point2f &candidateU,
+                    Float candidatePHat, Float weight, Float u) {
+            wSum += weight;
+            if (weight > 0 && u * wSum < weight) {
+                lightIndex = candidateLight;
+                uLight = candidateU;
+                pHat = candidatePHat;
+            }
+        }
+        // Returns the unbiased contribution weight of the chosen sample.
+        Float W() const { return pHat > 0 ? wSum / (M * pHat) : 0; }
+
+        int lightIndex = -1;
+        Point2f uLight;
+        // Target function value of the chosen sample at the shading point
+        Float pHat = 0;
+        Float wSum = 0;
+        int M = 0;
     };
 
+    // A shading point whose RIS sample is shaded after spatial reuse
+    struct ReservoirRecord {
+        Point2f pFilm;
+        Point2i pPixel;
+        int pixelIndex;
+        const SurfaceInteraction *isect;
+        Reservoir reservoir;
+    };
+
+public:
+    // If |records| is non-null, RIS samples are appended to it for
+    // spatial reuse rather than being shaded immediately.
+    virtual Spectrum Li(const RayDifferential &ray, const Scene &scene,
+                        Sampler &sampler, MemoryArena &arena, const Point2f& pixel,
+                        const int iter,
+                        std::vector<ReservoirRecord> *records = nullptr);
+
+protected:
+
     OurMode ourMode;
     MisMode misMode;
     bool enableBsdfSamples;
@@ -83,13 +142,38 @@ protected:
     bool visWeights;
     int downsamplingFactor;
     Float weightThreshold;
+    int risCandidates;
+    int risNeighbors;
+    int risRadius;
 
-    virtual Spectrum SampleLightSurface(const Point2f& pixel, const Scene &scene, const Distribution1D *lightDistrib,
+    virtual Spectrum SampleLightSurface(const Point2f& pixel, const Scene &scene, const LightDistribution &lightDistrib,
         const Interaction &it, Sampler &sampler, SamplingTech tech);
 
-    virtual Spectrum SampleBsdf(const Point2f& pixel, const Scene &scene, const Distribution1D *lightDistrib, const Interaction &it, Sampler &sampler);
+    virtual Spectrum SampleBsdf(const Point2f& pixel, const Scene &scene, const LightDistribution &lightDistrib, const Interaction &it, Sampler &sampler);
+
+    virtual Float MisWeight(const Scene& scene, const Point2f& pixel, const Light* light, const LightDistribution &lightDistrib,
+        const Interaction &it, SamplingTech tech, Float pdfBsdf, Float pdfLight);
 
-    virtual Float MisWeight(const Scene& scene, const Point2f& pixel, const Light* light, const Distribution1D *lightDistrib, SamplingTech tech, Float pdfBsdf, Float pdfLight);
+    // Returns f * Li / lightPdf for the light sample |uLight| on |light|,
+    // without testing visibility; the RIS target function is its
+    // luminance.
+    Spectrum UnshadowedContribution(const Light &light, const Interaction &it,
+                                    const Point2f &uLight, Float *scatteringPdf,
+                                    Float *lightPdf, VisibilityTester *vis) const;
+
+    Reservoir GenerateReservoir(const Scene &scene, const LightDistribution &lightDistrib,
+                                const Interaction &it, Sampler &sampler) const;
+
+    // Combines each record's reservoir with those of random neighboring
+    // records and adds the resulting estimates to |L|.
+    void ReuseReservoirs(const Scene &scene, const LightDistribution &lightDistrib,
+                         const std::vector<ReservoirRecord> &records,
+                         const Bounds2i &tileBounds, RNG &rng, std::vector<Spectrum> &L);
+
+    // Shades the chosen sample of a reservoir with unbiased contribution
+    // weight |W|, tracing one shadow ray.
+    virtual Spectrum SampleRIS(const Point2f& pixel, const Scene &scene, const LightDistribution &lightDistrib,
+        const Interaction &it, const Reservoir &reservoir, Float W);
 
     // Callback function invoked whenever an MC estimate is computed from any technique
     virtual void LogContrib(const Point2f& pixel, const Spectrum& value, Float misWeight, SamplingTech tech);
@@ -98,10 +182,9 @@ private:
     std::shared_ptr<Sampler> sampler;
     std::shared_ptr<const Camera> camera;
 
+    const std::string lightSampleStrategy;
     std::unique_ptr<LightDistribution> guidedLightDistrib;
 
-    std::unordered_map<const Light *, size_t> lightToIdx;
-
     std::unique_ptr<SAMISRectifier> rectifier;
 
     int numIterations;
@@ -45,7 +45,6 @@
 #include "spectrum.h"
 #include "film.h"
 #include "rng.h"
-#include <unordered_map>
 
 namespace pbrt {
 
@@ -120,7 +119,6 @@ class MLTIntegrator : public Integrator {
     void Render(const Scene &scene);
     Spectrum L(const Scene &scene, MemoryArena &arena,
                const std::unique_ptr<Distribution1D> &lightDistr,
-               const std::unordered_map<const Light *, size_t> &lightToIndex,
                MLTSampler &sampler, int k, Point2f *pRaster);
 
   private:
@@ -52,7 +52,9 @@ class PathIntegrator : public SamplerIntegrator {
     PathIntegrator(int maxDepth, std::shared_ptr<const Camera> camera,
                    std::shared_ptr<Sampler> sampler,
                    const Bounds2i &pixelBounds, Float rrThreshold = 1,
-                   const std::string &lightSampleStrategy = "spatial");
+                   const std::string &lightSampleStrategy = "spatial",
+                   bool singleLobe = false,
+                   bool prebuildLightDistrib = false);
 
     void Preprocess(const Scene &scene, Sampler &sampler);
     Spectrum Li(const RayDifferential &ray, const Scene &scene,
@@ -63,6 +65,8 @@ class PathIntegrator : public SamplerIntegrator {
     const int maxDepth;
     const Float rrThreshold;
     const std::string lightSampleStrategy;
+    const bool singleLobe;
+    const bool prebuildLightDistrib;
     std::unique_ptr<LightDistribution> lightDistribution;
 };
 
@@ -50,6 +50,8 @@ STAT_COUNTER("Integrator/Surface interactions", surfaceInteractions);
 void VolPathIntegrator::Preprocess(const Scene &scene, Sampler &sampler) {
     lightDistribution =
         CreateLightSampleDistribution(lightSampleStrategy, scene);
+    if (prebuildLightDistrib)
+        PrebuildLightDistribution(lightDistribution.get(), scene, *camera);
 }
 
 Spectrum VolPathIntegrator::Li(const RayDifferential &r, const Scene &scene,
@@ -86,10 +88,8 @@ Spectrum VolPathIntegrator::Li(const RayDifferential &r, const Scene &scene,
 
             ++volumeInteractions;
             // Handle scattering at point in medium for volumetric path tracer
-            const Distribution1D *lightDistrib =
-                lightDistribution->Lookup(mi.p);
             L += beta * UniformSampleOneLight(mi, scene, arena, sampler, true,
-                                              lightDistrib);
+                                              *lightDistribution);
 
             Vector3f wo = -ray.d, wi;
             mi.phase->Sample_p(wo, &wi, sampler.Get2D());
@@ -122,10 +122,8 @@ Spectrum VolPathIntegrator::Li(const RayDifferential &r, const Scene &scene,
 
             // Sample illumination from lights to find attenuated path
             // contribution
-            const Distribution1D *lightDistrib =
-                lightDistribution->Lookup(isect.p);
             L += beta * UniformSampleOneLight(isect, scene, arena, sampler,
-                                              true, lightDistrib);
+                                              true, *lightDistribution);
 
             // Sample BSDF to get new path direction
             Vector3f wo = -ray.d, wi;
@@ -151,8 +149,8 @@ Spectrum VolPathIntegrator::Li(const RayDifferential &r, const Scene &scene,
             if (isect.bssrdf && (flags & BSDF_TRANSMISSION)) {
                 // Importance sample the BSSRDF
                 SurfaceInteraction pi;
-                Spectrum S = isect.bssrdf->Sample_S(
-                    scene, sampler.Get1D(), sampler.Get2D(), arena, &pi, &pdf);
+                Spectrum S = isect.bssrdf->Sample_S(scene, sampler, arena,
+                                                    &pi, &pdf);
                 DCHECK(std::isinf(beta.y()) == false);
                 if (S.IsBlack() || pdf == 0) break;
                 beta *= S / pdf;
@@ -161,7 +159,7 @@ Spectrum VolPathIntegrator::Li(const RayDifferential &r, const Scene &scene,
                 // component
                 L += beta *
                      UniformSampleOneLight(pi, scene, arena, sampler, true,
-                                           lightDistribution->Lookup(pi.p));
+                                           *lightDistribution);
 
                 // Account for the indirect subsurface scattering component
                 Spectrum f = pi.bsdf->Sample_f(pi.wo, &wi, sampler.Get2D(),
@@ -209,8 +207,9 @@ VolPathIntegrator *CreateVolPathIntegrator(
     Float rrThreshold = params.FindOneFloat("rrthreshold", 1.);
     std::string lightStrategy =
         params.FindOneString("lightsamplestrategy", "spatial");
+    bool prebuild = params.FindOneBool("prebuildlightdistrib", false);
     return new VolPathIntegrator(maxDepth, camera, sampler, pixelBounds,
-                                 rrThreshold, lightStrategy);
+                                 rrThreshold, lightStrategy, prebuild);
 }
 
 }  // namespace pbrt
@@ -52,11 +52,13 @@ class VolPathIntegrator : public SamplerIntegrator {
     VolPathIntegrator(int maxDepth, std::shared_ptr<const Camera> camera,
                       std::shared_ptr<Sampler> sampler,
                       const Bounds2i &pixelBounds, Float rrThreshold = 1,
-                      const std::string &lightSampleStrategy = "spatial")
+                      const std::string &lightSampleStrategy = "spatial",
+                      bool prebuildLightDistrib = false)
         : SamplerIntegrator(camera, sampler, pixelBounds),
           maxDepth(maxDepth),
           rrThreshold(rrThreshold),
-          lightSampleStrategy(lightSampleStrategy) { }
+          lightSampleStrategy(lightSampleStrategy),
+          prebuildLightDistrib(prebuildLightDistrib) { }
     void Preprocess(const Scene &scene, Sampler &sampler);
     Spectrum Li(const RayDifferential &ray, const Scene &scene,
                 Sampler &sampler, MemoryArena &arena, int depth) const;
@@ -66,6 +68,7 @@ class VolPathIntegrator : public SamplerIntegrator {
     const int maxDepth;
     const Float rrThreshold;
     const std::string lightSampleStrategy;
+    const bool prebuildLightDistrib;
     std::unique_ptr<LightDistribution> lightDistribution;
 };
 
@@ -34,6 +34,7 @@
 #include "lights/diffuse.h"
 #include "paramset.h"
 #include "sampling.h"
+#include "scene.h"
 #include "shapes/triangle.h"
 #include "stats.h"
 
@@ -65,6 +66,14 @@ Spectrum DiffuseAreaLight::Power() const {
     return (twoSided ? 2 : 1) * Lemit * area * Pi;
 }
 
+bool DiffuseAreaLight::Bounds(LightBounds *bounds) const {
+    // The peak intensity of a diffuse emitter, along its normal, is $L A$
+    DirectionCone nb = shape->NormalBounds();
+    *bounds = LightBounds(shape->WorldBound(), nb.w, 4 * Pi * Lemit.y() * area,
+                          nb.cosTheta, 0 /* cos(Pi/2) */, twoSided);
+    return true;
+}
+
 Spectrum DiffuseAreaLight::Sample_Li(const Interaction &ref, const Point2f &u,
                                      Vector3f *wi, Float *pdf,
                                      VisibilityTester *vis) const {
@@ -132,6 +141,186 @@ void DiffuseAreaLight::Pdf_Le(const Ray &ray, const Normal3f &n, Float *pdfPos,
                        : CosineHemispherePdf(Dot(n, ray.d));
 }
 
+// TriangleMeshAreaLight Method Definitions
+STAT_COUNTER("Scene/Triangle mesh lights", nMeshLights);
+STAT_MEMORY_COUNTER("Memory/Triangle mesh lights", meshLightBytes);
+
+// Triangles that subtend solid angles in this range from the receiving
+// point are sampled with respect to solid angle. Below it, area sampling
+// is nearly as good and is more robust; above it, spherical triangle
+// sampling becomes numerically unstable.
+static const Float minSphericalSampleSolidAngle = 3e-4f;
+static const Float maxSphericalSampleSolidAngle = 6.22f;
+
+static bool SampleSolidAngle(Float solidAngle) {
+    return solidAngle >= minSphericalSampleSolidAngle &&
+           solidAngle <= maxSphericalSampleSolidAngle;
+}
+
+static std::vector<Float> TriangleAreas(
+    const std::vector<std::shared_ptr<Shape>> &triangles) {
+    std::vector<Float> areas;
+    areas.reserve(triangles.size());
+    for (const std::shared_ptr<Shape> &tri : triangles)
+        areas.push_back(tri->Area());
+    return areas;
+}
+
+TriangleMeshAreaLight::TriangleMeshAreaLight(
+    const Transform &LightToWorld, const MediumInterface &mediumInterface,
+    const Spectrum &Lemit, int nSamples,
+    const std::vector<std::shared_ptr<Shape>> &triangles, bool twoSided)
+    : AreaLight(LightToWorld, mediumInterface, nSamples),
+      Lemit(Lemit),
+      triangles(triangles),
+      triangleDistrib(&TriangleAreas(triangles)[0], int(triangles.size())),
+      twoSided(twoSided) {
+    CHECK(IsTriangleMesh(triangles));
+    area = 0;
+    normalBounds = triangles[0]->NormalBounds();
+    for (const std::shared_ptr<Shape> &tri : triangles) {
+        area += tri->Area();
+        bounds = Union(bounds, tri->WorldBound());
+        normalBounds = Union(normalBounds, tri->NormalBounds());
+    }
+    ++nMeshLights;
+    meshLightBytes += sizeof(*this) + triangleDistrib.BytesUsed() +
+                      triangles.size() * sizeof(triangles[0]);
+}
+
+Spectrum TriangleMeshAreaLight::Power() const {
+    return (twoSided ? 2 : 1) * Lemit * area * Pi;
+}
+
+bool TriangleMeshAreaLight::Bounds(LightBounds *lb) const {
+    *lb = LightBounds(bounds, normalBounds.w, 4 * Pi * Lemit.y() * area,
+                      normalBounds.cosTheta, 0 /* cos(Pi/2) */, twoSided);
+    return true;
+}
+
+Spectrum TriangleMeshAreaLight::Sample_Li(const Interaction &ref,
+                                          const Point2f &u, Vector3f *wi,
+                                          Float *pdf,
+                                          VisibilityTester *vis) const {
+    ProfilePhase _(Prof::LightSample);
+    // Choose a triangle and then a point on it
+    Float pmf;
+    Point2f uTri = u;
+    int index = triangleDistrib.Sample(u[0], &pmf, &uTri[0]);
+    const Triangle &tri = static_cast<const Triangle &>(*triangles[index]);
+    Interaction pShape;
+    Float solidAngle = tri.SolidAngle(ref.p);
+    if (SampleSolidAngle(solidAngle)) {
+        if (!tri.SampleSolidAngle(ref.p, uTri, &pShape)) {
+            *pdf = 0;
+            return 0.f;
+        }
+        *pdf = pmf / solidAngle;
+    } else {
+        pShape = tri.Sample(ref, uTri, pdf);
+        *pdf *= pmf;
+    }
+    pShape.mediumInterface = mediumInterface;
+    if (*pdf == 0 || (pShape.p - ref.p).LengthSquared() == 0) {
+        *pdf = 0;
+        return 0.f;
+    }
+    *wi = Normalize(pShape.p - ref.p);
+    *vis = VisibilityTester(ref, pShape);
+    return L(pShape, -*wi);
+}
+
+Float TriangleMeshAreaLight::Pdf_Li(const Interaction &ref,
+                                    const Vector3f &wi) const {
+    ProfilePhase _(Prof::LightPdf);
+    // Find the triangle along _wi_, passing through surfaces without a
+    // material that only mark medium boundaries as _Scene::IntersectTr()_
+    // does
+    SurfaceInteraction isect;
+    Ray ray = ref.SpawnRay(wi);
+    while (true) {
+        if (!scene->Intersect(ray, &isect)) return 0;
+        if (isect.primitive->GetAreaLight() == this) break;
+        if (isect.primitive->GetMaterial() != nullptr) return 0;
+        ray = isect.SpawnRay(wi);
+    }
+    return Pdf_LiAt(ref, wi, isect);
+}
+
+Float TriangleMeshAreaLight::Pdf_LiAt(const Interaction &ref,
+                                      const Vector3f &wi,
+                                      const SurfaceInteraction &isect) const {
+    ProfilePhase _(Prof::LightPdf);
+    const Triangle &tri = static_cast<const Triangle &>(*isect.shape);
+    Float pmf = triangleDistrib.PMF(tri.MeshIndex());
+    Float solidAngle = tri.SolidAngle(ref.p);
+    if (SampleSolidAngle(solidAngle)) return pmf / solidAngle;
+
+    // Convert the triangle's area density to solid angle
+    Float pdf = DistanceSquared(ref.p, isect.p) /
+                (AbsDot(isect.n, -wi) * tri.Area());
+    if (std::isinf(pdf)) return 0;
+    return pmf * pdf;
+}
+
+Spectrum TriangleMeshAreaLight::Sample_Le(const Point2f &u1, const Point2f &u2,
+                                          Float time, Ray *ray,
+                                          Normal3f *nLight, Float *pdfPos,
+                                          Float *pdfDir) const {
+    ProfilePhase _(Prof::LightSample);
+    // Sample a point on the mesh uniformly by area
+    Point2f uTri = u1;
+    int index = triangleDistrib.Sample(u1[0], nullptr, &uTri[0]);
+    Interaction pShape = triangles[index]->Sample(uTri, pdfPos);
+    *pdfPos = 1 / area;
+    pShape.mediumInterface = mediumInterface;
+    *nLight = pShape.n;
+
+    // Sample a cosine-weighted outgoing direction _w_ for area light
+    Vector3f w;
+    if (twoSided) {
+        Point2f u = u2;
+        if (u[0] < .5) {
+            u[0] = std::min(u[0] * 2, OneMinusEpsilon);
+            w = CosineSampleHemisphere(u);
+        } else {
+            u[0] = std::min((u[0] - .5f) * 2, OneMinusEpsilon);
+            w = CosineSampleHemisphere(u);
+            w.z *= -1;
+        }
+        *pdfDir = 0.5f * CosineHemispherePdf(std::abs(w.z));
+    } else {
+        w = CosineSampleHemisphere(u2);
+        *pdfDir = CosineHemispherePdf(w.z);
+    }
+
+    Vector3f v1, v2, n(pShape.n);
+    CoordinateSystem(n, &v1, &v2);
+    w = w.x * v1 + w.y * v2 + w.z * n;
+    *ray = pShape.SpawnRay(w);
+    return L(pShape, w);
+}
+
+void TriangleMeshAreaLight::Pdf_Le(const Ray &ray, const Normal3f &n,
+                                   Float *pdfPos, Float *pdfDir) const {
+    ProfilePhase _(Prof::LightPdf);
+    *pdfPos = 1 / area;
+    *pdfDir = twoSided ? (.5 * CosineHemispherePdf(AbsDot(n, ray.d)))
+                       : CosineHemispherePdf(Dot(n, ray.d));
+}
+
+bool IsTriangleMesh(const std::vector<std::shared_ptr<Shape>> &shapes) {
+    if (shapes.empty()) return false;
+    const Triangle *first = dynamic_cast<const Triangle *>(shapes[0].get());
+    if (!first) return false;
+    for (size_t i = 0; i < shapes.size(); ++i) {
+        const Triangle *tri = dynamic_cast<const Triangle *>(shapes[i].get());
+        if (!tri || tri->Mesh() != first->Mesh() || tri->MeshIndex() != int(i))
+            return false;
+    }
+    return true;
+}
+
 std::shared_ptr<AreaLight> CreateDiffuseAreaLight(
     const Transform &light2world, const Medium *medium,
     const ParamSet &paramSet, const std::shared_ptr<Shape> &shape) {
@@ -145,4 +334,18 @@ std::shared_ptr<AreaLight> CreateDiffuseAreaLight(
                                               nSamples, shape, twoSided);
 }
 
+std::shared_ptr<AreaLight> CreateTriangleMeshAreaLight(
+    const Transform &light2world, const Medium *medium,
+    const ParamSet &paramSet,
+    const std::vector<std::shared_ptr<Shape>> &triangles) {
+    Spectrum L = paramSet.FindOneSpectrum("L", Spectrum(1.0));
+    Spectrum sc = paramSet.FindOneSpectrum("scale", Spectrum(1.0));
+    int nSamples = paramSet.FindOneInt("samples",
+                                       paramSet.FindOneInt("nsamples", 1));
+    bool twoSided = paramSet.FindOneBool("twosided", false);
+    if (PbrtOptions.quickRender) nSamples = std::max(1, nSamples / 4);
+    return std::make_shared<TriangleMeshAreaLight>(
+        light2world, medium, L * sc, nSamples, triangles, twoSided);
+}
+
 }  // namespace pbrt
@@ -42,6 +42,7 @@
 #include "pbrt.h"
 #include "light.h"
 #include "primitive.h"
+#include "sampling.h"
 
 namespace pbrt {
 
@@ -57,6 +58,7 @@ class DiffuseAreaLight : public AreaLight {
         return (twoSided || Dot(intr.n, w) > 0) ? Lemit : Spectrum(0.f);
     }
     Spectrum Power() const;
+    bool Bounds(LightBounds *bounds) const;
     Spectrum Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wo,
                        Float *pdf, VisibilityTester *vis) const;
     Float Pdf_Li(const Interaction &, const Vector3f &) const;
@@ -77,9 +79,65 @@ class DiffuseAreaLight : public AreaLight {
     const Float area;
 };
 
+// TriangleMeshAreaLight Declarations
+// A diffuse area light for all of the triangles of a mesh, which the light
+// sampling distributions see as a single light.  It chooses a triangle in
+// proportion to its area with an alias table; triangles that subtend a
+// large enough solid angle from the receiving point are then sampled
+// uniformly in solid angle, and the others by area.
+class TriangleMeshAreaLight : public AreaLight {
+  public:
+    // TriangleMeshAreaLight Public Methods
+    TriangleMeshAreaLight(const Transform &LightToWorld,
+                          const MediumInterface &mediumInterface,
+                          const Spectrum &Le, int nSamples,
+                          const std::vector<std::shared_ptr<Shape>> &triangles,
+                          bool twoSided = false);
+    Spectrum L(const Interaction &intr, const Vector3f &w) const {
+        return (twoSided || Dot(intr.n, w) > 0) ? Lemit : Spectrum(0.f);
+    }
+    void Preprocess(const Scene &scene) { this->scene = &scene; }
+    Spectrum Power() const;
+    bool Bounds(LightBounds *bounds) const;
+    Spectrum Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wo,
+                       Float *pdf, VisibilityTester *vis) const;
+    // Finds the triangle along |wi| by tracing a ray into the scene,
+    // passing through surfaces without a material as IntersectTr() does.
+    // If another surface is hit first, zero is returned; the light can't
+    // contribute along |wi| then, so MIS weights are unaffected. Callers
+    // that already found the light along |wi| should use Pdf_LiAt().
+    Float Pdf_Li(const Interaction &ref, const Vector3f &wi) const;
+    Float Pdf_LiAt(const Interaction &ref, const Vector3f &wi,
+                   const SurfaceInteraction &lightIsect) const;
+    Spectrum Sample_Le(const Point2f &u1, const Point2f &u2, Float time,
+                       Ray *ray, Normal3f *nLight, Float *pdfPos,
+                       Float *pdfDir) const;
+    void Pdf_Le(const Ray &, const Normal3f &, Float *pdfPos,
+                Float *pdfDir) const;
+
+  private:
+    // TriangleMeshAreaLight Private Data
+    const Spectrum Lemit;
+    std::vector<std::shared_ptr<Shape>> triangles;
+    AliasTable triangleDistrib;
+    const bool twoSided;
+    Float area;
+    Bounds3f bounds;
+    DirectionCone normalBounds;
+    const Scene *scene = nullptr;
+};
+
+// Returns true if |shapes| are all of the triangles of a single mesh, in
+// order, so that a TriangleMeshAreaLight can be used for them.
+bool IsTriangleMesh(const std::vector<std::shared_ptr<Shape>> &shapes);
+
 std::shared_ptr<AreaLight> CreateDiffuseAreaLight(
     const Transform &light2world, const Medium *medium,
     const ParamSet &paramSet, const std::shared_ptr<Shape> &shape);
+std::shared_ptr<AreaLight> CreateTriangleMeshAreaLight(
+    const Transform &light2world, const Medium *medium,
+    const ParamSet &paramSet,
+    const std::vector<std::shared_ptr<Shape>> &triangles);
 
 }  // namespace pbrt
 
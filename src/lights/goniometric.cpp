@@ -40,6 +40,44 @@
 namespace pbrt {
 
 // GonioPhotometricLight Method Definitions
+GonioPhotometricLight::GonioPhotometricLight(
+    const Transform &LightToWorld, const MediumInterface &mediumInterface,
+    const Spectrum &I, const std::string &texname)
+    : Light((int)LightFlags::DeltaPosition, LightToWorld, mediumInterface),
+      pLight(LightToWorld(Point3f(0, 0, 0))),
+      I(I) {
+    // Create _mipmap_ for _GonioPhotometricLight_
+    Point2i resolution;
+    std::unique_ptr<RGBSpectrum[]> texels = ReadImage(texname, &resolution);
+    if (!texels) return;
+    mipmap.reset(new MIPMap<RGBSpectrum>(resolution, texels.get()));
+
+    // Find the diagram's peak luminance to bound the light's intensity
+    maxScale = 0;
+    for (int t = 0; t < mipmap->Height(); ++t)
+        for (int s = 0; s < mipmap->Width(); ++s)
+            maxScale = std::max(
+                maxScale,
+                Spectrum(mipmap->Texel(0, s, t), SpectrumType::Illuminant).y());
+
+    // Compute sampling distribution for the goniometric diagram, weighting
+    // its texels by the solid angle they subtend as the environment map of
+    // _InfiniteAreaLight_ does
+    int width = 2 * mipmap->Width(), height = 2 * mipmap->Height();
+    std::unique_ptr<Float[]> img(new Float[width * height]);
+    Float fwidth = 0.5f / std::min(width, height);
+    for (int v = 0; v < height; ++v) {
+        Float vp = (v + .5f) / (Float)height;
+        Float sinTheta = std::sin(Pi * vp);
+        for (int u = 0; u < width; ++u) {
+            Float up = (u + .5f) / (Float)width;
+            img[u + v * width] =
+                mipmap->Lookup(Point2f(up, vp), fwidth).y() * sinTheta;
+        }
+    }
+    distribution.reset(new Distribution2D(img.get(), width, height));
+}
+
 Spectrum GonioPhotometricLight::Sample_Li(const Interaction &ref,
                                           const Point2f &u, Vector3f *wi,
                                           Float *pdf,
@@ -58,6 +96,15 @@ Spectrum GonioPhotometricLight::Power() const {
                                  SpectrumType::Illuminant);
 }
 
+bool GonioPhotometricLight::Bounds(LightBounds *bounds) const {
+    // Like _PointLight_, bound the emission by the peak intensity in every
+    // direction; the diagram's average would undercount narrow beams
+    *bounds = LightBounds(Bounds3f(pLight), Vector3f(0, 0, 1),
+                          4 * Pi * I.y() * maxScale, -1 /* cos(Pi) */,
+                          0 /* cos(Pi/2) */, false);
+    return true;
+}
+
 Float GonioPhotometricLight::Pdf_Li(const Interaction &,
                                     const Vector3f &) const {
     return 0.f;
@@ -68,19 +115,50 @@ Spectrum GonioPhotometricLight::Sample_Le(const Point2f &u1, const Point2f &u2,
                                           Normal3f *nLight, Float *pdfPos,
                                           Float *pdfDir) const {
     ProfilePhase _(Prof::LightSample);
-    *ray = Ray(pLight, UniformSampleSphere(u1), Infinity, time,
+    *pdfPos = 1.f;
+    if (!distribution) {
+        *ray = Ray(pLight, UniformSampleSphere(u1), Infinity, time,
+                   mediumInterface.inside);
+        *nLight = (Normal3f)ray->d;
+        *pdfDir = UniformSpherePdf();
+        return I * Scale(ray->d);
+    }
+
+    // Sample a direction from the goniometric diagram's distribution
+    Float mapPdf;
+    Point2f uv = distribution->SampleContinuous(u1, &mapPdf);
+    Float theta = uv[1] * Pi, phi = uv[0] * 2 * Pi;
+    Float cosTheta = std::cos(theta), sinTheta = std::sin(theta);
+    Float sinPhi = std::sin(phi), cosPhi = std::cos(phi);
+    if (mapPdf == 0 || sinTheta == 0) {
+        *pdfDir = 0;
+        return Spectrum(0.f);
+    }
+    // Swap $y$ and $z$ back to match the parameterization in Scale()
+    Vector3f w(sinTheta * cosPhi, cosTheta, sinTheta * sinPhi);
+    *ray = Ray(pLight, Normalize(LightToWorld(w)), Infinity, time,
                mediumInterface.inside);
     *nLight = (Normal3f)ray->d;
-    *pdfPos = 1.f;
-    *pdfDir = UniformSpherePdf();
+    *pdfDir = mapPdf / (2 * Pi * Pi * sinTheta);
     return I * Scale(ray->d);
 }
 
-void GonioPhotometricLight::Pdf_Le(const Ray &, const Normal3f &, Float *pdfPos,
-                                   Float *pdfDir) const {
+void GonioPhotometricLight::Pdf_Le(const Ray &ray, const Normal3f &,
+                                   Float *pdfPos, Float *pdfDir) const {
     ProfilePhase _(Prof::LightPdf);
     *pdfPos = 0.f;
-    *pdfDir = UniformSpherePdf();
+    if (!distribution) {
+        *pdfDir = UniformSpherePdf();
+        return;
+    }
+    Vector3f wp = Normalize(WorldToLight(ray.d));
+    std::swap(wp.y, wp.z);
+    Float theta = SphericalTheta(wp), phi = SphericalPhi(wp);
+    Float sinTheta = std::sin(theta);
+    *pdfDir = sinTheta == 0 ? 0
+                            : distribution->Pdf(Point2f(phi * Inv2Pi,
+                                                        theta * InvPi)) /
+                                  (2 * Pi * Pi * sinTheta);
 }
 
 std::shared_ptr<GonioPhotometricLight> CreateGoniometricLight(
@@ -45,6 +45,7 @@
 #include "scene.h"
 #include "mipmap.h"
 #include "imageio.h"
+#include "sampling.h"
 
 namespace pbrt {
 
@@ -56,16 +57,7 @@ class GonioPhotometricLight : public Light {
                        Float *pdf, VisibilityTester *vis) const;
     GonioPhotometricLight(const Transform &LightToWorld,
                           const MediumInterface &mediumInterface,
-                          const Spectrum &I, const std::string &texname)
-        : Light((int)LightFlags::DeltaPosition, LightToWorld, mediumInterface),
-          pLight(LightToWorld(Point3f(0, 0, 0))),
-          I(I) {
-        // Create _mipmap_ for _GonioPhotometricLight_
-        Point2i resolution;
-        std::unique_ptr<RGBSpectrum[]> texels = ReadImage(texname, &resolution);
-        if (texels)
-            mipmap.reset(new MIPMap<RGBSpectrum>(resolution, texels.get()));
-    }
+                          const Spectrum &I, const std::string &texname);
     Spectrum Scale(const Vector3f &w) const {
         Vector3f wp = Normalize(WorldToLight(w));
         std::swap(wp.y, wp.z);
@@ -76,6 +68,7 @@ class GonioPhotometricLight : public Light {
                        : Spectrum(mipmap->Lookup(st), SpectrumType::Illuminant);
     }
     Spectrum Power() const;
+    bool Bounds(LightBounds *bounds) const;
     Float Pdf_Li(const Interaction &, const Vector3f &) const;
     Spectrum Sample_Le(const Point2f &u1, const Point2f &u2, Float time,
                        Ray *ray, Normal3f *nLight, Float *pdfPos,
@@ -88,6 +81,8 @@ class GonioPhotometricLight : public Light {
     const Point3f pLight;
     const Spectrum I;
     std::unique_ptr<MIPMap<RGBSpectrum>> mipmap;
+    std::unique_ptr<Distribution2D> distribution;
+    Float maxScale = 1;
 };
 
 std::shared_ptr<GonioPhotometricLight> CreateGoniometricLight(
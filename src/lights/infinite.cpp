@@ -39,12 +39,45 @@
 
 namespace pbrt {
 
+STAT_MEMORY_COUNTER("Memory/Environment map sampling", envSamplingBytes);
+
+// With cosine sampling, the environment map's sampling distribution is
+// weighted by the cosine lobe down to this many levels below its root;
+// finer nodes are small enough that it makes little difference.
+static const int nCosineLevels = 6;
+
+// Every node keeps at least this weight so that directions below the
+// horizon, which transmissive BSDFs scatter light from, can be sampled.
+static const Float minCosineWeight = .05f;
+
+// Returns an upper bound on the cosine of the angle between |axis| and the
+// directions in the region of the environment map's $(u,v)$ domain given
+// by |b|.
+static Float CosineBound(const Vector3f &axis, const Bounds2f &b) {
+    Float theta0 = Pi * b.pMin.y, theta1 = Pi * b.pMax.y;
+    Float phi0 = 2 * Pi * b.pMin.x, phi1 = 2 * Pi * b.pMax.x;
+    // Bound the angular distance from the region's center to its points by
+    // the length of a path along a meridian and then along a parallel
+    Float sinThetaMax = (theta0 < Pi / 2 && theta1 > Pi / 2)
+                            ? 1
+                            : std::max(std::sin(theta0), std::sin(theta1));
+    Float radius = (theta1 - theta0) / 2 + sinThetaMax * (phi1 - phi0) / 2;
+    if (radius >= Pi) return 1;
+    Float thetaCenter = (theta0 + theta1) / 2;
+    Vector3f wCenter = SphericalDirection(
+        std::sin(thetaCenter), std::cos(thetaCenter), (phi0 + phi1) / 2);
+    Float angle = std::acos(Clamp(Dot(axis, wCenter), -1, 1));
+    return (angle <= radius) ? 1 : std::cos(angle - radius);
+}
+
 // InfiniteAreaLight Method Definitions
 InfiniteAreaLight::InfiniteAreaLight(const Transform &LightToWorld,
                                      const Spectrum &L, int nSamples,
-                                     const std::string &texmap)
+                                     const std::string &texmap,
+                                     bool cosineSampling)
     : Light((int)LightFlags::Infinite, LightToWorld, MediumInterface(),
-            nSamples) {
+            nSamples),
+      cosineSampling(cosineSampling) {
     // Read texel data from _texmap_ and initialize _Lmap_
     Point2i resolution;
     std::unique_ptr<RGBSpectrum[]> texels(nullptr);
@@ -79,8 +112,10 @@ InfiniteAreaLight::InfiniteAreaLight(const Transform &LightToWorld,
         },
         height, 32);
 
-    // Compute sampling distributions for rows and columns of image
-    distribution.reset(new Distribution2D(img.get(), width, height));
+    // Compute hierarchical sampling distribution for image
+    distribution.reset(
+        new HierarchicalDistribution2D(img.get(), width, height));
+    envSamplingBytes += distribution->BytesUsed();
 }
 
 Spectrum InfiniteAreaLight::Power() const {
@@ -100,8 +135,13 @@ Spectrum InfiniteAreaLight::Sample_Li(const Interaction &ref, const Point2f &u,
                                       VisibilityTester *vis) const {
     ProfilePhase _(Prof::LightSample);
     // Find $(u,v)$ sample coordinates in infinite light texture
+    Vector3f axis = ProductAxis(ref);
+    auto cosineWeight = [&axis](const Bounds2f &b) {
+        return std::max(CosineBound(axis, b), minCosineWeight);
+    };
     Float mapPdf;
-    Point2f uv = distribution->SampleContinuous(u, &mapPdf);
+    Point2f uv = distribution->SampleContinuous(
+        u, &mapPdf, cosineWeight, (axis == Vector3f()) ? 0 : nCosineLevels);
     if (mapPdf == 0) return Spectrum(0.f);
 
     // Convert infinite light sample point to direction
@@ -121,16 +161,31 @@ Spectrum InfiniteAreaLight::Sample_Li(const Interaction &ref, const Point2f &u,
     return Spectrum(Lmap->Lookup(uv), SpectrumType::Illuminant);
 }
 
-Float InfiniteAreaLight::Pdf_Li(const Interaction &, const Vector3f &w) const {
+Float InfiniteAreaLight::Pdf_Li(const Interaction &ref,
+                                const Vector3f &w) const {
     ProfilePhase _(Prof::LightPdf);
     Vector3f wi = WorldToLight(w);
     Float theta = SphericalTheta(wi), phi = SphericalPhi(wi);
     Float sinTheta = std::sin(theta);
     if (sinTheta == 0) return 0;
-    return distribution->Pdf(Point2f(phi * Inv2Pi, theta * InvPi)) /
+    Vector3f axis = ProductAxis(ref);
+    auto cosineWeight = [&axis](const Bounds2f &b) {
+        return std::max(CosineBound(axis, b), minCosineWeight);
+    };
+    return distribution->Pdf(Point2f(phi * Inv2Pi, theta * InvPi),
+                             cosineWeight,
+                             (axis == Vector3f()) ? 0 : nCosineLevels) /
            (2 * Pi * Pi * sinTheta);
 }
 
+Vector3f InfiniteAreaLight::ProductAxis(const Interaction &ref) const {
+    // Points in media and interactions without an outgoing direction don't
+    // have a cosine lobe to sample
+    if (!cosineSampling || ref.n == Normal3f() || ref.wo == Vector3f())
+        return Vector3f();
+    return Normalize(WorldToLight(Vector3f(Faceforward(ref.n, ref.wo))));
+}
+
 Spectrum InfiniteAreaLight::Sample_Le(const Point2f &u1, const Point2f &u2,
                                       Float time, Ray *ray, Normal3f *nLight,
                                       Float *pdfPos, Float *pdfDir) const {
@@ -181,8 +236,9 @@ std::shared_ptr<InfiniteAreaLight> CreateInfiniteLight(
     int nSamples = paramSet.FindOneInt("samples",
                                        paramSet.FindOneInt("nsamples", 1));
     if (PbrtOptions.quickRender) nSamples = std::max(1, nSamples / 4);
+    bool cosineSampling = paramSet.FindOneBool("cosinesampling", false);
     return std::make_shared<InfiniteAreaLight>(light2world, L * sc, nSamples,
-                                               texmap);
+                                               texmap, cosineSampling);
 }
 
 }  // namespace pbrt
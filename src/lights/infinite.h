@@ -45,6 +45,7 @@
 #include "shape.h"
 #include "scene.h"
 #include "mipmap.h"
+#include "sampling.h"
 
 namespace pbrt {
 
@@ -53,7 +54,8 @@ class InfiniteAreaLight : public Light {
   public:
     // InfiniteAreaLight Public Methods
     InfiniteAreaLight(const Transform &LightToWorld, const Spectrum &power,
-                      int nSamples, const std::string &texmap);
+                      int nSamples, const std::string &texmap,
+                      bool cosineSampling = false);
     void Preprocess(const Scene &scene) {
         scene.WorldBound().BoundingSphere(&worldCenter, &worldRadius);
     }
@@ -69,11 +71,18 @@ class InfiniteAreaLight : public Light {
                 Float *pdfDir) const;
 
   private:
+    // InfiniteAreaLight Private Methods
+    // Returns the light-space direction about which Sample_Li() and
+    // Pdf_Li() take the product of the environment map with a clamped
+    // cosine lobe for |ref|, or a zero vector if they shouldn't.
+    Vector3f ProductAxis(const Interaction &ref) const;
+
     // InfiniteAreaLight Private Data
     std::unique_ptr<MIPMap<RGBSpectrum>> Lmap;
     Point3f worldCenter;
     Float worldRadius;
-    std::unique_ptr<Distribution2D> distribution;
+    std::unique_ptr<HierarchicalDistribution2D> distribution;
+    const bool cosineSampling;
 };
 
 std::shared_ptr<InfiniteAreaLight> CreateInfiniteLight(
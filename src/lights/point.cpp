@@ -54,6 +54,12 @@ Spectrum PointLight::Sample_Li(const Interaction &ref, const Point2f &u,
 
 Spectrum PointLight::Power() const { return 4 * Pi * I; }
 
+bool PointLight::Bounds(LightBounds *bounds) const {
+    *bounds = LightBounds(Bounds3f(pLight), Vector3f(0, 0, 1), 4 * Pi * I.y(),
+                          -1 /* cos(Pi) */, 0 /* cos(Pi/2) */, false);
+    return true;
+}
+
 Float PointLight::Pdf_Li(const Interaction &, const Vector3f &) const {
     return 0;
 }
@@ -67,10 +67,32 @@ ProjectionLight::ProjectionLight(const Transform &LightToWorld,
     yon = 1e30f;
     lightProjection = Perspective(fov, hither, yon);
 
-    Transform screenToLight = Inverse(lightProjection);
+    screenToLight = Inverse(lightProjection);
     Point3f pCorner(screenBounds.pMax.x, screenBounds.pMax.y, 0);
     Vector3f wCorner = Normalize(Vector3f(screenToLight(pCorner)));
     cosTotalWidth = wCorner.z;
+
+    // Compute area of the screen window projected to the $z=1$ plane
+    Point3f pMin = screenToLight(
+        Point3f(screenBounds.pMin.x, screenBounds.pMin.y, 0));
+    Point3f pMax = screenToLight(pCorner);
+    screenArea = std::abs((pMax.x / pMax.z - pMin.x / pMin.z) *
+                          (pMax.y / pMax.z - pMin.y / pMin.z));
+
+    // Compute sampling distribution for the projected image
+    if (!projectionMap) return;
+    int width = 2 * projectionMap->Width(), height = 2 * projectionMap->Height();
+    std::unique_ptr<Float[]> img(new Float[width * height]);
+    Float fwidth = 0.5f / std::min(width, height);
+    for (int v = 0; v < height; ++v) {
+        Float vp = (v + .5f) / (Float)height;
+        for (int u = 0; u < width; ++u) {
+            Float up = (u + .5f) / (Float)width;
+            img[u + v * width] =
+                projectionMap->Lookup(Point2f(up, vp), fwidth).y();
+        }
+    }
+    distribution.reset(new Distribution2D(img.get(), width, height));
 }
 
 Spectrum ProjectionLight::Sample_Li(const Interaction &ref, const Point2f &u,
@@ -105,6 +127,14 @@ Spectrum ProjectionLight::Power() const {
            I * 2 * Pi * (1.f - cosTotalWidth);
 }
 
+bool ProjectionLight::Bounds(LightBounds *bounds) const {
+    Vector3f w = Normalize(LightToWorld(Vector3f(0, 0, 1)));
+    Float phi = Power().y() * 2 / (1 - cosTotalWidth);
+    *bounds = LightBounds(Bounds3f(pLight), w, phi, cosTotalWidth,
+                          1 /* cos(0) */, false);
+    return true;
+}
+
 Float ProjectionLight::Pdf_Li(const Interaction &, const Vector3f &) const {
     return 0.f;
 }
@@ -113,11 +143,31 @@ Spectrum ProjectionLight::Sample_Le(const Point2f &u1, const Point2f &u2,
                                     Float time, Ray *ray, Normal3f *nLight,
                                     Float *pdfPos, Float *pdfDir) const {
     ProfilePhase _(Prof::LightSample);
-    Vector3f v = UniformSampleCone(u1, cosTotalWidth);
-    *ray = Ray(pLight, LightToWorld(v), Infinity, time, mediumInterface.inside);
-    *nLight = (Normal3f)ray->d;
     *pdfPos = 1.f;
-    *pdfDir = UniformConePdf(cosTotalWidth);
+    if (!distribution) {
+        Vector3f v = UniformSampleCone(u1, cosTotalWidth);
+        *ray = Ray(pLight, LightToWorld(v), Infinity, time,
+                   mediumInterface.inside);
+        *nLight = (Normal3f)ray->d;
+        *pdfDir = UniformConePdf(cosTotalWidth);
+        return I * Projection(ray->d);
+    }
+
+    // Sample a point on the screen window from the image's distribution
+    Float mapPdf;
+    Point2f st = distribution->SampleContinuous(u1, &mapPdf);
+    if (mapPdf == 0) {
+        *pdfDir = 0;
+        return Spectrum(0.f);
+    }
+    Point2f ps = screenBounds.Lerp(st);
+    Vector3f w = Normalize(Vector3f(screenToLight(Point3f(ps.x, ps.y, 0))));
+
+    // Convert the screen-space density to one with respect to solid angle
+    *ray = Ray(pLight, Normalize(LightToWorld(w)), Infinity, time,
+               mediumInterface.inside);
+    *nLight = (Normal3f)ray->d;
+    *pdfDir = mapPdf / (screenArea * w.z * w.z * w.z);
     return I * Projection(ray->d);
 }
 
@@ -125,9 +175,24 @@ void ProjectionLight::Pdf_Le(const Ray &ray, const Normal3f &, Float *pdfPos,
                              Float *pdfDir) const {
     ProfilePhase _(Prof::LightPdf);
     *pdfPos = 0.f;
-    *pdfDir = (CosTheta(WorldToLight(ray.d)) >= cosTotalWidth)
-                  ? UniformConePdf(cosTotalWidth)
-                  : 0;
+    Vector3f w = Normalize(WorldToLight(ray.d));
+    if (!distribution) {
+        *pdfDir =
+            (CosTheta(w) >= cosTotalWidth) ? UniformConePdf(cosTotalWidth) : 0;
+        return;
+    }
+    // Find the direction's $(s,t)$ coordinates in the projection map
+    if (w.z < hither) {
+        *pdfDir = 0;
+        return;
+    }
+    Point3f p = lightProjection(Point3f(w.x, w.y, w.z));
+    if (!Inside(Point2f(p.x, p.y), screenBounds)) {
+        *pdfDir = 0;
+        return;
+    }
+    Point2f st = Point2f(screenBounds.Offset(Point2f(p.x, p.y)));
+    *pdfDir = distribution->Pdf(st) / (screenArea * w.z * w.z * w.z);
 }
 
 std::shared_ptr<ProjectionLight> CreateProjectionLight(
@@ -43,6 +43,7 @@
 #include "light.h"
 #include "shape.h"
 #include "mipmap.h"
+#include "sampling.h"
 
 namespace pbrt {
 
@@ -57,6 +58,7 @@ class ProjectionLight : public Light {
                        Float *pdf, VisibilityTester *vis) const;
     Spectrum Projection(const Vector3f &w) const;
     Spectrum Power() const;
+    bool Bounds(LightBounds *bounds) const;
     Float Pdf_Li(const Interaction &, const Vector3f &) const;
     Spectrum Sample_Le(const Point2f &u1, const Point2f &u2, Float time,
                        Ray *ray, Normal3f *nLight, Float *pdfPos,
@@ -69,10 +71,14 @@ class ProjectionLight : public Light {
     std::unique_ptr<MIPMap<RGBSpectrum>> projectionMap;
     const Point3f pLight;
     const Spectrum I;
-    Transform lightProjection;
+    Transform lightProjection, screenToLight;
     Float hither, yon;
     Bounds2f screenBounds;
     Float cosTotalWidth;
+    // Sampling distribution over the projection map's $(s,t)$ coordinates
+    // and the area of the screen window on the $z=1$ plane in light space
+    std::unique_ptr<Distribution2D> distribution;
+    Float screenArea;
 };
 
 std::shared_ptr<ProjectionLight> CreateProjectionLight(
@@ -76,6 +76,15 @@ Spectrum SpotLight::Power() const {
     return I * 2 * Pi * (1 - .5f * (cosFalloffStart + cosTotalWidth));
 }
 
+bool SpotLight::Bounds(LightBounds *bounds) const {
+    // The spotlight's cone bounds its emission, so no falloff angle is
+    // needed beyond it
+    Vector3f w = Normalize(LightToWorld(Vector3f(0, 0, 1)));
+    *bounds = LightBounds(Bounds3f(pLight), w, 4 * Pi * I.y(), cosTotalWidth,
+                          1 /* cos(0) */, false);
+    return true;
+}
+
 Float SpotLight::Pdf_Li(const Interaction &, const Vector3f &) const {
     return 0.f;
 }
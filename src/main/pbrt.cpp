@@ -53,6 +53,11 @@ Rendering options:
   --quick              Automatically reduce a number of quality settings to
                        render more quickly.
   --quiet              Suppress all text output other than error messages.
+  --texcache <MB>      Memory budget for tiles of tiled (.tmip) textures.
+                       Default: 1024.
+  --ptexcache <MB>     Memory budget for the Ptex texture cache.
+                       Default: 4096.
+  --ptexfiles <num>    Maximum number of Ptex files kept open. Default: 100.
 
 Logging options:
   --logdir <dir>       Specify directory that log files should be written to.
@@ -117,6 +122,27 @@ int main(int argc, char *argv[]) {
             options.quickRender = true;
         } else if (!strcmp(argv[i], "--quiet") || !strcmp(argv[i], "-quiet")) {
             options.quiet = true;
+        } else if (!strcmp(argv[i], "--texcache") ||
+                   !strcmp(argv[i], "-texcache")) {
+            if (i + 1 == argc)
+                usage("missing value after --texcache argument");
+            options.textureCacheMB = atoi(argv[++i]);
+        } else if (!strncmp(argv[i], "--texcache=", 11)) {
+            options.textureCacheMB = atoi(&argv[i][11]);
+        } else if (!strcmp(argv[i], "--ptexcache") ||
+                   !strcmp(argv[i], "-ptexcache")) {
+            if (i + 1 == argc)
+                usage("missing value after --ptexcache argument");
+            options.ptexCacheMB = atoi(argv[++i]);
+        } else if (!strncmp(argv[i], "--ptexcache=", 12)) {
+            options.ptexCacheMB = atoi(&argv[i][12]);
+        } else if (!strcmp(argv[i], "--ptexfiles") ||
+                   !strcmp(argv[i], "-ptexfiles")) {
+            if (i + 1 == argc)
+                usage("missing value after --ptexfiles argument");
+            options.ptexMaxFiles = atoi(argv[++i]);
+        } else if (!strncmp(argv[i], "--ptexfiles=", 12)) {
+            options.ptexMaxFiles = atoi(&argv[i][12]);
         } else if (!strcmp(argv[i], "--cat") || !strcmp(argv[i], "-cat")) {
             options.cat = true;
         } else if (!strcmp(argv[i], "--toply") || !strcmp(argv[i], "-toply")) {
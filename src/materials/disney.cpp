@@ -96,6 +96,9 @@ class DisneyDiffuse : public BxDF {
     Spectrum f(const Vector3f &wo, const Vector3f &wi) const;
     Spectrum rho(const Vector3f &, int, const Point2f *) const { return R; }
     Spectrum rho(int, const Point2f *, const Point2f *) const { return R; }
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return R.MaxComponentValue();
+    }
     std::string ToString() const;
 
   private:
@@ -129,6 +132,9 @@ class DisneyFakeSS : public BxDF {
     Spectrum f(const Vector3f &wo, const Vector3f &wi) const;
     Spectrum rho(const Vector3f &, int, const Point2f *) const { return R; }
     Spectrum rho(int, const Point2f *, const Point2f *) const { return R; }
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return R.MaxComponentValue();
+    }
     std::string ToString() const;
 
   private:
@@ -171,6 +177,10 @@ class DisneyRetro : public BxDF {
     Spectrum f(const Vector3f &wo, const Vector3f &wi) const;
     Spectrum rho(const Vector3f &, int, const Point2f *) const { return R; }
     Spectrum rho(int, const Point2f *, const Point2f *) const { return R; }
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        // The retro-reflection term vanishes for smooth surfaces
+        return R.MaxComponentValue() * roughness;
+    }
     std::string ToString() const;
 
   private:
@@ -207,6 +217,9 @@ class DisneySheen : public BxDF {
     Spectrum f(const Vector3f &wo, const Vector3f &wi) const;
     Spectrum rho(const Vector3f &, int, const Point2f *) const { return R; }
     Spectrum rho(int, const Point2f *, const Point2f *) const { return R; }
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return R.MaxComponentValue() * SchlickWeight(AbsCosTheta(wo));
+    }
     std::string ToString() const;
 
   private:
@@ -239,6 +252,9 @@ class DisneyClearcoat : public BxDF {
     Spectrum Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &u,
                       Float *pdf, BxDFType *sampledType) const;
     Float Pdf(const Vector3f &wo, const Vector3f &wi) const;
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return .25f * weight * FrSchlick(.04, AbsCosTheta(wo));
+    }
     std::string ToString() const;
 
   private:
@@ -92,9 +92,13 @@ void KdSubsurfaceMaterial::ComputeScatteringFunctions(
     Spectrum mfree = scale * mfp->Evaluate(*si).Clamp();
     Spectrum kd = Kd->Evaluate(*si).Clamp();
     Spectrum sig_a, sig_s;
-    SubsurfaceFromDiffuse(table, kd, mfree, &sig_a, &sig_s);
-    si->bssrdf = ARENA_ALLOC(arena, TabulatedBSSRDF)(*si, this, mode, eta,
-                                                     sig_a, sig_s, table);
+    SubsurfaceFromDiffuse(*table, kd, mfree, &sig_a, &sig_s);
+    if (randomWalk)
+        si->bssrdf = ARENA_ALLOC(arena, RandomWalkBSSRDF)(
+            *si, this, mode, eta, sig_a, sig_s, g, maxWalkBounces);
+    else
+        si->bssrdf = ARENA_ALLOC(arena, TabulatedBSSRDF)(*si, this, mode, eta,
+                                                         sig_a, sig_s, *table);
 }
 
 KdSubsurfaceMaterial *CreateKdSubsurfaceMaterial(const TextureParams &mp) {
@@ -117,8 +121,16 @@ KdSubsurfaceMaterial *CreateKdSubsurfaceMaterial(const TextureParams &mp) {
     Float scale = mp.FindFloat("scale", 1.0f);
     Float g = mp.FindFloat("g", 0.0f);
     bool remapRoughness = mp.FindBool("remaproughness", true);
+    std::string method = mp.FindString("method", "diffusion");
+    if (method != "diffusion" && method != "randomwalk") {
+        Warning("Subsurface method \"%s\" unknown. Using \"diffusion\".",
+                method.c_str());
+        method = "diffusion";
+    }
+    int maxWalkBounces = mp.FindInt("maxwalkbounces", 256);
     return new KdSubsurfaceMaterial(scale, kd, kr, kt, mfp, g, eta, roughu,
-                                    roughv, bumpMap, remapRoughness);
+                                    roughv, bumpMap, remapRoughness,
+                                    method == "randomwalk", maxWalkBounces);
 }
 
 }  // namespace pbrt
@@ -59,7 +59,8 @@ class KdSubsurfaceMaterial : public Material {
                          const std::shared_ptr<Texture<Float>> &uRoughness,
                          const std::shared_ptr<Texture<Float>> &vRoughness,
                          const std::shared_ptr<Texture<Float>> &bumpMap,
-                         bool remapRoughness)
+                         bool remapRoughness, bool randomWalk,
+                         int maxWalkBounces)
         : scale(scale),
           Kd(Kd),
           Kr(Kr),
@@ -69,10 +70,11 @@ class KdSubsurfaceMaterial : public Material {
           vRoughness(vRoughness),
           bumpMap(bumpMap),
           eta(eta),
+          g(g),
           remapRoughness(remapRoughness),
-          table(100, 64) {
-        ComputeBeamDiffusionBSSRDF(g, eta, &table);
-    }
+          randomWalk(randomWalk),
+          maxWalkBounces(maxWalkBounces),
+          table(GetBeamDiffusionBSSRDFTable(g, eta)) {}
     void ComputeScatteringFunctions(SurfaceInteraction *si, MemoryArena &arena,
                                     TransportMode mode,
                                     bool allowMultipleLobes) const;
@@ -83,9 +85,10 @@ class KdSubsurfaceMaterial : public Material {
     std::shared_ptr<Texture<Spectrum>> Kd, Kr, Kt, mfp;
     std::shared_ptr<Texture<Float>> uRoughness, vRoughness;
     std::shared_ptr<Texture<Float>> bumpMap;
-    Float eta;
-    bool remapRoughness;
-    BSSRDFTable table;
+    Float eta, g;
+    bool remapRoughness, randomWalk;
+    int maxWalkBounces;
+    std::shared_ptr<const BSSRDFTable> table;
 };
 
 KdSubsurfaceMaterial *CreateKdSubsurfaceMaterial(const TextureParams &mp);
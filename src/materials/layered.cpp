@@ -0,0 +1,240 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+// materials/layered.cpp*
+#include "materials/layered.h"
+#include "spectrum.h"
+#include "reflection.h"
+#include "paramset.h"
+#include "texture.h"
+#include "interaction.h"
+#include "parallel.h"
+#include "rng.h"
+#include "stats.h"
+#include <map>
+#include <mutex>
+
+namespace pbrt {
+
+STAT_COUNTER("Scene/Layer statistics tables computed", nLayerStatistics);
+
+// CoatedBxDF Declarations
+class CoatedBxDF : public BxDF {
+  public:
+    // CoatedBxDF Public Methods
+    CoatedBxDF(BxDF *bxdf, const LayerStatistics *stats, Float alpha,
+               Float eta, const Spectrum &sigma_a, const Spectrum &scale)
+        : BxDF(bxdf->type),
+          bxdf(bxdf),
+          stats(stats),
+          alpha(alpha),
+          eta(eta),
+          sigma_a(sigma_a),
+          scale(scale) {}
+    Spectrum f(const Vector3f &wo, const Vector3f &wi) const {
+        return Transmittance(wo) * Transmittance(wi) * scale * bxdf->f(wo, wi);
+    }
+    Spectrum Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &u,
+                      Float *pdf, BxDFType *sampledType) const {
+        Spectrum f = bxdf->Sample_f(wo, wi, u, pdf, sampledType);
+        if (f.IsBlack()) return f;
+        return Transmittance(wo) * Transmittance(*wi) * scale * f;
+    }
+    Float Pdf(const Vector3f &wo, const Vector3f &wi) const {
+        return bxdf->Pdf(wo, wi);
+    }
+    Float EstimateAlbedo(const Vector3f &wo) const {
+        return (Transmittance(wo) * scale).MaxComponentValue() *
+               bxdf->EstimateAlbedo(wo);
+    }
+    std::string ToString() const {
+        return std::string("[ CoatedBxDF bxdf: ") + bxdf->ToString() +
+               StringPrintf(" alpha: %f eta: %f sigma_a: ", alpha, eta) +
+               sigma_a.ToString() + std::string(" scale: ") +
+               scale.ToString() + std::string(" ]");
+    }
+
+  private:
+    // CoatedBxDF Private Methods
+    Spectrum Transmittance(const Vector3f &w) const {
+        // Directions below the coating only interact with the base layer
+        Float cosTheta = CosTheta(w);
+        if (cosTheta <= 0) return Spectrum(1.f);
+
+        // Account for energy reflected by the coating's interface
+        Spectrum T(1 - stats->Albedo(cosTheta, alpha));
+        if (sigma_a.IsBlack()) return T;
+
+        // Attenuate by absorption along the refracted path through the coat
+        Float sin2ThetaT = (1 - cosTheta * cosTheta) / (eta * eta);
+        Float cosThetaT = std::sqrt(std::max((Float)0, 1 - sin2ThetaT));
+        return T * Exp(-sigma_a / cosThetaT);
+    }
+
+    // CoatedBxDF Private Data
+    BxDF *bxdf;
+    const LayerStatistics *stats;
+    const Float alpha, eta;
+    const Spectrum sigma_a, scale;
+};
+
+// LayeredMaterial Utility Functions
+static Float LayerSelectionSample(const SurfaceInteraction &si) {
+    // Hash the shading point and outgoing direction so that repeated
+    // evaluations at the same vertex select the same layer
+    uint64_t h = MixBits(FloatToBits(si.p.x));
+    h = MixBits(h ^ FloatToBits(si.p.y));
+    h = MixBits(h ^ FloatToBits(si.p.z));
+    h = MixBits(h ^ FloatToBits(si.wo.x));
+    h = MixBits(h ^ FloatToBits(si.wo.y));
+    h = MixBits(h ^ FloatToBits(si.wo.z));
+    return std::min((Float)(h >> 40) / (Float)(1 << 24), OneMinusEpsilon);
+}
+
+// LayerStatistics Method Definitions
+LayerStatistics::LayerStatistics(Float eta) {
+    ParallelFor([&](int a) {
+        // Tabulate directional albedo of the coating for roughness _alpha_
+        Float alpha = a / (Float)(nAlpha - 1);
+        const int sqrtSamples = 32, nSamples = sqrtSamples * sqrtSamples;
+        std::vector<Point2f> u(nSamples);
+        for (int i = 0; i < sqrtSamples; ++i)
+            for (int j = 0; j < sqrtSamples; ++j)
+                u[i * sqrtSamples + j] = Point2f((i + .5f) / sqrtSamples,
+                                                 (j + .5f) / sqrtSamples);
+        TrowbridgeReitzDistribution distrib(alpha, alpha);
+        FresnelDielectric fresnel(1.f, eta);
+        MicrofacetReflection coat(Spectrum(1.f), &distrib, &fresnel);
+        for (int c = 0; c < nCosTheta; ++c) {
+            Float cosTheta = std::max(c / (Float)(nCosTheta - 1), (Float)1e-3);
+            Vector3f wo(std::sqrt(1 - cosTheta * cosTheta), 0, cosTheta);
+            Float r = (a == 0) ? FrDielectric(cosTheta, 1, eta)
+                               : coat.rho(wo, nSamples, &u[0])[0];
+            albedo[a][c] = Clamp(r, 0, 1);
+        }
+    }, nAlpha);
+    ++nLayerStatistics;
+}
+
+Float LayerStatistics::Albedo(Float cosTheta, Float alpha) const {
+    // Bilinearly interpolate tabulated coating albedo
+    Float x = Clamp(cosTheta, 0, 1) * (nCosTheta - 1);
+    Float y = Clamp(alpha, 0, 1) * (nAlpha - 1);
+    int x0 = std::min((int)x, nCosTheta - 2), y0 = std::min((int)y, nAlpha - 2);
+    Float dx = x - x0, dy = y - y0;
+    return Lerp(dy, Lerp(dx, albedo[y0][x0], albedo[y0][x0 + 1]),
+                Lerp(dx, albedo[y0 + 1][x0], albedo[y0 + 1][x0 + 1]));
+}
+
+std::shared_ptr<const LayerStatistics> GetLayerStatistics(Float eta) {
+    static std::mutex mutex;
+    static std::map<Float, std::shared_ptr<const LayerStatistics>> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const LayerStatistics> &stats = cache[eta];
+    if (!stats) stats = std::make_shared<LayerStatistics>(eta);
+    return stats;
+}
+
+// LayeredMaterial Method Definitions
+void LayeredMaterial::ComputeScatteringFunctions(
+    SurfaceInteraction *si, MemoryArena &arena, TransportMode mode,
+    bool allowMultipleLobes) const {
+    // Perform bump mapping with _bumpMap_, if present
+    if (bumpMap) Bump(bumpMap, si);
+
+    // Initialize the coating's reflection lobe
+    Float rough = roughness->Evaluate(*si);
+    bool isSpecular = rough == 0;
+    Float alpha = 0;
+    if (!isSpecular)
+        alpha = remapRoughness
+                    ? TrowbridgeReitzDistribution::RoughnessToAlpha(rough)
+                    : rough;
+    Fresnel *fresnel = ARENA_ALLOC(arena, FresnelDielectric)(1.f, eta);
+    BxDF *coat;
+    if (isSpecular)
+        coat = ARENA_ALLOC(arena, SpecularReflection)(Spectrum(1.f), fresnel);
+    else
+        coat = ARENA_ALLOC(arena, MicrofacetReflection)(
+            Spectrum(1.f),
+            ARENA_ALLOC(arena, TrowbridgeReitzDistribution)(alpha, alpha),
+            fresnel);
+
+    // Stochastically choose a single layer to evaluate, if requested
+    Float pCoat = 0;
+    if (stochastic) {
+        Float cosThetaO = AbsDot(si->wo, si->shading.n);
+        pCoat = Clamp(stats->Albedo(cosThetaO, alpha), .05f, .95f);
+        if (LayerSelectionSample(*si) < pCoat) {
+            si->bsdf = ARENA_ALLOC(arena, BSDF)(*si);
+            si->bsdf->Add(
+                ARENA_ALLOC(arena, ScaledBxDF)(coat, Spectrum(1 / pCoat)));
+            return;
+        }
+    }
+
+    // Evaluate the base material and attenuate its lobes by the coating
+    base->ComputeScatteringFunctions(si, arena, mode, allowMultipleLobes);
+    Spectrum sig_a =
+        sigma_a->Evaluate(*si).Clamp() * std::max((Float)0,
+                                                  thickness->Evaluate(*si));
+    Spectrum scale(1 / (1 - pCoat));
+    int n = si->bsdf->NumComponents();
+    for (int i = 0; i < n; ++i)
+        si->bsdf->bxdfs[i] = ARENA_ALLOC(arena, CoatedBxDF)(
+            si->bsdf->bxdfs[i], stats.get(), alpha, eta, sig_a, scale);
+    if (!stochastic) {
+        if (n < BSDF::MaxBxDFs)
+            si->bsdf->Add(coat);
+        else
+            Warning("Base material has too many BxDFs to add coating.");
+    }
+}
+
+LayeredMaterial *CreateLayeredMaterial(const TextureParams &mp,
+                                       const std::shared_ptr<Material> &base) {
+    Float eta = mp.FindFloat("eta", 1.5f);
+    std::shared_ptr<Texture<Float>> roughness =
+        mp.GetFloatTexture("roughness", 0.f);
+    std::shared_ptr<Texture<Spectrum>> sigma_a =
+        mp.GetSpectrumTexture("sigma_a", Spectrum(0.f));
+    std::shared_ptr<Texture<Float>> thickness =
+        mp.GetFloatTexture("thickness", 1.f);
+    std::shared_ptr<Texture<Float>> bumpMap =
+        mp.GetFloatTextureOrNull("bumpmap");
+    bool remapRoughness = mp.FindBool("remaproughness", true);
+    bool stochastic = mp.FindBool("stochastic", false);
+    return new LayeredMaterial(base, eta, roughness, sigma_a, thickness,
+                               bumpMap, remapRoughness, stochastic);
+}
+
+}  // namespace pbrt
@@ -0,0 +1,102 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_MATERIALS_LAYERED_H
+#define PBRT_MATERIALS_LAYERED_H
+
+// materials/layered.h*
+#include "pbrt.h"
+#include "material.h"
+
+namespace pbrt {
+
+// LayerStatistics Declarations
+class LayerStatistics {
+  public:
+    // LayerStatistics Public Methods
+    LayerStatistics(Float eta);
+    Float Albedo(Float cosTheta, Float alpha) const;
+
+  private:
+    // LayerStatistics Private Data
+    static PBRT_CONSTEXPR int nCosTheta = 32, nAlpha = 16;
+    Float albedo[nAlpha][nCosTheta];
+};
+
+std::shared_ptr<const LayerStatistics> GetLayerStatistics(Float eta);
+
+// LayeredMaterial Declarations
+class LayeredMaterial : public Material {
+  public:
+    // LayeredMaterial Public Methods
+    LayeredMaterial(const std::shared_ptr<Material> &base, Float eta,
+                    const std::shared_ptr<Texture<Float>> &roughness,
+                    const std::shared_ptr<Texture<Spectrum>> &sigma_a,
+                    const std::shared_ptr<Texture<Float>> &thickness,
+                    const std::shared_ptr<Texture<Float>> &bumpMap,
+                    bool remapRoughness, bool stochastic)
+        : base(base),
+          eta(eta),
+          roughness(roughness),
+          sigma_a(sigma_a),
+          thickness(thickness),
+          bumpMap(bumpMap),
+          remapRoughness(remapRoughness),
+          stochastic(stochastic),
+          stats(GetLayerStatistics(eta)) {}
+    void ComputeScatteringFunctions(SurfaceInteraction *si, MemoryArena &arena,
+                                    TransportMode mode,
+                                    bool allowMultipleLobes) const;
+
+  private:
+    // LayeredMaterial Private Data
+    std::shared_ptr<Material> base;
+    const Float eta;
+    std::shared_ptr<Texture<Float>> roughness;
+    std::shared_ptr<Texture<Spectrum>> sigma_a;
+    std::shared_ptr<Texture<Float>> thickness;
+    std::shared_ptr<Texture<Float>> bumpMap;
+    const bool remapRoughness, stochastic;
+    std::shared_ptr<const LayerStatistics> stats;
+};
+
+LayeredMaterial *CreateLayeredMaterial(const TextureParams &mp,
+                                       const std::shared_ptr<Material> &base);
+
+}  // namespace pbrt
+
+#endif  // PBRT_MATERIALS_LAYERED_H
@@ -93,8 +93,12 @@ void SubsurfaceMaterial::ComputeScatteringFunctions(
     }
     Spectrum sig_a = scale * sigma_a->Evaluate(*si).Clamp();
     Spectrum sig_s = scale * sigma_s->Evaluate(*si).Clamp();
-    si->bssrdf = ARENA_ALLOC(arena, TabulatedBSSRDF)(*si, this, mode, eta,
-                                                     sig_a, sig_s, table);
+    if (randomWalk)
+        si->bssrdf = ARENA_ALLOC(arena, RandomWalkBSSRDF)(
+            *si, this, mode, eta, sig_a, sig_s, g, maxWalkBounces);
+    else
+        si->bssrdf = ARENA_ALLOC(arena, TabulatedBSSRDF)(*si, this, mode, eta,
+                                                         sig_a, sig_s, *table);
 }
 
 SubsurfaceMaterial *CreateSubsurfaceMaterial(const TextureParams &mp) {
@@ -130,8 +134,16 @@ SubsurfaceMaterial *CreateSubsurfaceMaterial(const TextureParams &mp) {
     std::shared_ptr<Texture<Float>> bumpMap =
         mp.GetFloatTextureOrNull("bumpmap");
     bool remapRoughness = mp.FindBool("remaproughness", true);
+    std::string method = mp.FindString("method", "diffusion");
+    if (method != "diffusion" && method != "randomwalk") {
+        Warning("Subsurface method \"%s\" unknown. Using \"diffusion\".",
+                method.c_str());
+        method = "diffusion";
+    }
+    int maxWalkBounces = mp.FindInt("maxwalkbounces", 256);
     return new SubsurfaceMaterial(scale, Kr, Kt, sigma_a, sigma_s, g, eta,
-                                  roughu, roughv, bumpMap, remapRoughness);
+                                  roughu, roughv, bumpMap, remapRoughness,
+                                  method == "randomwalk", maxWalkBounces);
 }
 
 }  // namespace pbrt
@@ -59,7 +59,8 @@ class SubsurfaceMaterial : public Material {
                        const std::shared_ptr<Texture<Float>> &uRoughness,
                        const std::shared_ptr<Texture<Float>> &vRoughness,
                        const std::shared_ptr<Texture<Float>> &bumpMap,
-                       bool remapRoughness)
+                       bool remapRoughness, bool randomWalk,
+                       int maxWalkBounces)
         : scale(scale),
           Kr(Kr),
           Kt(Kt),
@@ -69,9 +70,11 @@ class SubsurfaceMaterial : public Material {
           vRoughness(vRoughness),
           bumpMap(bumpMap),
           eta(eta),
+          g(g),
           remapRoughness(remapRoughness),
-          table(100, 64) {
-        ComputeBeamDiffusionBSSRDF(g, eta, &table);
+          randomWalk(randomWalk),
+          maxWalkBounces(maxWalkBounces) {
+        if (!randomWalk) table = GetBeamDiffusionBSSRDFTable(g, eta);
     }
     void ComputeScatteringFunctions(SurfaceInteraction *si, MemoryArena &arena,
                                     TransportMode mode,
@@ -83,9 +86,10 @@ class SubsurfaceMaterial : public Material {
     std::shared_ptr<Texture<Spectrum>> Kr, Kt, sigma_a, sigma_s;
     std::shared_ptr<Texture<Float>> uRoughness, vRoughness;
     std::shared_ptr<Texture<Float>> bumpMap;
-    const Float eta;
-    const bool remapRoughness;
-    BSSRDFTable table;
+    const Float eta, g;
+    const bool remapRoughness, randomWalk;
+    const int maxWalkBounces;
+    std::shared_ptr<const BSSRDFTable> table;
 };
 
 SubsurfaceMaterial *CreateSubsurfaceMaterial(const TextureParams &mp);
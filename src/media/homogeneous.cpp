@@ -50,29 +50,18 @@ Spectrum HomogeneousMedium::Sample(const Ray &ray, Sampler &sampler,
                                    MemoryArena &arena,
                                    MediumInteraction *mi) const {
     ProfilePhase _(Prof::MediumSample);
-    // Sample a channel and distance along the ray
-    int channel = std::min((int)(sampler.Get1D() * Spectrum::nSamples),
-                           Spectrum::nSamples - 1);
-    Float dist = -std::log(1 - sampler.Get1D()) / sigma_t[channel];
-    Float t = std::min(dist / ray.d.Length(), ray.tMax);
-    bool sampledMedium = t < ray.tMax;
+    // Sample a distance along the ray using the shared free-flight sampler
+    Float uChannel = sampler.Get1D();
+    Float uDist = sampler.Get1D();
+    Float rayLength = ray.d.Length(), dist;
+    bool sampledMedium;
+    Spectrum beta = SampleHomogeneousFreeFlight(
+        sigma_t, sigma_s, ray.tMax * rayLength, Point2f(uChannel, uDist),
+        &dist, &sampledMedium);
     if (sampledMedium)
-        *mi = MediumInteraction(ray(t), -ray.d, ray.time, this,
+        *mi = MediumInteraction(ray(dist / rayLength), -ray.d, ray.time, this,
                                 ARENA_ALLOC(arena, HenyeyGreenstein)(g));
-
-    // Compute the transmittance and sampling density
-    Spectrum Tr = Exp(-sigma_t * std::min(t, MaxFloat) * ray.d.Length());
-
-    // Return weighting factor for scattering from homogeneous medium
-    Spectrum density = sampledMedium ? (sigma_t * Tr) : Tr;
-    Float pdf = 0;
-    for (int i = 0; i < Spectrum::nSamples; ++i) pdf += density[i];
-    pdf *= 1 / (Float)Spectrum::nSamples;
-    if (pdf == 0) {
-        CHECK(Tr.IsBlack());
-        pdf = 1;
-    }
-    return sampledMedium ? (Tr * sigma_s / pdf) : (Tr / pdf);
+    return beta;
 }
 
 }  // namespace pbrt
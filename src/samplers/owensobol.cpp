@@ -0,0 +1,146 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+// samplers/owensobol.cpp*
+#include "samplers/owensobol.h"
+#include "lowdiscrepancy.h"
+#include "paramset.h"
+#include "stats.h"
+
+namespace pbrt {
+
+// OwenSobolSampler Local Definitions
+
+// Converts 32 fixed-point bits to a Float in $[0,1)$
+static Float ToFloat(uint32_t v) {
+    return std::min(v * Float(2.3283064365386963e-10), OneMinusEpsilon);
+}
+
+// OwenSobolSampler Method Definitions
+OwenSobolSampler::OwenSobolSampler(int64_t samplesPerPixel, int seed)
+    : Sampler(RoundUpPow2(samplesPerPixel)), seed(seed) {
+    if (!IsPowerOf2(samplesPerPixel))
+        Warning("Non power-of-two sample count rounded up to %" PRId64
+                " for OwenSobolSampler.",
+                this->samplesPerPixel);
+}
+
+uint64_t OwenSobolSampler::DimensionHash(int64_t dim) const {
+    return MixBits(pixelHash + uint64_t(dim) * 0x9e3779b97f4a7c15ull);
+}
+
+// The sample index is shuffled with a nested scramble of its low bits,
+// _indexMask_, which permutes the indices below each power of two; keeping
+// the shuffled index small also bounds the work in SobolSampleBits32().
+Float OwenSobolSampler::SampleDimension(uint32_t index, uint32_t indexMask,
+                                        uint64_t hash) const {
+    // Shuffle the sample index, then scramble the first Sobol$'$ dimension
+    uint32_t i = OwenScramble(index, uint32_t(hash)) & indexMask;
+    return ToFloat(OwenScramble(ReverseBits32(i), uint32_t(hash >> 32)));
+}
+
+Point2f OwenSobolSampler::SampleDimensions(uint32_t index, uint32_t indexMask,
+                                           uint64_t hash) const {
+    // Shuffle the sample index, then scramble the first two Sobol$'$
+    // dimensions independently
+    uint32_t i = OwenScramble(index, uint32_t(hash)) & indexMask;
+    uint64_t scrambleHash = MixBits(hash);
+    return Point2f(
+        ToFloat(OwenScramble(ReverseBits32(i), uint32_t(hash >> 32))),
+        ToFloat(OwenScramble(SobolSampleBits32(i, 1), uint32_t(scrambleHash))));
+}
+
+void OwenSobolSampler::StartPixel(const Point2i &p) {
+    ProfilePhase _(Prof::StartPixel);
+    pixelHash = MixBits(((uint64_t(uint32_t(p.x)) << 32) | uint32_t(p.y)) ^
+                        MixBits(uint64_t(uint32_t(seed))));
+    dimension = 0;
+
+    // Generate sample arrays, using negative dimensions to keep them apart
+    // from the ones returned by Get1D() and Get2D(); the samples for each
+    // pixel sample are an aligned power-of-two block of indices, so they
+    // are stratified with respect to each other.
+    for (size_t i = 0; i < sampleArray1D.size(); ++i) {
+        uint64_t hash = DimensionHash(-1 - int64_t(i));
+        uint32_t mask = uint32_t(sampleArray1D[i].size() - 1);
+        for (size_t j = 0; j < sampleArray1D[i].size(); ++j)
+            sampleArray1D[i][j] = SampleDimension(j, mask, hash);
+    }
+    for (size_t i = 0; i < sampleArray2D.size(); ++i) {
+        uint64_t hash = DimensionHash(-1 - int64_t(sampleArray1D.size() + i));
+        uint32_t mask = uint32_t(sampleArray2D[i].size() - 1);
+        for (size_t j = 0; j < sampleArray2D[i].size(); ++j)
+            sampleArray2D[i][j] = SampleDimensions(j, mask, hash);
+    }
+    Sampler::StartPixel(p);
+}
+
+bool OwenSobolSampler::StartNextSample() {
+    dimension = 0;
+    return Sampler::StartNextSample();
+}
+
+bool OwenSobolSampler::SetSampleNumber(int64_t sampleNum) {
+    dimension = 0;
+    return Sampler::SetSampleNumber(sampleNum);
+}
+
+Float OwenSobolSampler::Get1D() {
+    ProfilePhase _(Prof::GetSample);
+    CHECK_LT(currentPixelSampleIndex, samplesPerPixel);
+    return SampleDimension(currentPixelSampleIndex, samplesPerPixel - 1,
+                           DimensionHash(dimension++));
+}
+
+Point2f OwenSobolSampler::Get2D() {
+    ProfilePhase _(Prof::GetSample);
+    CHECK_LT(currentPixelSampleIndex, samplesPerPixel);
+    return SampleDimensions(currentPixelSampleIndex, samplesPerPixel - 1,
+                            DimensionHash(dimension++));
+}
+
+std::unique_ptr<Sampler> OwenSobolSampler::Clone(int seed) {
+    // The samples only depend on the pixel, so the seed is ignored; this
+    // keeps the sample indices of a pixel consistent when integrators
+    // render them over multiple iterations with different clones.
+    return std::unique_ptr<Sampler>(new OwenSobolSampler(*this));
+}
+
+OwenSobolSampler *CreateOwenSobolSampler(const ParamSet &params) {
+    int nsamp = params.FindOneInt("pixelsamples", 16);
+    int seed = params.FindOneInt("seed", 0);
+    if (PbrtOptions.quickRender) nsamp = 1;
+    return new OwenSobolSampler(nsamp, seed);
+}
+
+}  // namespace pbrt
@@ -0,0 +1,86 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_SAMPLERS_OWENSOBOL_H
+#define PBRT_SAMPLERS_OWENSOBOL_H
+
+// samplers/owensobol.h*
+#include "sampler.h"
+
+namespace pbrt {
+
+// OwenSobolSampler Declarations
+
+// OwenSobolSampler generates each pixel's samples from the first two
+// dimensions of the Sobol$'$ sequence with hash-based Owen scrambling.
+// Every call to Get1D() or Get2D() hashes the pixel, the dimension and the
+// seed to shuffle the sample indices and to scramble the sample values, so
+// that dimensions and pixels are decorrelated. Any sample in any
+// dimension is computed on demand without per-pixel tables or index
+// searches. Because the shuffle is a nested scramble of the index, each
+// power-of-two prefix of a pixel's samples is well stratified too.
+class OwenSobolSampler : public Sampler {
+  public:
+    // OwenSobolSampler Public Methods
+    OwenSobolSampler(int64_t samplesPerPixel, int seed = 0);
+    void StartPixel(const Point2i &p);
+    bool StartNextSample();
+    bool SetSampleNumber(int64_t sampleNum);
+    Float Get1D();
+    Point2f Get2D();
+    int RoundCount(int count) const { return RoundUpPow2(count); }
+    std::unique_ptr<Sampler> Clone(int seed);
+
+  private:
+    // OwenSobolSampler Private Methods
+    uint64_t DimensionHash(int64_t dim) const;
+    Float SampleDimension(uint32_t index, uint32_t indexMask,
+                          uint64_t hash) const;
+    Point2f SampleDimensions(uint32_t index, uint32_t indexMask,
+                             uint64_t hash) const;
+
+    // OwenSobolSampler Private Data
+    const int seed;
+    uint64_t pixelHash;
+    int dimension;
+};
+
+OwenSobolSampler *CreateOwenSobolSampler(const ParamSet &params);
+
+}  // namespace pbrt
+
+#endif  // PBRT_SAMPLERS_OWENSOBOL_H
@@ -0,0 +1,196 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+// samplers/zsobol.cpp*
+#include "samplers/zsobol.h"
+#include "lowdiscrepancy.h"
+#include "paramset.h"
+#include "stats.h"
+
+namespace pbrt {
+
+// ZSobolSampler Local Definitions
+static inline uint64_t LeftShift2(uint64_t x) {
+    x &= 0xffffffff;
+    x = (x ^ (x << 16)) & 0x0000ffff0000ffff;
+    x = (x ^ (x << 8)) & 0x00ff00ff00ff00ff;
+    x = (x ^ (x << 4)) & 0x0f0f0f0f0f0f0f0f;
+    x = (x ^ (x << 2)) & 0x3333333333333333;
+    x = (x ^ (x << 1)) & 0x5555555555555555;
+    return x;
+}
+
+static inline uint64_t EncodeMorton2(uint32_t x, uint32_t y) {
+    return (LeftShift2(y) << 1) | LeftShift2(x);
+}
+
+static Float ToFloat(uint32_t v) {
+    return std::min(v * Float(2.3283064365386963e-10), OneMinusEpsilon);
+}
+
+// All permutations of four base-4 digits
+static const uint8_t Base4Permutations[24][4] = {
+    {0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 1, 3}, {0, 2, 3, 1}, {0, 3, 2, 1},
+    {0, 3, 1, 2}, {1, 0, 2, 3}, {1, 0, 3, 2}, {1, 2, 0, 3}, {1, 2, 3, 0},
+    {1, 3, 2, 0}, {1, 3, 0, 2}, {2, 1, 0, 3}, {2, 1, 3, 0}, {2, 0, 1, 3},
+    {2, 0, 3, 1}, {2, 3, 0, 1}, {2, 3, 1, 0}, {3, 1, 2, 0}, {3, 1, 0, 2},
+    {3, 2, 1, 0}, {3, 2, 0, 1}, {3, 0, 2, 1}, {3, 0, 1, 2}};
+
+// ZSobolSampler Method Definitions
+ZSobolSampler::ZSobolSampler(int64_t samplesPerPixel,
+                             const Bounds2i &sampleBounds, int seed)
+    : Sampler(RoundUpPow2(samplesPerPixel)),
+      sampleBounds(sampleBounds),
+      seed(seed) {
+    if (!IsPowerOf2(samplesPerPixel))
+        Warning("Non power-of-two sample count rounded up to %" PRId64
+                " for ZSobolSampler.",
+                this->samplesPerPixel);
+    log2SamplesPerPixel = Log2Int(this->samplesPerPixel);
+    int resolution = RoundUpPow2(
+        std::max(sampleBounds.Diagonal().x, sampleBounds.Diagonal().y));
+    int log2Resolution = Log2Int(std::max(resolution, 1));
+    nBase4Digits = log2Resolution + (log2SamplesPerPixel + 1) / 2;
+    CHECK_LE(2 * nBase4Digits, SobolMatrixSize);
+}
+
+uint64_t ZSobolSampler::GetSampleIndex(int64_t pixelSample,
+                                       int64_t dim) const {
+    uint64_t mortonIndex =
+        (pixelMortonIndex << log2SamplesPerPixel) | uint64_t(pixelSample);
+    uint64_t dimHash = (0x55555555u * uint64_t(dim)) ^ uint64_t(uint32_t(seed));
+
+    // Randomly permute the base-4 digits of _mortonIndex_, choosing each
+    // digit's permutation from the digits above it
+    uint64_t sampleIndex = 0;
+    bool pow2Samples = log2SamplesPerPixel & 1;
+    int lastDigit = pow2Samples ? 1 : 0;
+    for (int i = nBase4Digits - 1; i >= lastDigit; --i) {
+        int digitShift = 2 * i - (pow2Samples ? 1 : 0);
+        int digit = (mortonIndex >> digitShift) & 3;
+        uint64_t higherDigits = mortonIndex >> (digitShift + 2);
+        int p = (MixBits(higherDigits ^ dimHash) >> 24) % 24;
+        digit = Base4Permutations[p][digit];
+        sampleIndex |= uint64_t(digit) << digitShift;
+    }
+
+    // Handle the remaining bit for sample counts that are powers of two
+    // but not of four
+    if (pow2Samples) {
+        int digit = mortonIndex & 1;
+        sampleIndex |= digit ^ (MixBits((mortonIndex >> 1) ^ dimHash) & 1);
+    }
+    return sampleIndex;
+}
+
+Point2f ZSobolSampler::SampleDimensions(uint64_t index, int64_t dim) const {
+    // Owen-scramble the first two Sobol$'$ dimensions with seeds that only
+    // depend on the dimension, so that all pixels share one sequence
+    uint64_t hash = MixBits((uint64_t(dim) << 32) ^ uint32_t(seed));
+    return Point2f(ToFloat(OwenScramble(SobolSampleBits32(index, 0),
+                                        uint32_t(hash))),
+                   ToFloat(OwenScramble(SobolSampleBits32(index, 1),
+                                        uint32_t(hash >> 32))));
+}
+
+void ZSobolSampler::StartPixel(const Point2i &p) {
+    ProfilePhase _(Prof::StartPixel);
+    Vector2i pi = p - sampleBounds.pMin;
+    pixelMortonIndex = EncodeMorton2(pi.x, pi.y);
+    dimension = 0;
+
+    // Generate sample arrays: each pixel sample's array values are an
+    // aligned block of Sobol$'$ points following the sample's index
+    // for a dimension that isn't used by Get1D() or Get2D().
+    for (size_t i = 0; i < sampleArray1D.size(); ++i) {
+        int64_t dim = -1 - int64_t(i);
+        int n = samples1DArraySizes[i], log2n = Log2Int(n);
+        for (int64_t s = 0; s < samplesPerPixel; ++s) {
+            uint64_t base = GetSampleIndex(s, dim) << log2n;
+            for (int j = 0; j < n; ++j)
+                sampleArray1D[i][s * n + j] = SampleDimensions(base | j, dim).x;
+        }
+    }
+    for (size_t i = 0; i < sampleArray2D.size(); ++i) {
+        int64_t dim = -1 - int64_t(sampleArray1D.size() + i);
+        int n = samples2DArraySizes[i], log2n = Log2Int(n);
+        for (int64_t s = 0; s < samplesPerPixel; ++s) {
+            uint64_t base = GetSampleIndex(s, dim) << log2n;
+            for (int j = 0; j < n; ++j)
+                sampleArray2D[i][s * n + j] = SampleDimensions(base | j, dim);
+        }
+    }
+    Sampler::StartPixel(p);
+}
+
+bool ZSobolSampler::StartNextSample() {
+    dimension = 0;
+    return Sampler::StartNextSample();
+}
+
+bool ZSobolSampler::SetSampleNumber(int64_t sampleNum) {
+    dimension = 0;
+    return Sampler::SetSampleNumber(sampleNum);
+}
+
+Float ZSobolSampler::Get1D() {
+    ProfilePhase _(Prof::GetSample);
+    CHECK_LT(currentPixelSampleIndex, samplesPerPixel);
+    int dim = dimension++;
+    uint64_t index = GetSampleIndex(currentPixelSampleIndex, dim);
+    uint64_t hash = MixBits((uint64_t(dim) << 32) ^ uint32_t(seed));
+    return ToFloat(OwenScramble(SobolSampleBits32(index, 0), uint32_t(hash)));
+}
+
+Point2f ZSobolSampler::Get2D() {
+    ProfilePhase _(Prof::GetSample);
+    CHECK_LT(currentPixelSampleIndex, samplesPerPixel);
+    int dim = dimension++;
+    return SampleDimensions(GetSampleIndex(currentPixelSampleIndex, dim), dim);
+}
+
+std::unique_ptr<Sampler> ZSobolSampler::Clone(int seed) {
+    // As with the other Sobol$'$ samplers, the samples are fully determined
+    // by the pixel and the sample index, so the seed is ignored
+    return std::unique_ptr<Sampler>(new ZSobolSampler(*this));
+}
+
+ZSobolSampler *CreateZSobolSampler(const ParamSet &params,
+                                   const Bounds2i &sampleBounds) {
+    int nsamp = params.FindOneInt("pixelsamples", 16);
+    int seed = params.FindOneInt("seed", 0);
+    if (PbrtOptions.quickRender) nsamp = 1;
+    return new ZSobolSampler(nsamp, sampleBounds, seed);
+}
+
+}  // namespace pbrt
@@ -0,0 +1,93 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_SAMPLERS_ZSOBOL_H
+#define PBRT_SAMPLERS_ZSOBOL_H
+
+// samplers/zsobol.h*
+#include "sampler.h"
+
+namespace pbrt {
+
+// ZSobolSampler Declarations
+
+// ZSobolSampler implements Ahmed and Wonka's "Screen-Space Blue-Noise
+// Diffusion of Monte Carlo Sampling Error via Hierarchical Ordering of
+// Pixels": pixels are ordered along a Morton curve and assigned
+// consecutive blocks of a single Owen-scrambled Sobol$'$ sequence, with
+// the base-4 digits of the sample indices randomly permuted for each
+// dimension. Neighboring pixels thus get well-distributed samples, which
+// spreads the error as blue noise. Each sample of a pixel is found
+// directly from its index, so the samples may be split across any number
+// of rendering iterations with SetSampleNumber(). Every power-of-two
+// prefix of a pixel's samples is stratified in 1D, but prefixes are only
+// stratified in 2D when they cover whole base-4 digits of the sample
+// index: $4^k$ samples when _samplesPerPixel_ is a power of four and
+// $2 \cdot 4^k$ samples otherwise.
+class ZSobolSampler : public Sampler {
+  public:
+    // ZSobolSampler Public Methods
+    ZSobolSampler(int64_t samplesPerPixel, const Bounds2i &sampleBounds,
+                  int seed = 0);
+    void StartPixel(const Point2i &p);
+    bool StartNextSample();
+    bool SetSampleNumber(int64_t sampleNum);
+    Float Get1D();
+    Point2f Get2D();
+    int RoundCount(int count) const { return RoundUpPow2(count); }
+    std::unique_ptr<Sampler> Clone(int seed);
+
+  private:
+    // ZSobolSampler Private Methods
+    uint64_t GetSampleIndex(int64_t pixelSample, int64_t dim) const;
+    Point2f SampleDimensions(uint64_t index, int64_t dim) const;
+
+    // ZSobolSampler Private Data
+    const Bounds2i sampleBounds;
+    const int seed;
+    int log2SamplesPerPixel, nBase4Digits;
+    uint64_t pixelMortonIndex;
+    int dimension;
+};
+
+ZSobolSampler *CreateZSobolSampler(const ParamSet &params,
+                                   const Bounds2i &sampleBounds);
+
+}  // namespace pbrt
+
+#endif  // PBRT_SAMPLERS_ZSOBOL_H
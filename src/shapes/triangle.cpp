@@ -579,6 +579,22 @@ Float Triangle::Area() const {
     return 0.5 * Cross(p1 - p0, p2 - p0).Length();
 }
 
+DirectionCone Triangle::NormalBounds() const {
+    // Get triangle vertices in _p0_, _p1_, and _p2_
+    const Point3f &p0 = mesh->p[v[0]];
+    const Point3f &p1 = mesh->p[v[1]];
+    const Point3f &p2 = mesh->p[v[2]];
+    Normal3f n = Normalize(Normal3f(Cross(p1 - p0, p2 - p0)));
+    // Orient the normal as in Triangle::Sample(), using the shading normal at
+    // the triangle's center
+    if (mesh->n) {
+        Normal3f ns(mesh->n[v[0]] + mesh->n[v[1]] + mesh->n[v[2]]);
+        n = Faceforward(n, ns);
+    } else if (reverseOrientation ^ transformSwapsHandedness)
+        n *= -1;
+    return DirectionCone(Vector3f(n), 1);
+}
+
 Interaction Triangle::Sample(const Point2f &u, Float *pdf) const {
     Point2f b = UniformSampleTriangle(u);
     // Get triangle vertices in _p0_, _p1_, and _p2_
@@ -644,6 +660,101 @@ Float Triangle::SolidAngle(const Point3f &p, int nSamples) const {
         std::acos(Clamp(Dot(cross20, -cross01), -1, 1)) - Pi);
 }
 
+// Vector3's Length() and division compute in Float, so these helpers keep
+// the full precision of double-precision vectors.
+static double Length(const Vector3<double> &v) { return std::sqrt(Dot(v, v)); }
+
+static Vector3<double> Normalize(const Vector3<double> &v) {
+    return (1 / Length(v)) * v;
+}
+
+// Returns the angle between the normalized vectors |v1| and |v2|, computed
+// in a way that's accurate for nearly parallel and anti-parallel vectors.
+static double AngleBetween(const Vector3<double> &v1,
+                           const Vector3<double> &v2) {
+    if (Dot(v1, v2) < 0)
+        return Pi - 2 * std::asin(std::min(1., Length(v1 + v2) / 2));
+    return 2 * std::asin(std::min(1., Length(v2 - v1) / 2));
+}
+
+bool Triangle::SampleSolidAngle(const Point3f &p, const Point2f &u,
+                                Interaction *it) const {
+    const Point3f &p0 = mesh->p[v[0]];
+    const Point3f &p1 = mesh->p[v[1]];
+    const Point3f &p2 = mesh->p[v[2]];
+    Float pdf;
+    // Compute the normalized directions _a_, _b_, and _c_ to the vertices
+    // and the normals of the planes through each pair of them; the
+    // spherical trigonometry below loses too much precision for small
+    // triangles in single precision, so it's done in double precision.
+    // Degenerate spherical triangles are rejected rather than area
+    // sampled, since the caller's PDF assumes solid angle sampling.
+    auto toDouble = [](const Vector3f &v) {
+        return Vector3<double>(v.x, v.y, v.z);
+    };
+    Vector3<double> a = Normalize(toDouble(p0 - p)),
+                    b = Normalize(toDouble(p1 - p)),
+                    c = Normalize(toDouble(p2 - p));
+    Vector3<double> nab = Cross(a, b), nbc = Cross(b, c), nca = Cross(c, a);
+    if (Dot(nab, nab) == 0 || Dot(nbc, nbc) == 0 || Dot(nca, nca) == 0)
+        return false;
+    nab = Normalize(nab);
+    nbc = Normalize(nbc);
+    nca = Normalize(nca);
+
+    // Find the spherical triangle's angle at _a_ and its area
+    double alpha = AngleBetween(nab, -nca);
+    double area = 2 * std::atan2(std::abs(Dot(a, Cross(b, c))),
+                                 1 + Dot(a, b) + Dot(a, c) + Dot(b, c));
+
+    // Choose the area of the sub-triangle with vertices _a_, _b_, and
+    // _cp_ uniformly and find _cp_ on the arc from _a_ to _c_
+    double areaPlusPi = Pi + u[0] * area;
+    double cosAlpha = std::cos(alpha), sinAlpha = std::sin(alpha);
+    double sinPhi = std::sin(areaPlusPi) * cosAlpha -
+                    std::cos(areaPlusPi) * sinAlpha;
+    double cosPhi = std::cos(areaPlusPi) * cosAlpha +
+                    std::sin(areaPlusPi) * sinAlpha;
+    double k1 = cosPhi + cosAlpha;
+    double k2 = sinPhi - sinAlpha * Dot(a, b);
+    double cosBp = (k2 + (k2 * cosPhi - k1 * sinPhi) * cosAlpha) /
+                   ((k2 * sinPhi + k1 * cosPhi) * sinAlpha);
+    if (std::isnan(cosBp)) return false;
+    cosBp = Clamp(cosBp, -1, 1);
+    double sinBp = std::sqrt(std::max(0., 1 - cosBp * cosBp));
+    Vector3<double> cp = cosBp * a + sinBp * Normalize(c - Dot(c, a) * a);
+
+    // Choose the direction along the arc from _b_ to _cp_
+    double cosTheta = 1 - u[1] * (1 - Dot(cp, b));
+    double sinTheta = std::sqrt(std::max(0., 1 - cosTheta * cosTheta));
+    Vector3<double> wd = cosTheta * b;
+    Vector3<double> cpPerp = cp - Dot(cp, b) * b;
+    if (Dot(cpPerp, cpPerp) > 0) wd += sinTheta * Normalize(cpPerp);
+    Vector3f w(wd.x, wd.y, wd.z);
+
+    // Intersect the ray from _p_ along _w_ with the triangle's plane to
+    // find the barycentric coordinates of the sampled point
+    Vector3f e1 = p1 - p0, e2 = p2 - p0;
+    Vector3f s1 = Cross(w, e2);
+    Float divisor = Dot(s1, e1);
+    if (divisor == 0) return false;
+    Vector3f s = p - p0;
+    Float b1 = Clamp(Dot(s, s1) / divisor, 0, 1);
+    Float b2 = Clamp(Dot(w, Cross(s, e1)) / divisor, 0, 1);
+    if (b1 + b2 > 1) {
+        Float sum = b1 + b2;
+        b1 /= sum;
+        b2 /= sum;
+    }
+
+    // Use Sample() to compute the point's geometry, inverting the mapping
+    // from sample values to barycentrics that it uses
+    Float su0 = b1 + b2;
+    *it = Sample(Point2f(su0 * su0, (su0 > 0) ? Clamp(b1 / su0, 0, 1) : 0),
+                 &pdf);
+    return true;
+}
+
 std::vector<std::shared_ptr<Shape>> CreateTriangleMeshShape(
     const Transform *o2w, const Transform *w2o, bool reverseOrientation,
     const ParamSet &params,
@@ -92,6 +92,17 @@ class Triangle : public Shape {
     // Returns the solid angle subtended by the triangle w.r.t. the given
     // reference point p.
     Float SolidAngle(const Point3f &p, int nSamples = 0) const;
+    // Samples a point on the triangle uniformly with respect to the solid
+    // angle that it subtends from |p|, using Arvo's method for sampling
+    // spherical triangles; the PDF is one over SolidAngle(p). Returns
+    // false if the spherical triangle is too degenerate to sample, in
+    // which case the sample should be discarded.
+    bool SampleSolidAngle(const Point3f &p, const Point2f &u,
+                          Interaction *it) const;
+    DirectionCone NormalBounds() const;
+    const TriangleMesh *Mesh() const { return mesh.get(); }
+    // Returns the index of the triangle in its mesh.
+    int MeshIndex() const { return int(v - &mesh->vertexIndices[0]) / 3; }
 
   private:
     // Triangle Private Methods
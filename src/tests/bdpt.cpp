@@ -0,0 +1,79 @@
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "accelerators/bvh.h"
+#include "cameras/perspective.h"
+#include "filters/box.h"
+#include "film.h"
+#include "integrators/bdpt.h"
+#include "lights/point.h"
+#include "materials/matte.h"
+#include "primitive.h"
+#include "samplers/random.h"
+#include "sampling.h"
+#include "scene.h"
+#include "shapes/triangle.h"
+#include "textures/constant.h"
+
+using namespace pbrt;
+
+static std::shared_ptr<Camera> MakeCamera(int res) {
+    static Transform identity;
+    AnimatedTransform cameraTransform(&identity, 0, &identity, 1);
+    std::unique_ptr<Filter> filter(new BoxFilter(Vector2f(0.5, 0.5)));
+    Film *film = new Film(Point2i(res, res),
+                          Bounds2f(Point2f(0, 0), Point2f(1, 1)),
+                          std::move(filter), 1., "test.exr", 1.);
+    return std::make_shared<PerspectiveCamera>(
+        cameraTransform, Bounds2f(Point2f(-1, -1), Point2f(1, 1)), 0., 1., 0.,
+        10., 45, film, nullptr);
+}
+
+// Light subpaths are shared by every sample on the film, so the footprint
+// that each one covers should shrink as the film's resolution grows.
+TEST(BDPT, LightSubpathFootprint) {
+    static Transform identity;
+    const Float e = 100;
+    const Point3f p[4] = {Point3f(-e, -e, 0), Point3f(e, -e, 0),
+                          Point3f(e, e, 0), Point3f(-e, e, 0)};
+    const int indices[6] = {0, 1, 2, 0, 2, 3};
+    std::vector<std::shared_ptr<Shape>> triangles =
+        CreateTriangleMesh(&identity, &identity, false, 2, indices, 4, p,
+                           nullptr, nullptr, nullptr, nullptr, nullptr);
+    auto matte = std::make_shared<MatteMaterial>(
+        std::make_shared<ConstantTexture<Spectrum>>(Spectrum(.5f)),
+        std::make_shared<ConstantTexture<Float>>(0.f), nullptr);
+    std::vector<std::shared_ptr<Primitive>> prims;
+    for (const std::shared_ptr<Shape> &tri : triangles)
+        prims.push_back(std::make_shared<GeometricPrimitive>(
+            tri, matte, nullptr, MediumInterface()));
+    auto light = std::make_shared<PointLight>(
+        Translate(Vector3f(0, 0, 1)), MediumInterface(), Spectrum(1.f));
+    Scene scene(std::make_shared<BVHAccel>(prims), {light});
+    Float lightPower = 1;
+    Distribution1D lightDistr(&lightPower, 1);
+
+    // Returns the footprint of the first light subpath vertex that lands
+    // on the plane close to normal incidence, generating subpaths with the
+    // same samples each time.
+    auto footprint = [&](int res) -> Float {
+        std::shared_ptr<Camera> camera = MakeCamera(res);
+        RandomSampler sampler(256);
+        sampler.StartPixel(Point2i(0, 0));
+        MemoryArena arena;
+        do {
+            Vertex path[2];
+            if (GenerateLightSubpath(scene, sampler, arena, 2, 0, lightDistr,
+                                     *camera, path) == 2 &&
+                std::abs(path[1].p().x) < .25f &&
+                std::abs(path[1].p().y) < .25f)
+                return path[1].si.dpdx.Length();
+        } while (sampler.StartNextSample());
+        return 0;
+    };
+
+    Float small = footprint(16), large = footprint(64);
+    ASSERT_GT(small, 0);
+    ASSERT_GT(large, 0);
+    // Four times the resolution has sixteen times as many light subpaths.
+    EXPECT_NEAR(small / 4, large, .05f * small);
+}
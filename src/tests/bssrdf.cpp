@@ -0,0 +1,124 @@
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "accelerators/bvh.h"
+#include "bssrdf.h"
+#include "material.h"
+#include "memory.h"
+#include "primitive.h"
+#include "samplers/random.h"
+#include "scene.h"
+#include "shapes/triangle.h"
+
+using namespace pbrt;
+
+namespace {
+
+// Only the identity of the slab's material matters to the random walk.
+class SlabMaterial : public Material {
+  public:
+    void ComputeScatteringFunctions(SurfaceInteraction *si, MemoryArena &arena,
+                                    TransportMode mode,
+                                    bool allowMultipleLobes) const {}
+};
+
+// Random-walk reflectance and transmittance of a slab between z=0 and
+// z=-thickness for light entering at the origin.
+struct SlabEstimate {
+    Float R = 0, T = 0;
+};
+
+SlabEstimate WalkSlab(Float thickness, const Spectrum &sigma_a,
+                      const Spectrum &sigma_s, Float eta, int nSamples) {
+    static Transform identity;
+    const Float e = 1000;
+    const Point3f p[8] = {
+        Point3f(-e, -e, 0),          Point3f(e, -e, 0),
+        Point3f(e, e, 0),            Point3f(-e, e, 0),
+        Point3f(-e, -e, -thickness), Point3f(e, -e, -thickness),
+        Point3f(e, e, -thickness),   Point3f(-e, e, -thickness)};
+    const int indices[12] = {0, 1, 2, 0, 2, 3, 4, 6, 5, 4, 7, 6};
+    std::vector<std::shared_ptr<Shape>> triangles =
+        CreateTriangleMesh(&identity, &identity, false, 4, indices, 8, p,
+                           nullptr, nullptr, nullptr, nullptr, nullptr);
+    auto material = std::make_shared<SlabMaterial>();
+    MediumInterface mediumInterface;
+    std::vector<std::shared_ptr<Primitive>> prims;
+    for (const std::shared_ptr<Shape> &tri : triangles)
+        prims.push_back(std::make_shared<GeometricPrimitive>(
+            tri, material, nullptr, mediumInterface));
+    Scene scene(std::make_shared<BVHAccel>(prims), {});
+
+    SurfaceInteraction po(Point3f(0, 0, 0), Vector3f(0, 0, 0), Point2f(0, 0),
+                          Vector3f(0, 0, 1), Vector3f(1, 0, 0),
+                          Vector3f(0, 1, 0), Normal3f(), Normal3f(), 0,
+                          nullptr);
+    RandomWalkBSSRDF bssrdf(po, material.get(), TransportMode::Radiance, eta,
+                            sigma_a, sigma_s, 0, 256);
+    RandomSampler sampler(nSamples);
+    sampler.StartPixel(Point2i(0, 0));
+    MemoryArena arena;
+    SlabEstimate est;
+    do {
+        SurfaceInteraction pi;
+        Float pdf = 0;
+        Spectrum S = bssrdf.Sample_S(scene, sampler, arena, &pi, &pdf);
+        if (!S.IsBlack() && pdf > 0)
+            (pi.p.z > -thickness / 2 ? est.R : est.T) += S.y() / pdf;
+        arena.Reset();
+    } while (sampler.StartNextSample());
+    est.R /= nSamples;
+    est.T /= nSamples;
+    return est;
+}
+
+// Integrates f(mu) over cosine-distributed entry directions.
+template <typename F>
+Float CosineAverage(F f) {
+    const int n = 10000;
+    Float sum = 0;
+    for (int i = 0; i < n; ++i) {
+        Float mu = (i + .5f) / n;
+        sum += 2 * mu * f(mu) / n;
+    }
+    return sum;
+}
+
+}  // namespace
+
+// Without scattering and with a matched index, everything that isn't
+// absorbed leaves through the far side of the slab.
+TEST(RandomWalkBSSRDF, AbsorbingSlab) {
+    Float tau = 1;
+    SlabEstimate est = WalkSlab(1, Spectrum(tau), Spectrum(0.f), 1, 100000);
+    Float T = CosineAverage([&](Float mu) { return std::exp(-tau / mu); });
+    EXPECT_EQ(0, est.R);
+    EXPECT_NEAR(T, est.T, .01);
+}
+
+// With a dielectric boundary, light bounces between the slab's faces,
+// losing the fraction F to internal reflection at each one; the total
+// albedo is a geometric series for each direction.
+TEST(RandomWalkBSSRDF, AbsorbingSlabFresnel) {
+    Float tau = .5, eta = 1.5;
+    SlabEstimate est = WalkSlab(1, Spectrum(tau), Spectrum(0.f), eta, 100000);
+    Float albedo = CosineAverage([&](Float mu) {
+        Float F = FrDielectric(mu, eta, 1), tr = std::exp(-tau / mu);
+        return (1 - F) * tr / (1 - F * tr);
+    });
+    Float T = CosineAverage([&](Float mu) {
+        Float F = FrDielectric(mu, eta, 1), tr = std::exp(-tau / mu);
+        return (1 - F) * tr / (1 - F * F * tr * tr);
+    });
+    EXPECT_NEAR(T, est.T, .01);
+    EXPECT_NEAR(albedo - T, est.R, .005);
+}
+
+// A non-absorbing slab neither loses nor gains energy, however many
+// times light is reflected at its boundary.
+TEST(RandomWalkBSSRDF, NonAbsorbingSlab) {
+    SlabEstimate est =
+        WalkSlab(1, Spectrum(0.f), Spectrum(2.f), 1.33f, 20000);
+    EXPECT_GT(est.R, .1);
+    EXPECT_GT(est.T, .1);
+    EXPECT_NEAR(1, est.R + est.T, .01);
+}
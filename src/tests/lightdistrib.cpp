@@ -0,0 +1,260 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "accelerators/bvh.h"
+#include "lightdistrib.h"
+#include "lights/diffuse.h"
+#include "lights/distant.h"
+#include "lights/point.h"
+#include "lights/spot.h"
+#include "rng.h"
+#include "scene.h"
+#include "shapes/sphere.h"
+
+using namespace pbrt;
+
+// Checks that the light BVH's sampling probabilities agree with
+// DiscretePDF() for a mix of point, spot, area and distant lights.
+TEST(BVHLightDistribution, PDFsMatchSampling) {
+    RNG rng;
+    auto randomPoint = [&rng]() {
+        return Point3f(-10 + 20 * rng.UniformFloat(),
+                       -10 + 20 * rng.UniformFloat(),
+                       -10 + 20 * rng.UniformFloat());
+    };
+
+    MediumInterface mediumInterface;
+    std::vector<std::unique_ptr<Transform>> transforms;
+    std::vector<std::shared_ptr<Primitive>> prims;
+    std::vector<std::shared_ptr<Light>> lights;
+    for (int i = 0; i < 300; ++i) {
+        Point3f p = randomPoint();
+        Spectrum I(1 + 10 * rng.UniformFloat());
+        if (i % 3 == 0)
+            lights.push_back(std::make_shared<PointLight>(
+                Translate(Vector3f(p)), mediumInterface, I));
+        else if (i % 3 == 1)
+            lights.push_back(std::make_shared<SpotLight>(
+                Translate(Vector3f(p)) *
+                    Rotate(360 * rng.UniformFloat(), Vector3f(1, 1, 0)),
+                mediumInterface, I, 30, 20));
+        else {
+            transforms.push_back(std::unique_ptr<Transform>(
+                new Transform(Translate(Vector3f(p)))));
+            const Transform *o2w = transforms.back().get();
+            transforms.push_back(
+                std::unique_ptr<Transform>(new Transform(Inverse(*o2w))));
+            const Transform *w2o = transforms.back().get();
+            std::shared_ptr<Shape> sphere =
+                std::make_shared<Sphere>(o2w, w2o, false, .25, -.25, .25, 360);
+            prims.push_back(std::make_shared<GeometricPrimitive>(
+                sphere, nullptr, nullptr, mediumInterface));
+            lights.push_back(std::make_shared<DiffuseAreaLight>(
+                *o2w, mediumInterface, I, 1, sphere));
+        }
+    }
+    lights.push_back(std::make_shared<DistantLight>(Transform(), Spectrum(1),
+                                                    Vector3f(0, 0, 1)));
+    Scene scene(std::make_shared<BVHAccel>(prims), lights);
+    BVHLightDistribution distrib(scene);
+
+    for (int i = 0; i < 20; ++i) {
+        Point3f p = randomPoint();
+        Normal3f n;
+        if (i & 1)
+            n = Normalize(Normal3f(rng.UniformFloat() - .5f,
+                                   rng.UniformFloat() - .5f,
+                                   rng.UniformFloat() - .5f));
+
+        // Subtrees whose lights can't reach _p_ are never sampled, so the
+        // probabilities may sum to less than one; the point lights emit in
+        // all directions and must always be reachable, though.
+        Float sum = 0;
+        for (size_t j = 0; j < lights.size(); ++j) {
+            Float pdf = distrib.DiscretePDF(p, n, j);
+            if (j % 3 == 0) {
+                EXPECT_GT(pdf, 0);
+            }
+            sum += pdf;
+        }
+        EXPECT_LE(sum, 1 + 1e-3);
+        EXPECT_GT(sum, .5);
+
+        for (int j = 0; j < 1000; ++j) {
+            Float pdf;
+            int index = distrib.SampleDiscrete(p, n, rng.UniformFloat(), &pdf);
+            if (pdf > 0)
+                EXPECT_NEAR(pdf, distrib.DiscretePDF(p, n, index), 1e-4f * pdf);
+        }
+    }
+}
+
+// Returns a scene with 100 point lights scattered over [-10,10]^3, along
+// with two spheres at its corners so that it has the same bounds.
+static Scene PointLightScene(RNG &rng) {
+    MediumInterface mediumInterface;
+    std::vector<std::shared_ptr<Light>> lights;
+    for (int i = 0; i < 100; ++i) {
+        Point3f p(-10 + 20 * rng.UniformFloat(), -10 + 20 * rng.UniformFloat(),
+                  -10 + 20 * rng.UniformFloat());
+        lights.push_back(std::make_shared<PointLight>(
+            Translate(Vector3f(p)), mediumInterface,
+            Spectrum(1 + 10 * rng.UniformFloat())));
+    }
+    static Transform o2w[2] = {Translate(Vector3f(-10, -10, -10)),
+                               Translate(Vector3f(10, 10, 10))};
+    static Transform w2o[2] = {Inverse(o2w[0]), Inverse(o2w[1])};
+    std::vector<std::shared_ptr<Primitive>> prims;
+    for (int i = 0; i < 2; ++i)
+        prims.push_back(std::make_shared<GeometricPrimitive>(
+            std::make_shared<Sphere>(&o2w[i], &w2o[i], false, 1, -1, 1, 360),
+            nullptr, nullptr, mediumInterface));
+    return Scene(std::make_shared<BVHAccel>(prims), lights);
+}
+
+// Checks that scenes number their lights and that the power distribution's
+// alias table samples lights with the probabilities of its Distribution1D.
+TEST(PowerLightDistribution, AliasTableMatchesLookup) {
+    RNG rng;
+    Scene scene = PointLightScene(rng);
+    for (size_t i = 0; i < scene.lights.size(); ++i)
+        EXPECT_EQ(int(i), scene.lights[i]->Index());
+
+    PowerLightDistribution distrib(scene);
+    Point3f p(1, 2, 3);
+    const Distribution1D *lookup = distrib.Lookup(p);
+    for (size_t i = 0; i < scene.lights.size(); ++i)
+        EXPECT_NEAR(lookup->DiscretePDF(i),
+                    distrib.DiscretePDF(p, Normal3f(), i), 1e-6f);
+    for (int i = 0; i < 1000; ++i) {
+        Float pdf;
+        int index =
+            distrib.SampleDiscrete(p, Normal3f(), rng.UniformFloat(), &pdf);
+        EXPECT_EQ(pdf, distrib.DiscretePDF(p, Normal3f(), index));
+    }
+}
+
+// Checks that the sparse per-voxel distributions of the spatial light
+// distribution are normalized and consistent with their PDFs, both for
+// the lights that are stored individually and for the others.
+TEST(SpatialLightDistribution, SparsePDFsMatchSampling) {
+    RNG rng;
+    Scene scene = PointLightScene(rng);
+    int nLights = scene.lights.size();
+    SpatialLightDistribution distrib(scene, 4, 8);
+
+    for (int i = 0; i < 20; ++i) {
+        Point3f p(-10 + 20 * rng.UniformFloat(), -10 + 20 * rng.UniformFloat(),
+                  -10 + 20 * rng.UniformFloat());
+        Float sum = 0;
+        for (int j = 0; j < nLights; ++j) {
+            Float pdf = distrib.DiscretePDF(p, Normal3f(), j);
+            EXPECT_GT(pdf, 0);
+            sum += pdf;
+        }
+        EXPECT_NEAR(1, sum, 1e-3);
+
+        for (int j = 0; j < 1000; ++j) {
+            Float pdf;
+            int index =
+                distrib.SampleDiscrete(p, Normal3f(), rng.UniformFloat(), &pdf);
+            ASSERT_TRUE(index >= 0 && index < nLights);
+            EXPECT_NEAR(pdf, distrib.DiscretePDF(p, Normal3f(), index),
+                        1e-4f * pdf);
+        }
+
+        const Distribution1D *dense = distrib.Lookup(p);
+        for (int j = 0; j < nLights; ++j)
+            EXPECT_NEAR(dense->DiscretePDF(j),
+                        distrib.DiscretePDF(p, Normal3f(), j), 1e-5f);
+    }
+}
+
+// Checks that prebuilding the distributions of a scene without lights
+// returns rather than waiting for distributions that are never built.
+TEST(SpatialLightDistribution, PrebuildWithoutLights) {
+    static Transform o2w = Translate(Vector3f(1, 2, 3));
+    static Transform w2o = Inverse(o2w);
+    std::vector<std::shared_ptr<Primitive>> prims;
+    prims.push_back(std::make_shared<GeometricPrimitive>(
+        std::make_shared<Sphere>(&o2w, &w2o, false, 5, -5, 5, 360), nullptr,
+        nullptr, MediumInterface()));
+    Scene scene(std::make_shared<BVHAccel>(prims), {});
+    SpatialLightDistribution distrib(scene, 4, 8);
+    distrib.Prebuild({Point3f(0, 0, 0), Point3f(1, 2, 3), Point3f(4, 5, 6)});
+}
+
+// Reports every shadow ray toward even-numbered lights as blocked and
+// checks that their probabilities drop, though not below the defensive
+// fraction of the originals, while the distribution stays normalized.
+TEST(SpatialLightDistribution, LearnsVisibility) {
+    RNG rng;
+    Scene scene = PointLightScene(rng);
+    int nLights = scene.lights.size();
+    SpatialLightDistribution distrib(scene, 4, nLights, true);
+
+    Point3f p(1, 2, 3);
+    std::vector<Float> initialPdf(nLights);
+    for (int i = 0; i < nLights; ++i)
+        initialPdf[i] = distrib.DiscretePDF(p, Normal3f(), i);
+    for (int i = 0; i < 4096; ++i) {
+        Float pdf;
+        int index =
+            distrib.SampleDiscrete(p, Normal3f(), rng.UniformFloat(), &pdf);
+        distrib.RecordVisibility(p, index, (index & 1) ? 1 : 0);
+    }
+
+    Float sum = 0, evenBefore = 0, evenAfter = 0;
+    for (int i = 0; i < nLights; ++i) {
+        Float pdf = distrib.DiscretePDF(p, Normal3f(), i);
+        EXPECT_GT(pdf, 0);
+        sum += pdf;
+        if ((i & 1) == 0) {
+            evenBefore += initialPdf[i];
+            evenAfter += pdf;
+        }
+    }
+    EXPECT_NEAR(1, sum, 1e-3);
+    EXPECT_LT(evenAfter, .5f * evenBefore);
+    EXPECT_GT(evenAfter, .09f * evenBefore);
+}
+
+// Checks that lightcuts partition the point lights among at most
+// _maxCutSize_ clusters and that a cut refined all the way down holds
+// every light in its own cluster.
+TEST(BVHLightDistribution, Lightcuts) {
+    RNG rng;
+    Scene scene = PointLightScene(rng);
+    int nLights = scene.lights.size();
+    BVHLightDistribution distrib(scene);
+    std::vector<int> cut(nLights);
+
+    Point3f p(1, 2, 3);
+    int nClusters = distrib.ComputeCut(p, Normal3f(), 0, nLights, &cut[0]);
+    EXPECT_EQ(nLights, nClusters);
+    std::vector<int> clusterOfLight(nLights, -1);
+    for (int i = 0; i < nClusters; ++i) {
+        Float pdf;
+        int lightIndex = distrib.SampleCluster(cut[i], p, Normal3f(),
+                                               rng.UniformFloat(), &pdf);
+        EXPECT_EQ(1, pdf);
+        EXPECT_EQ(-1, clusterOfLight[lightIndex]);
+        clusterOfLight[lightIndex] = i;
+    }
+
+    const int maxCutSize = 8;
+    nClusters = distrib.ComputeCut(p, Normal3f(), .01f, maxCutSize, &cut[0]);
+    EXPECT_GT(nClusters, 1);
+    EXPECT_LE(nClusters, maxCutSize);
+    clusterOfLight.assign(nLights, -1);
+    for (int i = 0; i < nClusters; ++i)
+        for (int j = 0; j < 1000; ++j) {
+            Float pdf;
+            int lightIndex = distrib.SampleCluster(cut[i], p, Normal3f(),
+                                                   rng.UniformFloat(), &pdf);
+            EXPECT_GT(pdf, 0);
+            EXPECT_TRUE(clusterOfLight[lightIndex] == -1 ||
+                        clusterOfLight[lightIndex] == i);
+            clusterOfLight[lightIndex] = i;
+        }
+}
@@ -0,0 +1,170 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "accelerators/bvh.h"
+#include "imageio.h"
+#include "lights/diffuse.h"
+#include "lights/goniometric.h"
+#include "lights/projection.h"
+#include "parallel.h"
+#include "rng.h"
+#include "sampling.h"
+#include "scene.h"
+#include "shapes/sphere.h"
+#include "shapes/triangle.h"
+
+using namespace pbrt;
+
+// Writes an image that is dark apart from a small bright region, like a
+// narrow beam in a goniometric diagram or a slide with a bright spot.
+static void WritePeakedImage(const std::string &filename) {
+    Point2i res(32, 16);
+    std::vector<Float> pixels(3 * res.x * res.y, .001f);
+    for (int y = 5; y < 8; ++y)
+        for (int x = 20; x < 24; ++x)
+            for (int c = 0; c < 3; ++c) pixels[3 * (y * res.x + x) + c] = 50;
+    WriteImage(filename, &pixels[0], Bounds2i({0, 0}, res), res);
+}
+
+// Checks that the densities returned by Sample_Le() match Pdf_Le() and
+// that Sample_Le() estimates the integral of the light's _intensity_ over
+// the sphere with much lower variance than uniform sampling does. Samples
+// that land on texel boundaries may find the neighboring texel's density
+// in Pdf_Le(), so a few mismatches are allowed.
+template <typename F>
+static void TestSampleLe(const Light &light, F intensity) {
+    RNG rng;
+    const int n = 200000;
+    double sum = 0, sumSquared = 0, uniformSum = 0, uniformSumSquared = 0;
+    int nMismatched = 0;
+    for (int i = 0; i < n; ++i) {
+        Point2f u1(rng.UniformFloat(), rng.UniformFloat());
+        Point2f u2(rng.UniformFloat(), rng.UniformFloat());
+        Ray ray;
+        Normal3f nLight;
+        Float pdfPos, pdfDir;
+        Spectrum Le =
+            light.Sample_Le(u1, u2, 0, &ray, &nLight, &pdfPos, &pdfDir);
+        if (pdfDir > 0) {
+            Float pdfPos2, pdfDir2;
+            light.Pdf_Le(ray, nLight, &pdfPos2, &pdfDir2);
+            if (std::abs(pdfDir - pdfDir2) > 1e-3f * pdfDir) ++nMismatched;
+            double f = Le.y() / pdfDir;
+            sum += f;
+            sumSquared += f * f;
+        }
+
+        Vector3f w = UniformSampleSphere(u1);
+        double f = intensity(w) / UniformSpherePdf();
+        uniformSum += f;
+        uniformSumSquared += f * f;
+    }
+    double mean = sum / n, uniformMean = uniformSum / n;
+    double variance = sumSquared / n - mean * mean;
+    double uniformVariance =
+        uniformSumSquared / n - uniformMean * uniformMean;
+    EXPECT_LT(nMismatched, n / 1000);
+    EXPECT_NEAR(uniformMean, mean, .03 * uniformMean);
+    EXPECT_LT(variance, .1 * uniformVariance);
+}
+
+TEST(GonioPhotometricLight, SampleLe) {
+    ParallelInit();
+    std::string filename = "gonio.pfm";
+    WritePeakedImage(filename);
+    Transform lightToWorld =
+        Translate(Vector3f(1, 2, 3)) * Rotate(30, Vector3f(1, 1, 0));
+    GonioPhotometricLight light(lightToWorld, MediumInterface(), Spectrum(2),
+                                filename);
+    EXPECT_EQ(0, remove(filename.c_str()));
+    TestSampleLe(light, [&](const Vector3f &w) {
+        return 2 * light.Scale(w).y();
+    });
+    ParallelCleanup();
+}
+
+// The light's bounds must cover its brightest direction, not just its
+// average intensity; otherwise the light BVH undersamples narrow beams.
+TEST(GonioPhotometricLight, Bounds) {
+    ParallelInit();
+    std::string filename = "gonio.pfm";
+    WritePeakedImage(filename);
+    GonioPhotometricLight light(Transform(), MediumInterface(), Spectrum(2),
+                                filename);
+    EXPECT_EQ(0, remove(filename.c_str()));
+    LightBounds bounds;
+    ASSERT_TRUE(light.Bounds(&bounds));
+    RNG rng;
+    Float maxI = 0;
+    for (int i = 0; i < 100000; ++i) {
+        Vector3f w = UniformSampleSphere(
+            Point2f(rng.UniformFloat(), rng.UniformFloat()));
+        maxI = std::max(maxI, 2 * light.Scale(w).y());
+    }
+    EXPECT_GT(maxI, 10 * light.Power().y() / (4 * Pi));
+    EXPECT_GE(bounds.phi * (1 + 1e-4f), 4 * Pi * maxI);
+    ParallelCleanup();
+}
+
+TEST(ProjectionLight, SampleLe) {
+    ParallelInit();
+    std::string filename = "projection.pfm";
+    WritePeakedImage(filename);
+    Transform lightToWorld =
+        Translate(Vector3f(1, 2, 3)) * Rotate(30, Vector3f(1, 1, 0));
+    ProjectionLight light(lightToWorld, MediumInterface(), Spectrum(2),
+                          filename, 60);
+    EXPECT_EQ(0, remove(filename.c_str()));
+    TestSampleLe(light, [&](const Vector3f &w) {
+        return 2 * light.Projection(w).y();
+    });
+    ParallelCleanup();
+}
+
+// Checks that a surface without a material, which only marks a medium
+// boundary, between the receiving point and a mesh light doesn't change
+// the light's solid angle density.
+TEST(TriangleMeshAreaLight, PdfLiSkipsMediumBoundaries) {
+    static Transform identity;
+    const Point3f p[4] = {Point3f(-1, -1, 5), Point3f(1, -1, 5),
+                          Point3f(1, 1, 5), Point3f(-1, 1, 5)};
+    const int indices[6] = {0, 2, 1, 0, 3, 2};
+    std::vector<std::shared_ptr<Shape>> triangles =
+        CreateTriangleMesh(&identity, &identity, false, 2, indices, 4, p,
+                           nullptr, nullptr, nullptr, nullptr, nullptr);
+    MediumInterface mediumInterface;
+    auto light = std::make_shared<TriangleMeshAreaLight>(
+        identity, mediumInterface, Spectrum(1), 1, triangles);
+    std::vector<std::shared_ptr<Primitive>> prims;
+    for (const std::shared_ptr<Shape> &tri : triangles)
+        prims.push_back(std::make_shared<GeometricPrimitive>(
+            tri, nullptr, light, mediumInterface));
+    Scene scene(std::make_shared<BVHAccel>(prims), {light});
+
+    Interaction ref(Point3f(0, 0, 0), Normal3f(0, 0, 1), Vector3f(),
+                    Vector3f(0, 0, 1), 0, mediumInterface);
+    std::vector<Vector3f> dirs = {Vector3f(0, 0, 1), Vector3f(.1, .2, 1),
+                                  Vector3f(-.15, .05, 1)};
+    std::vector<Float> pdfs;
+    for (const Vector3f &w : dirs) {
+        pdfs.push_back(light->Pdf_Li(ref, Normalize(w)));
+        EXPECT_GT(pdfs.back(), 0);
+
+        // Callers that found the light themselves get the same density
+        SurfaceInteraction isect;
+        ASSERT_TRUE(scene.Intersect(ref.SpawnRay(Normalize(w)), &isect));
+        EXPECT_FLOAT_EQ(pdfs.back(),
+                        light->Pdf_LiAt(ref, Normalize(w), isect));
+    }
+
+    // Enclose the receiving point in a sphere without a material
+    static Transform sphereToWorld = Scale(2, 2, 2);
+    static Transform worldToSphere = Inverse(sphereToWorld);
+    prims.push_back(std::make_shared<GeometricPrimitive>(
+        std::make_shared<Sphere>(&sphereToWorld, &worldToSphere, false, 1, -1,
+                                 1, 360),
+        nullptr, nullptr, mediumInterface));
+    Scene boundaryScene(std::make_shared<BVHAccel>(prims), {light});
+    for (size_t i = 0; i < dirs.size(); ++i)
+        EXPECT_FLOAT_EQ(pdfs[i], light->Pdf_Li(ref, Normalize(dirs[i])));
+}
@@ -0,0 +1,280 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "imageio.h"
+#include "interaction.h"
+#include "rng.h"
+#include "mipmap.h"
+#include "parallel.h"
+#include "paramset.h"
+#include "textures/imagemap.h"
+
+using namespace pbrt;
+
+TEST(Half, RoundTrip) {
+    // Every finite half converts to a float and back exactly
+    for (int h = 0; h < 65536; ++h) {
+        if ((h & 0x7c00) == 0x7c00) continue;
+        EXPECT_EQ(h, FloatToHalf(HalfToFloat(h))) << h;
+    }
+
+    EXPECT_EQ(0x3c00, FloatToHalf(1.f));
+    EXPECT_EQ(0xc000, FloatToHalf(-2.f));
+    EXPECT_EQ(0x7bff, FloatToHalf(1e6f));
+    EXPECT_EQ(0x7c00, FloatToHalf(Infinity));
+    EXPECT_EQ(0x0001, FloatToHalf(std::ldexp(1.f, -24)));
+    EXPECT_EQ(0, FloatToHalf(std::ldexp(1.f, -26)));
+    // Ties round to even
+    EXPECT_EQ(0x3c00, FloatToHalf(1.f + std::ldexp(1.f, -11)));
+    EXPECT_EQ(0x3c02, FloatToHalf(1.f + 3 * std::ldexp(1.f, -11)));
+
+    RNG rng;
+    for (int i = 0; i < 10000; ++i) {
+        float f = 1000 * (rng.UniformFloat() - .5f);
+        EXPECT_LE(std::abs(HalfToFloat(FloatToHalf(f)) - f),
+                  std::abs(f) * std::ldexp(1.f, -11));
+    }
+}
+
+// Returns the largest difference between texels of the two MIPMaps
+template <typename T>
+static Float MaxTexelDifference(const MIPMap<T> &a, const MIPMap<T> &b) {
+    Float maxDiff = 0;
+    for (int level = 0; level < a.Levels(); ++level) {
+        Point2i res = a.LevelResolution(level);
+        for (int t = 0; t < res.y; ++t)
+            for (int s = 0; s < res.x; ++s) {
+                T diff = a.Texel(level, s, t) - b.Texel(level, s, t);
+                for (int c = 0; c < TexelTraits<T>::nChannels; ++c)
+                    maxDiff = std::max(maxDiff,
+                                       std::abs(TexelTraits<T>::Get(diff, c)));
+            }
+    }
+    return maxDiff;
+}
+
+TEST(MIPMap, CompactTexels) {
+    // Create an image with the values of an 8-bit sRGB-encoded image
+    Point2i res(64, 32);
+    RNG rng;
+    std::vector<RGBSpectrum> image(res.x * res.y);
+    for (RGBSpectrum &s : image)
+        for (int c = 0; c < 3; ++c)
+            s[c] = InverseGammaCorrect(int(256 * rng.UniformFloat()) / 255.f);
+    ParallelInit();
+    MIPMap<RGBSpectrum> full(res, &image[0]);
+
+    // 8-bit sRGB storage is lossless for the finest level
+    MIPMap<RGBSpectrum> srgb(res, &image[0], false, 8.f, ImageWrap::Repeat, 0,
+                             TexelFormat::SRGB8);
+    for (int t = 0; t < res.y; ++t)
+        for (int s = 0; s < res.x; ++s)
+            EXPECT_EQ(full.Texel(0, s, t), srgb.Texel(0, s, t));
+    EXPECT_LT(MaxTexelDifference(full, srgb), .01f);
+
+    MIPMap<RGBSpectrum> half(res, &image[0], false, 8.f, ImageWrap::Repeat, 0,
+                             TexelFormat::Half);
+    EXPECT_LT(MaxTexelDifference(full, half), 1e-3f);
+
+    // Block compression of a color gradient
+    for (int t = 0; t < res.y; ++t)
+        for (int s = 0; s < res.x; ++s) {
+            Float rgb[3] = {Float(s) / res.x, 1 - Float(s) / res.x, .5f};
+            image[t * res.x + s] = RGBSpectrum::FromRGB(rgb);
+        }
+    MIPMap<RGBSpectrum> smooth(res, &image[0]);
+    MIPMap<RGBSpectrum> bc(res, &image[0], false, 8.f, ImageWrap::Repeat, 0,
+                           TexelFormat::SRGBBC);
+    EXPECT_LT(MaxTexelDifference(smooth, bc), .03f);
+
+    // Single-channel textures
+    std::vector<Float> values(res.x * res.y);
+    for (Float &v : values) v = rng.UniformFloat();
+    MIPMap<Float> fullFloat(res, &values[0]);
+    MIPMap<Float> linear(res, &values[0], false, 8.f, ImageWrap::Repeat, 0,
+                         TexelFormat::Linear8);
+    EXPECT_LE(MaxTexelDifference(fullFloat, linear), .5f / 255.f + 1e-6f);
+
+    // Linear data requested with block compression falls back to linear
+    // bytes rather than an sRGB encoding
+    MIPMap<Float> linearBC(res, &values[0], false, 8.f, ImageWrap::Repeat, 0,
+                           TexelFormat::LinearBC);
+    EXPECT_LE(MaxTexelDifference(fullFloat, linearBC), .5f / 255.f + 1e-6f);
+
+    // Linear block compression of RGB texels quantizes endpoints uniformly
+    MIPMap<RGBSpectrum> linearRGB(res, &image[0], false, 8.f,
+                                  ImageWrap::Repeat, 0, TexelFormat::LinearBC);
+    EXPECT_LT(MaxTexelDifference(smooth, linearRGB), .03f);
+    ParallelCleanup();
+}
+
+// The EWA filter as MIPMap implemented it before texels were filtered one
+// row at a time: every texel of the ellipse's bounding box is read through
+// Texel() and weighted if it's inside the ellipse.
+template <typename T>
+static T ReferenceEWA(const MIPMap<T> &mipmap, int level, Point2f st,
+                      Vector2f dst0, Vector2f dst1) {
+    if (level >= mipmap.Levels())
+        return mipmap.Texel(mipmap.Levels() - 1, 0, 0);
+    const Point2i &res = mipmap.LevelResolution(level);
+    st[0] = st[0] * res[0] - 0.5f;
+    st[1] = st[1] * res[1] - 0.5f;
+    dst0[0] *= res[0];
+    dst0[1] *= res[1];
+    dst1[0] *= res[0];
+    dst1[1] *= res[1];
+    Float A = dst0[1] * dst0[1] + dst1[1] * dst1[1] + 1;
+    Float B = -2 * (dst0[0] * dst0[1] + dst1[0] * dst1[1]);
+    Float C = dst0[0] * dst0[0] + dst1[0] * dst1[0] + 1;
+    Float invF = 1 / (A * C - B * B * 0.25f);
+    A *= invF;
+    B *= invF;
+    C *= invF;
+    Float det = -B * B + 4 * A * C;
+    Float invDet = 1 / det;
+    Float uSqrt = std::sqrt(det * C), vSqrt = std::sqrt(A * det);
+    int s0 = std::ceil(st[0] - 2 * invDet * uSqrt);
+    int s1 = std::floor(st[0] + 2 * invDet * uSqrt);
+    int t0 = std::ceil(st[1] - 2 * invDet * vSqrt);
+    int t1 = std::floor(st[1] + 2 * invDet * vSqrt);
+    T sum(0.f);
+    Float sumWts = 0;
+    for (int it = t0; it <= t1; ++it) {
+        Float tt = it - st[1];
+        for (int is = s0; is <= s1; ++is) {
+            Float ss = is - st[0];
+            Float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
+            if (r2 < 1) {
+                const int lutSize = 128;
+                int index = std::min((int)(r2 * lutSize), lutSize - 1);
+                Float r2Lut = Float(index) / Float(lutSize - 1);
+                Float weight = std::exp(-2 * r2Lut) - std::exp(-2.f);
+                sum += mipmap.Texel(level, is, it) * weight;
+                sumWts += weight;
+            }
+        }
+    }
+    return sum / sumWts;
+}
+
+// Checks that EWA lookups match the reference filter, both for footprints
+// inside the image, where texels are read directly from the pyramid, and
+// for ones that cross its edges.
+TEST(MIPMap, EWAMatchesReference) {
+    Point2i res(64, 32);
+    RNG rng;
+    std::vector<Float> values(res.x * res.y);
+    for (Float &v : values) v = rng.UniformFloat();
+
+    ParallelInit();
+    const Float maxAniso = 8;
+    for (ImageWrap wrap : {ImageWrap::Repeat, ImageWrap::Black}) {
+        MIPMap<Float> mipmap(res, &values[0], false, maxAniso, wrap);
+        for (int i = 0; i < 1000; ++i) {
+            Point2f st(rng.UniformFloat(), rng.UniformFloat());
+            Float minor = (.5f + 4 * rng.UniformFloat()) / res.x;
+            Float aniso = 1 + 15 * rng.UniformFloat();
+            Float phi = 2 * Pi * rng.UniformFloat();
+            Vector2f dst0 = aniso * minor * Vector2f(std::cos(phi), std::sin(phi));
+            Vector2f dst1 = minor * Vector2f(-std::sin(phi), std::cos(phi));
+
+            // Clamp the eccentricity and choose the levels as Lookup() does
+            Vector2f dst1Clamped = dst1;
+            Float majorLength = dst0.Length(), minorLength = dst1.Length();
+            if (minorLength * maxAniso < majorLength) {
+                Float scale = majorLength / (minorLength * maxAniso);
+                dst1Clamped *= scale;
+                minorLength *= scale;
+            }
+            Float lod = std::max((Float)0,
+                                 mipmap.Levels() - (Float)1 + Log2(minorLength));
+            int ilod = std::floor(lod);
+            Float expected =
+                Lerp(lod - ilod, ReferenceEWA(mipmap, ilod, st, dst0, dst1Clamped),
+                     ReferenceEWA(mipmap, ilod + 1, st, dst0, dst1Clamped));
+            EXPECT_NEAR(expected, mipmap.Lookup(st, dst0, dst1), 1e-5f)
+                << "st " << st << ", dst0 " << dst0 << ", dst1 " << dst1;
+        }
+    }
+    ParallelCleanup();
+}
+
+// Returns an image texture of _filename_ created with the given "filter"
+// and "trilinear" parameters; empty values leave them unset.
+static std::unique_ptr<Texture<Spectrum>> MakeImageTexture(
+    const std::string &filename, const std::string &filter,
+    const std::string &trilinear) {
+    ParamSet params;
+    std::unique_ptr<std::string[]> name(new std::string[1]);
+    name[0] = filename;
+    params.AddString("filename", std::move(name), 1);
+    if (!filter.empty()) {
+        std::unique_ptr<std::string[]> f(new std::string[1]);
+        f[0] = filter;
+        params.AddString("filter", std::move(f), 1);
+    }
+    if (!trilinear.empty()) {
+        std::unique_ptr<bool[]> t(new bool[1]);
+        t[0] = (trilinear == "true");
+        params.AddBool("trilinear", std::move(t), 1);
+    }
+    ParamSet geomParams;
+    std::map<std::string, std::shared_ptr<Texture<Float>>> floatTextures;
+    std::map<std::string, std::shared_ptr<Texture<Spectrum>>> spectrumTextures;
+    TextureParams tp(geomParams, params, floatTextures, spectrumTextures);
+    std::unique_ptr<Texture<Spectrum>> tex(
+        CreateImageSpectrumTexture(Transform(), tp));
+    ImageTexture<RGBSpectrum, Spectrum>::FinishLoading();
+    return tex;
+}
+
+// Checks that the "filter" parameter selects the same filters as the
+// "trilinear" flag did and that "filter" takes precedence when both are
+// given.
+TEST(ImageTexture, FilterParameters) {
+    ParallelInit();
+    std::string filename = "filters.pfm";
+    Point2i res(32, 16);
+    RNG rng;
+    std::vector<Float> pixels(3 * res.x * res.y);
+    for (Float &p : pixels) p = rng.UniformFloat();
+    WriteImage(filename, &pixels[0], Bounds2i({0, 0}, res), res);
+
+    // Evaluates the texture with anisotropic footprints
+    auto evaluate = [](const Texture<Spectrum> &tex) {
+        RNG rng;
+        std::vector<Float> values;
+        for (int i = 0; i < 100; ++i) {
+            SurfaceInteraction si;
+            si.uv = Point2f(rng.UniformFloat(), rng.UniformFloat());
+            si.dudx = .2f * rng.UniformFloat();
+            si.dvdx = .2f * rng.UniformFloat();
+            si.dudy = -si.dvdx * .1f;
+            si.dvdy = si.dudx * .1f;
+            values.push_back(tex.Evaluate(si).y());
+        }
+        return values;
+    };
+
+    std::vector<Float> ewa = evaluate(*MakeImageTexture(filename, "", ""));
+    EXPECT_EQ(ewa, evaluate(*MakeImageTexture(filename, "ewa", "")));
+    EXPECT_EQ(ewa, evaluate(*MakeImageTexture(filename, "", "false")));
+    EXPECT_EQ(ewa, evaluate(*MakeImageTexture(filename, "ewa", "true")));
+
+    std::vector<Float> trilinear =
+        evaluate(*MakeImageTexture(filename, "", "true"));
+    EXPECT_NE(ewa, trilinear);
+    EXPECT_EQ(trilinear,
+              evaluate(*MakeImageTexture(filename, "trilinear", "")));
+
+    std::vector<Float> aniso =
+        evaluate(*MakeImageTexture(filename, "anisotropic", ""));
+    EXPECT_NE(ewa, aniso);
+    EXPECT_NE(trilinear, aniso);
+    EXPECT_EQ(aniso,
+              evaluate(*MakeImageTexture(filename, "anisotropic", "true")));
+
+    ImageTexture<RGBSpectrum, Spectrum>::ClearCache();
+    EXPECT_EQ(0, remove(filename.c_str()));
+    ParallelCleanup();
+}
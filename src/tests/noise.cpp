@@ -0,0 +1,25 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "rng.h"
+#include "texture.h"
+
+using namespace pbrt;
+
+TEST(Noise, BatchMatchesScalar) {
+    RNG rng;
+    std::vector<Point3f> p(1000);
+    for (Point3f &pt : p)
+        pt = Point3f(-500 + 1000 * rng.UniformFloat(),
+                     -500 + 1000 * rng.UniformFloat(),
+                     -500 + 1000 * rng.UniformFloat());
+    // Include lattice points, where the noise function is zero
+    p[0] = Point3f(0, 0, 0);
+    p[1] = Point3f(-3, 17, 256);
+
+    std::vector<Float> noise(p.size());
+    Noise(&p[0], p.size(), &noise[0]);
+    for (size_t i = 0; i < p.size(); ++i) EXPECT_EQ(Noise(p[i]), noise[i]);
+    EXPECT_EQ(0, noise[0]);
+    EXPECT_EQ(0, noise[1]);
+}
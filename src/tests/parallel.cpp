@@ -37,3 +37,28 @@ TEST(Parallel, DoNothing) {
 
     ParallelCleanup();
 }
+
+TEST(Parallel, Async) {
+    ParallelInit();
+
+    // Launch tasks that themselves run parallel loops while the main
+    // thread runs one, too
+    std::atomic<int> counter{0};
+    std::vector<std::shared_ptr<AsyncTask>> tasks;
+    for (int i = 0; i < 32; ++i)
+        tasks.push_back(RunAsync([&]() {
+            ParallelFor([&](int64_t) { ++counter; }, 100, 7);
+        }));
+    ParallelFor([&](int64_t) { ++counter; }, 1000, 3);
+    for (const std::shared_ptr<AsyncTask> &task : tasks) task->Wait();
+    EXPECT_EQ(32 * 100 + 1000, counter);
+
+    // Waiting again or from multiple threads is fine
+    counter = 0;
+    std::shared_ptr<AsyncTask> task = RunAsync([&]() { ++counter; });
+    ParallelFor([&](int64_t) { task->Wait(); }, 16);
+    task->Wait();
+    EXPECT_EQ(1, counter);
+
+    ParallelCleanup();
+}
@@ -6,9 +6,12 @@
 #include "rng.h"
 #include "sampling.h"
 #include "lowdiscrepancy.h"
+#include "parallel.h"
 #include "samplers/maxmin.h"
+#include "samplers/owensobol.h"
 #include "samplers/sobol.h"
 #include "samplers/zerotwosequence.h"
+#include "samplers/zsobol.h"
 
 using namespace pbrt;
 
@@ -184,7 +187,88 @@ TEST(LowDiscrepancy, ElementaryIntervals) {
                                   1 << logSamples,
                                   Bounds2i(Point2i(0, 0), Point2i(10, 10)))),
                      logSamples);
+        checkSampler("OwenSobol", std::unique_ptr<Sampler>(
+                                      new OwenSobolSampler(1 << logSamples)),
+                     logSamples);
+        checkSampler("ZSobol", std::unique_ptr<Sampler>(new ZSobolSampler(
+                                   1 << logSamples,
+                                   Bounds2i(Point2i(0, 0), Point2i(10, 10)))),
+                     logSamples);
+    }
+}
+
+// Checks that power-of-two prefixes of a pixel's samples are stratified in
+// later dimensions too, even when the samples are taken by several clones
+// that resume with SetSampleNumber(), and that neighboring pixels get
+// different samples. Every prefix must be stratified in 1D, while 2D
+// stratification is only checked for prefixes of _firstPrefix_ times a
+// power of _prefixScale_ samples.
+static void CheckStratifiedPrefixes(const char *name, Sampler &sampler,
+                                    int firstPrefix, int prefixScale) {
+    const int nSamples = sampler.samplesPerPixel;
+    // Returns samples _start_ through _end_-1 of pixel _p_ from a clone,
+    // after skipping a few 2D dimensions
+    auto takeSamples = [&](const Point2i &p, int start, int end,
+                           std::vector<Float> *s1, std::vector<Point2f> *s2) {
+        std::unique_ptr<Sampler> clone = sampler.Clone(start);
+        clone->StartPixel(p);
+        clone->SetSampleNumber(start);
+        for (int i = start; i < end; ++i) {
+            for (int d = 0; d < 5; ++d) clone->Get2D();
+            s1->push_back(clone->Get1D());
+            s2->push_back(clone->Get2D());
+            clone->StartNextSample();
+        }
+    };
+
+    std::vector<Float> s1;
+    std::vector<Point2f> s2;
+    takeSamples(Point2i(5, 3), 0, 16, &s1, &s2);
+    takeSamples(Point2i(5, 3), 16, 64, &s1, &s2);
+    takeSamples(Point2i(5, 3), 64, nSamples, &s1, &s2);
+    for (int n = 1; n <= nSamples; n *= 2) {
+        std::vector<int> count(n, 0);
+        for (int i = 0; i < n; ++i) ++count[int(s1[i] * n)];
+        for (int c : count) EXPECT_EQ(1, c) << name << " 1D prefix " << n;
+
+        // Check all of the 2D elementary intervals with _n_ cells
+        int m = firstPrefix;
+        while (m < n) m *= prefixScale;
+        if (m != n) continue;
+        for (int nx = 1; nx <= n; nx *= 2) {
+            int ny = n / nx;
+            std::vector<int> count2(n, 0);
+            for (int i = 0; i < n; ++i)
+                ++count2[int(s2[i].y * ny) * nx + int(s2[i].x * nx)];
+            for (int c : count2)
+                EXPECT_EQ(1, c) << name << " 2D prefix " << n << ", " << nx
+                                << "x" << ny;
+        }
     }
+
+    std::vector<Float> t1;
+    std::vector<Point2f> t2;
+    takeSamples(Point2i(6, 3), 0, nSamples, &t1, &t2);
+    int nEqual = 0;
+    for (int i = 0; i < nSamples; ++i)
+        if (s1[i] == t1[i] || s2[i] == t2[i]) ++nEqual;
+    EXPECT_LT(nEqual, 4) << name;
+}
+
+TEST(OwenSobolSampler, StratifiedPrefixes) {
+    OwenSobolSampler sampler(256);
+    CheckStratifiedPrefixes("OwenSobol", sampler, 1, 2);
+}
+
+// ZSobolSampler permutes the base-4 digits of the sample index, so
+// prefixes are only guaranteed to be 2D stratified when they cover whole
+// digits; with an odd power of two samples, the lowest digit is one bit.
+TEST(ZSobolSampler, StratifiedPrefixes) {
+    Bounds2i sampleBounds(Point2i(0, 0), Point2i(10, 10));
+    ZSobolSampler sampler256(256, sampleBounds);
+    CheckStratifiedPrefixes("ZSobol 256", sampler256, 1, 4);
+    ZSobolSampler sampler128(128, sampleBounds);
+    CheckStratifiedPrefixes("ZSobol 128", sampler128, 2, 4);
 }
 
 TEST(MaxMinDist, MinDist) {
@@ -301,3 +385,97 @@ TEST(Distribution1D, Continuous) {
     EXPECT_FLOAT_EQ(0., dist.SampleContinuous(0., &pdf));
     EXPECT_FLOAT_EQ(1., dist.SampleContinuous(1., &pdf));
 }
+
+TEST(Distribution1D, AliasSampling) {
+    Float func[] = {1, 0, 2, 4, 8, 0.5};
+    const int n = sizeof(func) / sizeof(func[0]);
+    Distribution1D cdf(func, n), alias(func, n, true);
+    EXPECT_FALSE(cdf.AliasSampling());
+    EXPECT_TRUE(alias.AliasSampling());
+    EXPECT_EQ(cdf.funcInt, alias.funcInt);
+
+    RNG rng;
+    std::vector<int> hist(n, 0);
+    const int count = 1024 * 1024;
+    for (int i = 0; i < count; ++i) {
+        Float u = rng.UniformFloat(), pdf, uRemapped;
+        int offset = alias.SampleDiscrete(u, &pdf, &uRemapped);
+        ASSERT_TRUE(offset >= 0 && offset < n);
+        EXPECT_EQ(alias.DiscretePDF(offset), pdf);
+        EXPECT_TRUE(uRemapped >= 0 && uRemapped < 1);
+        ++hist[offset];
+
+        // Continuous samples must fall in the chosen segment and have the
+        // same density as with CDF inversion
+        int cOffset;
+        Float x = alias.SampleContinuous(u, &pdf, &cOffset);
+        EXPECT_TRUE(x * n >= cOffset && x * n <= cOffset + 1);
+        EXPECT_FLOAT_EQ(func[cOffset] / alias.funcInt, pdf);
+    }
+    for (int i = 0; i < n; ++i)
+        EXPECT_NEAR(cdf.DiscretePDF(i), Float(hist[i]) / count, 2e-3f);
+}
+
+TEST(AliasTable, Sampling) {
+    Float weights[] = {0, 1, 7, 0, 4, .5, 3.5};
+    const int n = sizeof(weights) / sizeof(weights[0]);
+    AliasTable table(weights, n);
+    EXPECT_EQ(n, table.Count());
+    for (int i = 0; i < n; ++i) EXPECT_FLOAT_EQ(weights[i] / 16, table.PMF(i));
+
+    // Sample the table and compare the histogram to the PMF
+    const int count = 1024 * 1024;
+    std::vector<int> hist(n, 0);
+    RNG rng;
+    for (int i = 0; i < count; ++i) {
+        Float pmf, uRemapped;
+        int index = table.Sample(rng.UniformFloat(), &pmf, &uRemapped);
+        ASSERT_TRUE(index >= 0 && index < n);
+        EXPECT_EQ(table.PMF(index), pmf);
+        EXPECT_TRUE(uRemapped >= 0 && uRemapped < 1);
+        ++hist[index];
+    }
+    for (int i = 0; i < n; ++i)
+        EXPECT_NEAR(table.PMF(i), Float(hist[i]) / count, 2e-3f);
+    EXPECT_EQ(0, hist[0]);
+    EXPECT_EQ(0, hist[3]);
+}
+
+TEST(HierarchicalDistribution2D, PDFs) {
+    ParallelInit();
+    int nu = 16, nv = 8;
+    RNG rng;
+    std::vector<Float> func(nu * nv);
+    for (Float &f : func) f = (rng.UniformFloat() < .2f) ? 0 : rng.UniformFloat();
+    HierarchicalDistribution2D dist(&func[0], nu, nv);
+    Distribution2D reference(&func[0], nu, nv);
+
+    // Weight nodes toward larger u at the first two levels below the root
+    auto weight = [](const Bounds2f &b) { return 1 + 4 * b.pMin.x; };
+    for (int weighted = 0; weighted < 2; ++weighted) {
+        int nWeightedLevels = weighted ? 2 : 0;
+        // The PDF integrates to one and is zero exactly where the function is
+        Float integral = 0;
+        for (int v = 0; v < nv; ++v)
+            for (int u = 0; u < nu; ++u) {
+                Point2f p((u + .5f) / nu, (v + .5f) / nv);
+                Float pdf = dist.Pdf(p, weight, nWeightedLevels);
+                EXPECT_EQ(func[v * nu + u] == 0, pdf == 0);
+                if (!weighted) {
+                    EXPECT_NEAR(reference.Pdf(p), pdf, 1e-4f);
+                }
+                integral += pdf / (nu * nv);
+            }
+        EXPECT_NEAR(1, integral, 1e-4f);
+
+        for (int i = 0; i < 1000; ++i) {
+            Float pdf;
+            Point2f p = dist.SampleContinuous(
+                Point2f(rng.UniformFloat(), rng.UniformFloat()), &pdf, weight,
+                nWeightedLevels);
+            EXPECT_GT(pdf, 0);
+            EXPECT_NEAR(pdf, dist.Pdf(p, weight, nWeightedLevels), 1e-4f * pdf);
+        }
+    }
+    ParallelCleanup();
+}
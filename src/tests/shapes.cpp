@@ -316,6 +316,56 @@ TEST(Triangle, SolidAngle) {
     }
 }
 
+// Checks that Triangle::SampleSolidAngle() returns points on the triangle
+// and that estimates of the integral of a smooth function over the
+// subtended directions agree with ones computed using area sampling.
+TEST(Triangle, SolidAngleSampling) {
+    for (int i = 0; i < 50; ++i) {
+        const Float range = 10;
+        RNG rng(200 + i);
+        std::shared_ptr<Triangle> tri =
+            GetRandomTriangle([&]() { return pUnif(rng, range); });
+        if (!tri) continue;
+
+        Point3f pc{pUnif(rng, range), pUnif(rng, range), pUnif(rng, range)};
+        pc[rng.UniformUInt32() % 3] =
+            rng.UniformFloat() > .5 ? (-range - 3) : (range + 3);
+        Float solidAngle = tri->SolidAngle(pc);
+        if (solidAngle < 1e-3) continue;
+
+        auto f = [](const Vector3f &w) { return (w.x + 1) * (w.x + 1) + w.y; };
+        const int count = 64 * 1024;
+        Interaction ref(pc, Normal3f(), Vector3f(), Vector3f(0, 0, 1), 0,
+                        MediumInterface{});
+        double areaEstimate = 0, sphericalEstimate = 0;
+        int nChecked = 0, nMissed = 0;
+        for (int j = 0; j < count; ++j) {
+            Point2f u{RadicalInverse(0, j), RadicalInverse(1, j)};
+            Float pdf;
+            Interaction pArea = tri->Sample(ref, u, &pdf);
+            if (pdf > 0)
+                areaEstimate += f(Normalize(pArea.p - pc)) / (count * pdf);
+
+            Interaction pSph;
+            if (!tri->SampleSolidAngle(pc, u, &pSph)) continue;
+            Vector3f w = Normalize(pSph.p - pc);
+            sphericalEstimate += f(w) * solidAngle / count;
+            // Rays toward sampled points may graze past the triangle's edges
+            if (j % 64 == 0) {
+                ++nChecked;
+                if (!tri->IntersectP(Ray(pc, 2 * (pSph.p - pc)))) ++nMissed;
+            }
+        }
+        EXPECT_LE(nMissed, nChecked / 100) << "tri index " << i;
+
+        EXPECT_LT(std::abs(areaEstimate - sphericalEstimate),
+                  .015 * std::abs(areaEstimate) + 1e-4)
+            << "area sampling: " << areaEstimate
+            << ", spherical sampling: " << sphericalEstimate
+            << ", tri index " << i;
+    }
+}
+
 // Use Quasi Monte Carlo with uniform sphere sampling to esimate the solid
 // angle subtended by the given shape from the given point.
 static Float mcSolidAngle(const Point3f &p, const Shape &shape, int nSamples) {
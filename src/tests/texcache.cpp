@@ -0,0 +1,109 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "rng.h"
+#include "mipmap.h"
+#include "texcache.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace pbrt;
+
+// Writes a MIP pyramid to a tiled image and checks that filtered lookups
+// through the texture cache match lookups into the in-memory pyramid.
+TEST(TextureCache, TiledMIPMapMatchesInMemory) {
+    Point2i res(53, 29);
+    RNG rng;
+    std::vector<RGBSpectrum> image(res.x * res.y);
+    for (RGBSpectrum &s : image) {
+        Float rgb[3] = {rng.UniformFloat(), rng.UniformFloat(),
+                        rng.UniformFloat()};
+        s = RGBSpectrum::FromRGB(rgb);
+    }
+
+    ParallelInit();
+    MIPMap<RGBSpectrum> mipmap(res, &image[0], false, 8.f, ImageWrap::Clamp);
+    std::vector<Point2i> levelResolution;
+    for (int level = 0; level < mipmap.Levels(); ++level)
+        levelResolution.push_back(mipmap.LevelResolution(level));
+
+    std::string filename = "test.tmip";
+    ASSERT_TRUE(WriteTiledImage(filename, 16, levelResolution,
+                                [&](int level, int s, int t) {
+                                    return mipmap.Texel(level, s, t);
+                                }));
+    std::unique_ptr<TiledImage> tiled = TiledImage::Open(filename);
+    ASSERT_TRUE(tiled.get() != nullptr);
+    EXPECT_EQ(mipmap.Levels(), tiled->Levels());
+
+    {
+        MIPMap<RGBSpectrum> tiledMipmap(
+            std::move(tiled), [](const RGBSpectrum &s) { return s; }, false,
+            8.f, ImageWrap::Clamp);
+        EXPECT_EQ(mipmap.Width(), tiledMipmap.Width());
+        EXPECT_EQ(mipmap.Height(), tiledMipmap.Height());
+        for (int level = 0; level < mipmap.Levels(); ++level) {
+            Point2i r = mipmap.LevelResolution(level);
+            for (int t = 0; t < r.y; ++t)
+                for (int s = 0; s < r.x; ++s)
+                    EXPECT_EQ(mipmap.Texel(level, s, t),
+                              tiledMipmap.Texel(level, s, t));
+        }
+
+        for (int i = 0; i < 200; ++i) {
+            Point2f st(rng.UniformFloat(), rng.UniformFloat());
+            Float width = .1f * rng.UniformFloat();
+            EXPECT_EQ(mipmap.Lookup(st, width), tiledMipmap.Lookup(st, width));
+            Vector2f dst0(.05f * rng.UniformFloat(), .01f * rng.UniformFloat());
+            Vector2f dst1(-.01f * rng.UniformFloat(), .03f * rng.UniformFloat());
+            EXPECT_EQ(mipmap.Lookup(st, dst0, dst1),
+                      tiledMipmap.Lookup(st, dst0, dst1));
+        }
+    }
+    ParallelCleanup();
+    EXPECT_EQ(0, remove(filename.c_str()));
+}
+
+// Checks that a slow tile load doesn't hold up lookups of other tiles in
+// its shard and that threads asking for a tile while it is being loaded
+// share that load.
+TEST(TextureCache, ConcurrentLoads) {
+    TextureCache cache(size_t(1) << 20);
+    const int nOtherTiles = 1024;
+    std::atomic<int> nLoads(0);
+    std::atomic<bool> othersDone(false);
+    bool timedOut = false;
+    int id = cache.AddImage([&](int level, const Point2i &tile,
+                                size_t *bytes) {
+        ++nLoads;
+        if (tile == Point2i(0, 0)) {
+            // Hold up this tile's load until all other tiles are loaded
+            auto start = std::chrono::steady_clock::now();
+            while (!othersDone && !timedOut) {
+                timedOut = std::chrono::steady_clock::now() - start >
+                           std::chrono::seconds(5);
+                std::this_thread::yield();
+            }
+        }
+        *bytes = sizeof(int);
+        return std::shared_ptr<const void>(std::make_shared<int>(tile.x));
+    });
+    auto tileValue = [&](int x) {
+        return *static_cast<const int *>(
+            cache.GetTile(id, 0, Point2i(x, 0)).get());
+    };
+
+    std::vector<std::thread> slowThreads;
+    for (int i = 0; i < 4; ++i)
+        slowThreads.push_back(
+            std::thread([&]() { EXPECT_EQ(0, tileValue(0)); }));
+    while (nLoads == 0) std::this_thread::yield();
+    for (int x = 1; x <= nOtherTiles; ++x) EXPECT_EQ(x, tileValue(x));
+    othersDone = true;
+    for (std::thread &thread : slowThreads) thread.join();
+
+    EXPECT_FALSE(timedOut);
+    EXPECT_EQ(nOtherTiles + 1, nLoads);
+    cache.RemoveImage(id);
+}
@@ -0,0 +1,117 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "interaction.h"
+#include "texgraph.h"
+#include "textures/constant.h"
+#include "textures/mix.h"
+#include "textures/scale.h"
+
+using namespace pbrt;
+
+// Texture that returns the $u$ coordinate and counts its evaluations
+class CountingTexture : public Texture<Float> {
+  public:
+    Float Evaluate(const SurfaceInteraction &si) const {
+        ++nEvaluations;
+        return si.uv[0];
+    }
+    mutable int nEvaluations = 0;
+};
+
+template <typename T>
+static std::shared_ptr<Texture<T>> Const(const T &value) {
+    return std::make_shared<ConstantTexture<T>>(value);
+}
+
+TEST(TextureGraph, FoldConstants) {
+    SurfaceInteraction si;
+    auto scale = std::make_shared<ScaleTexture<Float, Float>>(
+        Const<Float>(2), Const<Float>(3));
+    std::shared_ptr<Texture<Float>> mix = std::make_shared<MixTexture<Float>>(
+        scale, Const<Float>(10), Const<Float>(.25f));
+    std::shared_ptr<Texture<Float>> compiled = CompileTexture(mix);
+    EXPECT_EQ(mix->Evaluate(si), compiled->Evaluate(si));
+    EXPECT_EQ(.75f * 6 + .25f * 10, compiled->Evaluate(si));
+
+    // Single textures are returned as is
+    std::shared_ptr<Texture<Float>> c = Const<Float>(1);
+    EXPECT_EQ(c, CompileTexture(c));
+}
+
+TEST(TextureGraph, CollapseTrivialNodes) {
+    auto leaf = std::make_shared<CountingTexture>();
+    std::shared_ptr<Texture<Float>> scaleByOne =
+        std::make_shared<ScaleTexture<Float, Float>>(Const<Float>(1), leaf);
+    EXPECT_EQ(leaf, CompileTexture(scaleByOne));
+
+    std::shared_ptr<Texture<Spectrum>> red = Const(Spectrum(.5f));
+    std::shared_ptr<Texture<Spectrum>> mixed =
+        std::make_shared<MixTexture<Spectrum>>(red, Const(Spectrum(1.f)),
+                                               Const<Float>(0));
+    SurfaceInteraction si;
+    EXPECT_EQ(Spectrum(.5f), CompileTexture(mixed)->Evaluate(si));
+}
+
+TEST(TextureGraph, SharedSubgraphs) {
+    // Both inputs of the mix are equivalent scales of the same texture,
+    // which is also the mix amount
+    auto leaf = std::make_shared<CountingTexture>();
+    auto scale1 =
+        std::make_shared<ScaleTexture<Float, Float>>(leaf, Const<Float>(2));
+    auto scale2 =
+        std::make_shared<ScaleTexture<Float, Float>>(leaf, Const<Float>(2));
+    std::shared_ptr<Texture<Float>> mix =
+        std::make_shared<MixTexture<Float>>(scale1, scale2, leaf);
+    auto spectrumScale = std::make_shared<ScaleTexture<Spectrum, Spectrum>>(
+        Const(Spectrum(.25f)),
+        std::make_shared<MixTexture<Spectrum>>(Const(Spectrum(0.f)),
+                                               Const(Spectrum(1.f)), mix));
+    std::shared_ptr<Texture<Float>> compiled = CompileTexture(mix);
+    std::shared_ptr<Texture<Spectrum>> compiledSpectrum =
+        CompileTexture<Spectrum>(spectrumScale);
+
+    SurfaceInteraction si;
+    for (Float u : {0.f, .3f, 1.f}) {
+        si.uv = Point2f(u, 0);
+        leaf->nEvaluations = 0;
+        Float expected = mix->Evaluate(si);
+        EXPECT_EQ(3, leaf->nEvaluations);
+        leaf->nEvaluations = 0;
+        EXPECT_EQ(expected, compiled->Evaluate(si));
+        EXPECT_EQ(1, leaf->nEvaluations);
+
+        leaf->nEvaluations = 0;
+        EXPECT_EQ(spectrumScale->Evaluate(si), compiledSpectrum->Evaluate(si));
+        EXPECT_EQ(4, leaf->nEvaluations);
+    }
+}
+
+TEST(TextureGraph, DiscardFoldedSubgraphs) {
+    // Neither the unused input of a mix with a constant amount nor a
+    // texture multiplied by zero should be evaluated
+    auto used = std::make_shared<CountingTexture>();
+    auto unused = std::make_shared<CountingTexture>();
+    std::shared_ptr<Texture<Float>> mix = std::make_shared<MixTexture<Float>>(
+        std::make_shared<ScaleTexture<Float, Float>>(used, Const<Float>(2)),
+        std::make_shared<ScaleTexture<Float, Float>>(unused, Const<Float>(3)),
+        Const<Float>(0));
+    std::shared_ptr<Texture<Float>> compiled = CompileTexture(mix);
+    SurfaceInteraction si;
+    si.uv = Point2f(.5f, 0);
+    EXPECT_EQ(1.f, compiled->Evaluate(si));
+    EXPECT_EQ(1, used->nEvaluations);
+    EXPECT_EQ(0, unused->nEvaluations);
+
+    // Graphs that fold entirely become constant textures
+    std::shared_ptr<Texture<Float>> zero =
+        std::make_shared<ScaleTexture<Float, Float>>(
+            std::make_shared<MixTexture<Float>>(unused, used, Const<Float>(1)),
+            Const<Float>(0));
+    std::shared_ptr<Texture<Float>> compiledZero = CompileTexture(zero);
+    EXPECT_TRUE(std::dynamic_pointer_cast<ConstantTexture<Float>>(
+                    compiledZero) != nullptr);
+    EXPECT_EQ(0.f, compiledZero->Evaluate(si));
+    EXPECT_EQ(1, used->nEvaluations);
+    EXPECT_EQ(0, unused->nEvaluations);
+}
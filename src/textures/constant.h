@@ -41,6 +41,7 @@
 // textures/constant.h*
 #include "pbrt.h"
 #include "texture.h"
+#include "texgraph.h"
 #include "paramset.h"
 
 namespace pbrt {
@@ -52,6 +53,10 @@ class ConstantTexture : public Texture<T> {
     // ConstantTexture Public Methods
     ConstantTexture(const T &value) : value(value) {}
     T Evaluate(const SurfaceInteraction &) const { return value; }
+    bool Compile(TextureCompiler *compiler, int *operand) const {
+        *operand = compiler->Constant(value);
+        return true;
+    }
 
   private:
     T value;
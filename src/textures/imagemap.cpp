@@ -42,65 +42,174 @@ namespace pbrt {
 template <typename Tmemory, typename Treturn>
 ImageTexture<Tmemory, Treturn>::ImageTexture(
     std::unique_ptr<TextureMapping2D> mapping, const std::string &filename,
-    bool doTrilinear, Float maxAniso, ImageWrap wrapMode, Float scale,
-    bool gamma)
+    bool doTrilinear, Float maxAniso, int maxProbes, ImageWrap wrapMode,
+    Float scale, bool gamma, TexelFormat format)
     : mapping(std::move(mapping)) {
-    mipmap =
-        GetTexture(filename, doTrilinear, maxAniso, wrapMode, scale, gamma);
+    // Load the image in the background while parsing continues
+    loadTask = RunAsync([this, filename, doTrilinear, maxAniso, maxProbes,
+                         wrapMode, scale, gamma, format]() {
+        mipmap = GetTexture(filename, doTrilinear, maxAniso, maxProbes,
+                            wrapMode, scale, gamma, format);
+    });
+    std::lock_guard<std::mutex> lock(texturesMutex);
+    pendingLoads.push_back(loadTask);
+}
+
+template <typename Tmemory, typename Treturn>
+ImageTexture<Tmemory, Treturn>::~ImageTexture() {
+    // The load task writes to _mipmap_, so it must finish first
+    loadTask->Wait();
+}
+
+template <typename Tmemory, typename Treturn>
+void ImageTexture<Tmemory, Treturn>::FinishLoading() {
+    std::vector<std::shared_ptr<AsyncTask>> loads;
+    {
+        std::lock_guard<std::mutex> lock(texturesMutex);
+        loads.swap(pendingLoads);
+    }
+    for (const std::shared_ptr<AsyncTask> &load : loads) load->Wait();
 }
 
 template <typename Tmemory, typename Treturn>
 MIPMap<Tmemory> *ImageTexture<Tmemory, Treturn>::GetTexture(
     const std::string &filename, bool doTrilinear, Float maxAniso,
-    ImageWrap wrap, Float scale, bool gamma) {
+    int maxProbes, ImageWrap wrap, Float scale, bool gamma,
+    TexelFormat format) {
     // Return _MIPMap_ from texture cache if present
-    TexInfo texInfo(filename, doTrilinear, maxAniso, wrap, scale, gamma);
-    if (textures.find(texInfo) != textures.end())
-        return textures[texInfo].get();
+    TexInfo texInfo(filename, doTrilinear, maxAniso, maxProbes, wrap, scale,
+                    gamma, format);
+    {
+        std::unique_lock<std::mutex> lock(texturesMutex);
+        auto iter = textures.find(texInfo);
+        if (iter != textures.end()) {
+            // Wait for the thread that is loading the image to finish
+            textureLoaded.wait(lock, [&]() { return bool(iter->second); });
+            return iter->second.get();
+        }
+        // Add an empty entry so that other textures using the same image
+        // wait for it instead of loading it again
+        textures[texInfo] = nullptr;
+    }
 
     // Create _MIPMap_ for _filename_
     ProfilePhase _(Prof::TextureLoading);
+    MIPMap<Tmemory> *mipmap = nullptr;
     Point2i resolution;
-    std::unique_ptr<RGBSpectrum[]> texels = ReadImage(filename, &resolution);
-    if (!texels) {
-        Warning("Creating a constant grey texture to replace \"%s\".",
-                filename.c_str());
-        resolution.x = resolution.y = 1;
-        RGBSpectrum *rgb = new RGBSpectrum[1];
-        *rgb = RGBSpectrum(0.5f);
-        texels.reset(rgb);
-    }
-
-    // Flip image in y; texture coordinate space has (0,0) at the lower
-    // left corner.
-    for (int y = 0; y < resolution.y / 2; ++y)
-        for (int x = 0; x < resolution.x; ++x) {
-            int o1 = y * resolution.x + x;
-            int o2 = (resolution.y - 1 - y) * resolution.x + x;
-            std::swap(texels[o1], texels[o2]);
+    std::unique_ptr<RGBSpectrum[]> texels;
+    if (HasExtension(filename, ".tmip")) {
+        // Page texels of tiled images in on demand
+        std::unique_ptr<TiledImage> image = TiledImage::Open(filename);
+        if (image)
+            mipmap = new MIPMap<Tmemory>(
+                std::move(image),
+                [scale, gamma](const RGBSpectrum &rgb) {
+                    Tmemory texel;
+                    convertIn(rgb, &texel, scale, gamma);
+                    return texel;
+                },
+                doTrilinear, maxAniso, wrap, maxProbes);
+    } else
+        texels = ReadImage(filename, &resolution);
+    if (!mipmap) {
+        if (!texels) {
+            Warning("Creating a constant grey texture to replace \"%s\".",
+                    filename.c_str());
+            resolution.x = resolution.y = 1;
+            RGBSpectrum *rgb = new RGBSpectrum[1];
+            *rgb = RGBSpectrum(0.5f);
+            texels.reset(rgb);
         }
 
-    MIPMap<Tmemory> *mipmap = nullptr;
-    if (texels) {
+        // Flip image in y; texture coordinate space has (0,0) at the lower
+        // left corner.
+        for (int y = 0; y < resolution.y / 2; ++y)
+            for (int x = 0; x < resolution.x; ++x) {
+                int o1 = y * resolution.x + x;
+                int o2 = (resolution.y - 1 - y) * resolution.x + x;
+                std::swap(texels[o1], texels[o2]);
+            }
+
         // Convert texels to type _Tmemory_ and create _MIPMap_
         std::unique_ptr<Tmemory[]> convertedTexels(
             new Tmemory[resolution.x * resolution.y]);
-        for (int i = 0; i < resolution.x * resolution.y; ++i)
+        ParallelFor([&](int64_t i) {
             convertIn(texels[i], &convertedTexels[i], scale, gamma);
+        }, resolution.x * resolution.y, 4096);
         mipmap = new MIPMap<Tmemory>(resolution, convertedTexels.get(),
-                                     doTrilinear, maxAniso, wrap);
-    } else {
-        // Create one-valued _MIPMap_
-        Tmemory oneVal = scale;
-        mipmap = new MIPMap<Tmemory>(Point2i(1, 1), &oneVal);
+                                     doTrilinear, maxAniso, wrap, maxProbes,
+                                     format, scale);
+    }
+
+    // Add _mipmap_ to the texture cache and wake up waiting threads
+    {
+        std::lock_guard<std::mutex> lock(texturesMutex);
+        textures[texInfo].reset(mipmap);
     }
-    textures[texInfo].reset(mipmap);
+    textureLoaded.notify_all();
     return mipmap;
 }
 
 template <typename Tmemory, typename Treturn>
 std::map<TexInfo, std::unique_ptr<MIPMap<Tmemory>>>
     ImageTexture<Tmemory, Treturn>::textures;
+template <typename Tmemory, typename Treturn>
+std::mutex ImageTexture<Tmemory, Treturn>::texturesMutex;
+template <typename Tmemory, typename Treturn>
+std::condition_variable ImageTexture<Tmemory, Treturn>::textureLoaded;
+template <typename Tmemory, typename Treturn>
+std::vector<std::shared_ptr<AsyncTask>>
+    ImageTexture<Tmemory, Treturn>::pendingLoads;
+// Chooses the filter function from the "filter" parameter or, for older
+// scenes, the "trilinear" flag. If both are given and disagree, "filter"
+// is used.
+static void TextureFilter(const TextureParams &tp, bool *trilerp,
+                          int *maxProbes) {
+    bool trilinearFlag = tp.FindBool("trilinear", false);
+    std::string filter = tp.FindString("filter", "");
+    if (filter.empty())
+        filter = trilinearFlag ? "trilinear" : "ewa";
+    else if (trilinearFlag && filter != "trilinear")
+        Warning("\"bool trilinear\" ignored for texture filter \"%s\"",
+                filter.c_str());
+    *trilerp = false;
+    *maxProbes = 0;
+    if (filter == "trilinear")
+        *trilerp = true;
+    else if (filter == "anisotropic")
+        *maxProbes = std::max(1, tp.FindInt("maxprobes", 8));
+    else if (filter != "ewa")
+        Error("Texture filter function \"%s\" unknown", filter.c_str());
+}
+
+// Chooses the in-memory texel format from the "storage" parameter. By
+// default, texels are stored at full precision; with "auto", texels of
+// 8-bit images are stored with a byte per channel and those of
+// floating-point images as half floats.
+static TexelFormat TexelStorage(const TextureParams &tp,
+                                const std::string &filename, bool gamma) {
+    std::string storage = tp.FindString("storage", "float");
+    if (storage == "auto") {
+        if (HasExtension(filename, ".png") || HasExtension(filename, ".tga"))
+            storage = "byte";
+        else if (HasExtension(filename, ".exr") ||
+                 HasExtension(filename, ".pfm"))
+            storage = "half";
+        else
+            storage = "float";
+    }
+    if (storage == "float")
+        return TexelFormat::Float;
+    else if (storage == "half")
+        return TexelFormat::Half;
+    else if (storage == "byte")
+        return gamma ? TexelFormat::SRGB8 : TexelFormat::Linear8;
+    else if (storage == "bc")
+        return gamma ? TexelFormat::SRGBBC : TexelFormat::LinearBC;
+    Error("Texel storage \"%s\" unknown", storage.c_str());
+    return TexelFormat::Float;
+}
+
 ImageTexture<Float, Float> *CreateImageFloatTexture(const Transform &tex2world,
                                                     const TextureParams &tp) {
     // Initialize 2D texture mapping _map_ from _tp_
@@ -128,7 +237,9 @@ ImageTexture<Float, Float> *CreateImageFloatTexture(const Transform &tex2world,
 
     // Initialize _ImageTexture_ parameters
     Float maxAniso = tp.FindFloat("maxanisotropy", 8.f);
-    bool trilerp = tp.FindBool("trilinear", false);
+    bool trilerp;
+    int maxProbes;
+    TextureFilter(tp, &trilerp, &maxProbes);
     std::string wrap = tp.FindString("wrap", "repeat");
     ImageWrap wrapMode = ImageWrap::Repeat;
     if (wrap == "black")
@@ -139,8 +250,10 @@ ImageTexture<Float, Float> *CreateImageFloatTexture(const Transform &tex2world,
     std::string filename = tp.FindFilename("filename");
     bool gamma = tp.FindBool("gamma", HasExtension(filename, ".tga") ||
                                           HasExtension(filename, ".png"));
+    TexelFormat format = TexelStorage(tp, filename, gamma);
     return new ImageTexture<Float, Float>(std::move(map), filename, trilerp,
-                                          maxAniso, wrapMode, scale, gamma);
+                                          maxAniso, maxProbes, wrapMode, scale,
+                                          gamma, format);
 }
 
 ImageTexture<RGBSpectrum, Spectrum> *CreateImageSpectrumTexture(
@@ -170,7 +283,9 @@ ImageTexture<RGBSpectrum, Spectrum> *CreateImageSpectrumTexture(
 
     // Initialize _ImageTexture_ parameters
     Float maxAniso = tp.FindFloat("maxanisotropy", 8.f);
-    bool trilerp = tp.FindBool("trilinear", false);
+    bool trilerp;
+    int maxProbes;
+    TextureFilter(tp, &trilerp, &maxProbes);
     std::string wrap = tp.FindString("wrap", "repeat");
     ImageWrap wrapMode = ImageWrap::Repeat;
     if (wrap == "black")
@@ -181,8 +296,10 @@ ImageTexture<RGBSpectrum, Spectrum> *CreateImageSpectrumTexture(
     std::string filename = tp.FindFilename("filename");
     bool gamma = tp.FindBool("gamma", HasExtension(filename, ".tga") ||
                                           HasExtension(filename, ".png"));
+    TexelFormat format = TexelStorage(tp, filename, gamma);
     return new ImageTexture<RGBSpectrum, Spectrum>(
-        std::move(map), filename, trilerp, maxAniso, wrapMode, scale, gamma);
+        std::move(map), filename, trilerp, maxAniso, maxProbes, wrapMode,
+        scale, gamma, format);
 }
 
 template class ImageTexture<Float, Float>;
@@ -43,32 +43,41 @@
 #include "texture.h"
 #include "mipmap.h"
 #include "paramset.h"
+#include "parallel.h"
+#include <condition_variable>
 #include <map>
+#include <mutex>
 
 namespace pbrt {
 
 // TexInfo Declarations
 struct TexInfo {
-    TexInfo(const std::string &f, bool dt, Float ma, ImageWrap wm, Float sc,
-            bool gamma)
+    TexInfo(const std::string &f, bool dt, Float ma, int mp, ImageWrap wm,
+            Float sc, bool gamma, TexelFormat format)
         : filename(f),
           doTrilinear(dt),
           maxAniso(ma),
+          maxProbes(mp),
           wrapMode(wm),
           scale(sc),
-          gamma(gamma) {}
+          gamma(gamma),
+          format(format) {}
     std::string filename;
     bool doTrilinear;
     Float maxAniso;
+    int maxProbes;
     ImageWrap wrapMode;
     Float scale;
     bool gamma;
+    TexelFormat format;
     bool operator<(const TexInfo &t2) const {
         if (filename != t2.filename) return filename < t2.filename;
         if (doTrilinear != t2.doTrilinear) return doTrilinear < t2.doTrilinear;
         if (maxAniso != t2.maxAniso) return maxAniso < t2.maxAniso;
+        if (maxProbes != t2.maxProbes) return maxProbes < t2.maxProbes;
         if (scale != t2.scale) return scale < t2.scale;
         if (gamma != t2.gamma) return !gamma;
+        if (format != t2.format) return format < t2.format;
         return wrapMode < t2.wrapMode;
     }
 };
@@ -80,8 +89,12 @@ class ImageTexture : public Texture<Treturn> {
     // ImageTexture Public Methods
     ImageTexture(std::unique_ptr<TextureMapping2D> m,
                  const std::string &filename, bool doTri, Float maxAniso,
-                 ImageWrap wm, Float scale, bool gamma);
+                 int maxProbes, ImageWrap wm, Float scale, bool gamma,
+                 TexelFormat format);
+    ~ImageTexture();
+    static void FinishLoading();
     static void ClearCache() {
+        FinishLoading();
         textures.erase(textures.begin(), textures.end());
     }
     Treturn Evaluate(const SurfaceInteraction &si) const {
@@ -97,7 +110,9 @@ class ImageTexture : public Texture<Treturn> {
     // ImageTexture Private Methods
     static MIPMap<Tmemory> *GetTexture(const std::string &filename,
                                        bool doTrilinear, Float maxAniso,
-                                       ImageWrap wm, Float scale, bool gamma);
+                                       int maxProbes, ImageWrap wm,
+                                       Float scale, bool gamma,
+                                       TexelFormat format);
     static void convertIn(const RGBSpectrum &from, RGBSpectrum *to, Float scale,
                           bool gamma) {
         for (int i = 0; i < RGBSpectrum::nSamples; ++i)
@@ -116,8 +131,12 @@ class ImageTexture : public Texture<Treturn> {
 
     // ImageTexture Private Data
     std::unique_ptr<TextureMapping2D> mapping;
-    MIPMap<Tmemory> *mipmap;
+    MIPMap<Tmemory> *mipmap = nullptr;
+    std::shared_ptr<AsyncTask> loadTask;
     static std::map<TexInfo, std::unique_ptr<MIPMap<Tmemory>>> textures;
+    static std::mutex texturesMutex;
+    static std::condition_variable textureLoaded;
+    static std::vector<std::shared_ptr<AsyncTask>> pendingLoads;
 };
 
 extern template class ImageTexture<Float, Float>;
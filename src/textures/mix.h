@@ -41,6 +41,7 @@
 // textures/mix.h*
 #include "pbrt.h"
 #include "texture.h"
+#include "texgraph.h"
 #include "paramset.h"
 
 namespace pbrt {
@@ -59,6 +60,11 @@ class MixTexture : public Texture<T> {
         Float amt = amount->Evaluate(si);
         return (1 - amt) * t1 + amt * t2;
     }
+    bool Compile(TextureCompiler *compiler, int *operand) const {
+        int t1 = compiler->Compile(tex1), t2 = compiler->Compile(tex2);
+        *operand = compiler->Mix<T>(t1, t2, compiler->Compile(amount));
+        return true;
+    }
 
   private:
     std::shared_ptr<Texture<T>> tex1, tex2;
@@ -35,6 +35,7 @@
 
 #include "error.h"
 #include "interaction.h"
+#include "parallel.h"
 #include "paramset.h"
 #include "stats.h"
 
@@ -49,8 +50,28 @@ namespace {
 int nActiveTextures;
 Ptex::PtexCache *cache;
 
-STAT_COUNTER("Texture/Ptex lookups", nLookups);
+// Each thread keeps the filter for the last texture it evaluated, indexed
+// by _ThreadIndex_; consecutive lookups tend to hit the same texture, and
+// holding a single texture reference per thread keeps the cache free to
+// evict everything else.
+struct ThreadFilter {
+    const void *owner = nullptr;
+    Ptex::PtexTexture *texture = nullptr;
+    Ptex::PtexFilter *filter = nullptr;
+
+    void Release() {
+        if (filter) filter->release();
+        if (texture) texture->release();
+        *this = ThreadFilter();
+    }
+};
+std::vector<ThreadFilter> threadFilters;
+
+STAT_PERCENT("Texture/Ptex lookups reusing thread's filter", nFilterReuses,
+             nLookups);
 STAT_COUNTER("Texture/Ptex files accessed", nFilesAccessed);
+STAT_COUNTER("Texture/Ptex file reopens", nFileReopens);
+STAT_COUNTER("Texture/Ptex peak files open", peakFilesOpen);
 STAT_COUNTER("Texture/Ptex block reads", nBlockReads);
 STAT_MEMORY_COUNTER("Memory/Ptex peak memory used", peakMemoryUsed);
 
@@ -66,13 +87,14 @@ PtexTexture<T>::PtexTexture(const std::string &filename, Float gamma)
     : filename(filename), gamma(gamma) {
     if (!cache) {
         CHECK_EQ(nActiveTextures, 0);
-        int maxFiles = 100;
-        size_t maxMem = 1ull << 32;  // 4GB
+        int maxFiles = PbrtOptions.ptexMaxFiles;
+        size_t maxMem = size_t(PbrtOptions.ptexCacheMB) << 20;
         bool premultiply = true;
 
         cache = Ptex::PtexCache::create(maxFiles, maxMem, premultiply, nullptr,
                                         &errorHandler);
         // TODO? cache->setSearchPath(...);
+        threadFilters.resize(MaxThreadIndex());
     }
     ++nActiveTextures;
 
@@ -97,11 +119,17 @@ PtexTexture<T>::PtexTexture(const std::string &filename, Float gamma)
 
 template <typename T>
 PtexTexture<T>::~PtexTexture() {
+    for (ThreadFilter &tf : threadFilters)
+        if (tf.owner == this) tf.Release();
+
     if (--nActiveTextures == 0) {
         LOG(INFO) << "Releasing ptex cache";
+        threadFilters.clear();
         Ptex::PtexCache::Stats stats;
         cache->getStats(stats);
         nFilesAccessed += stats.filesAccessed;
+        nFileReopens += stats.fileReopens;
+        peakFilesOpen = stats.peakFilesOpen;
         nBlockReads += stats.blockReads;
         peakMemoryUsed = stats.peakMemUsed;
 
@@ -140,20 +168,29 @@ T PtexTexture<T>::Evaluate(const SurfaceInteraction &si) const {
     if (!valid) return T{};
 
     ++nLookups;
-    Ptex::String error;
-    Ptex::PtexTexture *texture = cache->get(filename.c_str(), error);
-    CHECK(texture != nullptr);
-    // TODO: make the filter an option?
-    Ptex::PtexFilter::Options opts(Ptex::PtexFilter::FilterType::f_bspline);
-    Ptex::PtexFilter *filter = Ptex::PtexFilter::getFilter(texture, opts);
-    int nc = texture->numChannels();
+    // Get this thread's filter, creating one if it was last used for a
+    // different texture
+    CHECK_LT(ThreadIndex, (int)threadFilters.size());
+    ThreadFilter &tf = threadFilters[ThreadIndex];
+    if (tf.owner == this)
+        ++nFilterReuses;
+    else {
+        tf.Release();
+        Ptex::String error;
+        tf.texture = cache->get(filename.c_str(), error);
+        CHECK(tf.texture != nullptr);
+        // TODO: make the filter an option?
+        Ptex::PtexFilter::Options opts(
+            Ptex::PtexFilter::FilterType::f_bspline);
+        tf.filter = Ptex::PtexFilter::getFilter(tf.texture, opts);
+        tf.owner = this;
+    }
+    int nc = tf.texture->numChannels();
 
     float result[3];
     int firstChan = 0;
-    filter->eval(result, firstChan, nc, si.faceIndex, si.uv[0],
-                 si.uv[1], si.dudx, si.dvdx, si.dudy, si.dvdy);
-    filter->release();
-    texture->release();
+    tf.filter->eval(result, firstChan, nc, si.faceIndex, si.uv[0],
+                    si.uv[1], si.dudx, si.dvdx, si.dudy, si.dvdy);
 
     if (gamma != 1)
         for (int i = 0; i < nc; ++i)
@@ -41,6 +41,7 @@
 // textures/scale.h*
 #include "pbrt.h"
 #include "texture.h"
+#include "texgraph.h"
 #include "paramset.h"
 
 namespace pbrt {
@@ -56,6 +57,9 @@ class ScaleTexture : public Texture<T2> {
     T2 Evaluate(const SurfaceInteraction &si) const {
         return tex1->Evaluate(si) * tex2->Evaluate(si);
     }
+    bool Compile(TextureCompiler *compiler, int *operand) const {
+        return compiler->Scale(tex1, tex2, operand);
+    }
 
   private:
     // ScaleTexture Private Data
@@ -0,0 +1,486 @@
+//
+// bsdfbench.cpp
+//
+// Throughput and sampling-quality benchmark for pbrt's materials.
+//
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <tuple>
+#include "pbrt.h"
+#include "api.h"
+#include "chi2.h"
+#include "interaction.h"
+#include "material.h"
+#include "memory.h"
+#include "parallel.h"
+#include "paramset.h"
+#include "reflection.h"
+#include "rng.h"
+#include "sampling.h"
+#include "shapes/disk.h"
+#include "materials/disney.h"
+#include "materials/glass.h"
+#include "materials/hair.h"
+#include "materials/kdsubsurface.h"
+#include "materials/layered.h"
+#include "materials/matte.h"
+#include "materials/metal.h"
+#include "materials/mirror.h"
+#include "materials/mixmat.h"
+#include "materials/plastic.h"
+#include "materials/substrate.h"
+#include "materials/subsurface.h"
+#include "materials/translucent.h"
+#include "materials/uber.h"
+
+using namespace pbrt;
+
+static void usage(const char *msg = nullptr, ...) {
+    if (msg) {
+        va_list args;
+        va_start(args, msg);
+        fprintf(stderr, "bsdfbench: ");
+        vfprintf(stderr, msg, args);
+        fprintf(stderr, "\n");
+    }
+    fprintf(stderr, R"(usage: bsdfbench [options]
+
+Measures BSDF::f(), BSDF::Sample_f() and BSDF::Pdf() throughput for each
+material and runs chi^2 tests of the sampling routines in parallel.
+
+options:
+    --chi2runs <n>     Number of outgoing directions tested per material.
+                       Default: 5
+    --chi2samples <n>  Number of samples taken for each chi^2 test.
+                       Default: 1000000
+    --evals <n>        Number of evaluations used to measure throughput.
+                       Default: 1000000
+    --filter <str>     Only benchmark materials whose name contains <str>.
+    --nthreads <n>     Number of threads used for the chi^2 tests.
+                       Default: number of cores
+    --outfile <name>   Filename for the JSON report ("-" for stdout).
+                       Default: "bsdfbench.json"
+    --strict           Exit with a nonzero status if any chi^2 test fails.
+                       Some materials have known failures, so by default
+                       they are only reported.
+)");
+    exit(1);
+}
+
+// Sink for benchmark results so that the evaluations aren't optimized away
+static volatile Float sink;
+
+// Chi^2 Test Definitions
+// The tests use the helpers in core/chi2.h, as src/tests/bsdfs.cpp does,
+// but sample the full sphere of directions so that transmissive materials
+// are covered as well.
+struct Chi2Result {
+    Vector3f wo;
+    bool passed = false, skipped = false;
+    Float pValue = 0;
+    std::string message;
+};
+
+// Benchmark Material Definitions
+static void AddFloat(ParamSet &ps, const std::string &name, Float v) {
+    std::unique_ptr<Float[]> value(new Float[1]);
+    value[0] = v;
+    ps.AddFloat(name, std::move(value), 1);
+}
+
+static void AddRGB(ParamSet &ps, const std::string &name, Float r, Float g,
+                   Float b) {
+    std::unique_ptr<Float[]> value(new Float[3]);
+    value[0] = r;
+    value[1] = g;
+    value[2] = b;
+    ps.AddRGBSpectrum(name, std::move(value), 3);
+}
+
+static std::shared_ptr<Material> CreateBenchMaterial(
+    const std::string &type, const ParamSet &params,
+    const std::shared_ptr<Material> &m1 = nullptr,
+    const std::shared_ptr<Material> &m2 = nullptr) {
+    ParamSet geomParams;
+    std::map<std::string, std::shared_ptr<Texture<Float>>> floatTextures;
+    std::map<std::string, std::shared_ptr<Texture<Spectrum>>> spectrumTextures;
+    TextureParams mp(geomParams, params, floatTextures, spectrumTextures);
+    Material *material = nullptr;
+    if (type == "matte")
+        material = CreateMatteMaterial(mp);
+    else if (type == "plastic")
+        material = CreatePlasticMaterial(mp);
+    else if (type == "translucent")
+        material = CreateTranslucentMaterial(mp);
+    else if (type == "glass")
+        material = CreateGlassMaterial(mp);
+    else if (type == "mirror")
+        material = CreateMirrorMaterial(mp);
+    else if (type == "hair")
+        material = CreateHairMaterial(mp);
+    else if (type == "disney")
+        material = CreateDisneyMaterial(mp);
+    else if (type == "mix")
+        material = CreateMixMaterial(mp, m1, m2);
+    else if (type == "layered")
+        material = CreateLayeredMaterial(mp, m1);
+    else if (type == "metal")
+        material = CreateMetalMaterial(mp);
+    else if (type == "substrate")
+        material = CreateSubstrateMaterial(mp);
+    else if (type == "uber")
+        material = CreateUberMaterial(mp);
+    else if (type == "subsurface")
+        material = CreateSubsurfaceMaterial(mp);
+    else if (type == "kdsubsurface")
+        material = CreateKdSubsurfaceMaterial(mp);
+    else
+        LOG(FATAL) << "Unknown material type \"" << type << "\"";
+    return std::shared_ptr<Material>(material);
+}
+
+struct BenchCase {
+    std::string name;
+    std::shared_ptr<Material> material;
+};
+
+// The "fourier" material isn't included since it requires measured data
+// from disk.
+static std::vector<BenchCase> CreateBenchCases() {
+    std::vector<BenchCase> cases;
+    auto add = [&](const std::string &name, const std::string &type,
+                   const ParamSet &ps) {
+        cases.push_back({name, CreateBenchMaterial(type, ps)});
+    };
+    ParamSet ps;
+    AddRGB(ps, "Kd", .5, .5, .5);
+    add("matte", "matte", ps);
+
+    ps = ParamSet();
+    AddFloat(ps, "sigma", 20);
+    add("matte (sigma 20)", "matte", ps);
+
+    ps = ParamSet();
+    AddFloat(ps, "roughness", .3);
+    add("plastic (roughness .3)", "plastic", ps);
+
+    ps = ParamSet();
+    add("translucent", "translucent", ps);
+
+    ps = ParamSet();
+    add("glass", "glass", ps);
+
+    ps = ParamSet();
+    AddFloat(ps, "roughness", .2);
+    add("glass (roughness .2)", "glass", ps);
+
+    ps = ParamSet();
+    add("mirror", "mirror", ps);
+
+    ps = ParamSet();
+    AddFloat(ps, "roughness", .1);
+    add("metal (roughness .1)", "metal", ps);
+
+    ps = ParamSet();
+    AddFloat(ps, "uroughness", .3);
+    AddFloat(ps, "vroughness", .05);
+    add("metal (anisotropic .3/.05)", "metal", ps);
+
+    ps = ParamSet();
+    add("substrate", "substrate", ps);
+
+    ps = ParamSet();
+    AddRGB(ps, "Kt", .2, .2, .2);
+    AddFloat(ps, "roughness", .2);
+    add("uber (transmissive)", "uber", ps);
+
+    ps = ParamSet();
+    add("disney", "disney", ps);
+
+    ps = ParamSet();
+    AddFloat(ps, "sheen", .5);
+    AddFloat(ps, "clearcoat", 1);
+    AddFloat(ps, "roughness", .3);
+    AddFloat(ps, "metallic", .3);
+    add("disney (sheen, clearcoat)", "disney", ps);
+
+    ps = ParamSet();
+    AddFloat(ps, "spectrans", .7);
+    AddFloat(ps, "roughness", .3);
+    add("disney (spectrans)", "disney", ps);
+
+    ps = ParamSet();
+    add("hair", "hair", ps);
+
+    ps = ParamSet();
+    AddFloat(ps, "roughness", .2);
+    add("subsurface (roughness .2)", "subsurface", ps);
+
+    ps = ParamSet();
+    AddFloat(ps, "uroughness", .2);
+    AddFloat(ps, "vroughness", .2);
+    add("kdsubsurface (roughness .2)", "kdsubsurface", ps);
+
+    ParamSet matteParams, plasticParams;
+    std::shared_ptr<Material> matte =
+        CreateBenchMaterial("matte", matteParams);
+    AddFloat(plasticParams, "roughness", .05);
+    std::shared_ptr<Material> plastic =
+        CreateBenchMaterial("plastic", plasticParams);
+    ps = ParamSet();
+    cases.push_back({"mix (matte, plastic)",
+                     CreateBenchMaterial("mix", ps, matte, plastic)});
+
+    ps = ParamSet();
+    AddFloat(ps, "roughness", .1);
+    cases.push_back(
+        {"layered (matte base)", CreateBenchMaterial("layered", ps, matte)});
+    return cases;
+}
+
+// Create a surface interaction on a disk that materials can be evaluated at.
+static SurfaceInteraction BenchInteraction(const Shape &disk) {
+    // Offset slightly so we don't hit the center of the disk
+    Ray r(Point3f(0.1, 1, 0.2), Vector3f(0, -1, 0));
+    Float tHit;
+    SurfaceInteraction isect;
+    CHECK(disk.Intersect(r, &tHit, &isect));
+    return isect;
+}
+
+// Throughput Definitions
+struct Throughput {
+    double scatteringFunctions = 0, f = 0, sampleF = 0, pdf = 0;
+};
+
+template <typename Func>
+static double EvalsPerSecond(int nEvals, Func func) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nEvals; ++i) func(i);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return nEvals / std::max(elapsed.count(), 1e-9);
+}
+
+static Throughput MeasureThroughput(const Material &material,
+                                    const SurfaceInteraction &isectBase,
+                                    int nEvals) {
+    MemoryArena arena;
+    Throughput t;
+
+    // Measure the cost of creating the BSDF itself
+    int nSetup = std::max(1, nEvals / 16);
+    t.scatteringFunctions = EvalsPerSecond(nSetup, [&](int) {
+        SurfaceInteraction isect = isectBase;
+        material.ComputeScatteringFunctions(&isect, arena,
+                                            TransportMode::Radiance, true);
+        sink = sink + (isect.bsdf ? isect.bsdf->NumComponents() : 0);
+        arena.Reset();
+    });
+
+    // Precompute a small set of directions that stays in the cache
+    SurfaceInteraction isect = isectBase;
+    material.ComputeScatteringFunctions(&isect, arena, TransportMode::Radiance,
+                                        true);
+    const BSDF *bsdf = isect.bsdf;
+    if (!bsdf) return t;
+    const int nDirections = 4096;
+    std::vector<Vector3f> wo(nDirections), wi(nDirections);
+    std::vector<Point2f> u(nDirections);
+    RNG rng;
+    for (int i = 0; i < nDirections; ++i) {
+        Point2f u0{rng.UniformFloat(), rng.UniformFloat()};
+        Point2f u1{rng.UniformFloat(), rng.UniformFloat()};
+        wo[i] = bsdf->LocalToWorld(CosineSampleHemisphere(u0));
+        wi[i] = UniformSampleSphere(u1);
+        u[i] = Point2f{rng.UniformFloat(), rng.UniformFloat()};
+    }
+
+    t.f = EvalsPerSecond(nEvals, [&](int i) {
+        int j = i & (nDirections - 1);
+        sink = sink + bsdf->f(wo[j], wi[j]).y();
+    });
+    t.sampleF = EvalsPerSecond(nEvals, [&](int i) {
+        int j = i & (nDirections - 1);
+        Vector3f w;
+        Float pdf;
+        sink = sink + bsdf->Sample_f(wo[j], &w, u[j], &pdf).y() + pdf;
+    });
+    t.pdf = EvalsPerSecond(nEvals, [&](int i) {
+        int j = i & (nDirections - 1);
+        sink = sink + bsdf->Pdf(wo[j], wi[j]);
+    });
+    return t;
+}
+
+// JSON Report Definitions
+// Escapes quotes, backslashes and control characters for a JSON string
+static std::string JSONEscape(const std::string &s) {
+    std::string escaped;
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            escaped += std::string("\\") + c;
+        else if (c == '\n')
+            escaped += "\\n";
+        else if ((unsigned char)c < 0x20)
+            escaped += StringPrintf("\\u%04x", c);
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+static void WriteReport(FILE *f, int nEvals, int chi2Samples,
+                        const std::vector<BenchCase> &cases,
+                        const std::vector<Throughput> &throughput,
+                        const std::vector<std::vector<Chi2Result>> &chi2) {
+    fprintf(f, "{\n  \"evaluations\": %d,\n  \"chi2samples\": %d,\n", nEvals,
+            chi2Samples);
+    fprintf(f, "  \"threads\": %d,\n  \"materials\": [\n", MaxThreadIndex());
+    for (size_t c = 0; c < cases.size(); ++c) {
+        const Throughput &t = throughput[c];
+        bool passed = true;
+        for (const Chi2Result &r : chi2[c]) passed &= r.passed || r.skipped;
+        fprintf(f, "    {\n      \"name\": \"%s\",\n",
+                JSONEscape(cases[c].name).c_str());
+        fprintf(f,
+                "      \"throughput\": { \"ComputeScatteringFunctions\": %.6g, "
+                "\"f\": %.6g, \"Sample_f\": %.6g, \"Pdf\": %.6g },\n",
+                t.scatteringFunctions, t.f, t.sampleF, t.pdf);
+        fprintf(f, "      \"chi2passed\": %s,\n      \"chi2\": [\n",
+                passed ? "true" : "false");
+        for (size_t i = 0; i < chi2[c].size(); ++i) {
+            const Chi2Result &r = chi2[c][i];
+            fprintf(f,
+                    "        { \"wo\": [%f, %f, %f], \"skipped\": %s, "
+                    "\"passed\": %s, \"pvalue\": %g, \"message\": \"%s\" }%s\n",
+                    r.wo.x, r.wo.y, r.wo.z, r.skipped ? "true" : "false",
+                    r.passed ? "true" : "false", r.pValue,
+                    JSONEscape(r.message).c_str(),
+                    i + 1 < chi2[c].size() ? "," : "");
+        }
+        fprintf(f, "      ]\n    }%s\n", c + 1 < cases.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+int main(int argc, char *argv[]) {
+    int nEvals = 1000000, chi2Samples = 1000000, chi2Runs = 5;
+    const char *outfile = "bsdfbench.json";
+    std::string filter;
+    bool strict = false;
+    Options opt;
+    opt.quiet = true;
+
+    for (int i = 1; i < argc; ++i) {
+        auto intArg = [&](const char *name) {
+            if (i + 1 == argc) usage("missing value after %s", name);
+            int v = atoi(argv[++i]);
+            if (v <= 0) usage("%s must be positive", name);
+            return v;
+        };
+        if (!strcmp(argv[i], "--evals"))
+            nEvals = intArg(argv[i]);
+        else if (!strcmp(argv[i], "--chi2samples"))
+            chi2Samples = intArg(argv[i]);
+        else if (!strcmp(argv[i], "--chi2runs"))
+            chi2Runs = intArg(argv[i]);
+        else if (!strcmp(argv[i], "--nthreads"))
+            opt.nThreads = intArg(argv[i]);
+        else if (!strcmp(argv[i], "--strict"))
+            strict = true;
+        else if (!strcmp(argv[i], "--outfile")) {
+            if (i + 1 == argc) usage("missing filename after --outfile");
+            outfile = argv[++i];
+        } else if (!strcmp(argv[i], "--filter")) {
+            if (i + 1 == argc) usage("missing string after --filter");
+            filter = argv[++i];
+        } else
+            usage("unknown argument \"%s\"", argv[i]);
+    }
+    pbrtInit(opt);
+
+    std::vector<BenchCase> cases = CreateBenchCases();
+    if (!filter.empty())
+        cases.erase(std::remove_if(cases.begin(), cases.end(),
+                                   [&](const BenchCase &c) {
+                                       return c.name.find(filter) ==
+                                              std::string::npos;
+                                   }),
+                    cases.end());
+    Transform t = RotateX(-90), tInv = Inverse(t);
+    Disk disk(&t, &tInv, false, 0., 1., 0, 360.);
+    SurfaceInteraction isect = BenchInteraction(disk);
+
+    // Measure throughput one material at a time on the main thread
+    std::vector<Throughput> throughput;
+    fprintf(stderr, "%-32s %12s %12s %12s %12s\n", "material", "setup/s",
+            "f/s", "Sample_f/s", "Pdf/s");
+    for (const BenchCase &c : cases) {
+        throughput.push_back(MeasureThroughput(*c.material, isect, nEvals));
+        const Throughput &tp = throughput.back();
+        fprintf(stderr, "%-32s %12.4g %12.4g %12.4g %12.4g\n", c.name.c_str(),
+                tp.scatteringFunctions, tp.f, tp.sampleF, tp.pdf);
+    }
+
+    // Run the chi^2 tests for all materials and directions in parallel
+    const int thetaRes = 10, phiRes = 2 * thetaRes;
+    int nTests = cases.size() * chi2Runs;
+    std::vector<std::vector<Chi2Result>> chi2(
+        cases.size(), std::vector<Chi2Result>(chi2Runs));
+    ParallelFor([&](int64_t index) {
+        int c = index / chi2Runs, run = index % chi2Runs;
+        Chi2Result &result = chi2[c][run];
+        MemoryArena arena;
+        SurfaceInteraction si = isect;
+        cases[c].material->ComputeScatteringFunctions(
+            &si, arena, TransportMode::Radiance, true);
+        RNG rng(index);
+        result.wo = si.bsdf ? si.bsdf->LocalToWorld(CosineSampleHemisphere(
+                                  Point2f{rng.UniformFloat(),
+                                          rng.UniformFloat()}))
+                            : Vector3f(0, 0, 1);
+        if (!si.bsdf ||
+            si.bsdf->NumComponents(BxDFType(BSDF_ALL & ~BSDF_SPECULAR)) == 0) {
+            result.skipped = true;
+            result.message = "No non-specular components";
+            return;
+        }
+        std::vector<Float> frequencies(thetaRes * phiRes),
+            expFrequencies(thetaRes * phiRes);
+        BSDFFrequencyTable(si.bsdf, result.wo, rng, chi2Samples, thetaRes,
+                           phiRes, &frequencies[0]);
+        IntegrateBSDFFrequencyTable(si.bsdf, result.wo, chi2Samples,
+                                    thetaRes, phiRes, &expFrequencies[0]);
+        std::tie(result.passed, result.message) =
+            Chi2Test(&frequencies[0], &expFrequencies[0], thetaRes * phiRes,
+                     chi2Samples, 5, .01, nTests, &result.pValue);
+    }, nTests);
+
+    int nFailed = 0;
+    for (size_t c = 0; c < cases.size(); ++c)
+        for (const Chi2Result &r : chi2[c])
+            if (!r.passed && !r.skipped) {
+                fprintf(stderr, "chi^2 test failed for \"%s\": %s\n",
+                        cases[c].name.c_str(), r.message.c_str());
+                ++nFailed;
+            }
+
+    FILE *f = strcmp(outfile, "-") ? fopen(outfile, "w") : stdout;
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", outfile, strerror(errno));
+        return 1;
+    }
+    WriteReport(f, nEvals, chi2Samples, cases, throughput, chi2);
+    if (f != stdout) fclose(f);
+
+    pbrtCleanup();
+    return (strict && nFailed > 0) ? 1 : 0;
+}
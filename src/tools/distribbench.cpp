@@ -0,0 +1,128 @@
+//
+// distribbench.cpp
+//
+// Construction and sampling throughput benchmarks for Distribution1D with
+// CDF inversion and with alias tables.
+//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <cmath>
+#include "pbrt.h"
+#include "api.h"
+#include "rng.h"
+#include "sampling.h"
+
+using namespace pbrt;
+
+static void usage(const char *msg = nullptr, ...) {
+    if (msg) {
+        va_list args;
+        va_start(args, msg);
+        fprintf(stderr, "distribbench: ");
+        vfprintf(stderr, msg, args);
+        fprintf(stderr, "\n");
+    }
+    fprintf(stderr, R"(usage: distribbench [options]
+
+Measures the time to build a Distribution1D and the rate at which it takes
+discrete and continuous samples, using both binary search over its CDF and
+an alias table, for distributions of 10 to 10M entries. Each size is run
+with uniformly distributed values and with a heavily skewed distribution
+where a few entries hold most of the probability.
+
+options:
+    --filter <str>      Only run benchmarks whose name contains <str>.
+    --maxsize <n>       Largest distribution size. Default: 10000000
+    --samples <n>       Number of samples taken per benchmark.
+                        Default: 10000000
+)");
+    exit(1);
+}
+
+// Sink for benchmark results so that the sampling isn't optimized away
+static volatile Float sink;
+
+template <typename F>
+static double Seconds(F func) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static void Benchmark(const char *funcName, const std::vector<Float> &func,
+                      const std::vector<Float> &u, const std::string &filter) {
+    std::string prefix = StringPrintf("%s/%d/", funcName, int(func.size()));
+    for (bool alias : {false, true}) {
+        std::string name = prefix + (alias ? "alias" : "cdf");
+        if (name.find(filter) == std::string::npos) continue;
+
+        std::unique_ptr<Distribution1D> distrib;
+        double buildSeconds = Seconds([&]() {
+            distrib.reset(
+                new Distribution1D(&func[0], int(func.size()), alias));
+        });
+        Float sum = 0;
+        double discreteSeconds = Seconds([&]() {
+            for (Float ui : u) sum += distrib->SampleDiscrete(ui);
+        });
+        double continuousSeconds = Seconds([&]() {
+            Float pdf;
+            for (Float ui : u) sum += distrib->SampleContinuous(ui, &pdf);
+        });
+        sink = sink + sum;
+
+        printf("%-26s build %9.3f ms  %7.1f MB  discrete %8.2f Msamples/s  "
+               "continuous %8.2f Msamples/s\n",
+               name.c_str(), buildSeconds * 1e3,
+               distrib->BytesUsed() / (1024. * 1024.),
+               u.size() / std::max(discreteSeconds, 1e-9) * 1e-6,
+               u.size() / std::max(continuousSeconds, 1e-9) * 1e-6);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int maxSize = 10000000, nSamples = 10000000;
+    std::string filter;
+    Options opt;
+    opt.quiet = true;
+    for (int i = 1; i < argc; ++i) {
+        auto intArg = [&](const char *name) {
+            if (i + 1 == argc) usage("missing value after %s", name);
+            int v = atoi(argv[++i]);
+            if (v <= 0) usage("%s must be positive", name);
+            return v;
+        };
+        if (!strcmp(argv[i], "--maxsize"))
+            maxSize = intArg(argv[i]);
+        else if (!strcmp(argv[i], "--samples"))
+            nSamples = intArg(argv[i]);
+        else if (!strcmp(argv[i], "--filter")) {
+            if (i + 1 == argc) usage("missing string after --filter");
+            filter = argv[++i];
+        } else
+            usage("unknown argument \"%s\"", argv[i]);
+    }
+    pbrtInit(opt);
+
+    RNG rng;
+    std::vector<Float> u(nSamples);
+    for (Float &ui : u) ui = rng.UniformFloat();
+
+    for (int size = 10; size <= maxSize; size *= 10) {
+        std::vector<Float> uniform(size), skewed(size);
+        for (int i = 0; i < size; ++i) {
+            uniform[i] = rng.UniformFloat();
+            skewed[i] = std::pow(rng.UniformFloat(), Float(32));
+        }
+        Benchmark("uniform", uniform, u, filter);
+        Benchmark("skewed", skewed, u, filter);
+    }
+
+    pbrtCleanup();
+    return 0;
+}
@@ -14,6 +14,8 @@
 #include "pbrt.h"
 #include "spectrum.h"
 #include "parallel.h"
+#include "mipmap.h"
+#include "texcache.h"
 extern "C" {
 #include "ext/ArHosekSkyModel.h"
 }
@@ -31,7 +33,7 @@ static void usage(const char *msg = nullptr, ...) {
     }
     fprintf(stderr, R"(usage: imgtool <command> [options] <filenames...>
 
-commands: assemble, cat, convert, diff, info, makesky
+commands: assemble, cat, convert, diff, info, makesky, maketiled
 
 assemble option:
     --outfile          Output image filename.
@@ -80,6 +82,14 @@ makesky options:
                        (Horizontal resolution is twice this value.)
                        Default: 2048
 
+maketiled options (usage: imgtool maketiled [options] <input> <output.tmip>):
+    --gamma            Convert texels from sRGB to linear before filtering.
+                       Default: enabled for .png and .tga inputs
+    --nogamma          Keep texel values as they are stored in the input.
+    --tilesize <n>     Resolution of the square tiles. Default: 64
+    --wrap <mode>      Wrap mode used when resampling to a power-of-two
+                       resolution: repeat, black or clamp. Default: repeat
+
 )");
     exit(1);
 }
@@ -187,6 +197,76 @@ int makesky(int argc, char *argv[]) {
     return 0;
 }
 
+int maketiled(int argc, char *argv[]) {
+    int tileSize = 64;
+    ImageWrap wrapMode = ImageWrap::Repeat;
+    int gamma = -1;  // Use the default for the input format
+
+    int i;
+    for (i = 0; i < argc; ++i) {
+        if (argv[i][0] != '-') break;
+        if (!strcmp(argv[i], "--gamma") || !strcmp(argv[i], "-gamma"))
+            gamma = 1;
+        else if (!strcmp(argv[i], "--nogamma") || !strcmp(argv[i], "-nogamma"))
+            gamma = 0;
+        else if (!strcmp(argv[i], "--tilesize") ||
+                 !strcmp(argv[i], "-tilesize")) {
+            if (i + 1 == argc) usage("missing value after %s flag", argv[i]);
+            tileSize = atoi(argv[++i]);
+            if (tileSize <= 0) usage("--tilesize value must be positive");
+        } else if (!strcmp(argv[i], "--wrap") || !strcmp(argv[i], "-wrap")) {
+            if (i + 1 == argc) usage("missing value after %s flag", argv[i]);
+            std::string wrap = argv[++i];
+            if (wrap == "repeat")
+                wrapMode = ImageWrap::Repeat;
+            else if (wrap == "black")
+                wrapMode = ImageWrap::Black;
+            else if (wrap == "clamp")
+                wrapMode = ImageWrap::Clamp;
+            else
+                usage("unknown wrap mode \"%s\"", wrap.c_str());
+        } else
+            usage("unknown \"maketiled\" option \"%s\"", argv[i]);
+    }
+    if (i + 2 != argc)
+        usage("expected input and output filenames for \"maketiled\"");
+    const char *infile = argv[i], *outfile = argv[i + 1];
+    if (!HasExtension(outfile, ".tmip"))
+        usage("output filename \"%s\" must have a \".tmip\" extension",
+              outfile);
+
+    Point2i res;
+    std::unique_ptr<RGBSpectrum[]> texels = ReadImage(infile, &res);
+    if (!texels) {
+        fprintf(stderr, "%s: unable to read image\n", infile);
+        return 1;
+    }
+    if (gamma == -1)
+        gamma = HasExtension(infile, ".png") || HasExtension(infile, ".tga");
+
+    // Flip and linearize texels the same way _ImageTexture_ does
+    for (int y = 0; y < res.y / 2; ++y)
+        for (int x = 0; x < res.x; ++x)
+            std::swap(texels[y * res.x + x], texels[(res.y - 1 - y) * res.x + x]);
+    if (gamma)
+        for (int j = 0; j < res.x * res.y; ++j)
+            for (int c = 0; c < RGBSpectrum::nSamples; ++c)
+                texels[j][c] = InverseGammaCorrect(texels[j][c]);
+
+    // Build the MIP pyramid in memory and write it out tile by tile
+    ParallelInit();
+    MIPMap<RGBSpectrum> mipmap(res, texels.get(), false, 8.f, wrapMode);
+    std::vector<Point2i> levelResolution;
+    for (int level = 0; level < mipmap.Levels(); ++level)
+        levelResolution.push_back(mipmap.LevelResolution(level));
+    bool ok = WriteTiledImage(outfile, tileSize, levelResolution,
+                              [&](int level, int s, int t) {
+                                  return mipmap.Texel(level, s, t);
+                              });
+    ParallelCleanup();
+    return ok ? 0 : 1;
+}
+
 int assemble(int argc, char *argv[]) {
     if (argc == 0) usage("no filenames provided to \"assemble\"?");
     const char *outfile = nullptr;
@@ -779,6 +859,8 @@ int main(int argc, char *argv[]) {
         return info(argc - 2, argv + 2);
     else if (!strcmp(argv[1], "makesky"))
         return makesky(argc - 2, argv + 2);
+    else if (!strcmp(argv[1], "maketiled"))
+        return maketiled(argc - 2, argv + 2);
     else
         usage("unknown command \"%s\"", argv[1]);
 
@@ -0,0 +1,359 @@
+//
+// texbench.cpp
+//
+// Throughput benchmarks for pbrt's MIPMap texture filtering and procedural
+// noise textures.
+//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "pbrt.h"
+#include "api.h"
+#include "interaction.h"
+#include "mipmap.h"
+#include "parallel.h"
+#include "paramset.h"
+#include "rng.h"
+#include "textures/fbm.h"
+#include "textures/marble.h"
+#include "textures/windy.h"
+#include "textures/wrinkled.h"
+
+using namespace pbrt;
+
+static void usage(const char *msg = nullptr, ...) {
+    if (msg) {
+        va_list args;
+        va_start(args, msg);
+        fprintf(stderr, "texbench: ");
+        vfprintf(stderr, msg, args);
+        fprintf(stderr, "\n");
+    }
+    fprintf(stderr, R"(usage: texbench [options]
+
+Measures MIPMap::Lookup() throughput for the trilinear, EWA and bounded-probe
+anisotropic filters across a range of filter footprint anisotropies. The
+EWA filter is also compared against a straightforward scalar implementation
+that fetches every texel in the ellipse's bounding box.
+
+Also measures the evaluation rate of Perlin noise, evaluated one point at a
+time and in batches, of FBm() and Turbulence(), and of the fbm, wrinkled,
+windy and marble procedural textures.
+
+options:
+    --filter <str>      Only run benchmarks whose name contains <str>.
+    --lookups <n>       Number of lookups or texture evaluations per
+                        benchmark. Default: 1000000
+    --resolution <n>    Resolution of the benchmark texture. Default: 1024
+)");
+    exit(1);
+}
+
+// Sink for benchmark results so that the lookups aren't optimized away
+static volatile Float sink;
+
+static Float Value(Float v) { return v; }
+static Float Value(const RGBSpectrum &s) { return s.y(); }
+
+struct Footprint {
+    Point2f st;
+    Vector2f dst0, dst1;
+};
+
+// Generates randomly oriented filter footprints with the given ratio of
+// major to minor axis length; the minor axis covers about one texel of the
+// given level.
+static std::vector<Footprint> GenerateFootprints(int n, Float anisotropy,
+                                                 int resolution) {
+    RNG rng;
+    std::vector<Footprint> footprints(n);
+    for (Footprint &f : footprints) {
+        f.st = Point2f(rng.UniformFloat(), rng.UniformFloat());
+        Float minor = (1 + 3 * rng.UniformFloat()) / resolution;
+        Float phi = 2 * Pi * rng.UniformFloat();
+        Vector2f dir(std::cos(phi), std::sin(phi));
+        f.dst0 = anisotropy * minor * dir;
+        f.dst1 = minor * Vector2f(-dir.y, dir.x);
+    }
+    return footprints;
+}
+
+// Scalar EWA filter that fetches every texel of the ellipse's bounding box
+// through MIPMap::Texel(); used as a baseline for the optimized filter.
+template <typename T>
+static T ReferenceEWA(const MIPMap<T> &mipmap, int level, Point2f st,
+                      Vector2f dst0, Vector2f dst1) {
+    if (level >= mipmap.Levels())
+        return mipmap.Texel(mipmap.Levels() - 1, 0, 0);
+    const Point2i &res = mipmap.LevelResolution(level);
+    st[0] = st[0] * res[0] - 0.5f;
+    st[1] = st[1] * res[1] - 0.5f;
+    dst0[0] *= res[0];
+    dst0[1] *= res[1];
+    dst1[0] *= res[0];
+    dst1[1] *= res[1];
+    Float A = dst0[1] * dst0[1] + dst1[1] * dst1[1] + 1;
+    Float B = -2 * (dst0[0] * dst0[1] + dst1[0] * dst1[1]);
+    Float C = dst0[0] * dst0[0] + dst1[0] * dst1[0] + 1;
+    Float invF = 1 / (A * C - B * B * 0.25f);
+    A *= invF;
+    B *= invF;
+    C *= invF;
+    Float det = -B * B + 4 * A * C;
+    Float invDet = 1 / det;
+    Float uSqrt = std::sqrt(det * C), vSqrt = std::sqrt(A * det);
+    int s0 = std::ceil(st[0] - 2 * invDet * uSqrt);
+    int s1 = std::floor(st[0] + 2 * invDet * uSqrt);
+    int t0 = std::ceil(st[1] - 2 * invDet * vSqrt);
+    int t1 = std::floor(st[1] + 2 * invDet * vSqrt);
+    T sum(0.f);
+    Float sumWts = 0;
+    for (int it = t0; it <= t1; ++it) {
+        Float tt = it - st[1];
+        for (int is = s0; is <= s1; ++is) {
+            Float ss = is - st[0];
+            Float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
+            if (r2 < 1) {
+                const int lutSize = 128;
+                int index = std::min((int)(r2 * lutSize), lutSize - 1);
+                Float alpha = 2, lr2 = Float(index) / Float(lutSize - 1);
+                Float weight = std::exp(-alpha * lr2) - std::exp(-alpha);
+                sum += mipmap.Texel(level, is, it) * weight;
+                sumWts += weight;
+            }
+        }
+    }
+    return sum / sumWts;
+}
+
+template <typename T>
+static T ReferenceLookup(const MIPMap<T> &mipmap, Float maxAnisotropy,
+                         const Point2f &st, Vector2f dst0, Vector2f dst1) {
+    if (dst0.LengthSquared() < dst1.LengthSquared()) std::swap(dst0, dst1);
+    Float majorLength = dst0.Length(), minorLength = dst1.Length();
+    if (minorLength * maxAnisotropy < majorLength && minorLength > 0) {
+        Float scale = majorLength / (minorLength * maxAnisotropy);
+        dst1 *= scale;
+        minorLength *= scale;
+    }
+    if (minorLength == 0) return mipmap.Lookup(st, 0.f);
+    Float lod =
+        std::max((Float)0, mipmap.Levels() - (Float)1 + Log2(minorLength));
+    int ilod = std::floor(lod);
+    return Lerp(lod - ilod, ReferenceEWA(mipmap, ilod, st, dst0, dst1),
+                ReferenceEWA(mipmap, ilod + 1, st, dst0, dst1));
+}
+
+struct BenchResult {
+    Float lookupsPerSecond;
+    std::vector<Float> values;
+};
+
+template <typename P, typename F>
+static BenchResult Run(const std::vector<P> &points, F lookup) {
+    BenchResult result;
+    result.values.reserve(points.size());
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const P &p : points) result.values.push_back(lookup(p));
+    auto end = std::chrono::high_resolution_clock::now();
+    Float seconds = std::chrono::duration<Float>(end - start).count();
+    result.lookupsPerSecond = points.size() / std::max(seconds, (Float)1e-9);
+    for (Float v : result.values) sink = sink + v;
+    return result;
+}
+
+// Returns the relative RMS difference between two sets of lookup results
+static Float RelativeRMS(const std::vector<Float> &a,
+                         const std::vector<Float> &b) {
+    double sumSqDiff = 0, sumSq = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        sumSqDiff += (a[i] - b[i]) * (a[i] - b[i]);
+        sumSq += b[i] * b[i];
+    }
+    return sumSq > 0 ? std::sqrt(sumSqDiff / sumSq) : 0;
+}
+
+template <typename T>
+static void Benchmark(const char *typeName, int resolution, int nLookups,
+                      const std::string &filter) {
+    // Create a random texture and _MIPMap_s using each of the filters
+    RNG rng(resolution);
+    std::vector<T> texels(resolution * resolution);
+    for (T &t : texels) t = T(rng.UniformFloat());
+    const Float maxAniso = 16;
+    Point2i res(resolution, resolution);
+    MIPMap<T> trilinear(res, &texels[0], true, maxAniso);
+    MIPMap<T> ewa(res, &texels[0], false, maxAniso);
+    MIPMap<T> aniso(res, &texels[0], false, maxAniso, ImageWrap::Repeat, 8);
+
+    for (Float anisotropy : {1, 2, 4, 8, 16}) {
+        std::vector<Footprint> footprints =
+            GenerateFootprints(nLookups, anisotropy, resolution);
+        std::string prefix =
+            StringPrintf("%s/aniso%d/", typeName, (int)anisotropy);
+        auto report = [&](const std::string &name, const BenchResult &r,
+                          const BenchResult *ref) {
+            printf("%-36s %10.3f Mlookups/s", (prefix + name).c_str(),
+                   r.lookupsPerSecond * 1e-6);
+            if (ref)
+                printf("   rel. RMS vs. EWA %.4f",
+                       RelativeRMS(r.values, ref->values));
+            printf("\n");
+        };
+        auto enabled = [&](const std::string &name) {
+            return (prefix + name).find(filter) != std::string::npos;
+        };
+
+        BenchResult ewaResult = Run(footprints, [&](const Footprint &f) {
+            return Value(ewa.Lookup(f.st, f.dst0, f.dst1));
+        });
+        if (enabled("ewa")) report("ewa", ewaResult, nullptr);
+        if (enabled("ewa-scalar"))
+            report("ewa-scalar", Run(footprints, [&](const Footprint &f) {
+                       return Value(ReferenceLookup(ewa, maxAniso, f.st,
+                                                    f.dst0, f.dst1));
+                   }), &ewaResult);
+        if (enabled("anisotropic"))
+            report("anisotropic", Run(footprints, [&](const Footprint &f) {
+                       return Value(aniso.Lookup(f.st, f.dst0, f.dst1));
+                   }), &ewaResult);
+        if (enabled("trilinear"))
+            report("trilinear", Run(footprints, [&](const Footprint &f) {
+                       return Value(trilinear.Lookup(f.st, f.dst0, f.dst1));
+                   }), &ewaResult);
+    }
+}
+
+static Float MaxDifference(const std::vector<Float> &a,
+                           const std::vector<Float> &b) {
+    Float maxDiff = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        maxDiff = std::max(maxDiff, std::abs(a[i] - b[i]));
+    return maxDiff;
+}
+
+static void NoiseBenchmark(int nEvals, const std::string &filter) {
+    // Generate shading points whose footprints select between 0 and 8
+    // octaves of noise
+    RNG rng;
+    std::vector<SurfaceInteraction> points(nEvals);
+    for (SurfaceInteraction &si : points) {
+        si.p = Point3f(100 * rng.UniformFloat(), 100 * rng.UniformFloat(),
+                       100 * rng.UniformFloat());
+        Float width = std::pow(2.f, -10 * rng.UniformFloat());
+        si.dpdx = Vector3f(width, 0, 0);
+        si.dpdy = Vector3f(0, width, 0);
+    }
+    auto report = [&](const std::string &name, const BenchResult &r,
+                      const BenchResult *ref) {
+        printf("%-36s %10.3f Mevals/s", name.c_str(),
+               r.lookupsPerSecond * 1e-6);
+        if (ref)
+            printf("   max diff. vs. scalar %g",
+                   MaxDifference(r.values, ref->values));
+        printf("\n");
+    };
+    auto enabled = [&](const std::string &name) {
+        return name.find(filter) != std::string::npos;
+    };
+
+    // Compare batched noise evaluation to evaluating one point at a time
+    if (enabled("noise/points")) {
+        std::vector<Point3f> p;
+        for (const SurfaceInteraction &si : points) p.push_back(si.p);
+        BenchResult ref = Run(p, [](const Point3f &p) { return Noise(p); });
+        BenchResult batched;
+        batched.values.resize(p.size());
+        auto start = std::chrono::high_resolution_clock::now();
+        Noise(&p[0], p.size(), &batched.values[0]);
+        auto end = std::chrono::high_resolution_clock::now();
+        Float seconds = std::chrono::duration<Float>(end - start).count();
+        batched.lookupsPerSecond = p.size() / std::max(seconds, (Float)1e-9);
+        report("noise/points-scalar", ref, nullptr);
+        report("noise/points", batched, &ref);
+    }
+
+    const Float omega = .5f;
+    const int octaves = 8;
+    if (enabled("noise/fbm"))
+        report("noise/fbm", Run(points,
+                                [&](const SurfaceInteraction &si) {
+                                    return FBm(si.p, si.dpdx, si.dpdy, omega,
+                                               octaves);
+                                }),
+               nullptr);
+    if (enabled("noise/turbulence"))
+        report("noise/turbulence",
+               Run(points,
+                   [&](const SurfaceInteraction &si) {
+                       return Turbulence(si.p, si.dpdx, si.dpdy, omega,
+                                         octaves);
+                   }),
+               nullptr);
+
+    // Measure the procedural textures that are built on the noise kernels
+    ParamSet empty;
+    std::map<std::string, std::shared_ptr<Texture<Float>>> floatTextures;
+    std::map<std::string, std::shared_ptr<Texture<Spectrum>>> spectrumTextures;
+    TextureParams tp(empty, empty, floatTextures, spectrumTextures);
+    Transform identity;
+    std::unique_ptr<Texture<Float>> fbm(CreateFBmFloatTexture(identity, tp));
+    std::unique_ptr<Texture<Float>> wrinkled(
+        CreateWrinkledFloatTexture(identity, tp));
+    std::unique_ptr<Texture<Float>> windy(
+        CreateWindyFloatTexture(identity, tp));
+    std::unique_ptr<Texture<Spectrum>> marble(
+        CreateMarbleSpectrumTexture(identity, tp));
+    std::pair<const char *, const Texture<Float> *> floatBenchmarks[] = {
+        {"texture/fbm", fbm.get()},
+        {"texture/wrinkled", wrinkled.get()},
+        {"texture/windy", windy.get()}};
+    for (const auto &b : floatBenchmarks)
+        if (enabled(b.first))
+            report(b.first, Run(points,
+                                [&](const SurfaceInteraction &si) {
+                                    return b.second->Evaluate(si);
+                                }),
+                   nullptr);
+    if (enabled("texture/marble"))
+        report("texture/marble", Run(points,
+                                     [&](const SurfaceInteraction &si) {
+                                         return marble->Evaluate(si).y();
+                                     }),
+               nullptr);
+}
+
+int main(int argc, char *argv[]) {
+    int nLookups = 1000000, resolution = 1024;
+    std::string filter;
+    Options opt;
+    opt.quiet = true;
+    for (int i = 1; i < argc; ++i) {
+        auto intArg = [&](const char *name) {
+            if (i + 1 == argc) usage("missing value after %s", name);
+            int v = atoi(argv[++i]);
+            if (v <= 0) usage("%s must be positive", name);
+            return v;
+        };
+        if (!strcmp(argv[i], "--lookups"))
+            nLookups = intArg(argv[i]);
+        else if (!strcmp(argv[i], "--resolution"))
+            resolution = intArg(argv[i]);
+        else if (!strcmp(argv[i], "--filter")) {
+            if (i + 1 == argc) usage("missing string after --filter");
+            filter = argv[++i];
+        } else
+            usage("unknown argument \"%s\"", argv[i]);
+    }
+    pbrtInit(opt);
+
+    Benchmark<Float>("float", resolution, nLookups, filter);
+    Benchmark<RGBSpectrum>("rgb", resolution, nLookups, filter);
+    NoiseBenchmark(nLookups, filter);
+
+    pbrtCleanup();
+    return 0;
+}
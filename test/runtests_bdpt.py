@@ -26,9 +26,9 @@ pt_integrator_di = 'Integrator "path" "integer maxdepth" [1] "string lightsample
 
 reference_integrator = 'Integrator "bdpt" "integer maxdepth" [5] "bool visualizefactors" "false" ' + ' "float clampthreshold" 2.0 '
 
-experiment_sampler = 'Sampler "random" "integer pixelsamples" 8'
-double_sampler = 'Sampler "random" "integer pixelsamples" 16'
-reference_sampler = 'Sampler "random" "integer pixelsamples" 1024'
+experiment_sampler = 'Sampler "zsobol" "integer pixelsamples" 8'
+double_sampler = 'Sampler "zsobol" "integer pixelsamples" 16'
+reference_sampler = 'Sampler "zsobol" "integer pixelsamples" 1024'
 
 moment = ' "string mismod" "moment" '
 variance = ' "string mismod" "reciprocal" '